@@ -0,0 +1,171 @@
+// Asynchronous connection log for the joke server.
+// Each thread appends fixed-size records to its own single-producer ring
+// (no locks, no I/O on the caller's path); a background thread drains all
+// rings, formats the records and writes them out in batches. A full ring
+// drops the record and bumps a counter instead of blocking the session.
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace alog {
+
+enum class Event : uint8_t { CONNECT, FINISH, REJECT };
+
+struct Record {
+    Event    ev;
+    uint32_t ip;            // network byte order, as in sockaddr_in
+    uint16_t port;          // network byte order
+    uint64_t session;
+    uint32_t duration_ms;   // FINISH only
+    uint32_t jokes;         // FINISH: punchlines delivered
+    int32_t  active;        // clients being served after the event
+    int32_t  total;         // FINISH: sessions served, REJECT: clients rejected
+};
+
+class Logger {
+public:
+    static constexpr size_t kRingSize = 512;      // records per thread, power of two
+
+    // Start draining to fd (stdout or an opened log file).
+    void start(int fd){
+        fd_ = fd;
+        running_ = true;
+        th_ = std::thread([this]{ drain_loop(); });
+    }
+
+    // Drain what is left and stop the background thread.
+    void stop(){
+        if (!th_.joinable()) return;
+        running_ = false;
+        th_.join();
+        uint64_t d = dropped();
+        if (d > 0){
+            std::string msg = "[!] log: " + std::to_string(d) + " record(s) dropped (ring full)\n";
+            write_all(msg);
+        }
+    }
+
+    // Called from any thread; never blocks on I/O. False if the record was dropped.
+    bool log(const Record& r){
+        Ring* ring = local_ring();
+        size_t head = ring->head.load(std::memory_order_relaxed);
+        if (head - ring->tail.load(std::memory_order_acquire) == kRingSize){
+            ring->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        ring->slots[head & (kRingSize - 1)] = r;
+        ring->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint64_t dropped(){
+        std::lock_guard<std::mutex> lk(mx_);
+        uint64_t d = 0;
+        for (auto& r : rings_) d += r->dropped.load(std::memory_order_relaxed);
+        return d;
+    }
+
+private:
+    struct Ring {
+        alignas(64) std::atomic<size_t> head{0};  // written by the owning thread
+        alignas(64) std::atomic<size_t> tail{0};  // written by the drain thread
+        std::atomic<uint64_t> dropped{0};
+        std::array<Record, kRingSize> slots;
+    };
+
+    // Rings are shared with the registry so records outlive their thread.
+    Ring* local_ring(){
+        thread_local std::shared_ptr<Ring> ring;
+        if (!ring){
+            ring = std::make_shared<Ring>();
+            std::lock_guard<std::mutex> lk(mx_);
+            rings_.push_back(ring);
+        }
+        return ring.get();
+    }
+
+    void drain_loop(){
+        std::string batch;
+        std::vector<std::shared_ptr<Ring>> rings;
+        while (true){
+            bool last = !running_.load();
+            {
+                std::lock_guard<std::mutex> lk(mx_);
+                if (rings.size() != rings_.size()) rings = rings_;
+            }
+            for (auto& ring : rings){
+                size_t tail = ring->tail.load(std::memory_order_relaxed);
+                size_t head = ring->head.load(std::memory_order_acquire);
+                for (; tail != head; ++tail) format(ring->slots[tail & (kRingSize - 1)], batch);
+                ring->tail.store(tail, std::memory_order_release);
+            }
+            if (!batch.empty()){
+                write_all(batch);
+                batch.clear();
+            } else if (!last){
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            if (last) break;
+        }
+    }
+
+    static void format(const Record& r, std::string& out){
+        char ip[INET_ADDRSTRLEN];
+        in_addr a; a.s_addr = r.ip;
+        inet_ntop(AF_INET, &a, ip, sizeof(ip));
+        char line[256];
+        int n = 0;
+        switch (r.ev){
+        case Event::CONNECT:
+            n = std::snprintf(line, sizeof(line),
+                              "[+] Client %s:%u connected. session=%llu active=%d\n",
+                              ip, ntohs(r.port), (unsigned long long)r.session, r.active);
+            break;
+        case Event::FINISH:
+            n = std::snprintf(line, sizeof(line),
+                              "[-] Client %s:%u finished. session=%llu jokes=%u duration_ms=%u"
+                              " active=%d totalServed=%d\n",
+                              ip, ntohs(r.port), (unsigned long long)r.session, r.jokes,
+                              r.duration_ms, r.active, r.total);
+            break;
+        case Event::REJECT:
+            n = std::snprintf(line, sizeof(line),
+                              "[!] Rejected %s:%u (server saturated, rejected=%d)\n",
+                              ip, ntohs(r.port), r.total);
+            break;
+        }
+        if (n > 0) out.append(line, std::min<size_t>(n, sizeof(line) - 1));
+    }
+
+    void write_all(const std::string& s){
+        const char* p = s.data();
+        size_t left = s.size();
+        while (left > 0){
+            ssize_t n = ::write(fd_, p, left);
+            if (n <= 0) return;
+            p += n; left -= n;
+        }
+    }
+
+    int fd_ = 1;
+    std::atomic<bool> running_{false};
+    std::thread th_;
+    std::mutex mx_;                               // guards rings_ (registration only)
+    std::vector<std::shared_ptr<Ring>> rings_;
+};
+
+} // namespace alog
@@ -0,0 +1,59 @@
+// Connection-rate benchmark for the joke server's accept path.
+// Client threads repeatedly connect, wait for the first prompt and hang
+// up; run it against servers started with different --acceptors counts.
+//
+//   ./server 127.0.0.1 5555 --engine epoll --acceptors 4 --backlog 4096
+//   ./bench/accept_rate_bench 127.0.0.1 5555 [threads] [seconds]
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../line_reader.h"
+
+int main(int argc, char** argv){
+    if (argc < 3){
+        std::fprintf(stderr, "Usage: %s <server_ip> <port> [threads] [seconds]\n", argv[0]);
+        return 1;
+    }
+    sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_port = htons(std::stoi(argv[2]));
+    if (inet_pton(AF_INET, argv[1], &addr.sin_addr) <= 0){ perror("inet_pton"); return 1; }
+    int nthreads = argc > 3 ? std::stoi(argv[3]) : 8;
+    double seconds = argc > 4 ? std::stod(argv[4]) : 5.0;
+
+    std::atomic<bool> stop{false};
+    std::atomic<long> ok{0}, failed{0};
+    std::vector<std::thread> threads;
+    for (int t=0; t<nthreads; ++t){
+        threads.emplace_back([&]{
+            while (!stop){
+                int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+                if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0){
+                    if (fd >= 0) ::close(fd);
+                    failed++;
+                    continue;
+                }
+                LineReader rd(fd);
+                if (rd.read_line()) ok++; else failed++;
+                ::close(fd);
+            }
+        });
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (auto& t : threads) t.join();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::printf("threads=%d  connections=%ld  failed=%ld  %.0f conn/s\n",
+                nthreads, ok.load(), failed.load(), ok / sec);
+    return 0;
+}
@@ -0,0 +1,78 @@
+// Compare the old one-byte recv() line reader with LineReader.
+// A writer thread streams protocol-sized lines over a socketpair; the
+// reader counts recv() calls per line and wall time for each strategy.
+//
+//   ./bench/line_reader_bench [lines] [lines_per_write]
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "../line_reader.h"
+
+static size_t g_byte_reads = 0;
+
+// the previous implementation, instrumented
+static std::optional<std::string> recv_line_bytewise(int fd){
+    std::string buf; buf.reserve(128);
+    char c;
+    while (true){
+        ssize_t n = ::recv(fd, &c, 1, 0);
+        ++g_byte_reads;
+        if (n <= 0) return std::nullopt;
+        if (c == '\n') break;
+        buf.push_back(c);
+        if (buf.size() > 4096) return std::nullopt;
+    }
+    return buf;
+}
+
+static void writer(int fd, size_t lines, size_t per_write){
+    const std::string line = "Server: Would you like to listen to another? (Y/N)\n";
+    std::string burst;
+    for (size_t i=0; i<per_write; ++i) burst += line;
+    for (size_t sent=0; sent<lines; sent+=per_write){
+        const char* p = burst.data(); size_t left = burst.size();
+        while (left > 0){
+            ssize_t n = ::send(fd, p, left, 0);
+            if (n <= 0) return;
+            p += n; left -= n;
+        }
+    }
+    ::shutdown(fd, SHUT_WR);
+}
+
+template <class ReadFn>
+static void run(const char* name, size_t lines, size_t per_write, ReadFn read_all){
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0){ perror("socketpair"); return; }
+    std::thread w(writer, sv[0], lines, per_write);
+    auto t0 = std::chrono::steady_clock::now();
+    auto [got, calls] = read_all(sv[1]);
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    w.join();
+    ::close(sv[0]); ::close(sv[1]);
+    std::printf("%-12s lines=%zu  recv/line=%8.3f  %10.0f lines/s\n",
+                name, got, got ? double(calls) / got : 0.0, got / sec);
+}
+
+int main(int argc, char** argv){
+    size_t lines = argc > 1 ? std::stoul(argv[1]) : 200000;
+    size_t per_write = argc > 2 ? std::stoul(argv[2]) : 2;   // punchline + prompt
+
+    run("byte-recv", lines, per_write, [](int fd){
+        g_byte_reads = 0; size_t got = 0;
+        while (recv_line_bytewise(fd)) ++got;
+        return std::pair<size_t, size_t>(got, g_byte_reads);
+    });
+    run("LineReader", lines, per_write, [](int fd){
+        LineReader rd(fd); size_t got = 0;
+        while (rd.read_line()) ++got;
+        return std::pair<size_t, size_t>(got, rd.reads());
+    });
+    return 0;
+}
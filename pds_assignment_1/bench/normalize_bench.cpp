@@ -0,0 +1,113 @@
+// Microbenchmark: answer matching over the jokes.txt corpus.
+// "old" is the previous normalize()/is_setup_who() pair (three temporary
+// strings per line plus re-normalizing the setup); "new" matches against
+// precomputed answers with norm_equals(). Both must agree on every input.
+//
+//   ./bench/normalize_bench [jokes.txt] [rounds]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../normalize.h"
+
+static std::atomic<size_t> g_allocs{0};
+void* operator new(size_t n){
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace old_impl {
+static std::string trim(const std::string& s){
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+static std::string normalize(const std::string& raw){
+    std::string s = trim(raw);
+    std::string tmp; tmp.reserve(s.size());
+    for (size_t i=0; i<s.size(); ++i){
+        unsigned char a = s[i];
+        if (i+2 < s.size() && a==0xE2 && (unsigned char)s[i+1]==0x80 &&
+           ((unsigned char)s[i+2]==0x98 || (unsigned char)s[i+2]==0x99)) {
+            tmp.push_back('\''); i+=2; continue;
+        }
+        tmp.push_back(s[i]);
+    }
+    std::string collapsed; collapsed.reserve(tmp.size());
+    bool prev_space=false;
+    for(char c: tmp){
+        if (std::isspace((unsigned char)c)){
+            if (!prev_space) collapsed.push_back(' ');
+            prev_space = true;
+        } else { collapsed.push_back(c); prev_space = false; }
+    }
+    std::transform(collapsed.begin(), collapsed.end(), collapsed.begin(),
+                   [](unsigned char c){ return std::tolower(c); });
+    return trim(collapsed);
+}
+static bool is_setup_who(const std::string& in, const std::string& setup){
+    return normalize(in) == normalize(setup) + " who?";
+}
+} // namespace old_impl
+
+struct Case { std::string line; size_t joke; };
+
+int main(int argc, char** argv){
+    const char* path = argc > 1 ? argv[1] : "jokes.txt";
+    size_t rounds = argc > 2 ? std::stoul(argv[2]) : 20000;
+
+    std::vector<std::string> setups, answers;
+    std::ifstream f(path);
+    for (std::string line; std::getline(f, line); ){
+        std::string_view l = trim(line);
+        auto p = l.find('|');
+        if (l.empty() || l[0] == '#' || p == std::string_view::npos) continue;
+        setups.emplace_back(trim(l.substr(0, p)));
+        answers.push_back(normalize(setups.back()) + " who?");
+    }
+    if (setups.empty()){ std::fprintf(stderr, "no jokes in %s\n", path); return 1; }
+
+    // what clients actually type: exact, sloppy, curly-quoted and wrong answers
+    std::vector<Case> cases;
+    for (size_t j=0; j<setups.size(); ++j){
+        std::string up = setups[j];
+        std::transform(up.begin(), up.end(), up.begin(), ::toupper);
+        cases.push_back({setups[j] + " who?", j});
+        cases.push_back({"  " + up + "   WHO?\r", j});
+        cases.push_back({setups[j] + "\t who ?", j});
+        cases.push_back({"Who\xE2\x80\x99s there?", j});
+        cases.push_back({setups[(j + 1) % setups.size()] + " who?", j});
+    }
+
+    size_t mismatches = 0;
+    for (auto& c : cases)
+        if (old_impl::is_setup_who(c.line, setups[c.joke]) != norm_equals(c.line, answers[c.joke]))
+            ++mismatches;
+
+    auto bench = [&](const char* name, auto match){
+        size_t hits = 0;
+        size_t a0 = g_allocs.load();
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t r=0; r<rounds; ++r)
+            for (auto& c : cases) hits += match(c);
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        size_t n = rounds * cases.size();
+        std::printf("%-4s %8.1f ns/line  %6.2f allocs/line  (hits=%zu)\n",
+                    name, sec * 1e9 / n, double(g_allocs.load() - a0) / n, hits);
+    };
+    bench("old", [&](const Case& c){ return old_impl::is_setup_who(c.line, setups[c.joke]); });
+    bench("new", [&](const Case& c){ return norm_equals(c.line, answers[c.joke]); });
+
+    std::printf("jokes=%zu cases=%zu mismatches=%zu\n", setups.size(), cases.size(), mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
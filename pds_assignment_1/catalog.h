@@ -0,0 +1,158 @@
+// Joke catalog in one contiguous arena.
+// The jokes file is read into a scratch buffer and parsed there (a mapping
+// of it would fault with SIGBUS if the file were truncated while a reload
+// parses it); every string a session
+// needs (reply frames and the normalized expected answer) is laid out back
+// to back in a single anonymous mapping, and each joke is a fixed-size
+// record of offsets into it. A catalog is immutable once built; the server
+// publishes new ones by swapping a shared_ptr, so sessions holding the old
+// snapshot keep valid views until they finish.
+#pragma once
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "normalize.h"
+
+// View of one joke; all members point into the owning catalog's arena.
+struct Joke {
+    std::string_view setup, punch;
+    std::string_view answer;        // normalize(setup) + " who?", matched against client lines
+    std::string_view setup_frame;   // "Server: <setup>.\n"
+    std::string_view punch_frame;   // "Server: <punch>\n"
+    std::string_view retry_frame;   // correction after a wrong "<setup> who?"
+};
+
+class Catalog {
+public:
+    ~Catalog(){ if (arena_) munmap(arena_, arena_len_); }
+    Catalog(const Catalog&) = delete;
+    Catalog& operator=(const Catalog&) = delete;
+
+    size_t size() const { return recs_.size(); }
+
+    Joke operator[](size_t i) const {
+        const Rec& r = recs_[i];
+        std::string_view setup_frame = view(r.setup_frame);
+        std::string_view punch_frame = view(r.punch_frame);
+        return Joke{ setup_frame.substr(kPrefix.size(), setup_frame.size() - kPrefix.size() - 2),
+                     punch_frame.substr(kPrefix.size(), punch_frame.size() - kPrefix.size() - 1),
+                     view(r.answer), setup_frame, punch_frame, view(r.retry_frame) };
+    }
+
+    size_t arena_bytes() const { return arena_len_; }
+
+    // Parse "Setup|Punchline" lines ('#' comments and blank lines skipped).
+    // Throws std::runtime_error if the file is unreadable or too small.
+    static std::shared_ptr<const Catalog> load(const std::string& path){
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw std::runtime_error("Failed to open jokes file: " + path);
+        // read to EOF: the file may grow or shrink while it is being replaced
+        struct stat st{};
+        std::string buf(fstat(fd, &st) == 0 && st.st_size > 0 ? st.st_size : 4096, '\0');
+        size_t flen = 0;
+        for (;;){
+            if (flen == buf.size()) buf.resize(buf.size() * 2);
+            ssize_t n = ::read(fd, &buf[flen], buf.size() - flen);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0){
+                ::close(fd);
+                throw std::runtime_error("Failed to read jokes file: " + path);
+            }
+            if (n == 0) break;
+            flen += n;
+        }
+        ::close(fd);
+        if (flen == 0) throw std::runtime_error("Failed to read jokes file: " + path);
+
+        // pass 1: find the jokes and size the arena
+        std::string_view text(buf.data(), flen);
+        std::vector<std::pair<std::string_view, std::string_view>> parsed;
+        size_t bytes = 0;
+        while (!text.empty()){
+            size_t nl = text.find('\n');
+            std::string_view l = trim(text.substr(0, nl));
+            text = nl == std::string_view::npos ? std::string_view() : text.substr(nl + 1);
+            if (l.empty() || l[0] == '#') continue;
+            auto p = l.find('|');
+            if (p == std::string_view::npos) continue;   // enforce Setup|Punchline
+            std::string_view setup = trim(l.substr(0, p)), punch = trim(l.substr(p + 1));
+            if (setup.empty() || punch.empty()) continue;
+            parsed.emplace_back(setup, punch);
+            bytes += kPrefix.size() + setup.size() + 2
+                   + kPrefix.size() + punch.size() + 1
+                   + kRetryHead.size() + setup.size() + kRetryTail.size()
+                   + setup.size() + kWho.size();     // normalizing never grows the text
+        }
+        if (parsed.size() < 15){
+            throw std::runtime_error("Need at least 15 jokes in jokes.txt (have " +
+                                     std::to_string(parsed.size()) + ")");
+        }
+
+        // pass 2: lay the frames out in the arena
+        std::shared_ptr<Catalog> cat(new Catalog);
+        cat->arena_len_ = bytes;
+        void* arena = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (arena == MAP_FAILED){
+            throw std::runtime_error("Out of memory building joke catalog");
+        }
+        cat->arena_ = static_cast<char*>(arena);
+        cat->recs_.reserve(parsed.size());
+        uint32_t pos = 0;
+        for (auto& [setup, punch] : parsed){
+            Rec r;
+            r.setup_frame = cat->put(pos, {kPrefix, setup, ".\n"});
+            r.punch_frame = cat->put(pos, {kPrefix, punch, "\n"});
+            r.retry_frame = cat->put(pos, {kRetryHead, setup, kRetryTail});
+            r.answer.off = pos;
+            NormCursor cur(setup);
+            for (char c; cur.next(c); ) cat->arena_[pos++] = c;
+            std::memcpy(cat->arena_ + pos, kWho.data(), kWho.size());
+            pos += kWho.size();
+            r.answer.len = pos - r.answer.off;
+            cat->recs_.push_back(r);
+        }
+        mprotect(cat->arena_, bytes, PROT_READ);
+        return cat;
+    }
+
+private:
+    static constexpr std::string_view kPrefix = "Server: ";
+    static constexpr std::string_view kRetryHead = "Server: You are supposed to say, \"";
+    static constexpr std::string_view kRetryTail = " who?\" Let’s try again.\n";
+    static constexpr std::string_view kWho = " who?";
+
+    struct Span { uint32_t off, len; };
+    struct Rec { Span setup_frame, punch_frame, retry_frame, answer; };
+
+    Catalog() = default;
+
+    std::string_view view(Span s) const { return std::string_view(arena_ + s.off, s.len); }
+
+    Span put(uint32_t& pos, std::initializer_list<std::string_view> parts){
+        Span s{pos, 0};
+        for (auto part : parts){
+            std::memcpy(arena_ + pos, part.data(), part.size());
+            pos += part.size();
+        }
+        s.len = pos - s.off;
+        return s;
+    }
+
+    char* arena_ = nullptr;
+    size_t arena_len_ = 0;
+    std::vector<Rec> recs_;
+};
@@ -1,14 +1,27 @@
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
 #include <algorithm>
+#include <array>
 #include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
 #include <iostream>
+#include <memory>
 #include <optional>
+#include <random>
 #include <string>
+#include <thread>
+#include <vector>
+
+#include "line_reader.h"
+
 // here is a simple TCP client implementation
 static std::string trim(const std::string& s){
     size_t b = s.find_first_not_of(" \t\r\n");
@@ -17,19 +30,6 @@ static std::string trim(const std::string& s){
     return s.substr(b, e - b + 1);
 }
 
-static std::optional<std::string> recv_line(int fd){
-    std::string buf; buf.reserve(128);
-    char c;
-    while (true){
-        ssize_t n = ::recv(fd, &c, 1, 0);
-        if (n <= 0) return std::nullopt;
-        if (c == '\n') break;
-        buf.push_back(c);
-        if (buf.size() > 4096) return std::nullopt;
-    }
-    return buf;
-}
-
 static bool send_all(int fd, const std::string& msg){
     const char* p = msg.c_str();
     size_t left = msg.size();
@@ -41,31 +41,285 @@ static bool send_all(int fd, const std::string& msg){
     return true;
 }
 
+// ----------------------- load generator -----------------------
+// --load mode: many non-blocking connections per thread, each playing the
+// protocol automatically and timing every request/reply step.
+
+using Clock = std::chrono::steady_clock;
+
+// Log-linear latency histogram in microseconds: 16 sub-buckets per power
+// of two, so percentiles are accurate to ~6%.
+struct Histogram {
+    std::array<uint64_t, 64 * 16> buckets{};
+    uint64_t count = 0;
+
+    static size_t index(uint64_t us){
+        if (us < 16) return us;
+        int e = 63 - __builtin_clzll(us);                  // e >= 4
+        return size_t(e - 3) * 16 + ((us >> (e - 4)) & 15);
+    }
+    static uint64_t upper(size_t idx){
+        if (idx < 16) return idx;
+        int e = int(idx / 16) + 3;
+        return ((16 + idx % 16 + 1) << (e - 4)) - 1;
+    }
+    void add(uint64_t us){ buckets[index(us)]++; count++; }
+    void merge(const Histogram& o){
+        for (size_t i=0; i<buckets.size(); ++i) buckets[i] += o.buckets[i];
+        count += o.count;
+    }
+    uint64_t percentile(double q) const {
+        uint64_t want = uint64_t(q * count + 0.5), seen = 0;
+        if (want == 0) want = 1;
+        for (size_t i=0; i<buckets.size(); ++i){
+            seen += buckets[i];
+            if (seen >= want) return upper(i);
+        }
+        return 0;
+    }
+};
+
+// What the connection is waiting for; each is one timed protocol step.
+enum class Step { CONNECT, WHO, SETUP, RETRY, NEXT, BYE, COUNT };
+static const char* const kStepNames[] = { "connect", "who", "setup", "retry", "next", "bye" };
+
+struct LoadOptions {
+    int conns = 100;             // concurrent connections (total)
+    int threads = 1;
+    double seconds = 10;
+    int jokes_per_session = 2;   // answer "Y" this many times minus one, then "N"
+    double wrong_rate = 0;       // chance of a wrong answer at each prompt
+};
+
+struct LoadStats {
+    std::array<Histogram, size_t(Step::COUNT)> steps;
+    uint64_t sessions = 0, errors = 0;
+    void merge(const LoadStats& o){
+        for (size_t i=0; i<steps.size(); ++i) steps[i].merge(o.steps[i]);
+        sessions += o.sessions; errors += o.errors;
+    }
+};
+
+struct LoadConn {
+    int fd = -1;
+    LineReader rd;
+    Step step = Step::CONNECT;
+    int lines_left = 0;          // reply lines still expected for this step
+    Clock::time_point sent;      // when the step's request went out
+    std::string setup;
+    int told = 0;
+};
+
+class LoadWorker {
+public:
+    LoadWorker(const sockaddr_in& addr, const LoadOptions& opt, int nconns, uint64_t seed)
+        : addr_(addr), opt_(opt), conns_(nconns), rng_(seed) {}
+
+    void run(Clock::time_point deadline){
+        epfd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epfd_ < 0){ perror("epoll_create1"); return; }
+        for (auto& c : conns_) open(c);
+
+        std::vector<epoll_event> events(256);
+        while (Clock::now() < deadline){
+            int n = epoll_wait(epfd_, events.data(), (int)events.size(), 100);
+            for (int i=0; i<n; ++i){
+                LoadConn& c = *static_cast<LoadConn*>(events[i].data.ptr);
+                if (!on_readable(c)) reopen(c);
+            }
+        }
+        for (auto& c : conns_) if (c.fd >= 0) ::close(c.fd);
+        ::close(epfd_);
+    }
+
+    const LoadStats& stats() const { return stats_; }
+
+private:
+    void open(LoadConn& c){
+        c.fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (c.fd < 0){ stats_.errors++; return; }
+        c.rd.reset(c.fd);
+        c.told = 0;
+        c.sent = Clock::now();
+        expect(c, Step::CONNECT, 1);
+        if (::connect(c.fd, (const sockaddr*)&addr_, sizeof(addr_)) < 0 && errno != EINPROGRESS){
+            ::close(c.fd); c.fd = -1; stats_.errors++; return;
+        }
+        epoll_event ev{}; ev.events = EPOLLIN | EPOLLRDHUP; ev.data.ptr = &c;
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, c.fd, &ev);
+    }
+
+    void reopen(LoadConn& c){
+        if (c.fd >= 0) ::close(c.fd);       // also removes it from the epoll set
+        c.fd = -1;
+        open(c);
+    }
+
+    void expect(LoadConn& c, Step step, int lines){ c.step = step; c.lines_left = lines; }
+
+    bool send_line(LoadConn& c, const std::string& line, Step step, int lines){
+        c.sent = Clock::now();
+        expect(c, step, lines);
+        return ::send(c.fd, line.data(), line.size(), MSG_NOSIGNAL) == (ssize_t)line.size();
+    }
+
+    bool wrong(){ return opt_.wrong_rate > 0 && coin_(rng_) < opt_.wrong_rate; }
+
+    bool ask_who(LoadConn& c){
+        if (wrong()) return send_line(c, "Who is it?\n", Step::RETRY, 2);
+        return send_line(c, "Who's there?\n", Step::WHO, 1);
+    }
+
+    // A BYE step ends at EOF; everything else ends after lines_left lines.
+    bool on_readable(LoadConn& c){
+        while (true){
+            std::string_view line;
+            while (c.rd.pop_line(line)){
+                if (--c.lines_left > 0) continue;
+                if (!on_reply(c, trim(std::string(line)))) return false;
+            }
+            switch (c.rd.fill()){
+            case LineReader::Fill::DATA:   continue;
+            case LineReader::Fill::AGAIN:  return true;
+            case LineReader::Fill::CLOSED:
+                if (c.step != Step::BYE){ stats_.errors++; return false; }
+                record(c);
+                stats_.sessions++;
+                return false;             // reconnect for the next session
+            }
+        }
+    }
+
+    void record(const LoadConn& c){
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - c.sent).count();
+        stats_.steps[size_t(c.step)].add(uint64_t(us));
+    }
+
+    // Last expected line of the current step has arrived.
+    bool on_reply(LoadConn& c, const std::string& last){
+        record(c);
+        switch (c.step){
+        case Step::CONNECT:
+        case Step::RETRY:
+            return ask_who(c);
+        case Step::WHO:
+            // "Server: <setup>."
+            if (last.size() < 10 || last.compare(0, 8, "Server: ") != 0){ stats_.errors++; return false; }
+            c.setup = last.substr(8, last.size() - 9);
+            if (wrong()) return send_line(c, "Nobody who?\n", Step::RETRY, 2);
+            return send_line(c, c.setup + " who?\n", Step::SETUP, 2);
+        case Step::SETUP:
+            if (++c.told < opt_.jokes_per_session) return send_line(c, "Y\n", Step::NEXT, 1);
+            return send_line(c, "N\n", Step::BYE, 0);
+        case Step::NEXT:
+            if (last.find("no more jokes") != std::string::npos){ expect(c, Step::BYE, 0); return true; }
+            return ask_who(c);
+        default:
+            stats_.errors++;
+            return false;
+        }
+    }
+
+    sockaddr_in addr_;
+    LoadOptions opt_;
+    std::vector<LoadConn> conns_;
+    std::mt19937_64 rng_;
+    std::uniform_real_distribution<double> coin_{0.0, 1.0};
+    int epfd_ = -1;
+    LoadStats stats_;
+};
+
+static int run_load(const sockaddr_in& addr, const LoadOptions& opt){
+    rlimit rl{};
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max){
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    std::vector<std::unique_ptr<LoadWorker>> workers;
+    std::random_device rd;
+    for (int t=0; t<opt.threads; ++t){
+        int n = opt.conns / opt.threads + (t < opt.conns % opt.threads ? 1 : 0);
+        workers.push_back(std::make_unique<LoadWorker>(addr, opt, n, (uint64_t(rd()) << 32) ^ rd()));
+    }
+
+    std::cout << "[*] Load: " << opt.conns << " connection(s) on " << opt.threads
+              << " thread(s) for " << opt.seconds << " s, " << opt.jokes_per_session
+              << " joke(s)/session, wrong-rate " << opt.wrong_rate << "\n" << std::flush;
+
+    auto start = Clock::now();
+    auto deadline = start + std::chrono::duration_cast<Clock::duration>(
+                                std::chrono::duration<double>(opt.seconds));
+    std::vector<std::thread> threads;
+    for (auto& w : workers) threads.emplace_back([&w, deadline]{ w->run(deadline); });
+    for (auto& t : threads) t.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    LoadStats total;
+    for (auto& w : workers) total.merge(w->stats());
+
+    std::printf("sessions=%llu  errors=%llu  %.1f sessions/s\n",
+                (unsigned long long)total.sessions, (unsigned long long)total.errors,
+                total.sessions / elapsed);
+    std::printf("%-8s %10s %10s %10s %10s\n", "step", "count", "p50(us)", "p99(us)", "p999(us)");
+    for (size_t i=0; i<total.steps.size(); ++i){
+        const Histogram& h = total.steps[i];
+        if (h.count == 0) continue;
+        std::printf("%-8s %10llu %10llu %10llu %10llu\n", kStepNames[i],
+                    (unsigned long long)h.count, (unsigned long long)h.percentile(0.50),
+                    (unsigned long long)h.percentile(0.99), (unsigned long long)h.percentile(0.999));
+    }
+    return total.errors == 0 ? 0 : 2;
+}
+
+// ----------------------- interactive client -----------------------
 int main(int argc, char** argv){
     if (argc < 3){
-        std::cerr << "Usage: " << argv[0] << " <server_ip> <port>\n";
+        std::cerr << "Usage: " << argv[0] << " <server_ip> <port>"
+                  << " [--load [--conns N] [--threads N] [--duration SEC]"
+                  << " [--jokes-per-session N] [--wrong-rate P]]\n";
         return 1;
     }
     std::string ip = argv[1];
     int port = std::stoi(argv[2]);
 
-    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
-    if (fd < 0){ perror("socket"); return 1; }
+    bool load = false;
+    LoadOptions opt;
+    for (int i=3; i<argc; ++i){
+        std::string a = argv[i];
+        if (a == "--load")                                 load = true;
+        else if (a == "--conns" && i+1 < argc)             opt.conns = std::stoi(argv[++i]);
+        else if (a == "--threads" && i+1 < argc)           opt.threads = std::stoi(argv[++i]);
+        else if (a == "--duration" && i+1 < argc)          opt.seconds = std::stod(argv[++i]);
+        else if (a == "--jokes-per-session" && i+1 < argc) opt.jokes_per_session = std::stoi(argv[++i]);
+        else if (a == "--wrong-rate" && i+1 < argc)        opt.wrong_rate = std::stod(argv[++i]);
+    }
+    if (opt.conns < 1 || opt.threads < 1 || opt.jokes_per_session < 1){
+        std::cerr << "--conns, --threads and --jokes-per-session must be >= 1\n";
+        return 1;
+    }
+    opt.threads = std::min(opt.threads, opt.conns);
 
     sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_port = htons(port);
     if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) <= 0){
         perror("inet_pton"); return 1;
     }
+    if (load) return run_load(addr, opt);
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0){ perror("socket"); return 1; }
+
     if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0){
         perror("connect"); return 1;
     }
 
     std::cout << "[*] Connected to " << ip << ":" << port << "\n";
 
+    LineReader rd(fd);
     while (true){
-        auto line = recv_line(fd);
+        auto line = rd.read_line();
         if (!line) break;                 // server closed
-        std::string msg = trim(*line);
+        std::string msg = trim(std::string(*line));
         if (msg.empty()) continue;
 
         std::cout << msg << "\n";
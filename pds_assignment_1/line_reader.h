@@ -0,0 +1,82 @@
+// Buffered, per-connection line reader shared by server and client.
+// Pulls large chunks off the socket and splits lines in user space, so a
+// protocol line costs one recv() instead of one per byte.
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+class LineReader {
+public:
+    static constexpr size_t kMaxLine = 4096;       // longest accepted line (guard)
+    static constexpr size_t kChunk = 2 * kMaxLine; // buffer size / largest single recv()
+
+    enum class Fill { DATA, AGAIN, CLOSED };
+
+    explicit LineReader(int fd = -1) : fd_(fd) {}
+
+    void reset(int fd){ fd_ = fd; head_ = tail_ = 0; reads_ = 0; }
+
+    // Next complete buffered line without the '\n'; the view stays valid
+    // until the next fill(). Returns false if no full line is buffered.
+    bool pop_line(std::string_view& line){
+        if (head_ == tail_) return false;
+        const char* b = buf_.get() + head_;
+        const char* nl = static_cast<const char*>(std::memchr(b, '\n', tail_ - head_));
+        if (!nl) return false;
+        line = std::string_view(b, nl - b);
+        head_ += line.size() + 1;
+        return true;
+    }
+
+    // True if a partial line has outgrown the guard.
+    bool overflow() const { return tail_ - head_ > kMaxLine; }
+
+    // Drop the buffer while nothing is pending, so idle connections
+    // in the event-loop engine hold no read memory.
+    void release_if_idle(){ if (head_ == tail_){ buf_.reset(); head_ = tail_ = 0; } }
+
+    // One recv() into the free tail of the buffer.
+    Fill fill(){
+        if (!buf_) buf_.reset(new char[kChunk]);
+        if (head_ == tail_) head_ = tail_ = 0;
+        else if (tail_ == kChunk){
+            std::memmove(buf_.get(), buf_.get() + head_, tail_ - head_);
+            tail_ -= head_; head_ = 0;
+        }
+        while (true){
+            ssize_t n = ::recv(fd_, buf_.get() + tail_, kChunk - tail_, 0);
+            ++reads_;
+            if (n > 0){ tail_ += n; return Fill::DATA; }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return Fill::AGAIN;
+            return Fill::CLOSED;
+        }
+    }
+
+    // Blocking read of one line; nullopt on close/error or an over-long line.
+    std::optional<std::string_view> read_line(){
+        std::string_view line;
+        while (!pop_line(line)){
+            if (overflow()) return std::nullopt;    // guard
+            if (fill() != Fill::DATA) return std::nullopt;
+        }
+        if (line.size() > kMaxLine) return std::nullopt;
+        return line;
+    }
+
+    size_t reads() const { return reads_; }       // recv() calls so far
+
+private:
+    int fd_;
+    size_t head_ = 0, tail_ = 0;
+    size_t reads_ = 0;
+    std::unique_ptr<char[]> buf_;
+};
@@ -0,0 +1,68 @@
+// Answer normalization for the knock-knock protocol.
+// Normalized text is trimmed, lowercased, has whitespace runs collapsed to
+// one space and curly apostrophes (U+2018/U+2019) mapped to ASCII '.
+// NormCursor produces that text one character at a time straight from the
+// input, so matching a client line never allocates.
+#pragma once
+
+#include <cctype>
+#include <string>
+#include <string_view>
+
+inline bool is_space(char c){ return std::isspace((unsigned char)c); }
+
+inline std::string_view trim(std::string_view s){
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string_view::npos) return {};
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+class NormCursor {
+public:
+    explicit NormCursor(std::string_view s) : p_(s.data()), end_(s.data() + s.size()) {
+        while (p_ < end_ && is_space(*p_)) ++p_;
+        while (end_ > p_ && is_space(end_[-1])) --end_;
+    }
+
+    // Next normalized character; false at the end.
+    bool next(char& c){
+        if (p_ == end_) return false;
+        if (is_space(*p_)){
+            while (is_space(*p_)) ++p_;         // trailing space was trimmed, so this stops
+            c = ' ';
+            return true;
+        }
+        if (end_ - p_ >= 3 && (unsigned char)p_[0] == 0xE2 && (unsigned char)p_[1] == 0x80 &&
+            ((unsigned char)p_[2] == 0x98 || (unsigned char)p_[2] == 0x99)){
+            p_ += 3;
+            c = '\'';
+            return true;
+        }
+        c = (char)std::tolower((unsigned char)*p_++);
+        return true;
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+};
+
+// Materialized form, for precomputing expected answers at load time.
+inline std::string normalize(std::string_view raw){
+    std::string out; out.reserve(raw.size());
+    NormCursor cur(raw);
+    for (char c; cur.next(c); ) out.push_back(c);
+    return out;
+}
+
+// normalize(raw) == want, in one pass and without allocating.
+// `want` must already be normalized.
+inline bool norm_equals(std::string_view raw, std::string_view want){
+    NormCursor cur(raw);
+    char c;
+    for (char w : want){
+        if (!cur.next(c) || c != w) return false;
+    }
+    return !cur.next(c);
+}
@@ -0,0 +1,68 @@
+// Lazily evaluated random permutation of [0, n).
+// A keyed 4-round Feistel network is a bijection on a 2^(2h)-element
+// domain (the smallest one >= n); cycle-walking folds it onto [0, n). Each
+// session stores only n and a key, and computes the i-th joke index when
+// it is actually asked for, instead of shuffling the whole catalog up front.
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <thread>
+
+// SplitMix64 step: advances state and returns a well-mixed 64-bit value.
+inline uint64_t splitmix64(uint64_t& state){
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Cheap per-thread random key; random_device is only read once per thread.
+inline uint64_t thread_random_u64(){
+    thread_local uint64_t state = [] {
+        std::random_device rd;
+        uint64_t seed = (uint64_t(rd()) << 32) ^ rd();
+        return seed ^ std::hash<std::thread::id>{}(std::this_thread::get_id());
+    }();
+    return splitmix64(state);
+}
+
+class LazyPermutation {
+public:
+    LazyPermutation() = default;
+
+    LazyPermutation(uint32_t n, uint64_t key) : n_(n), key_(key) {
+        half_bits_ = 1;
+        while ((uint64_t(1) << (2 * half_bits_)) < n) ++half_bits_;
+        mask_ = (uint32_t(1) << half_bits_) - 1;
+    }
+
+    uint32_t size() const { return n_; }
+
+    // i-th element of the permutation, i < size(). Expected < 4 Feistel
+    // evaluations since the domain is less than 4n.
+    uint32_t operator[](uint32_t i) const {
+        uint32_t x = i;
+        do { x = encrypt(x); } while (x >= n_);
+        return x;
+    }
+
+private:
+    uint32_t encrypt(uint32_t x) const {
+        uint32_t l = x >> half_bits_, r = x & mask_;
+        for (uint64_t round = 0; round < 4; ++round){
+            uint64_t st = key_ ^ (round << 32 | r);
+            uint32_t f = uint32_t(splitmix64(st)) & mask_;
+            uint32_t nl = r;
+            r = l ^ f;
+            l = nl;
+        }
+        return (l << half_bits_) | r;
+    }
+
+    uint32_t n_ = 0;
+    unsigned half_bits_ = 1;
+    uint32_t mask_ = 1;
+    uint64_t key_ = 0;
+};
@@ -1,26 +1,50 @@
 
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
-#include <sys/select.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <algorithm>
 #include <atomic>
 #include <cctype>
+#include <chrono>
+#include <condition_variable>
 #include <csignal>
-#include <fstream>
+#include <deque>
 #include <iostream>
+#include <memory>
 #include <mutex>
-#include <numeric>
 #include <optional>
-#include <random>
-#include <sstream>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <unordered_set>
 #include <vector>
 
-struct Joke { std::string setup, punch; };
+#include "async_log.h"
+#include "catalog.h"
+#include "line_reader.h"
+#include "normalize.h"
+#include "permutation.h"
+
+// A reply is a list of views into frames that live as long as the session's
+// catalog snapshot (or are literals), so building one copies nothing and it
+// goes out in one sendmsg().
+using Frames = std::vector<std::string_view>;
+
+static constexpr std::string_view kKnockFrame = "Server: Knock knock!\n";
+static constexpr std::string_view kPromptFrame = "Server: Would you like to listen to another? (Y/N)\n";
+static constexpr std::string_view kRetryWhoFrame =
+    "Server: You are supposed to say, \"Who’s there?\" Let’s try again.\n";
+static constexpr std::string_view kNoMoreFrame = "Server: I have no more jokes to tell.\n";
 
 // ----------------------- globals & helpers -----------------------
 static std::atomic<bool> g_running{true};
@@ -28,195 +52,493 @@ static std::atomic<int>  g_active{0};          // clients currently being served
 static std::atomic<int>  g_served_sessions{0}; // total finished sessions
 static int  g_expected_sessions = -1;          // optional: auto-exit after N sessions
 static int  g_idle_exit_ms = -1;               // optional: auto-exit when idle this long
-static std::mutex g_logmx;
+static std::string g_engine = "thread";        // "thread" (one per client) or "epoll"
+static int  g_loops = 0;                       // epoll engine: event-loop threads (0 = #cores)
+static int  g_max_workers = 256;               // thread engine: session threads
+static int  g_max_queue = 1024;                // thread engine: accepted clients waiting for a thread
+static std::atomic<int> g_rejected{0};         // clients turned away while saturated
+static int  g_acceptors = 1;                   // listening sockets / acceptor threads
+static int  g_backlog = 64;                    // listen() backlog per socket
+static int  g_wakefd = -1;                     // eventfd: wakes main on session end / SIGINT
+static std::atomic<uint64_t> g_next_session{1};
+static std::string g_log_path;                 // optional: log file instead of stdout
+static alog::Logger g_log;
+
+static void wake_main(){
+    uint64_t one = 1; (void)!::write(g_wakefd, &one, sizeof(one));
+}
 
-static void sigint_handler(int){ g_running = false; }
+static void sigint_handler(int){ g_running = false; wake_main(); }
+
+// Send frames[head..] with one sendmsg() per IOV batch, advancing head/off
+// past what the kernel took. Stops early (returning true) on EAGAIN for
+// non-blocking sockets; false on a hard error.
+static bool send_frames(int fd, const Frames& f, size_t& head, size_t& off){
+    constexpr int kMaxIov = 64;
+    while (head < f.size()){
+        iovec iov[kMaxIov];
+        int n = 0;
+        for (size_t i = head; i < f.size() && n < kMaxIov; ++i, ++n){
+            size_t skip = (i == head) ? off : 0;
+            iov[n].iov_base = const_cast<char*>(f[i].data() + skip);
+            iov[n].iov_len = f[i].size() - skip;
+        }
+        msghdr msg{};
+        msg.msg_iov = iov; msg.msg_iovlen = n;
+        ssize_t sent = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (sent <= 0) return false;
+        for (size_t left = sent; left > 0; ){
+            size_t avail = f[head].size() - off;
+            if (left < avail){ off += left; break; }
+            left -= avail; ++head; off = 0;
+        }
+    }
+    return true;
+}
 
-static std::string trim(const std::string& s){
-    size_t b = s.find_first_not_of(" \t\r\n");
-    if (b == std::string::npos) return "";
-    size_t e = s.find_last_not_of(" \t\r\n");
-    return s.substr(b, e - b + 1);
+static bool is_whos_there(std::string_view in){
+    return norm_equals(in, "who's there?") || norm_equals(in, "whos there?");
+}
+static bool is_setup_who(std::string_view in, const Joke& J){
+    return norm_equals(in, J.answer);
+}
+static bool is_yes(std::string_view in){
+    return norm_equals(in, "y") || norm_equals(in, "yes");
 }
 
-// send an entire string
-static bool send_all(int fd, const std::string& msg){
-    const char* p = msg.c_str();
-    size_t left = msg.size();
-    while (left > 0){
-        ssize_t n = ::send(fd, p, left, 0);
-        if (n <= 0) return false;
-        p += n; left -= n;
+// ----------------------- joke catalog -----------------------
+// Sessions take a snapshot of g_catalog when they start; a reload publishes
+// a new catalog and the old one is freed when its last session ends.
+static std::shared_ptr<const Catalog> g_catalog;
+static std::string g_jokes_path = "jokes.txt";
+static std::atomic<bool> g_reload{false};      // SIGHUP or file change: reload the jokes file
+static int  g_watchfd = -1;                    // inotify on the jokes file's directory
+
+static void sighup_handler(int){ g_reload = true; wake_main(); }
+
+static std::shared_ptr<const Catalog> current_catalog(){
+    return std::atomic_load(&g_catalog);
+}
+
+// Rebuild the catalog from disk; on failure keep serving the old one.
+static void reload_catalog(){
+    try {
+        auto cat = Catalog::load(g_jokes_path);
+        std::atomic_store(&g_catalog, cat);
+        std::cout << "[*] Reloaded " << g_jokes_path << " (jokes=" << cat->size() << ")\n" << std::flush;
+    } catch (const std::exception& e){
+        std::cerr << "[!] Reload failed, keeping previous jokes: " << e.what() << "\n";
     }
-    return true;
 }
 
-// receive one line (up to '\n'), returns nullopt on close/error
-static std::optional<std::string> recv_line(int fd){
-    std::string buf; buf.reserve(128);
-    char c;
-    while (true){
-        ssize_t n = ::recv(fd, &c, 1, 0);
-        if (n <= 0) return std::nullopt;
-        if (c == '\n') break;
-        buf.push_back(c);
-        if (buf.size() > 4096) return std::nullopt; // guard
+// Watch the directory rather than the file: editors usually replace it.
+static int watch_jokes_file(){
+    std::string dir = ".";
+    auto slash = g_jokes_path.rfind('/');
+    if (slash != std::string::npos) dir = slash == 0 ? "/" : g_jokes_path.substr(0, slash);
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return -1;
+    if (inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0){
+        ::close(fd); return -1;
     }
-    return buf;
+    return fd;
 }
 
-// Normalize: trim, lowercase, collapse spaces, curly apostrophe → ASCII '
-static std::string normalize(const std::string& raw){
-    std::string s = trim(raw);
-
-    // map U+2018/U+2019 to ASCII '
-    std::string tmp; tmp.reserve(s.size());
-    for (size_t i=0; i<s.size(); ++i){
-        unsigned char a = s[i];
-        if (i+2 < s.size() && a==0xE2 && (unsigned char)s[i+1]==0x80 &&
-           ((unsigned char)s[i+2]==0x98 || (unsigned char)s[i+2]==0x99)) {
-            tmp.push_back('\''); i+=2; continue;
+// Drain pending inotify events; true if one names the jokes file.
+static bool jokes_file_changed(int watchfd){
+    std::string base = g_jokes_path.substr(g_jokes_path.rfind('/') + 1);
+    bool hit = false;
+    alignas(inotify_event) char buf[4096];
+    ssize_t n;
+    while ((n = ::read(watchfd, buf, sizeof(buf))) > 0){
+        for (char* p = buf; p < buf + n; ){
+            auto* ev = reinterpret_cast<inotify_event*>(p);
+            if (ev->len && base == ev->name) hit = true;
+            p += sizeof(inotify_event) + ev->len;
         }
-        tmp.push_back(s[i]);
     }
+    return hit;
+}
 
-    // collapse spaces
-    std::string collapsed; collapsed.reserve(tmp.size());
-    bool prev_space=false;
-    for(char c: tmp){
-        if (std::isspace((unsigned char)c)){
-            if (!prev_space) collapsed.push_back(' ');
-            prev_space = true;
-        } else { collapsed.push_back(c); prev_space = false; }
-    }
+// ----------------------- session protocol -----------------------
+enum class State { WAIT_WHO, WAIT_WHO_SETUP, WAIT_CONTINUE };
 
-    std::transform(collapsed.begin(), collapsed.end(), collapsed.begin(),
-                   [](unsigned char c){ return std::tolower(c); });
-    return trim(collapsed);
+// Protocol state of one client, independent of how its socket is driven.
+struct Session {
+    std::shared_ptr<const Catalog> cat;   // snapshot this session tells jokes from
+    LazyPermutation order;    // per-client random order; no repetition within session
+    size_t idx = 0;
+    State st = State::WAIT_WHO;
+
+    uint64_t id = 0;          // for the log
+    sockaddr_in peer{};
+    std::chrono::steady_clock::time_point started;
+    unsigned told = 0;        // punchlines delivered
+};
+
+// Pick a random joke order and queue the first prompt.
+static void session_begin(Session& s, const sockaddr_in& peer, Frames& out){
+    s.id = g_next_session++;
+    s.peer = peer;
+    s.started = std::chrono::steady_clock::now();
+    s.told = 0;
+    s.cat = current_catalog();
+    s.order = LazyPermutation((uint32_t)s.cat->size(), thread_random_u64());
+    s.idx = 0;
+    s.st = State::WAIT_WHO;
+    out.push_back(kKnockFrame);
 }
 
-static bool is_whos_there(const std::string& in){
-    std::string s = normalize(in);
-    return (s == "who's there?" || s == "whos there?");
+// Feed one trimmed, non-empty client line; reply frames are appended to `out`.
+// Returns false when the session is over (out may still hold a final message).
+static bool session_step(Session& s, std::string_view in, Frames& out){
+    const Joke J = (*s.cat)[ s.order[s.idx] ];
+
+    switch (s.st){
+    case State::WAIT_WHO:
+        if (!is_whos_there(in)){
+            out.push_back(kRetryWhoFrame);
+            out.push_back(kKnockFrame);
+            return true;
+        }
+        out.push_back(J.setup_frame);
+        s.st = State::WAIT_WHO_SETUP;
+        return true;
+
+    case State::WAIT_WHO_SETUP:
+        if (!is_setup_who(in, J)){
+            out.push_back(J.retry_frame);
+            out.push_back(kKnockFrame);
+            s.st = State::WAIT_WHO;
+            return true;
+        }
+        out.push_back(J.punch_frame);
+        out.push_back(kPromptFrame);
+        s.told++;
+        s.st = State::WAIT_CONTINUE;
+        return true;
+
+    case State::WAIT_CONTINUE:
+        if (!is_yes(in)) return false;          // user chose not to continue
+        s.idx++;
+        if (s.idx >= s.order.size()){
+            // client has heard all jokes this session
+            out.push_back(kNoMoreFrame);
+            return false;
+        }
+        out.push_back(kKnockFrame);
+        s.st = State::WAIT_WHO;
+        return true;
+    }
+    return false;
 }
-static bool is_setup_who(const std::string& in, const std::string& setup){
-    std::string s = normalize(in);
-    std::string need = normalize(setup) + " who?";
-    return s == need;
+
+static void log_connect(const Session& s){
+    alog::Record r{};
+    r.ev = alog::Event::CONNECT;
+    r.ip = s.peer.sin_addr.s_addr; r.port = s.peer.sin_port;
+    r.session = s.id;
+    r.active = g_active.load();
+    g_log.log(r);
 }
-static bool is_yes(const std::string& in){
-    std::string s = normalize(in);
-    return (s == "y" || s == "yes");
+
+static void log_finish(const Session& s){
+    alog::Record r{};
+    r.ev = alog::Event::FINISH;
+    r.ip = s.peer.sin_addr.s_addr; r.port = s.peer.sin_port;
+    r.session = s.id;
+    r.duration_ms = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - s.started).count();
+    r.jokes = s.told;
+    r.active = g_active.load();
+    r.total = g_served_sessions.load();
+    g_log.log(r);
 }
 
-// ----------------------- jokes I/O -----------------------
-static std::vector<Joke> load_jokes(const std::string& path){
-    std::ifstream f(path);
-    if (!f) throw std::runtime_error("Failed to open jokes file: " + path);
-
-    std::vector<Joke> jokes;
-    std::string line;
-    while (std::getline(f, line)){
-        line = trim(line);
-        if (line.empty() || line[0] == '#') continue;
-        auto p = line.find('|');
-        if (p == std::string::npos) continue;   // enforce Setup|Punchline
-        Joke j{ trim(line.substr(0, p)), trim(line.substr(p+1)) };
-        if (!j.setup.empty() && !j.punch.empty())
-            jokes.push_back(std::move(j));
+// ----------------------- client worker (thread engine) -----------------------
+static void client_worker(int cfd, sockaddr_in cli){
+    g_active++;
+    Session s;
+    LineReader rd(cfd);
+    Frames out;
+    size_t head = 0, off = 0;
+    session_begin(s, cli, out);
+    log_connect(s);
+
+    if (send_frames(cfd, out, head, off)){
+        while (g_running){
+            auto line = rd.read_line();
+            if (!line) break;             // client closed
+            std::string_view in = trim(*line);
+            if (in.empty()) continue;     // ignore empty lines
+
+            out.clear(); head = off = 0;
+            bool more = session_step(s, in, out);
+            if (!send_frames(cfd, out, head, off) || !more) break;
+        }
     }
-    if (jokes.size() < 15)
-        throw std::runtime_error("Need at least 15 jokes in jokes.txt (have " + std::to_string(jokes.size()) + ")");
-    return jokes;
+
+    ::close(cfd);
+    g_active--;
+    g_served_sessions++;
+    log_finish(s);
+    wake_main();
 }
 
-// ----------------------- client worker -----------------------
-enum class State { WAIT_WHO, WAIT_WHO_SETUP, WAIT_CONTINUE };
+// Fixed set of session threads fed through a bounded handoff queue; when
+// both are full the accept loop rejects instead of spawning more threads.
+class WorkerPool {
+public:
+    WorkerPool(int nthreads, size_t max_queue) : max_queue_(max_queue) {
+        for (int i=0; i<nthreads; ++i) threads_.emplace_back([this]{ run(); });
+    }
 
-static void client_worker(int cfd, sockaddr_in cli, const std::vector<Joke>& jokes){
-    g_active++;
-    {
-        std::lock_guard<std::mutex> lk(g_logmx);
-        std::cout << "[+] Client " << inet_ntoa(cli.sin_addr) << ":" << ntohs(cli.sin_port)
-                  << " connected. (active=" << g_active.load() << ")\n";
+    // Queue an accepted client; false if every thread is busy and the
+    // queue is full.
+    bool try_submit(int cfd, const sockaddr_in& cli){
+        {
+            std::lock_guard<std::mutex> lk(mx_);
+            if (queue_.size() >= idle_ + max_queue_) return false;
+            queue_.emplace_back(cfd, cli);
+        }
+        cv_.notify_one();
+        return true;
     }
 
-    // Per-client random order; no repetition within session.
-    std::vector<int> order(jokes.size());
-    std::iota(order.begin(), order.end(), 0);
-    std::mt19937 rng(std::random_device{}());
-    std::shuffle(order.begin(), order.end(), rng);
+    // Serve what is already queued, then join the threads.
+    void shutdown(){
+        { std::lock_guard<std::mutex> lk(mx_); stopping_ = true; }
+        cv_.notify_all();
+        for (auto& t : threads_) t.join();
+        threads_.clear();
+    }
 
-    size_t idx = 0;
-    State st = State::WAIT_WHO;
+    ~WorkerPool(){ if (!threads_.empty()) shutdown(); }
+
+private:
+    void run(){
+        while (true){
+            std::pair<int, sockaddr_in> job;
+            {
+                std::unique_lock<std::mutex> lk(mx_);
+                ++idle_;
+                cv_.wait(lk, [&]{ return stopping_ || !queue_.empty(); });
+                --idle_;
+                if (queue_.empty()) return;
+                job = queue_.front();
+                queue_.pop_front();
+            }
+            client_worker(job.first, job.second);
+        }
+    }
 
-    auto restart_joke = [&](const std::string& correction){
-        send_all(cfd, "Server: " + correction + " Let’s try again.\n");
-        send_all(cfd, "Server: Knock knock!\n");
-        st = State::WAIT_WHO;
-    };
+    size_t max_queue_;
+    std::mutex mx_;
+    std::condition_variable cv_;
+    std::deque<std::pair<int, sockaddr_in>> queue_;
+    size_t idle_ = 0;          // threads waiting for a client
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+};
+
+// Turn a client away without tying up a thread.
+static void reject_client(int cfd, const sockaddr_in& cli){
+    static const char kBusy[] = "Server: Too busy right now, please try again later.\n";
+    ::send(cfd, kBusy, sizeof(kBusy) - 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+    ::close(cfd);
+    alog::Record r{};
+    r.ev = alog::Event::REJECT;
+    r.ip = cli.sin_addr.s_addr; r.port = cli.sin_port;
+    r.active = g_active.load();
+    r.total = ++g_rejected;
+    g_log.log(r);
+}
 
-    // Start first prompt
-    if (!send_all(cfd, "Server: Knock knock!\n")) goto done;
+// ----------------------- epoll engine -----------------------
+// Every session is a non-blocking state machine owned by one of a few
+// event-loop threads, so idle clients cost a buffer instead of a thread.
+struct Conn {
+    int fd = -1;
+    Session s;
+    LineReader rd;
+    Frames out;                // replies not yet accepted by the kernel
+    size_t out_head = 0, out_off = 0;
+    bool closing = false;      // close once `out` drains
+};
+
+struct EventLoop {
+    int epfd = -1;
+    int wakefd = -1;           // eventfd: new connections are pending
+    std::mutex mx;
+    std::vector<std::pair<int, sockaddr_in>> pending;
+    std::unordered_set<Conn*> conns;
+    std::thread th;
+};
+
+static void conn_close(EventLoop& L, Conn* c){
+    epoll_ctl(L.epfd, EPOLL_CTL_DEL, c->fd, nullptr);
+    ::close(c->fd);
+    L.conns.erase(c);
+    g_active--;
+    g_served_sessions++;
+    log_finish(c->s);
+    delete c;
+    wake_main();
+}
 
-    while (g_running && idx < order.size()){
-        const Joke& J = jokes[ order[idx] ];
+// Push queued output; returns false on a hard socket error.
+static bool conn_flush(EventLoop& L, Conn* c){
+    if (!send_frames(c->fd, c->out, c->out_head, c->out_off)) return false;
+    epoll_event ev{}; ev.data.ptr = c;
+    ev.events = c->closing ? 0 : (EPOLLIN | EPOLLRDHUP);
+    if (c->out_head < c->out.size()) ev.events |= EPOLLOUT;
+    else { c->out.clear(); c->out_head = c->out_off = 0; }
+    epoll_ctl(L.epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    return true;
+}
 
-        auto line = recv_line(cfd);
-        if (!line) break;             // client closed
-        std::string in = trim(*line);
-        if (in.empty()) continue;     // ignore empty lines
+// Drain the socket and run every complete line through the session.
+// Returns false if the peer closed or misbehaved.
+static bool conn_read(Conn* c){
+    while (true){
+        std::string_view line;
+        while (!c->closing && c->rd.pop_line(line)){
+            if (line.size() > LineReader::kMaxLine) return false; // guard
+            std::string_view in = trim(line);
+            if (in.empty()) continue;     // ignore empty lines
+            if (!session_step(c->s, in, c->out)) c->closing = true;
+        }
+        if (c->closing) return true;      // ignore anything after the goodbye
+        if (c->rd.overflow()) return false; // guard
 
-        if (st == State::WAIT_WHO){
-            if (!is_whos_there(in)){
-                restart_joke("You are supposed to say, \"Who’s there?\"");
-                continue;
-            }
-            if (!send_all(cfd, "Server: " + J.setup + ".\n")) break;
-            st = State::WAIT_WHO_SETUP;
-            continue;
+        switch (c->rd.fill()){
+        case LineReader::Fill::DATA:   continue;
+        case LineReader::Fill::AGAIN:  c->rd.release_if_idle(); return true;
+        case LineReader::Fill::CLOSED: return false;
         }
+    }
+}
 
-        if (st == State::WAIT_WHO_SETUP){
-            if (!is_setup_who(in, J.setup)){
-                std::ostringstream ss;
-                ss << "You are supposed to say, \"" << J.setup << " who?\"";
-                restart_joke(ss.str());
+static void event_loop(EventLoop& L){
+    std::vector<epoll_event> events(256);
+    while (g_running){
+        int n = epoll_wait(L.epfd, events.data(), (int)events.size(), 200);
+        if (n < 0 && errno != EINTR){ perror("epoll_wait"); break; }
+
+        for (int i=0; i<n; ++i){
+            if (events[i].data.ptr == nullptr){
+                // adopt connections handed over by the acceptor
+                uint64_t cnt; (void)!::read(L.wakefd, &cnt, sizeof(cnt));
+                std::vector<std::pair<int, sockaddr_in>> fresh;
+                { std::lock_guard<std::mutex> lk(L.mx); fresh.swap(L.pending); }
+                for (auto& [fd, cli] : fresh){
+                    Conn* c = new Conn;
+                    c->fd = fd;
+                    c->rd.reset(fd);
+                    g_active++;
+                    session_begin(c->s, cli, c->out);
+                    log_connect(c->s);
+                    epoll_event ev{}; ev.data.ptr = c; ev.events = EPOLLIN | EPOLLRDHUP;
+                    if (epoll_ctl(L.epfd, EPOLL_CTL_ADD, fd, &ev) < 0){
+                        perror("epoll_ctl"); ::close(fd); delete c;
+                        g_active--; continue;
+                    }
+                    L.conns.insert(c);
+                    if (!conn_flush(L, c)) conn_close(L, c);
+                }
                 continue;
             }
-            if (!send_all(cfd, "Server: " + J.punch + "\n")) break;
-            if (!send_all(cfd, "Server: Would you like to listen to another? (Y/N)\n")) break;
-            st = State::WAIT_CONTINUE;
-            continue;
+
+            Conn* c = static_cast<Conn*>(events[i].data.ptr);
+            uint32_t e = events[i].events;
+            bool ok = !(e & EPOLLERR);
+            if (ok && (e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) && !c->closing)
+                ok = conn_read(c);
+            if (ok) ok = conn_flush(L, c);
+            if (!ok || (c->closing && c->out.empty())) conn_close(L, c);
         }
+    }
+    for (Conn* c : std::vector<Conn*>(L.conns.begin(), L.conns.end())) conn_close(L, c);
+}
 
-        if (st == State::WAIT_CONTINUE){
-            if (is_yes(in)){
-                idx++;
-                if (idx >= order.size()) break;      // out of jokes for this client
-                if (!send_all(cfd, "Server: Knock knock!\n")) break;
-                st = State::WAIT_WHO;
-            } else {
-                // user chose not to continue
-                goto done;
+// Hand a freshly accepted (non-blocking) socket to an event loop.
+static void event_loop_adopt(EventLoop& L, int cfd, const sockaddr_in& cli){
+    { std::lock_guard<std::mutex> lk(L.mx); L.pending.emplace_back(cfd, cli); }
+    uint64_t one = 1; (void)!::write(L.wakefd, &one, sizeof(one));
+}
+
+// ----------------------- listeners -----------------------
+static int open_listener(const sockaddr_in& addr, bool reuseport){
+    int srv = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (srv < 0){ perror("socket"); return -1; }
+    int opt=1; setsockopt(srv, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (reuseport && setsockopt(srv, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0){
+        perror("SO_REUSEPORT"); ::close(srv); return -1;
+    }
+    if (bind(srv, (const sockaddr*)&addr, sizeof(addr)) < 0){ perror("bind"); ::close(srv); return -1; }
+    if (listen(srv, g_backlog) < 0){ perror("listen"); ::close(srv); return -1; }
+    return srv;
+}
+
+// One thread per listening socket; with SO_REUSEPORT the kernel spreads
+// incoming connections across them.
+struct Acceptor {
+    int lfd = -1;
+    int cpu = -1;              // core to pin to, -1 = unpinned
+    std::thread th;
+};
+
+static void acceptor_loop(Acceptor& A, int stopfd, WorkerPool* pool,
+                          std::vector<std::unique_ptr<EventLoop>>* loops, size_t first_loop){
+    if (A.cpu >= 0){
+        cpu_set_t set; CPU_ZERO(&set); CPU_SET(A.cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+    int flags = SOCK_CLOEXEC | (loops->empty() ? 0 : SOCK_NONBLOCK);
+    size_t next_loop = first_loop;
+    pollfd pfd[2] = { {A.lfd, POLLIN, 0}, {stopfd, POLLIN, 0} };
+
+    while (g_running){
+        if (poll(pfd, 2, -1) < 0){
+            if (errno == EINTR) continue;
+            perror("poll"); break;
+        }
+        if (pfd[1].revents) break;
+        while (g_running){
+            sockaddr_in cli{}; socklen_t cl = sizeof(cli);
+            int cfd = accept4(A.lfd, (sockaddr*)&cli, &cl, flags);
+            if (cfd < 0){
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept4");
+                break;
+            }
+            if (!loops->empty()){
+                event_loop_adopt(*(*loops)[next_loop++ % loops->size()], cfd, cli);
+            } else if (!pool->try_submit(cfd, cli)){
+                reject_client(cfd, cli);
             }
-            continue;
         }
     }
+}
 
-    if (idx >= order.size()){
-        // client has heard all jokes this session
-        send_all(cfd, "Server: I have no more jokes to tell.\n");
+// Block until a session ends, a signal arrives, the jokes file changes, or
+// timeout_ms passes (-1 = forever).
+static void wait_main(int timeout_ms){
+    pollfd pfd[2] = { {g_wakefd, POLLIN, 0}, {g_watchfd, POLLIN, 0} };
+    if (poll(pfd, g_watchfd >= 0 ? 2 : 1, timeout_ms) > 0){
+        if (pfd[0].revents){ uint64_t cnt; (void)!::read(g_wakefd, &cnt, sizeof(cnt)); }
+        if (g_watchfd >= 0 && pfd[1].revents && jokes_file_changed(g_watchfd)) g_reload = true;
     }
+}
 
-done:
-    ::close(cfd);
-    g_active--;
-    g_served_sessions++;
-    {
-        std::lock_guard<std::mutex> lk(g_logmx);
-        std::cout << "[-] Client finished. active=" << g_active.load()
-                  << "  totalServed=" << g_served_sessions.load() << "\n";
+// Tens of thousands of sessions need more descriptors than the usual soft limit.
+static void raise_fd_limit(){
+    rlimit rl{};
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max){
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
     }
 }
 
@@ -224,77 +546,153 @@ done:
 int main(int argc, char** argv){
     if (argc < 3){
         std::cerr << "Usage: " << argv[0]
-                  << " <bind_ip> <port> [--jokes jokes.txt] [--expected N] [--idle-exit-ms MS]\n";
+                  << " <bind_ip> <port> [--jokes jokes.txt] [--expected N] [--idle-exit-ms MS]"
+                  << " [--engine thread|epoll] [--loops N]"
+                  << " [--max-workers N] [--max-queue N]"
+                  << " [--acceptors N] [--backlog N] [--log-file PATH]\n";
         return 1;
     }
     std::string bind_ip = argv[1];
     int port = std::stoi(argv[2]);
-    std::string jokes_path = "jokes.txt";
 
     for (int i=3; i<argc; ++i){
         std::string a = argv[i];
-        if (a == "--jokes" && i+1 < argc)         jokes_path = argv[++i];
+        if (a == "--jokes" && i+1 < argc)         g_jokes_path = argv[++i];
         else if (a == "--expected" && i+1 < argc) g_expected_sessions = std::stoi(argv[++i]);
         else if (a == "--idle-exit-ms" && i+1<argc) g_idle_exit_ms = std::stoi(argv[++i]);
+        else if (a == "--engine" && i+1 < argc)   g_engine = argv[++i];
+        else if (a == "--loops" && i+1 < argc)    g_loops = std::stoi(argv[++i]);
+        else if (a == "--max-workers" && i+1 < argc) g_max_workers = std::stoi(argv[++i]);
+        else if (a == "--max-queue" && i+1 < argc)   g_max_queue = std::stoi(argv[++i]);
+        else if (a == "--acceptors" && i+1 < argc)   g_acceptors = std::stoi(argv[++i]);
+        else if (a == "--backlog" && i+1 < argc)     g_backlog = std::stoi(argv[++i]);
+        else if (a == "--log-file" && i+1 < argc)    g_log_path = argv[++i];
+    }
+    if (g_engine != "thread" && g_engine != "epoll"){
+        std::cerr << "Unknown engine '" << g_engine << "' (expected thread or epoll)\n";
+        return 1;
+    }
+    if (g_max_workers < 1 || g_max_queue < 0){
+        std::cerr << "--max-workers must be >= 1 and --max-queue >= 0\n";
+        return 1;
+    }
+    if (g_acceptors < 1 || g_backlog < 1){
+        std::cerr << "--acceptors and --backlog must be >= 1\n";
+        return 1;
     }
 
-    auto jokes = load_jokes(jokes_path);
+    g_catalog = Catalog::load(g_jokes_path);
 
     std::signal(SIGINT, sigint_handler);
+    std::signal(SIGHUP, sighup_handler);
+    std::signal(SIGPIPE, SIG_IGN);
 
-    int srv = ::socket(AF_INET, SOCK_STREAM, 0);
-    if (srv < 0){ perror("socket"); return 1; }
-    int opt=1; setsockopt(srv, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    g_wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int stopfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_wakefd < 0 || stopfd < 0){ perror("eventfd"); return 1; }
+    g_watchfd = watch_jokes_file();
 
     sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_port = htons(port);
     if (inet_pton(AF_INET, bind_ip.c_str(), &addr.sin_addr) <= 0){
         perror("inet_pton"); return 1;
     }
-    if (bind(srv, (sockaddr*)&addr, sizeof(addr)) < 0){ perror("bind"); return 1; }
-    if (listen(srv, 64) < 0){ perror("listen"); return 1; }
+    std::vector<std::unique_ptr<Acceptor>> acceptors;
+    unsigned ncpu = std::max(1u, std::thread::hardware_concurrency());
+    for (int i=0; i<g_acceptors; ++i){
+        auto A = std::make_unique<Acceptor>();
+        A->lfd = open_listener(addr, g_acceptors > 1);
+        if (A->lfd < 0) return 1;
+        if (g_acceptors > 1) A->cpu = i % ncpu;
+        acceptors.push_back(std::move(A));
+    }
+
+    int logfd = 1;
+    if (!g_log_path.empty()){
+        logfd = ::open(g_log_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (logfd < 0){ perror("open log file"); return 1; }
+    }
 
     {
-        std::lock_guard<std::mutex> lk(g_logmx);
         std::cout << "[*] Server listening on " << bind_ip << ":" << port
-                  << "  (jokes=" << jokes.size() << ")\n";
+                  << "  (jokes=" << g_catalog->size() << ")\n";
         if (g_expected_sessions >= 0)
             std::cout << "[*] Will exit after serving " << g_expected_sessions << " client(s).\n";
         if (g_idle_exit_ms > 0)
             std::cout << "[*] Will exit when idle (no clients) for " << g_idle_exit_ms << " ms.\n";
-        std::cout << "[*] Press Ctrl+C to stop.\n";
+        if (g_acceptors > 1)
+            std::cout << "[*] " << g_acceptors << " SO_REUSEPORT acceptors, backlog " << g_backlog << ".\n";
+        std::cout << "[*] Press Ctrl+C to stop; SIGHUP or editing the jokes file reloads it.\n";
+    }
+
+    std::unique_ptr<WorkerPool> pool;
+    std::vector<std::unique_ptr<EventLoop>> loops;
+    if (g_engine == "epoll"){
+        raise_fd_limit();
+        int nloops = g_loops > 0 ? g_loops : std::max(1u, std::thread::hardware_concurrency());
+        for (int i=0; i<nloops; ++i){
+            auto L = std::make_unique<EventLoop>();
+            L->epfd = epoll_create1(EPOLL_CLOEXEC);
+            L->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (L->epfd < 0 || L->wakefd < 0){ perror("epoll/eventfd"); return 1; }
+            epoll_event ev{}; ev.events = EPOLLIN; ev.data.ptr = nullptr;
+            epoll_ctl(L->epfd, EPOLL_CTL_ADD, L->wakefd, &ev);
+            L->th = std::thread(event_loop, std::ref(*L));
+            loops.push_back(std::move(L));
+        }
+        std::cout << "[*] epoll engine with " << nloops << " event loop(s).\n";
+    } else {
+        pool = std::make_unique<WorkerPool>(g_max_workers, g_max_queue);
+        std::cout << "[*] thread engine with " << g_max_workers << " worker(s), queue "
+                  << g_max_queue << ".\n";
     }
+    if (!g_log_path.empty()) std::cout << "[*] Connection log: " << g_log_path << "\n";
+    std::cout << std::flush;           // the log thread writes to fd 1 directly from here on
+    g_log.start(logfd);
 
-    std::vector<std::thread> workers;
-    int idle_ms = 0;
+    for (size_t i=0; i<acceptors.size(); ++i){
+        Acceptor& A = *acceptors[i];
+        A.th = std::thread(acceptor_loop, std::ref(A), stopfd, pool.get(), &loops, i);
+    }
 
+    auto idle_since = std::chrono::steady_clock::now();
+    int served_seen = 0;
     while (g_running){
         // Exit conditions for demos (both optional)
-        if (g_expected_sessions >= 0 && g_served_sessions.load() >= g_expected_sessions) break;
-        if (g_idle_exit_ms > 0 && g_active.load() == 0){
-            if (idle_ms >= g_idle_exit_ms) break;
-        } else {
-            idle_ms = 0;
-        }
-
-        fd_set rfds; FD_ZERO(&rfds); FD_SET(srv, &rfds);
-        timeval tv{0, 200000}; // 200 ms tick
-        int rv = select(srv+1, &rfds, nullptr, nullptr, &tv);
-        if (rv > 0){
-            sockaddr_in cli{}; socklen_t cl = sizeof(cli);
-            int cfd = accept(srv, (sockaddr*)&cli, &cl);
-            if (cfd >= 0){
-                workers.emplace_back(client_worker, cfd, cli, std::cref(jokes));
-            } else if (errno != EINTR){
-                perror("accept");
-            }
-        } else {
-            // timeout tick for idle counter
-            if (g_idle_exit_ms > 0 && g_active.load() == 0) idle_ms += 200;
+        int served = g_served_sessions.load();
+        if (g_expected_sessions >= 0 && served >= g_expected_sessions) break;
+
+        int timeout_ms = -1;
+        if (g_idle_exit_ms > 0){
+            auto now = std::chrono::steady_clock::now();
+            if (g_active.load() > 0 || served != served_seen) idle_since = now;
+            auto idle = std::chrono::duration_cast<std::chrono::milliseconds>(now - idle_since).count();
+            if (g_active.load() == 0 && idle >= g_idle_exit_ms) break;
+            // while clients are connected, their sessions ending will wake us
+            if (g_active.load() == 0) timeout_ms = int(g_idle_exit_ms - idle);
         }
+        served_seen = served;
+        wait_main(timeout_ms);
+        if (g_reload.exchange(false)) reload_catalog();
     }
 
-    for (auto& t : workers) if (t.joinable()) t.join();
-    ::close(srv);
+    // stop accepting, then let live sessions finish
+    uint64_t one = 1; (void)!::write(stopfd, &one, sizeof(one));
+    for (auto& A : acceptors){ A->th.join(); ::close(A->lfd); }
+    if (pool) pool->shutdown();
+    if (!loops.empty()){
+        while (g_running && g_active.load() > 0) wait_main(-1);
+        g_running = false;
+    }
+    for (auto& L : loops){
+        L->th.join();
+        for (auto& [fd, cli] : L->pending) ::close(fd);
+        ::close(L->wakefd); ::close(L->epfd);
+    }
+    g_log.stop();
+    if (logfd != 1) ::close(logfd);
+    if (g_watchfd >= 0) ::close(g_watchfd);
+    ::close(stopfd);
+    ::close(g_wakefd);
     std::cout << "[*] Server terminated.\n";
     return 0;
 }
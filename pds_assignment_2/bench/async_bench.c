@@ -0,0 +1,217 @@
+/*
+ * Throughput of small version 1 MATRIX_MULTIPLY calls (n x n, n <= 20)
+ * through the synchronous rpcgen stub against the pipelined client of
+ * matrix_async.c at growing depths (calls outstanding per connection).
+ * Every reply is checked against the product computed here. Run against
+ * a server started with --port and --cache-mb 0, or every call after the
+ * first is a cache hit.
+ *
+ *   ./bench/async_bench <host> <port> [n] [seconds] [connections] [max_depth]
+ */
+#define _DEFAULT_SOURCE
+#include "../matrixOp.h"
+#include "../matrix_async.h"
+#include <math.h>
+#include <netdb.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static matrix_pair pair;
+static double want[MAX_MATRIX_ELEMENTS];
+static unsigned long completed;
+static unsigned long failed;
+
+static double
+now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool
+correct(const matrix_result *res)
+{
+	if (res->status != 0 || res->value.data.data_len != pair.a.rows * pair.b.cols) {
+		return false;
+	}
+	for (u_int i = 0; i < res->value.data.data_len; ++i) {
+		if (fabs(res->value.data.data_val[i] - want[i]) > 1e-12) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void
+multiplied(void *ctx, enum clnt_stat status, void *res)
+{
+	(void)ctx;
+	if (status != RPC_SUCCESS || !correct(res)) {
+		__atomic_fetch_add(&failed, 1, __ATOMIC_RELAXED);
+	}
+	xdr_free((xdrproc_t)xdr_matrix_result, res);
+	free(res);
+	__atomic_fetch_add(&completed, 1, __ATOMIC_RELEASE);
+}
+
+/* calls per second through one synchronous connection */
+static double
+run_sync(const char *host, unsigned short port, double seconds)
+{
+	struct addrinfo hints, *ai;
+	struct sockaddr_in addr;
+	int sock = RPC_ANYSOCK;
+	unsigned long calls = 0;
+	double t0, t;
+	CLIENT *clnt;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, NULL, &hints, &ai) != 0) {
+		fprintf(stderr, "%s: unknown host\n", host);
+		exit(1);
+	}
+	memcpy(&addr, ai->ai_addr, sizeof(addr));
+	freeaddrinfo(ai);
+	addr.sin_port = htons(port);
+	if ((clnt = clnttcp_create(&addr, MATRIX_OP_PROG, MATRIX_OP_V1, &sock, 0, 0)) == NULL) {
+		clnt_pcreateerror(host);
+		exit(1);
+	}
+
+	t0 = now_sec();
+	do {
+		matrix_result *res = matrix_multiply_1(&pair, clnt);
+
+		if (res == NULL || !correct(res)) {
+			failed++;
+		}
+		if (res != NULL) {
+			xdr_free((xdrproc_t)xdr_matrix_result, (char *)res);
+		}
+		++calls;
+	} while ((t = now_sec() - t0) < seconds);
+	clnt_destroy(clnt);
+	return calls / t;
+}
+
+/* calls per second with depth calls outstanding on each connection */
+static double
+run_async(async_client *ac, double seconds)
+{
+	unsigned long sent = 0;
+	double t0, t;
+
+	__atomic_store_n(&completed, 0, __ATOMIC_RELAXED);
+	t0 = now_sec();
+	while (now_sec() - t0 < seconds) {
+		matrix_result *res = calloc(1, sizeof(*res));
+
+		if (res == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+		async_submit(ac, MATRIX_MULTIPLY, (xdrproc_t)xdr_matrix_pair, &pair,
+			     (xdrproc_t)xdr_matrix_result, res, multiplied, NULL);
+		++sent;
+	}
+	while (__atomic_load_n(&completed, __ATOMIC_ACQUIRE) < sent) {
+		usleep(100);
+	}
+	t = now_sec() - t0;
+	return sent / t;
+}
+
+int
+main(int argc, char *argv[])
+{
+	static double a[MAX_MATRIX_ELEMENTS], b[MAX_MATRIX_ELEMENTS];
+	unsigned short port;
+	u_int n, connections, max_depth;
+	double seconds, sync_rate;
+	matrix_result first;
+	async_client *ac;
+
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s <host> <port> [n] [seconds] [connections] [max_depth]\n",
+			argv[0]);
+		return 1;
+	}
+	port = (unsigned short)strtoul(argv[2], NULL, 10);
+	n = argc > 3 ? (u_int)strtoul(argv[3], NULL, 10) : 8;
+	seconds = argc > 4 ? strtod(argv[4], NULL) : 1.0;
+	connections = argc > 5 ? (u_int)strtoul(argv[5], NULL, 10) : 1;
+	max_depth = argc > 6 ? (u_int)strtoul(argv[6], NULL, 10) : 64;
+	if (n == 0 || n * n > MAX_MATRIX_ELEMENTS || connections == 0 || max_depth == 0) {
+		fprintf(stderr, "n must be 1..20, connections and max_depth positive\n");
+		return 1;
+	}
+
+	srand(7);
+	for (u_int i = 0; i < n * n; ++i) {
+		a[i] = (double)rand() / RAND_MAX - 0.5;
+		b[i] = (double)rand() / RAND_MAX - 0.5;
+	}
+	pair.a.rows = pair.a.cols = pair.b.rows = pair.b.cols = n;
+	pair.a.data.data_len = pair.b.data.data_len = n * n;
+	pair.a.data.data_val = a;
+	pair.b.data.data_val = b;
+
+	/* the expected product comes from the server itself, through a future */
+	if ((ac = async_create(argv[1], port, MATRIX_OP_PROG, MATRIX_OP_V1, 1, 1)) == NULL) {
+		return 1;
+	}
+	memset(&first, 0, sizeof(first));
+	if (async_wait(async_start(ac, MATRIX_MULTIPLY, (xdrproc_t)xdr_matrix_pair, &pair,
+				   (xdrproc_t)xdr_matrix_result, &first)) != RPC_SUCCESS ||
+	    first.status != 0) {
+		fprintf(stderr, "first multiply failed\n");
+		return 1;
+	}
+	for (u_int i = 0; i < n; ++i) {
+		for (u_int j = 0; j < n; ++j) {
+			double sum = 0.0;
+
+			for (u_int k = 0; k < n; ++k) {
+				sum += a[i * n + k] * b[k * n + j];
+			}
+			if (fabs(first.value.data.data_val[i * n + j] - sum) > 1e-12) {
+				fprintf(stderr, "server product differs from the reference\n");
+				return 1;
+			}
+			want[i * n + j] = first.value.data.data_val[i * n + j];
+		}
+	}
+	xdr_free((xdrproc_t)xdr_matrix_result, (char *)&first);
+	async_destroy(ac);
+
+	printf("%u x %u multiply, %u connection%s, %.1f s per row\n", n, n, connections,
+	       connections == 1 ? "" : "s", seconds);
+	sync_rate = run_sync(argv[1], port, seconds);
+	printf("%-12s %10.0f calls/s\n", "sync stub", sync_rate);
+	fflush(stdout);
+
+	for (u_int depth = 1; depth <= max_depth; depth *= 2) {
+		double rate;
+
+		if ((ac = async_create(argv[1], port, MATRIX_OP_PROG, MATRIX_OP_V1, connections,
+				       depth)) == NULL) {
+			return 1;
+		}
+		rate = run_async(ac, seconds);
+		async_destroy(ac);
+		printf("depth %-6u %10.0f calls/s  %5.2fx\n", depth, rate, rate / sync_rate);
+		fflush(stdout);
+	}
+	if (failed != 0) {
+		printf("%lu calls failed or returned a wrong product\n", failed);
+	}
+	return failed == 0 ? 0 : 1;
+}
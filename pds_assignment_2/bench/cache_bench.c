@@ -0,0 +1,99 @@
+/*
+ * Result cache: time of multiply and inverse computed by the kernels
+ * against the same call answered from the cache (hash, compare, copy),
+ * square sizes from 16 up to max_n. Cached results are checked to be
+ * identical to the kernel's.
+ *
+ *   ./bench/cache_bench [max_n]
+ */
+#define _POSIX_C_SOURCE 199309L
+#include "../matrix_cache.h"
+#include "../matrix_kernels.h"
+#include "../matrix_sparse.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double
+now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int
+main(int argc, char *argv[])
+{
+	size_t max_n = argc > 1 ? strtoul(argv[1], NULL, 10) : 512;
+	struct cache_stats stats;
+	int failures = 0;
+
+	printf("%6s %12s %12s %8s %12s %12s %8s\n", "n", "inverse us", "hit us", "speedup",
+	       "multiply us", "hit us", "speedup");
+
+	for (size_t n = 16; n <= max_n; n *= 2) {
+		double *a = malloc(sizeof(double) * n * n);
+		double *b = malloc(sizeof(double) * n * n);
+		double *ref = malloc(sizeof(double) * n * n);
+		double *out = malloc(sizeof(double) * n * n);
+		int reps = n <= 64 ? 10000 : n <= 256 ? 50 : 5;
+		double inv_s, inv_hit_s, mul_s, mul_hit_s;
+		double t0;
+
+		if (a == NULL || b == NULL || ref == NULL || out == NULL) {
+			fprintf(stderr, "out of memory at n=%zu\n", n);
+			return 1;
+		}
+		srand(5);
+		for (size_t i = 0; i < n * n; ++i) {
+			a[i] = (double)rand() / RAND_MAX - 0.5;
+			b[i] = (double)rand() / RAND_MAX - 0.5;
+		}
+
+		t0 = now_sec();
+		for (int r = 0; r < reps; ++r) {
+			kernel_inverse(a, ref, n);
+		}
+		inv_s = (now_sec() - t0) / reps;
+		cache_inverse(a, out, n);
+		t0 = now_sec();
+		for (int r = 0; r < reps; ++r) {
+			cache_inverse(a, out, n);
+		}
+		inv_hit_s = (now_sec() - t0) / reps;
+		failures += memcmp(ref, out, sizeof(double) * n * n) != 0;
+
+		t0 = now_sec();
+		for (int r = 0; r < reps; ++r) {
+			kernel_multiply_auto(a, b, ref, n, n, n);
+		}
+		mul_s = (now_sec() - t0) / reps;
+		cache_multiply(a, b, out, n, n, n);
+		t0 = now_sec();
+		for (int r = 0; r < reps; ++r) {
+			cache_multiply(a, b, out, n, n, n);
+		}
+		mul_hit_s = (now_sec() - t0) / reps;
+		failures += memcmp(ref, out, sizeof(double) * n * n) != 0;
+
+		printf("%6zu %12.2f %12.2f %7.1fx %12.2f %12.2f %7.1fx\n", n, inv_s * 1e6,
+		       inv_hit_s * 1e6, inv_s / inv_hit_s, mul_s * 1e6, mul_hit_s * 1e6,
+		       mul_s / mul_hit_s);
+		fflush(stdout);
+		free(a);
+		free(b);
+		free(ref);
+		free(out);
+	}
+
+	cache_get_stats(&stats);
+	printf("cache: %llu hits, %llu misses, %zu entries, %zu KiB\n", stats.hits, stats.misses,
+	       stats.entries, stats.bytes >> 10);
+	if (failures != 0) {
+		printf("%d cached results differ from the kernels\n", failures);
+	}
+	return failures == 0 ? 0 : 1;
+}
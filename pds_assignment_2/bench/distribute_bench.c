@@ -0,0 +1,174 @@
+/*
+ * MATRIX_MULTIPLY_H of an m x n by an n x p matrix on stored handles, as
+ * timed by the client. Against a coordinator (a server started with
+ * --workers) this is the distributed multiply; against a plain server it
+ * is the local baseline. The result is downloaded once and checked
+ * against kernel_multiply() here. Run against a server started with
+ * --port and --cache-mb 0, or repeated calls are answered from the cache;
+ * tests/run_distributed.sh starts the servers and prints the speedup for
+ * each worker count.
+ *
+ *   ./bench/distribute_bench <host> <port> [m] [n] [p] [reps]
+ */
+#define _DEFAULT_SOURCE
+#include "../matrixOp.h"
+#include "../matrix_kernels.h"
+#include <math.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static CLIENT *clnt;
+
+static double
+now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* the handle of a successful reply; exits otherwise */
+static u_int
+expect(const char *what, handle_result *res)
+{
+	if (res == NULL) {
+		clnt_perror(clnt, what);
+		exit(1);
+	}
+	if (res->status != 0) {
+		fprintf(stderr, "%s: %s\n", what, res->message);
+		exit(1);
+	}
+	return res->handle;
+}
+
+static u_int
+upload(const double *data, u_int rows, u_int cols)
+{
+	matrix_dims dims = { rows, cols };
+	u_int handle = expect("create", matrix_create_2(&dims, clnt));
+	u_int total = rows * cols;
+
+	for (u_int off = 0; off < total; off += MAX_CHUNK_ELEMENTS) {
+		matrix_chunk chunk;
+
+		chunk.handle = handle;
+		chunk.offset = off;
+		chunk.data.data_len = total - off < MAX_CHUNK_ELEMENTS ? total - off : MAX_CHUNK_ELEMENTS;
+		chunk.data.data_val = (double *)data + off;
+		expect("upload", matrix_upload_2(&chunk, clnt));
+	}
+	return handle;
+}
+
+static void
+download(u_int handle, double *out, u_int total)
+{
+	for (u_int off = 0; off < total; off += MAX_CHUNK_ELEMENTS) {
+		chunk_request req = { handle, off, total - off < MAX_CHUNK_ELEMENTS ? total - off : MAX_CHUNK_ELEMENTS };
+		chunk_result *res = matrix_download_2(&req, clnt);
+
+		if (res == NULL || res->status != 0) {
+			fprintf(stderr, "download failed\n");
+			exit(1);
+		}
+		memcpy(out + off, res->data.data_val, sizeof(double) * req.count);
+		xdr_free((xdrproc_t)xdr_chunk_result, (char *)res);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct timeval timeout = { 600, 0 };
+	struct addrinfo hints, *ai;
+	struct sockaddr_in addr;
+	int sock = RPC_ANYSOCK;
+	u_int m, n, p, reps;
+	handle_pair pair;
+	double *a, *b, *got, *want;
+	double best = 0.0, total_s = 0.0, err = 0.0, scale = 0.0;
+
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s <host> <port> [m] [n] [p] [reps]\n", argv[0]);
+		return 1;
+	}
+	m = argc > 3 ? (u_int)strtoul(argv[3], NULL, 10) : 1024;
+	n = argc > 4 ? (u_int)strtoul(argv[4], NULL, 10) : m;
+	p = argc > 5 ? (u_int)strtoul(argv[5], NULL, 10) : n;
+	reps = argc > 6 ? (u_int)strtoul(argv[6], NULL, 10) : 3;
+	if (m == 0 || n == 0 || p == 0 || reps == 0) {
+		fprintf(stderr, "dimensions and reps must be positive\n");
+		return 1;
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(argv[1], NULL, &hints, &ai) != 0) {
+		fprintf(stderr, "%s: unknown host\n", argv[1]);
+		return 1;
+	}
+	memcpy(&addr, ai->ai_addr, sizeof(addr));
+	freeaddrinfo(ai);
+	addr.sin_port = htons((unsigned short)strtoul(argv[2], NULL, 10));
+	if ((clnt = clnttcp_create(&addr, MATRIX_OP_PROG, MATRIX_OP_V2, &sock, 0, 0)) == NULL) {
+		clnt_pcreateerror(argv[1]);
+		return 1;
+	}
+	clnt_control(clnt, CLSET_TIMEOUT, (char *)&timeout);
+
+	srand(7);
+	a = malloc(sizeof(double) * m * n);
+	b = malloc(sizeof(double) * n * p);
+	got = malloc(sizeof(double) * m * p);
+	want = malloc(sizeof(double) * m * p);
+	if (a == NULL || b == NULL || got == NULL || want == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	for (size_t i = 0; i < (size_t)m * n; ++i) {
+		a[i] = (double)rand() / RAND_MAX - 0.5;
+	}
+	for (size_t i = 0; i < (size_t)n * p; ++i) {
+		b[i] = (double)rand() / RAND_MAX - 0.5;
+	}
+	pair.a = upload(a, m, n);
+	pair.b = upload(b, n, p);
+
+	for (u_int rep = 0; rep < reps; ++rep) {
+		double t0 = now_sec();
+		u_int h = expect("multiply", matrix_multiply_h_2(&pair, clnt));
+		double t = now_sec() - t0;
+
+		total_s += t;
+		if (rep == 0 || t < best) {
+			best = t;
+		}
+		if (rep == 0) {
+			download(h, got, m * p);
+		}
+		matrix_free_2(&h, clnt);
+	}
+
+	kernel_multiply(a, b, want, m, n, p);
+	for (size_t i = 0; i < (size_t)m * p; ++i) {
+		if (fabs(got[i] - want[i]) > err) {
+			err = fabs(got[i] - want[i]);
+		}
+		if (fabs(want[i]) > scale) {
+			scale = fabs(want[i]);
+		}
+	}
+	printf("%u x %u x %u: best %.1f ms, mean %.1f ms, %.2f GFLOP/s, max error %.1e\n", m, n, p,
+	       best * 1e3, total_s / reps * 1e3, 2.0 * m * n * p / best / 1e9, err);
+	if (err > 1e-12 * scale * n) {
+		fprintf(stderr, "result differs from kernel_multiply\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * Element-wise bandwidth: the original add loop against kernel_add(),
+ * axpy, and alpha * (A - B) .* C fused into one kernel_elementwise() pass
+ * against the same expression as three single-step passes (what the
+ * server ran before it fused MATRIX_EVAL chains). GB/s counts each
+ * operand read once and the output written once, so the fused and the
+ * three-pass columns are directly comparable. threads sets the kernel
+ * thread pool (0 = one per CPU).
+ *
+ *   ./bench/elementwise_bench [max_elements] [threads]
+ */
+#define _POSIX_C_SOURCE 199309L
+#include "../matrix_kernels.h"
+#include "../matrix_parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double
+now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* the loop matrix_add_1_svc used to run */
+static void
+add_naive(const double *a, const double *b, double *out, size_t count)
+{
+	for (size_t i = 0; i < count; ++i) {
+		out[i] = a[i] + b[i];
+	}
+}
+
+/* seconds per call after one untimed call (page faults), repeating for about 0.2 s */
+#define TIME_CALLS(call, secs) do { \
+	int reps_ = 0; \
+	double t0_; \
+	call; \
+	t0_ = now_sec(); \
+	do { \
+		call; \
+		++reps_; \
+	} while (now_sec() - t0_ < 0.2); \
+	secs = (now_sec() - t0_) / reps_; \
+} while (0)
+
+#define ALPHA 0.5
+
+static void
+three_passes(const double *a, const double *b, const double *c, double *tmp, double *out,
+	     size_t count)
+{
+	kernel_elementwise_op(EW_SUBTRACT, 0.0, a, b, tmp, count);
+	kernel_elementwise_op(EW_SCALE, ALPHA, tmp, NULL, tmp, count);
+	kernel_elementwise_op(EW_HADAMARD, 0.0, tmp, c, out, count);
+}
+
+int
+main(int argc, char *argv[])
+{
+	static const size_t counts[] = { 400, 4096, 65536, 262144, 1048576, 4194304, 16777216 };
+	static const struct ew_step fused[] = {
+		{ EW_LOAD, 0, 0.0 }, { EW_LOAD, 1, 0.0 }, { EW_SUBTRACT, 0, 0.0 },
+		{ EW_SCALE, 0, ALPHA }, { EW_LOAD, 2, 0.0 }, { EW_HADAMARD, 0, 0.0 },
+	};
+	size_t max_elements = argc > 1 ? strtoul(argv[1], NULL, 10) : 16777216;
+	int failures = 0;
+
+	if (argc > 2) {
+		parallel_set_threads((unsigned int)strtoul(argv[2], NULL, 10));
+	}
+	printf("threads: %u\n", parallel_threads());
+	printf("%9s %9s %9s %9s %9s %9s %8s\n", "elements", "loop add", "add", "axpy",
+	       "3 passes", "fused", "speedup");
+
+	for (size_t s = 0; s < sizeof(counts) / sizeof(counts[0]); ++s) {
+		size_t count = counts[s];
+		double *a, *b, *c, *tmp, *ref, *out;
+		const double *inputs[3];
+		double loop_s, add_s, axpy_s, passes_s, fused_s;
+
+		if (count > max_elements) {
+			continue;
+		}
+		a = malloc(sizeof(double) * count);
+		b = malloc(sizeof(double) * count);
+		c = malloc(sizeof(double) * count);
+		tmp = malloc(sizeof(double) * count);
+		ref = malloc(sizeof(double) * count);
+		out = malloc(sizeof(double) * count);
+		if (a == NULL || b == NULL || c == NULL || tmp == NULL || ref == NULL || out == NULL) {
+			fprintf(stderr, "out of memory at %zu elements\n", count);
+			return 1;
+		}
+		for (size_t i = 0; i < count; ++i) {
+			a[i] = (double)(i % 1000) / 7.0;
+			b[i] = (double)(i % 333) * 1.5;
+			c[i] = 1.0 / (double)(i % 17 + 1);
+		}
+		inputs[0] = a;
+		inputs[1] = b;
+		inputs[2] = c;
+
+		TIME_CALLS(add_naive(a, b, ref, count), loop_s);
+		TIME_CALLS(kernel_add(a, b, out, count), add_s);
+		failures += memcmp(ref, out, sizeof(double) * count) != 0;
+
+		TIME_CALLS(kernel_elementwise_op(EW_AXPY, ALPHA, a, b, out, count), axpy_s);
+		for (size_t i = 0; i < count; ++i) {
+			failures += out[i] != ALPHA * a[i] + b[i];
+		}
+
+		TIME_CALLS(three_passes(a, b, c, tmp, ref, count), passes_s);
+		TIME_CALLS(kernel_elementwise(fused, 6, inputs, out, count), fused_s);
+		failures += memcmp(ref, out, sizeof(double) * count) != 0;
+
+		printf("%9zu %9.2f %9.2f %9.2f %9.2f %9.2f %7.2fx\n", count,
+		       3.0 * sizeof(double) * count / loop_s / 1e9,
+		       3.0 * sizeof(double) * count / add_s / 1e9,
+		       3.0 * sizeof(double) * count / axpy_s / 1e9,
+		       4.0 * sizeof(double) * count / passes_s / 1e9,
+		       4.0 * sizeof(double) * count / fused_s / 1e9, passes_s / fused_s);
+		fflush(stdout);
+		free(a);
+		free(b);
+		free(c);
+		free(tmp);
+		free(ref);
+		free(out);
+	}
+	if (failures != 0) {
+		printf("%d results differ from the plain loops\n", failures);
+	}
+	return failures == 0 ? 0 : 1;
+}
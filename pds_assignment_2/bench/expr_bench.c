@@ -0,0 +1,199 @@
+/*
+ * inverse(A x B)^T + C on stored n x n matrices: four version 2 calls
+ * (MULTIPLY_H, INVERSE_H, TRANSPOSE_H, ADD_H) against one MATRIX_EVAL,
+ * which also skips the explicit transpose. Both results are downloaded
+ * and compared. Run against a server started with --port.
+ *
+ *   ./bench/expr_bench <host> <port> [n] [reps]
+ */
+#define _DEFAULT_SOURCE
+#include "../matrixOp.h"
+#include <math.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static CLIENT *clnt;
+
+static double
+now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* the handle of a successful reply; exits otherwise */
+static u_int
+expect(const char *what, handle_result *res)
+{
+	if (res == NULL) {
+		clnt_perror(clnt, what);
+		exit(1);
+	}
+	if (res->status != 0) {
+		fprintf(stderr, "%s: %s\n", what, res->message);
+		exit(1);
+	}
+	return res->handle;
+}
+
+static u_int
+upload(const double *data, u_int n)
+{
+	matrix_dims dims = { n, n };
+	u_int handle = expect("create", matrix_create_2(&dims, clnt));
+	u_int total = n * n;
+
+	for (u_int off = 0; off < total; off += MAX_CHUNK_ELEMENTS) {
+		matrix_chunk chunk;
+
+		chunk.handle = handle;
+		chunk.offset = off;
+		chunk.data.data_len = total - off < MAX_CHUNK_ELEMENTS ? total - off : MAX_CHUNK_ELEMENTS;
+		chunk.data.data_val = (double *)data + off;
+		expect("upload", matrix_upload_2(&chunk, clnt));
+	}
+	return handle;
+}
+
+static void
+download(u_int handle, double *out, u_int total)
+{
+	for (u_int off = 0; off < total; off += MAX_CHUNK_ELEMENTS) {
+		chunk_request req = { handle, off, total - off < MAX_CHUNK_ELEMENTS ? total - off : MAX_CHUNK_ELEMENTS };
+		chunk_result *res = matrix_download_2(&req, clnt);
+
+		if (res == NULL || res->status != 0) {
+			fprintf(stderr, "download failed\n");
+			exit(1);
+		}
+		memcpy(out + off, res->data.data_val, sizeof(double) * req.count);
+		xdr_free((xdrproc_t)xdr_chunk_result, (char *)res);
+	}
+}
+
+static void
+release(u_int handle)
+{
+	matrix_free_2(&handle, clnt);
+}
+
+static u_int
+step_by_step(u_int a, u_int b, u_int c)
+{
+	handle_pair pair = { a, b };
+	u_int prod = expect("multiply", matrix_multiply_h_2(&pair, clnt));
+	u_int inv = expect("inverse", matrix_inverse_h_2(&prod, clnt));
+	u_int tr = expect("transpose", matrix_transpose_h_2(&inv, clnt));
+	u_int sum;
+
+	pair.a = tr;
+	pair.b = c;
+	sum = expect("add", matrix_add_h_2(&pair, clnt));
+	release(prod);
+	release(inv);
+	release(tr);
+	return sum;
+}
+
+static u_int
+evaluate(u_int a, u_int b, u_int c)
+{
+	expr_node nodes[] = {
+		{ EXPR_HANDLE, a, 0, 0.0 },
+		{ EXPR_HANDLE, b, 0, 0.0 },
+		{ EXPR_HANDLE, c, 0, 0.0 },
+		{ EXPR_MULTIPLY, 0, 1, 0.0 },
+		{ EXPR_INVERSE, 3, 0, 0.0 },
+		{ EXPR_TRANSPOSE, 4, 0, 0.0 },
+		{ EXPR_ADD, 5, 2, 0.0 },
+	};
+	matrix_expr expr;
+
+	expr.nodes.nodes_len = sizeof(nodes) / sizeof(nodes[0]);
+	expr.nodes.nodes_val = nodes;
+	return expect("eval", matrix_eval_2(&expr, clnt));
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct addrinfo hints, *ai;
+	struct sockaddr_in addr;
+	int sock = RPC_ANYSOCK;
+	u_int n, reps, total;
+	u_int ha, hb, hc;
+	double *m[3], *r1, *r2;
+	double t_steps = 0.0, t_eval = 0.0, diff = 0.0;
+
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s <host> <port> [n] [reps]\n", argv[0]);
+		return 1;
+	}
+	n = argc > 3 ? (u_int)strtoul(argv[3], NULL, 10) : 512;
+	reps = argc > 4 ? (u_int)strtoul(argv[4], NULL, 10) : 5;
+	total = n * n;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(argv[1], NULL, &hints, &ai) != 0) {
+		fprintf(stderr, "%s: unknown host\n", argv[1]);
+		return 1;
+	}
+	memcpy(&addr, ai->ai_addr, sizeof(addr));
+	freeaddrinfo(ai);
+	addr.sin_port = htons((unsigned short)strtoul(argv[2], NULL, 10));
+	if ((clnt = clnttcp_create(&addr, MATRIX_OP_PROG, MATRIX_OP_V2, &sock, 0, 0)) == NULL) {
+		clnt_pcreateerror(argv[1]);
+		return 1;
+	}
+
+	srand(7);
+	for (int k = 0; k < 3; ++k) {
+		m[k] = malloc(sizeof(double) * total);
+		for (u_int i = 0; i < total; ++i) {
+			m[k][i] = (double)rand() / RAND_MAX - 0.5 + (i % (n + 1) == 0 ? 1.0 : 0.0);
+		}
+	}
+	ha = upload(m[0], n);
+	hb = upload(m[1], n);
+	hc = upload(m[2], n);
+	r1 = malloc(sizeof(double) * total);
+	r2 = malloc(sizeof(double) * total);
+
+	for (u_int rep = 0; rep < reps; ++rep) {
+		double t0 = now_sec();
+		u_int h1 = step_by_step(ha, hb, hc);
+		double t1 = now_sec();
+		u_int h2 = evaluate(ha, hb, hc);
+		double t2 = now_sec();
+
+		t_steps += t1 - t0;
+		t_eval += t2 - t1;
+		if (rep == 0) {
+			download(h1, r1, total);
+			download(h2, r2, total);
+			for (u_int i = 0; i < total; ++i) {
+				diff = fmax(diff, fabs(r1[i] - r2[i]));
+			}
+		}
+		release(h1);
+		release(h2);
+	}
+
+	printf("n=%u reps=%u\n", n, reps);
+	printf("4 calls     %10.2f ms\n", t_steps / reps * 1e3);
+	printf("MATRIX_EVAL %10.2f ms  (%.2fx)\n", t_eval / reps * 1e3, t_steps / t_eval);
+	printf("max |difference| %.1e\n", diff);
+
+	release(ha);
+	release(hb);
+	release(hc);
+	clnt_destroy(clnt);
+	return diff < 1e-9 ? 0 : 1;
+}
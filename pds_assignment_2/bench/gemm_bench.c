@@ -0,0 +1,125 @@
+/*
+ * Matrix multiply throughput: the original i-j-k loop against the blocked
+ * kernel_multiply(), square sizes from 16 up to max_n. The naive loop is
+ * skipped above max_naive (it needs minutes at 4096); there the blocked
+ * result is spot-checked against dot products instead.
+ *
+ *   ./bench/gemm_bench [max_n] [max_naive]
+ */
+#define _POSIX_C_SOURCE 199309L
+#include "../matrix_kernels.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double
+now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* the loop matrix_multiply_1_svc used to run */
+static void
+multiply_naive(const double *a, const double *b, double *out, size_t m, size_t n, size_t p)
+{
+	for (size_t i = 0; i < m; ++i) {
+		for (size_t j = 0; j < p; ++j) {
+			double sum = 0.0;
+			for (size_t k = 0; k < n; ++k) {
+				sum += a[i * n + k] * b[k * p + j];
+			}
+			out[i * p + j] = sum;
+		}
+	}
+}
+
+typedef void (*multiply_fn)(const double *, const double *, double *, size_t, size_t, size_t);
+
+/* best-of-runs GFLOP/s, repeating small sizes so each run takes ~0.2 s */
+static double
+gflops(multiply_fn fn, const double *a, const double *b, double *out, size_t n)
+{
+	double flops = 2.0 * n * n * n;
+	size_t reps = (size_t)(4e8 / flops) + 1;
+	int runs = flops > 1e10 ? 1 : 3;
+	double best = 0.0;
+
+	for (int r = 0; r < runs; ++r) {
+		double t0 = now_sec();
+		for (size_t i = 0; i < reps; ++i) {
+			fn(a, b, out, n, n, n);
+		}
+		double rate = flops * reps / (now_sec() - t0) / 1e9;
+		if (rate > best) {
+			best = rate;
+		}
+	}
+	return best;
+}
+
+int
+main(int argc, char *argv[])
+{
+	size_t max_n = argc > 1 ? strtoul(argv[1], NULL, 10) : 4096;
+	size_t max_naive = argc > 2 ? strtoul(argv[2], NULL, 10) : 1024;
+	int failures = 0;
+
+	printf("micro-kernel: %s\n", kernel_multiply_isa());
+	printf("%6s %12s %12s %8s %10s\n", "n", "naive GF/s", "blocked GF/s", "speedup", "max err");
+
+	for (size_t n = 16; n <= max_n; n *= 2) {
+		double *a = malloc(sizeof(double) * n * n);
+		double *b = malloc(sizeof(double) * n * n);
+		double *want = malloc(sizeof(double) * n * n);
+		double *got = malloc(sizeof(double) * n * n);
+		double naive = 0.0;
+		double blocked;
+		double err = 0.0;
+
+		if (a == NULL || b == NULL || want == NULL || got == NULL) {
+			fprintf(stderr, "out of memory at n=%zu\n", n);
+			return 1;
+		}
+		srand(42);
+		for (size_t i = 0; i < n * n; ++i) {
+			a[i] = (double)rand() / RAND_MAX - 0.5;
+			b[i] = (double)rand() / RAND_MAX - 0.5;
+		}
+
+		blocked = gflops(kernel_multiply, a, b, got, n);
+		if (n <= max_naive) {
+			naive = gflops(multiply_naive, a, b, want, n);
+			for (size_t i = 0; i < n * n; ++i) {
+				err = fmax(err, fabs(want[i] - got[i]));
+			}
+		} else {
+			for (size_t s = 0; s < 1000; ++s) {
+				size_t i = (size_t)rand() % n, j = (size_t)rand() % n;
+				double sum = 0.0;
+				for (size_t k = 0; k < n; ++k) {
+					sum += a[i * n + k] * b[k * n + j];
+				}
+				err = fmax(err, fabs(sum - got[i * n + j]));
+			}
+		}
+		if (err > 1e-9 * n) {
+			++failures;
+		}
+
+		if (naive > 0.0) {
+			printf("%6zu %12.2f %12.2f %7.1fx %10.1e\n", n, naive, blocked, blocked / naive, err);
+		} else {
+			printf("%6zu %12s %12.2f %8s %10.1e\n", n, "-", blocked, "-", err);
+		}
+		fflush(stdout);
+		free(a);
+		free(b);
+		free(want);
+		free(got);
+	}
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+/*
+ * Matrix inverse: the original Gauss-Jordan elimination against the blocked
+ * LU kernel_inverse(), square sizes from 64 up to max_n. Gauss-Jordan is
+ * skipped above max_gj. threads sets the kernel thread pool (0 = one per
+ * CPU); run with 1 and with N to see the parallel speedup.
+ *
+ *   ./bench/inverse_bench [max_n] [max_gj] [threads]
+ */
+#define _POSIX_C_SOURCE 199309L
+#include "../matrix_kernels.h"
+#include "../matrix_parallel.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double
+now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* the elimination matrix_inverse_1_svc used to run */
+static int
+inverse_gauss_jordan(const double *in, double *out, size_t n)
+{
+	size_t stride = n * 2;
+	double *augmented = malloc(sizeof(double) * n * stride);
+
+	if (augmented == NULL) {
+		return KERNEL_NO_MEMORY;
+	}
+	for (size_t i = 0; i < n; ++i) {
+		for (size_t j = 0; j < n; ++j) {
+			augmented[i * stride + j] = in[i * n + j];
+			augmented[i * stride + (n + j)] = (i == j) ? 1.0 : 0.0;
+		}
+	}
+	for (size_t col = 0; col < n; ++col) {
+		size_t pivot = col;
+		double max_val = fabs(augmented[col * stride + col]);
+
+		for (size_t row = col + 1; row < n; ++row) {
+			double val = fabs(augmented[row * stride + col]);
+			if (val > max_val) {
+				max_val = val;
+				pivot = row;
+			}
+		}
+		if (max_val < EPSILON) {
+			free(augmented);
+			return KERNEL_SINGULAR;
+		}
+		if (pivot != col) {
+			for (size_t j = 0; j < stride; ++j) {
+				double tmp = augmented[col * stride + j];
+				augmented[col * stride + j] = augmented[pivot * stride + j];
+				augmented[pivot * stride + j] = tmp;
+			}
+		}
+		{
+			double pivot_val = augmented[col * stride + col];
+			for (size_t j = 0; j < stride; ++j) {
+				augmented[col * stride + j] /= pivot_val;
+			}
+		}
+		for (size_t row = 0; row < n; ++row) {
+			if (row == col) {
+				continue;
+			}
+			double factor = augmented[row * stride + col];
+			if (fabs(factor) < EPSILON) {
+				continue;
+			}
+			for (size_t j = 0; j < stride; ++j) {
+				augmented[row * stride + j] -= factor * augmented[col * stride + j];
+			}
+		}
+	}
+	for (size_t i = 0; i < n; ++i) {
+		for (size_t j = 0; j < n; ++j) {
+			out[i * n + j] = augmented[i * stride + (n + j)];
+		}
+	}
+	free(augmented);
+	return KERNEL_OK;
+}
+
+/* max |A X - I| */
+static double
+residual(const double *a, const double *x, size_t n)
+{
+	double *ax = malloc(sizeof(double) * n * n);
+	double err = 0.0;
+
+	kernel_multiply(a, x, ax, n, n, n);
+	for (size_t i = 0; i < n; ++i) {
+		for (size_t j = 0; j < n; ++j) {
+			err = fmax(err, fabs(ax[i * n + j] - (i == j ? 1.0 : 0.0)));
+		}
+	}
+	free(ax);
+	return err;
+}
+
+int
+main(int argc, char *argv[])
+{
+	size_t max_n = argc > 1 ? strtoul(argv[1], NULL, 10) : 2048;
+	size_t max_gj = argc > 2 ? strtoul(argv[2], NULL, 10) : 1024;
+	int failures = 0;
+
+	if (argc > 3) {
+		parallel_set_threads((unsigned int)strtoul(argv[3], NULL, 10));
+	}
+	printf("threads: %u\n", parallel_threads());
+	printf("%6s %10s %10s %8s %10s %10s\n", "n", "GJ ms", "LU ms", "speedup", "GJ resid", "LU resid");
+
+	for (size_t n = 64; n <= max_n; n *= 2) {
+		double *a = malloc(sizeof(double) * n * n);
+		double *x = malloc(sizeof(double) * n * n);
+		double gj_ms = 0.0;
+		double lu_ms;
+		double gj_err = 0.0;
+		double lu_err;
+		double t0;
+
+		if (a == NULL || x == NULL) {
+			fprintf(stderr, "out of memory at n=%zu\n", n);
+			return 1;
+		}
+		srand(7);
+		for (size_t i = 0; i < n * n; ++i) {
+			a[i] = (double)rand() / RAND_MAX - 0.5;
+		}
+
+		t0 = now_sec();
+		if (kernel_inverse(a, x, n) != KERNEL_OK) {
+			fprintf(stderr, "LU reported n=%zu singular\n", n);
+			return 1;
+		}
+		lu_ms = (now_sec() - t0) * 1e3;
+		lu_err = residual(a, x, n);
+
+		if (n <= max_gj) {
+			t0 = now_sec();
+			inverse_gauss_jordan(a, x, n);
+			gj_ms = (now_sec() - t0) * 1e3;
+			gj_err = residual(a, x, n);
+			printf("%6zu %10.1f %10.1f %7.1fx %10.1e %10.1e\n", n, gj_ms, lu_ms, gj_ms / lu_ms,
+			       gj_err, lu_err);
+		} else {
+			printf("%6zu %10s %10.1f %8s %10s %10.1e\n", n, "-", lu_ms, "-", "-", lu_err);
+		}
+		/* random matrices are well conditioned enough for this bound */
+		if (lu_err > 1e-6 || (gj_ms > 0.0 && lu_err > 100 * gj_err + 1e-12)) {
+			++failures;
+		}
+		fflush(stdout);
+		free(a);
+		free(x);
+	}
+
+	{
+		/* singular input must still be rejected */
+		double s[9] = { 1, 2, 3, 2, 4, 6, 1, 0, 1 };
+		double out[9];
+
+		if (kernel_inverse(s, out, 3) != KERNEL_SINGULAR) {
+			printf("singular 3x3 not detected\n");
+			++failures;
+		}
+	}
+	return failures == 0 ? 0 : 1;
+}
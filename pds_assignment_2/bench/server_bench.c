@@ -0,0 +1,277 @@
+/*
+ * Server throughput under concurrent clients. Each client thread keeps one
+ * TCP connection and issues 20 x 20 MATRIX_MULTIPLY calls back to back;
+ * optionally one extra client keeps the server busy with large
+ * MATRIX_INVERSE_H calls, to show whether small requests still get through.
+ * With batch > 1 each call is instead one MATRIX_BATCH of that many
+ * multiplies; throughput then counts operations, latency whole batches.
+ * Run against a server started with --port (compare --threads 1 and N).
+ *
+ *   ./bench/server_bench <host> <port> [clients] [seconds] [slow_n] [batch]
+ */
+#define _DEFAULT_SOURCE
+#include "../matrixOp.h"
+#include <netdb.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SMALL_N 20
+
+/* the rpcgen stubs share one static result per procedure; client threads cannot */
+static struct timeval call_timeout = { 25, 0 };
+
+static struct sockaddr_in server_addr;
+static double deadline;
+static unsigned int slow_n;
+static unsigned int batch_size = 1;
+
+struct client_stats {
+	double *lat_us;
+	size_t count;
+	size_t cap;
+	size_t errors;
+	size_t ops;
+};
+
+static double
+now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static CLIENT *
+connect_v(u_long vers)
+{
+	struct sockaddr_in addr = server_addr;
+	int sock = RPC_ANYSOCK;
+	CLIENT *clnt = clnttcp_create(&addr, MATRIX_OP_PROG, vers, &sock, 0, 0);
+
+	if (clnt == NULL) {
+		clnt_pcreateerror("server_bench");
+	}
+	return clnt;
+}
+
+static void *
+small_client(void *arg)
+{
+	struct client_stats *st = arg;
+	double values[SMALL_N * SMALL_N];
+	matrix_pair pair;
+	matrix_batch batch;
+	CLIENT *clnt = connect_v(MATRIX_OP_V1);
+
+	if (clnt == NULL) {
+		st->errors++;
+		return NULL;
+	}
+	for (int i = 0; i < SMALL_N * SMALL_N; ++i) {
+		values[i] = (i % 7) - 3;
+	}
+	pair.a.rows = pair.a.cols = pair.b.rows = pair.b.cols = SMALL_N;
+	pair.a.data.data_len = pair.b.data.data_len = SMALL_N * SMALL_N;
+	pair.a.data.data_val = pair.b.data.data_val = values;
+
+	batch.ops.ops_len = batch_size;
+	batch.ops.ops_val = malloc(sizeof(matrix_op) * batch_size);
+	for (unsigned int i = 0; i < batch_size; ++i) {
+		batch.ops.ops_val[i].op = BATCH_MULTIPLY;
+		batch.ops.ops_val[i].a = pair.a;
+		batch.ops.ops_val[i].b = pair.b;
+	}
+
+	while (now_sec() < deadline) {
+		double t0 = now_sec();
+		bool_t ok;
+
+		if (batch_size > 1) {
+			batch_result res;
+
+			memset(&res, 0, sizeof(res));
+			if (clnt_call(clnt, MATRIX_BATCH, (xdrproc_t)xdr_matrix_batch, (caddr_t)&batch,
+				      (xdrproc_t)xdr_batch_result, (caddr_t)&res, call_timeout) != RPC_SUCCESS) {
+				st->errors++;
+				break;
+			}
+			ok = res.status == 0 && res.results.results_len == batch_size;
+			for (u_int i = 0; ok && i < res.results.results_len; ++i) {
+				ok = res.results.results_val[i].status == 0;
+			}
+			xdr_free((xdrproc_t)xdr_batch_result, (char *)&res);
+		} else {
+			matrix_result res;
+
+			memset(&res, 0, sizeof(res));
+			if (clnt_call(clnt, MATRIX_MULTIPLY, (xdrproc_t)xdr_matrix_pair, (caddr_t)&pair,
+				      (xdrproc_t)xdr_matrix_result, (caddr_t)&res, call_timeout) != RPC_SUCCESS) {
+				st->errors++;
+				break;
+			}
+			ok = res.status == 0;
+			xdr_free((xdrproc_t)xdr_matrix_result, (char *)&res);
+		}
+
+		if (!ok) {
+			st->errors++;
+			continue;
+		}
+		if (st->count == st->cap) {
+			st->cap = st->cap == 0 ? 4096 : st->cap * 2;
+			st->lat_us = realloc(st->lat_us, sizeof(double) * st->cap);
+		}
+		st->lat_us[st->count++] = (now_sec() - t0) * 1e6;
+		st->ops += batch_size;
+	}
+	free(batch.ops.ops_val);
+	clnt_destroy(clnt);
+	return NULL;
+}
+
+/* Upload one slow_n x slow_n matrix, then invert it until the deadline. */
+static void *
+slow_client(void *arg)
+{
+	size_t *done = arg;
+	CLIENT *clnt = connect_v(MATRIX_OP_V2);
+	matrix_dims dims = { slow_n, slow_n };
+	handle_result *res;
+	u_int handle;
+	double *data;
+	u_int total = slow_n * slow_n;
+
+	if (clnt == NULL) {
+		return NULL;
+	}
+	res = matrix_create_2(&dims, clnt);
+	if (res == NULL || res->status != 0) {
+		fprintf(stderr, "slow client: create failed\n");
+		return NULL;
+	}
+	handle = res->handle;
+	data = malloc(sizeof(double) * total);
+	for (u_int i = 0; i < total; ++i) {
+		data[i] = (i % slow_n == i / slow_n) ? slow_n : (double)((i * 7) % 11) / 11.0;
+	}
+	for (u_int off = 0; off < total; off += MAX_CHUNK_ELEMENTS) {
+		matrix_chunk chunk;
+
+		chunk.handle = handle;
+		chunk.offset = off;
+		chunk.data.data_len = total - off < MAX_CHUNK_ELEMENTS ? total - off : MAX_CHUNK_ELEMENTS;
+		chunk.data.data_val = data + off;
+		matrix_upload_2(&chunk, clnt);
+	}
+	free(data);
+
+	while (now_sec() < deadline) {
+		res = matrix_inverse_h_2(&handle, clnt);
+		if (res == NULL || res->status != 0) {
+			break;
+		}
+		matrix_free_2(&res->handle, clnt);
+		(*done)++;
+	}
+	matrix_free_2(&handle, clnt);
+	clnt_destroy(clnt);
+	return NULL;
+}
+
+static int
+compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct addrinfo hints, *ai;
+	unsigned int clients;
+	double seconds;
+	pthread_t *threads;
+	pthread_t slow_thread;
+	struct client_stats *stats;
+	struct client_stats all = { NULL, 0, 0, 0, 0 };
+	size_t slow_done = 0;
+	double started;
+
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s <host> <port> [clients] [seconds] [slow_n] [batch]\n", argv[0]);
+		return 1;
+	}
+	clients = argc > 3 ? (unsigned int)strtoul(argv[3], NULL, 10) : 16;
+	seconds = argc > 4 ? strtod(argv[4], NULL) : 5.0;
+	slow_n = argc > 5 ? (unsigned int)strtoul(argv[5], NULL, 10) : 0;
+	if (argc > 6) {
+		batch_size = (unsigned int)strtoul(argv[6], NULL, 10);
+		if (batch_size == 0 || batch_size > MAX_BATCH_OPS) {
+			fprintf(stderr, "batch must be between 1 and %d\n", MAX_BATCH_OPS);
+			return 1;
+		}
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(argv[1], NULL, &hints, &ai) != 0) {
+		fprintf(stderr, "%s: unknown host\n", argv[1]);
+		return 1;
+	}
+	memcpy(&server_addr, ai->ai_addr, sizeof(server_addr));
+	freeaddrinfo(ai);
+	server_addr.sin_port = htons((unsigned short)strtoul(argv[2], NULL, 10));
+
+	threads = calloc(clients, sizeof(*threads));
+	stats = calloc(clients, sizeof(*stats));
+	started = now_sec();
+	deadline = started + seconds;
+	if (slow_n > 0) {
+		pthread_create(&slow_thread, NULL, slow_client, &slow_done);
+	}
+	for (unsigned int i = 0; i < clients; ++i) {
+		pthread_create(&threads[i], NULL, small_client, &stats[i]);
+	}
+	for (unsigned int i = 0; i < clients; ++i) {
+		pthread_join(threads[i], NULL);
+		all.errors += stats[i].errors;
+		all.ops += stats[i].ops;
+		for (size_t j = 0; j < stats[i].count; ++j) {
+			if (all.count == all.cap) {
+				all.cap = all.cap == 0 ? 4096 : all.cap * 2;
+				all.lat_us = realloc(all.lat_us, sizeof(double) * all.cap);
+			}
+			all.lat_us[all.count++] = stats[i].lat_us[j];
+		}
+		free(stats[i].lat_us);
+	}
+	if (slow_n > 0) {
+		pthread_join(slow_thread, NULL);
+	}
+	seconds = now_sec() - started;
+
+	qsort(all.lat_us, all.count, sizeof(double), compare_double);
+	printf("clients=%u seconds=%.1f calls=%zu errors=%zu\n", clients, seconds, all.count, all.errors);
+	printf("throughput  %10.0f calls/s (%dx%d multiply)\n", all.count / seconds, SMALL_N, SMALL_N);
+	if (batch_size > 1) {
+		printf("            %10.0f ops/s (%u per MATRIX_BATCH)\n", all.ops / seconds, batch_size);
+	}
+	if (all.count > 0) {
+		printf("latency us  p50 %.0f  p99 %.0f  max %.0f\n", all.lat_us[all.count / 2],
+		       all.lat_us[all.count * 99 / 100], all.lat_us[all.count - 1]);
+	}
+	if (slow_n > 0) {
+		printf("slow client %zu inverses of %ux%u\n", slow_done, slow_n, slow_n);
+	}
+	free(all.lat_us);
+	free(stats);
+	free(threads);
+	return all.errors == 0 ? 0 : 1;
+}
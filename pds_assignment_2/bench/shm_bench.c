@@ -0,0 +1,206 @@
+/*
+ * Moving an n x n matrix to a same-host server and back, around a
+ * MATRIX_TRANSPOSE (cheap, so the transfer dominates): chunked upload and
+ * download through XDR arrays (version 2), through raw blocks (version 3),
+ * and through a shared-memory segment (version 4). The segment is created
+ * once per size, as a long-lived client would keep it; each call copies the
+ * operand in and the result out. Run against a server on this host started
+ * with --port.
+ *
+ *   ./bench/shm_bench <host> <port> [max_n] [reps]
+ */
+#define _DEFAULT_SOURCE
+#include "../matrixOp.h"
+#include "../matrix_shm.h"
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+static CLIENT *handles;	/* versions 2 and 3: only the connection that made a handle may upload to it */
+static CLIENT *v4;
+
+static double
+now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static u_int
+chunk_len(u_int total, u_int off)
+{
+	return total - off < MAX_CHUNK_ELEMENTS ? total - off : MAX_CHUNK_ELEMENTS;
+}
+
+static CLIENT *
+as(rpcvers_t vers)
+{
+	clnt_control(handles, CLSET_VERS, (char *)&vers);
+	return handles;
+}
+
+static void
+check(const char *what, int failed)
+{
+	if (failed) {
+		fprintf(stderr, "%s failed\n", what);
+		exit(1);
+	}
+}
+
+/* Upload, transpose by handle, download; raw selects the version 3 transfers. */
+static void
+by_handle(const double *in, double *out, u_int n, int raw)
+{
+	matrix_dims dims = { n, n };
+	handle_result *res = matrix_create_2(&dims, as(MATRIX_OP_V2));
+	u_int total = n * n;
+	u_int h, t;
+
+	check("create", res == NULL || res->status != 0);
+	h = res->handle;
+	for (u_int off = 0; off < total; off += MAX_CHUNK_ELEMENTS) {
+		u_int len = chunk_len(total, off);
+
+		if (raw) {
+			raw_chunk c = { h, off, RAW_FORMAT_LE_DOUBLE, { len * sizeof(double), (char *)(in + off) } };
+			res = matrix_upload_raw_3(&c, as(MATRIX_OP_V3));
+		} else {
+			matrix_chunk c = { h, off, { len, (double *)in + off } };
+			res = matrix_upload_2(&c, as(MATRIX_OP_V2));
+		}
+		check("upload", res == NULL || res->status != 0);
+	}
+	res = matrix_transpose_h_2(&h, as(MATRIX_OP_V2));
+	check("transpose", res == NULL || res->status != 0);
+	t = res->handle;
+	for (u_int off = 0; off < total; off += MAX_CHUNK_ELEMENTS) {
+		chunk_request req = { t, off, chunk_len(total, off) };
+
+		if (raw) {
+			raw_chunk_result *r = matrix_download_raw_3(&req, as(MATRIX_OP_V3));
+
+			check("download", r == NULL || r->status != 0);
+			memcpy(out + off, r->data.data_val, r->data.data_len);
+			xdr_free((xdrproc_t)xdr_raw_chunk_result, (char *)r);
+		} else {
+			chunk_result *r = matrix_download_2(&req, as(MATRIX_OP_V2));
+
+			check("download", r == NULL || r->status != 0);
+			memcpy(out + off, r->data.data_val, sizeof(double) * r->data.data_len);
+			xdr_free((xdrproc_t)xdr_chunk_result, (char *)r);
+		}
+	}
+	matrix_free_2(&h, as(MATRIX_OP_V2));
+	matrix_free_2(&t, as(MATRIX_OP_V2));
+}
+
+static void
+by_shm(const double *in, double *out, u_int n, const char *name, const shm_segment *seg)
+{
+	size_t bytes = sizeof(double) * n * n;
+	shm_request req;
+	shm_result *res;
+
+	memcpy(seg->base, in, bytes);
+	memset(&req, 0, sizeof(req));
+	req.segment = (char *)name;
+	req.a.rows = n;
+	req.a.cols = n;
+	req.result = bytes;
+	res = matrix_transpose_shm_4(&req, v4);
+	check("transpose_shm", res == NULL || res->status != 0);
+	/* a real client would use the result in place; copy to compare */
+	memcpy(out, (char *)seg->base + bytes, bytes);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct addrinfo hints, *ai;
+	struct sockaddr_in addr;
+	u_int max_n, reps;
+	int failures = 0;
+
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s <host> <port> [max_n] [reps]\n", argv[0]);
+		return 1;
+	}
+	max_n = argc > 3 ? (u_int)strtoul(argv[3], NULL, 10) : 2048;
+	reps = argc > 4 ? (u_int)strtoul(argv[4], NULL, 10) : 5;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(argv[1], NULL, &hints, &ai) != 0) {
+		fprintf(stderr, "%s: unknown host\n", argv[1]);
+		return 1;
+	}
+	memcpy(&addr, ai->ai_addr, sizeof(addr));
+	freeaddrinfo(ai);
+	addr.sin_port = htons((unsigned short)strtoul(argv[2], NULL, 10));
+	{
+		CLIENT **clients[] = { &handles, &v4 };
+		rpcvers_t vers[] = { MATRIX_OP_V2, MATRIX_OP_V4 };
+
+		for (int i = 0; i < 2; ++i) {
+			struct sockaddr_in a = addr;
+			int sock = RPC_ANYSOCK;
+
+			*clients[i] = clnttcp_create(&a, MATRIX_OP_PROG, vers[i], &sock, 0, 0);
+			if (*clients[i] == NULL) {
+				clnt_pcreateerror(argv[1]);
+				return 1;
+			}
+		}
+	}
+
+	printf("%6s %10s %10s %10s %8s\n", "n", "xdr ms", "raw ms", "shm ms", "shm x");
+	for (u_int n = 128; n <= max_n; n *= 2) {
+		size_t total = (size_t)n * n;
+		double *in = malloc(sizeof(double) * total);
+		double *out = malloc(sizeof(double) * total);
+		double t[3] = { 0.0, 0.0, 0.0 };
+		char name[SHM_NAME_LEN];
+		shm_segment seg;
+
+		check("shm_segment_create", shm_segment_create(2 * sizeof(double) * total, name, &seg) != 0);
+		for (size_t i = 0; i < total; ++i) {
+			in[i] = (double)i;
+		}
+		for (u_int r = 0; r < reps; ++r) {
+			for (int mode = 0; mode < 3; ++mode) {
+				double t0 = now_sec();
+
+				memset(out, 0, sizeof(double) * total);
+				if (mode < 2) {
+					by_handle(in, out, n, mode);
+				} else {
+					by_shm(in, out, n, name, &seg);
+				}
+				t[mode] += now_sec() - t0;
+				if (out[1] != in[n] || out[total - 2] != in[total - 1 - n]) {
+					++failures;
+				}
+			}
+		}
+		printf("%6u %10.2f %10.2f %10.2f %7.1fx\n", n, t[0] / reps * 1e3, t[1] / reps * 1e3,
+		       t[2] / reps * 1e3, t[0] / t[2]);
+		fflush(stdout);
+		shm_segment_close(&seg);
+		shm_unlink(name);
+		free(in);
+		free(out);
+	}
+	if (failures != 0) {
+		printf("%d transposes came back wrong\n", failures);
+	}
+	clnt_destroy(handles);
+	clnt_destroy(v4);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,187 @@
+/*
+ * Sparse (CSR) against dense kernels on n x n matrices at several
+ * densities: bytes on the wire (XDR dense_matrix vs csr_matrix), multiply
+ * by a dense matrix (SpMM) and by a sparse one (SpGEMM) against the
+ * blocked dense multiply, kernel_multiply_auto, and SpMV, add and
+ * transpose against their dense versions. Results are checked against
+ * the dense kernels.
+ *
+ *   ./bench/sparse_bench [n] [threads]
+ */
+#define _POSIX_C_SOURCE 199309L
+#include "../matrix_kernels.h"
+#include "../matrix_parallel.h"
+#include "../matrix_sparse.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double
+now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void
+random_sparse(double *m, size_t count, double density)
+{
+	for (size_t i = 0; i < count; ++i) {
+		m[i] = (double)rand() / RAND_MAX < density ? (double)rand() / RAND_MAX - 0.5 : 0.0;
+	}
+}
+
+static void
+to_dense(const sparse_matrix *s, double *out)
+{
+	memset(out, 0, sizeof(double) * s->rows * s->cols);
+	for (unsigned int r = 0; r < s->rows; ++r) {
+		for (unsigned int i = s->row_ptr[r]; i < s->row_ptr[r + 1]; ++i) {
+			out[(size_t)r * s->cols + s->col_idx[i]] = s->values[i];
+		}
+	}
+}
+
+static double
+max_diff(const double *x, const double *y, size_t count)
+{
+	double err = 0.0;
+
+	for (size_t i = 0; i < count; ++i) {
+		err = fmax(err, fabs(x[i] - y[i]));
+	}
+	return err;
+}
+
+int
+main(int argc, char *argv[])
+{
+	static const double densities[] = { 0.001, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2 };
+	size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1024;
+	size_t nn = n * n;
+	double *a = malloc(sizeof(double) * nn);
+	double *b = malloc(sizeof(double) * nn);
+	double *bd = malloc(sizeof(double) * nn);
+	double *ref = malloc(sizeof(double) * nn);
+	double *out = malloc(sizeof(double) * nn);
+	double *x = malloc(sizeof(double) * n);
+	double *y = malloc(sizeof(double) * n);
+	double *y_ref = malloc(sizeof(double) * n);
+	int failures = 0;
+
+	if (argc > 2) {
+		parallel_set_threads((unsigned int)strtoul(argv[2], NULL, 10));
+	}
+	srand(11);
+	for (size_t i = 0; i < nn; ++i) {
+		bd[i] = (double)rand() / RAND_MAX - 0.5;
+	}
+	for (size_t i = 0; i < n; ++i) {
+		x[i] = (double)rand() / RAND_MAX - 0.5;
+	}
+
+	printf("n=%zu threads=%u; times in ms\n", n, parallel_threads());
+	printf("%7s %8s %8s %6s %8s %8s %8s %8s %8s %7s %7s %7s %7s %7s %7s\n", "density",
+	       "dense MB", "csr MB", "wire x", "gemm", "spmm", "spgemm", "auto", "spmm x", "gemv",
+	       "spmv", "add", "sp add", "transp", "sp tr");
+
+	for (size_t d = 0; d < sizeof(densities) / sizeof(densities[0]); ++d) {
+		sparse_matrix sa, sb, sc;
+		double t0, t_gemm, t_spmm, t_spgemm, t_auto, t_gemv, t_spmv, t_add, t_spadd, t_tr, t_sptr;
+		double dense_bytes = 12.0 + 8.0 * nn;
+		double csr_bytes;
+
+		random_sparse(a, nn, densities[d]);
+		random_sparse(b, nn, densities[d]);
+		if (sparse_from_dense(a, n, n, &sa) != KERNEL_OK ||
+		    sparse_from_dense(b, n, n, &sb) != KERNEL_OK) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+		csr_bytes = 20.0 + 4.0 * (n + 1) + 12.0 * sparse_nnz(&sa);
+
+		/* sparse x dense */
+		t0 = now_sec();
+		kernel_multiply(a, bd, ref, n, n, n);
+		t_gemm = now_sec() - t0;
+		t0 = now_sec();
+		sparse_multiply_dense(&sa, bd, out, n);
+		t_spmm = now_sec() - t0;
+		failures += max_diff(ref, out, nn) > 1e-9;
+		t0 = now_sec();
+		kernel_multiply_auto(a, bd, out, n, n, n);
+		t_auto = now_sec() - t0;
+		failures += max_diff(ref, out, nn) > 1e-9;
+
+		/* sparse x sparse */
+		kernel_multiply(a, b, ref, n, n, n);
+		t0 = now_sec();
+		if (sparse_multiply(&sa, &sb, &sc) != KERNEL_OK) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+		t_spgemm = now_sec() - t0;
+		to_dense(&sc, out);
+		failures += max_diff(ref, out, nn) > 1e-9;
+		sparse_free(&sc);
+
+		/* matrix-vector: dense as a one-column multiply */
+		t0 = now_sec();
+		kernel_multiply(a, x, y_ref, n, n, 1);
+		t_gemv = now_sec() - t0;
+		t0 = now_sec();
+		sparse_multiply_vector(&sa, x, y);
+		t_spmv = now_sec() - t0;
+		failures += max_diff(y_ref, y, n) > 1e-9;
+
+		t0 = now_sec();
+		kernel_add(a, b, ref, nn);
+		t_add = now_sec() - t0;
+		t0 = now_sec();
+		if (sparse_add(&sa, &sb, &sc) != KERNEL_OK) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+		t_spadd = now_sec() - t0;
+		to_dense(&sc, out);
+		failures += max_diff(ref, out, nn) > 0.0;
+		sparse_free(&sc);
+
+		t0 = now_sec();
+		kernel_transpose(a, ref, n, n);
+		t_tr = now_sec() - t0;
+		t0 = now_sec();
+		if (sparse_transpose(&sa, &sc) != KERNEL_OK) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+		t_sptr = now_sec() - t0;
+		to_dense(&sc, out);
+		failures += max_diff(ref, out, nn) > 0.0;
+		sparse_free(&sc);
+
+		printf("%6.1f%% %8.2f %8.2f %5.0fx %8.1f %8.1f %8.1f %8.1f %7.1fx %7.2f %7.2f %7.2f %7.2f %7.2f %7.2f\n",
+		       densities[d] * 100, dense_bytes / 1e6, csr_bytes / 1e6, dense_bytes / csr_bytes,
+		       t_gemm * 1e3, t_spmm * 1e3, t_spgemm * 1e3, t_auto * 1e3, t_gemm / t_spmm,
+		       t_gemv * 1e3, t_spmv * 1e3, t_add * 1e3, t_spadd * 1e3, t_tr * 1e3, t_sptr * 1e3);
+		fflush(stdout);
+		sparse_free(&sa);
+		sparse_free(&sb);
+	}
+	if (failures != 0) {
+		printf("%d sparse results differ from the dense kernels\n", failures);
+	}
+	free(a);
+	free(b);
+	free(bd);
+	free(ref);
+	free(out);
+	free(x);
+	free(y);
+	free(y_ref);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+/*
+ * Transpose bandwidth: the original row-by-row loop against the tiled
+ * kernel_transpose(), and kernel_transpose_square() in place, over square
+ * and rectangular shapes. GB/s counts every element read once and written
+ * once. threads sets the kernel thread pool (0 = one per CPU).
+ *
+ *   ./bench/transpose_bench [max_n] [threads]
+ */
+#define _POSIX_C_SOURCE 199309L
+#include "../matrix_kernels.h"
+#include "../matrix_parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double
+now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* the loop matrix_transpose_1_svc used to run */
+static void
+transpose_naive(const double *in, double *out, size_t rows, size_t cols)
+{
+	for (size_t i = 0; i < rows; ++i) {
+		for (size_t j = 0; j < cols; ++j) {
+			out[j * rows + i] = in[i * cols + j];
+		}
+	}
+}
+
+/* seconds per call after one untimed call (page faults), repeating for about 0.2 s */
+#define TIME_CALLS(call, secs) do { \
+	int reps_ = 0; \
+	double t0_; \
+	call; \
+	t0_ = now_sec(); \
+	do { \
+		call; \
+		++reps_; \
+	} while (now_sec() - t0_ < 0.2); \
+	secs = (now_sec() - t0_) / reps_; \
+} while (0)
+
+int
+main(int argc, char *argv[])
+{
+	static const size_t shapes[][2] = {
+		{ 20, 20 }, { 64, 64 }, { 256, 256 }, { 1024, 1024 }, { 2048, 2048 }, { 4096, 4096 },
+		{ 1021, 1021 }, { 1000, 3000 }, { 3000, 1000 }, { 16, 65536 }, { 65536, 16 },
+		{ 256, 16384 }, { 16384, 256 },
+	};
+	size_t max_n = argc > 1 ? strtoul(argv[1], NULL, 10) : 4096;
+	int failures = 0;
+
+	if (argc > 2) {
+		parallel_set_threads((unsigned int)strtoul(argv[2], NULL, 10));
+	}
+	printf("threads: %u\n", parallel_threads());
+	printf("%13s %10s %10s %8s %12s\n", "shape", "naive GB/s", "tiled GB/s", "speedup",
+	       "in-place GB/s");
+
+	for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s) {
+		size_t rows = shapes[s][0];
+		size_t cols = shapes[s][1];
+		size_t count = rows * cols;
+		double bytes = 2.0 * sizeof(double) * count;
+		double *in, *ref, *out;
+		double naive_s, tiled_s, square_s = 0.0;
+		char shape[32];
+
+		if (rows > max_n * max_n / cols || cols > max_n * max_n / rows) {
+			continue;
+		}
+		in = malloc(sizeof(double) * count);
+		ref = malloc(sizeof(double) * count);
+		out = malloc(sizeof(double) * count);
+		if (in == NULL || ref == NULL || out == NULL) {
+			fprintf(stderr, "out of memory at %zu x %zu\n", rows, cols);
+			return 1;
+		}
+		for (size_t i = 0; i < count; ++i) {
+			in[i] = (double)i;
+		}
+
+		TIME_CALLS(transpose_naive(in, ref, rows, cols), naive_s);
+		TIME_CALLS(kernel_transpose(in, out, rows, cols), tiled_s);
+		failures += memcmp(ref, out, sizeof(double) * count) != 0;
+		if (rows == cols) {
+			/* pairs of calls leave in as it was */
+			TIME_CALLS((kernel_transpose_square(in, rows), kernel_transpose_square(in, rows)),
+				   square_s);
+			square_s /= 2;
+			kernel_transpose_square(in, rows);
+			failures += memcmp(ref, in, sizeof(double) * count) != 0;
+		}
+
+		snprintf(shape, sizeof(shape), "%zux%zu", rows, cols);
+		if (rows == cols) {
+			printf("%13s %10.2f %10.2f %7.1fx %12.2f\n", shape, bytes / naive_s / 1e9,
+			       bytes / tiled_s / 1e9, naive_s / tiled_s, bytes / square_s / 1e9);
+		} else {
+			printf("%13s %10.2f %10.2f %7.1fx %12s\n", shape, bytes / naive_s / 1e9,
+			       bytes / tiled_s / 1e9, naive_s / tiled_s, "-");
+		}
+		fflush(stdout);
+		free(in);
+		free(ref);
+		free(out);
+	}
+	if (failures != 0) {
+		printf("%d transposes differ from the naive loop\n", failures);
+	}
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+/*
+ * Encode/decode cost of one chunk of doubles: the XDR array used by
+ * versions 1 and 2 (xdr_matrix_chunk, one xdr_double call per element)
+ * against the raw block of version 3 (xdr_raw_chunk, one copy). Both run
+ * on an in-memory XDR stream into preallocated buffers, so only the
+ * encoding itself is timed.
+ *
+ *   ./bench/xdr_bench [max_elements]
+ */
+#define _POSIX_C_SOURCE 199309L
+#include "../matrixOp.h"
+#include "../matrix_raw.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double
+now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Seconds per encode and per decode of obj through proc; decoded into out. */
+static void
+time_codec(xdrproc_t proc, void *obj, void *out, char *buf, u_int size, size_t reps,
+	   double *enc, double *dec)
+{
+	XDR xdrs;
+	double t0;
+
+	t0 = now_sec();
+	for (size_t r = 0; r < reps; ++r) {
+		xdrmem_create(&xdrs, buf, size, XDR_ENCODE);
+		if (!proc(&xdrs, obj)) {
+			fprintf(stderr, "encode failed\n");
+			exit(1);
+		}
+	}
+	*enc = (now_sec() - t0) / reps;
+
+	t0 = now_sec();
+	for (size_t r = 0; r < reps; ++r) {
+		xdrmem_create(&xdrs, buf, size, XDR_DECODE);
+		if (!proc(&xdrs, out)) {
+			fprintf(stderr, "decode failed\n");
+			exit(1);
+		}
+	}
+	*dec = (now_sec() - t0) / reps;
+}
+
+int
+main(int argc, char *argv[])
+{
+	u_int max_n = argc > 1 ? (u_int)strtoul(argv[1], NULL, 10) : MAX_CHUNK_ELEMENTS;
+	u_int size = MAX_RAW_CHUNK_BYTES + 1024;
+	char *buf = malloc(size);
+	double *values = malloc(sizeof(double) * MAX_CHUNK_ELEMENTS);
+	double *decoded = malloc(sizeof(double) * MAX_CHUNK_ELEMENTS);
+	int failures = 0;
+
+	if (max_n > MAX_CHUNK_ELEMENTS) {
+		max_n = MAX_CHUNK_ELEMENTS;
+	}
+	for (u_int i = 0; i < MAX_CHUNK_ELEMENTS; ++i) {
+		values[i] = (double)i / 3.0 - 1000.0;
+	}
+
+	printf("%8s %12s %12s %12s %12s %8s %8s\n", "elements", "xdr enc GB/s", "raw enc GB/s",
+	       "xdr dec GB/s", "raw dec GB/s", "enc x", "dec x");
+	for (u_int n = 16; n <= max_n; n *= 4) {
+		size_t reps = (64u << 20) / (n * sizeof(double));
+		double bytes = (double)n * sizeof(double) / 1e9;
+		matrix_chunk chunk = { 1, 0, { n, values } };
+		matrix_chunk chunk_out = { 0, 0, { n, decoded } };
+		raw_chunk raw = { 1, 0, RAW_FORMAT_LE_DOUBLE, { n * sizeof(double), (char *)values } };
+		raw_chunk raw_out = { 0, 0, 0, { n * sizeof(double), (char *)decoded } };
+		double xe, xd, re, rd;
+
+		time_codec((xdrproc_t)xdr_matrix_chunk, &chunk, &chunk_out, buf, size, reps, &xe, &xd);
+		if (memcmp(decoded, values, sizeof(double) * n) != 0) {
+			++failures;
+		}
+		memset(decoded, 0, sizeof(double) * n);
+		time_codec((xdrproc_t)xdr_raw_chunk, &raw, &raw_out, buf, size, reps, &re, &rd);
+		raw_byte_order(decoded, n);
+		if (memcmp(decoded, values, sizeof(double) * n) != 0) {
+			++failures;
+		}
+
+		printf("%8u %12.2f %12.2f %12.2f %12.2f %7.1fx %7.1fx\n", n, bytes / xe, bytes / re,
+		       bytes / xd, bytes / rd, xe / re, xd / rd);
+		fflush(stdout);
+	}
+	if (failures != 0) {
+		printf("%d round trips did not reproduce the input\n", failures);
+	}
+	free(buf);
+	free(values);
+	free(decoded);
+	return failures == 0 ? 0 : 1;
+}
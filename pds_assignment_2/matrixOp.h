@@ -15,6 +15,15 @@ extern "C" {
 
 #define MAX_MATRIX_ELEMENTS 400
 #define ERROR_MESSAGE_LEN 256
+#define MAX_CHUNK_ELEMENTS 65536
+#define MAX_BATCH_OPS 1024
+#define MAX_EXPR_NODES 64
+#define MAX_RAW_MATRIX_BYTES 3200
+#define MAX_RAW_CHUNK_BYTES 524288
+#define RAW_FORMAT_LE_DOUBLE 1
+#define SHM_NAME_LEN 64
+#define MAX_SPARSE_NNZ 1048576
+#define MAX_DENSE_ELEMENTS 1048576
 
 struct matrix {
 	u_int rows;
@@ -32,6 +41,19 @@ struct matrix_pair {
 };
 typedef struct matrix_pair matrix_pair;
 
+struct scaled_matrix {
+	double alpha;
+	matrix a;
+};
+typedef struct scaled_matrix scaled_matrix;
+
+struct scaled_pair {
+	double alpha;
+	matrix a;
+	matrix b;
+};
+typedef struct scaled_pair scaled_pair;
+
 struct matrix_result {
 	int status;
 	matrix value;
@@ -39,6 +61,252 @@ struct matrix_result {
 };
 typedef struct matrix_result matrix_result;
 
+enum batch_opcode {
+	BATCH_ADD = 1,
+	BATCH_MULTIPLY = 2,
+	BATCH_TRANSPOSE = 3,
+	BATCH_INVERSE = 4,
+};
+typedef enum batch_opcode batch_opcode;
+
+struct matrix_op {
+	batch_opcode op;
+	matrix a;
+	matrix b;
+};
+typedef struct matrix_op matrix_op;
+
+struct matrix_batch {
+	struct {
+		u_int ops_len;
+		matrix_op *ops_val;
+	} ops;
+};
+typedef struct matrix_batch matrix_batch;
+
+struct batch_result {
+	int status;
+	struct {
+		u_int results_len;
+		matrix_result *results_val;
+	} results;
+	char *message;
+};
+typedef struct batch_result batch_result;
+
+struct matrix_dims {
+	u_int rows;
+	u_int cols;
+};
+typedef struct matrix_dims matrix_dims;
+
+struct matrix_chunk {
+	u_int handle;
+	u_int offset;
+	struct {
+		u_int data_len;
+		double *data_val;
+	} data;
+};
+typedef struct matrix_chunk matrix_chunk;
+
+struct chunk_request {
+	u_int handle;
+	u_int offset;
+	u_int count;
+};
+typedef struct chunk_request chunk_request;
+
+struct handle_pair {
+	u_int a;
+	u_int b;
+};
+typedef struct handle_pair handle_pair;
+
+struct scaled_handle {
+	double alpha;
+	u_int a;
+};
+typedef struct scaled_handle scaled_handle;
+
+struct scaled_handle_pair {
+	double alpha;
+	u_int a;
+	u_int b;
+};
+typedef struct scaled_handle_pair scaled_handle_pair;
+
+struct handle_result {
+	int status;
+	u_int handle;
+	u_int rows;
+	u_int cols;
+	char *message;
+};
+typedef struct handle_result handle_result;
+
+struct chunk_result {
+	int status;
+	struct {
+		u_int data_len;
+		double *data_val;
+	} data;
+	char *message;
+};
+typedef struct chunk_result chunk_result;
+
+enum expr_opcode {
+	EXPR_HANDLE = 0,
+	EXPR_ADD = 1,
+	EXPR_MULTIPLY = 2,
+	EXPR_TRANSPOSE = 3,
+	EXPR_INVERSE = 4,
+	EXPR_SUBTRACT = 5,
+	EXPR_HADAMARD = 6,
+	EXPR_SCALE = 7,
+	EXPR_AXPY = 8,
+};
+typedef enum expr_opcode expr_opcode;
+
+struct expr_node {
+	expr_opcode op;
+	u_int a;
+	u_int b;
+	double alpha;
+};
+typedef struct expr_node expr_node;
+
+struct matrix_expr {
+	struct {
+		u_int nodes_len;
+		expr_node *nodes_val;
+	} nodes;
+};
+typedef struct matrix_expr matrix_expr;
+
+struct raw_matrix {
+	u_int rows;
+	u_int cols;
+	u_int format;
+	struct {
+		u_int data_len;
+		char *data_val;
+	} data;
+};
+typedef struct raw_matrix raw_matrix;
+
+struct raw_pair {
+	raw_matrix a;
+	raw_matrix b;
+};
+typedef struct raw_pair raw_pair;
+
+struct raw_result {
+	int status;
+	raw_matrix value;
+	char *message;
+};
+typedef struct raw_result raw_result;
+
+struct raw_chunk {
+	u_int handle;
+	u_int offset;
+	u_int format;
+	struct {
+		u_int data_len;
+		char *data_val;
+	} data;
+};
+typedef struct raw_chunk raw_chunk;
+
+struct raw_chunk_result {
+	int status;
+	u_int format;
+	struct {
+		u_int data_len;
+		char *data_val;
+	} data;
+	char *message;
+};
+typedef struct raw_chunk_result raw_chunk_result;
+
+struct shm_matrix {
+	u_int rows;
+	u_int cols;
+	u_quad_t offset;
+};
+typedef struct shm_matrix shm_matrix;
+
+struct shm_request {
+	char *segment;
+	shm_matrix a;
+	shm_matrix b;
+	u_quad_t result;
+};
+typedef struct shm_request shm_request;
+
+struct shm_result {
+	int status;
+	u_int rows;
+	u_int cols;
+	char *message;
+};
+typedef struct shm_result shm_result;
+
+struct csr_matrix {
+	u_int rows;
+	u_int cols;
+	struct {
+		u_int row_ptr_len;
+		u_int *row_ptr_val;
+	} row_ptr;
+	struct {
+		u_int col_idx_len;
+		u_int *col_idx_val;
+	} col_idx;
+	struct {
+		u_int values_len;
+		double *values_val;
+	} values;
+};
+typedef struct csr_matrix csr_matrix;
+
+struct csr_pair {
+	csr_matrix a;
+	csr_matrix b;
+};
+typedef struct csr_pair csr_pair;
+
+struct csr_result {
+	int status;
+	csr_matrix value;
+	char *message;
+};
+typedef struct csr_result csr_result;
+
+struct dense_matrix {
+	u_int rows;
+	u_int cols;
+	struct {
+		u_int data_len;
+		double *data_val;
+	} data;
+};
+typedef struct dense_matrix dense_matrix;
+
+struct csr_dense_pair {
+	csr_matrix a;
+	dense_matrix b;
+};
+typedef struct csr_dense_pair csr_dense_pair;
+
+struct dense_result {
+	int status;
+	dense_matrix value;
+	char *message;
+};
+typedef struct dense_result dense_result;
+
 #define MATRIX_OP_PROG 0x31234567
 #define MATRIX_OP_V1 1
 
@@ -55,6 +323,21 @@ extern  matrix_result * matrix_transpose_1_svc(matrix *, struct svc_req *);
 #define MATRIX_INVERSE 4
 extern  matrix_result * matrix_inverse_1(matrix *, CLIENT *);
 extern  matrix_result * matrix_inverse_1_svc(matrix *, struct svc_req *);
+#define MATRIX_BATCH 5
+extern  batch_result * matrix_batch_1(matrix_batch *, CLIENT *);
+extern  batch_result * matrix_batch_1_svc(matrix_batch *, struct svc_req *);
+#define MATRIX_SUBTRACT 6
+extern  matrix_result * matrix_subtract_1(matrix_pair *, CLIENT *);
+extern  matrix_result * matrix_subtract_1_svc(matrix_pair *, struct svc_req *);
+#define MATRIX_HADAMARD 7
+extern  matrix_result * matrix_hadamard_1(matrix_pair *, CLIENT *);
+extern  matrix_result * matrix_hadamard_1_svc(matrix_pair *, struct svc_req *);
+#define MATRIX_SCALE 8
+extern  matrix_result * matrix_scale_1(scaled_matrix *, CLIENT *);
+extern  matrix_result * matrix_scale_1_svc(scaled_matrix *, struct svc_req *);
+#define MATRIX_AXPY 9
+extern  matrix_result * matrix_axpy_1(scaled_pair *, CLIENT *);
+extern  matrix_result * matrix_axpy_1_svc(scaled_pair *, struct svc_req *);
 extern int matrix_op_prog_1_freeresult (SVCXPRT *, xdrproc_t, caddr_t);
 
 #else /* K&R C */
@@ -70,20 +353,297 @@ extern  matrix_result * matrix_transpose_1_svc();
 #define MATRIX_INVERSE 4
 extern  matrix_result * matrix_inverse_1();
 extern  matrix_result * matrix_inverse_1_svc();
+#define MATRIX_BATCH 5
+extern  batch_result * matrix_batch_1();
+extern  batch_result * matrix_batch_1_svc();
+#define MATRIX_SUBTRACT 6
+extern  matrix_result * matrix_subtract_1();
+extern  matrix_result * matrix_subtract_1_svc();
+#define MATRIX_HADAMARD 7
+extern  matrix_result * matrix_hadamard_1();
+extern  matrix_result * matrix_hadamard_1_svc();
+#define MATRIX_SCALE 8
+extern  matrix_result * matrix_scale_1();
+extern  matrix_result * matrix_scale_1_svc();
+#define MATRIX_AXPY 9
+extern  matrix_result * matrix_axpy_1();
+extern  matrix_result * matrix_axpy_1_svc();
 extern int matrix_op_prog_1_freeresult ();
 #endif /* K&R C */
+#define MATRIX_OP_V2 2
+
+#if defined(__STDC__) || defined(__cplusplus)
+#define MATRIX_CREATE 1
+extern  handle_result * matrix_create_2(matrix_dims *, CLIENT *);
+extern  handle_result * matrix_create_2_svc(matrix_dims *, struct svc_req *);
+#define MATRIX_UPLOAD 2
+extern  handle_result * matrix_upload_2(matrix_chunk *, CLIENT *);
+extern  handle_result * matrix_upload_2_svc(matrix_chunk *, struct svc_req *);
+#define MATRIX_DOWNLOAD 3
+extern  chunk_result * matrix_download_2(chunk_request *, CLIENT *);
+extern  chunk_result * matrix_download_2_svc(chunk_request *, struct svc_req *);
+#define MATRIX_FREE 4
+extern  handle_result * matrix_free_2(u_int *, CLIENT *);
+extern  handle_result * matrix_free_2_svc(u_int *, struct svc_req *);
+#define MATRIX_ADD_H 5
+extern  handle_result * matrix_add_h_2(handle_pair *, CLIENT *);
+extern  handle_result * matrix_add_h_2_svc(handle_pair *, struct svc_req *);
+#define MATRIX_MULTIPLY_H 6
+extern  handle_result * matrix_multiply_h_2(handle_pair *, CLIENT *);
+extern  handle_result * matrix_multiply_h_2_svc(handle_pair *, struct svc_req *);
+#define MATRIX_TRANSPOSE_H 7
+extern  handle_result * matrix_transpose_h_2(u_int *, CLIENT *);
+extern  handle_result * matrix_transpose_h_2_svc(u_int *, struct svc_req *);
+#define MATRIX_INVERSE_H 8
+extern  handle_result * matrix_inverse_h_2(u_int *, CLIENT *);
+extern  handle_result * matrix_inverse_h_2_svc(u_int *, struct svc_req *);
+#define MATRIX_EVAL 9
+extern  handle_result * matrix_eval_2(matrix_expr *, CLIENT *);
+extern  handle_result * matrix_eval_2_svc(matrix_expr *, struct svc_req *);
+#define MATRIX_SUBTRACT_H 10
+extern  handle_result * matrix_subtract_h_2(handle_pair *, CLIENT *);
+extern  handle_result * matrix_subtract_h_2_svc(handle_pair *, struct svc_req *);
+#define MATRIX_HADAMARD_H 11
+extern  handle_result * matrix_hadamard_h_2(handle_pair *, CLIENT *);
+extern  handle_result * matrix_hadamard_h_2_svc(handle_pair *, struct svc_req *);
+#define MATRIX_SCALE_H 12
+extern  handle_result * matrix_scale_h_2(scaled_handle *, CLIENT *);
+extern  handle_result * matrix_scale_h_2_svc(scaled_handle *, struct svc_req *);
+#define MATRIX_AXPY_H 13
+extern  handle_result * matrix_axpy_h_2(scaled_handle_pair *, CLIENT *);
+extern  handle_result * matrix_axpy_h_2_svc(scaled_handle_pair *, struct svc_req *);
+extern int matrix_op_prog_2_freeresult (SVCXPRT *, xdrproc_t, caddr_t);
+
+#else /* K&R C */
+#define MATRIX_CREATE 1
+extern  handle_result * matrix_create_2();
+extern  handle_result * matrix_create_2_svc();
+#define MATRIX_UPLOAD 2
+extern  handle_result * matrix_upload_2();
+extern  handle_result * matrix_upload_2_svc();
+#define MATRIX_DOWNLOAD 3
+extern  chunk_result * matrix_download_2();
+extern  chunk_result * matrix_download_2_svc();
+#define MATRIX_FREE 4
+extern  handle_result * matrix_free_2();
+extern  handle_result * matrix_free_2_svc();
+#define MATRIX_ADD_H 5
+extern  handle_result * matrix_add_h_2();
+extern  handle_result * matrix_add_h_2_svc();
+#define MATRIX_MULTIPLY_H 6
+extern  handle_result * matrix_multiply_h_2();
+extern  handle_result * matrix_multiply_h_2_svc();
+#define MATRIX_TRANSPOSE_H 7
+extern  handle_result * matrix_transpose_h_2();
+extern  handle_result * matrix_transpose_h_2_svc();
+#define MATRIX_INVERSE_H 8
+extern  handle_result * matrix_inverse_h_2();
+extern  handle_result * matrix_inverse_h_2_svc();
+#define MATRIX_EVAL 9
+extern  handle_result * matrix_eval_2();
+extern  handle_result * matrix_eval_2_svc();
+#define MATRIX_SUBTRACT_H 10
+extern  handle_result * matrix_subtract_h_2();
+extern  handle_result * matrix_subtract_h_2_svc();
+#define MATRIX_HADAMARD_H 11
+extern  handle_result * matrix_hadamard_h_2();
+extern  handle_result * matrix_hadamard_h_2_svc();
+#define MATRIX_SCALE_H 12
+extern  handle_result * matrix_scale_h_2();
+extern  handle_result * matrix_scale_h_2_svc();
+#define MATRIX_AXPY_H 13
+extern  handle_result * matrix_axpy_h_2();
+extern  handle_result * matrix_axpy_h_2_svc();
+extern int matrix_op_prog_2_freeresult ();
+#endif /* K&R C */
+#define MATRIX_OP_V3 3
+
+#if defined(__STDC__) || defined(__cplusplus)
+#define MATRIX_ADD_RAW 1
+extern  raw_result * matrix_add_raw_3(raw_pair *, CLIENT *);
+extern  raw_result * matrix_add_raw_3_svc(raw_pair *, struct svc_req *);
+#define MATRIX_MULTIPLY_RAW 2
+extern  raw_result * matrix_multiply_raw_3(raw_pair *, CLIENT *);
+extern  raw_result * matrix_multiply_raw_3_svc(raw_pair *, struct svc_req *);
+#define MATRIX_TRANSPOSE_RAW 3
+extern  raw_result * matrix_transpose_raw_3(raw_matrix *, CLIENT *);
+extern  raw_result * matrix_transpose_raw_3_svc(raw_matrix *, struct svc_req *);
+#define MATRIX_INVERSE_RAW 4
+extern  raw_result * matrix_inverse_raw_3(raw_matrix *, CLIENT *);
+extern  raw_result * matrix_inverse_raw_3_svc(raw_matrix *, struct svc_req *);
+#define MATRIX_UPLOAD_RAW 5
+extern  handle_result * matrix_upload_raw_3(raw_chunk *, CLIENT *);
+extern  handle_result * matrix_upload_raw_3_svc(raw_chunk *, struct svc_req *);
+#define MATRIX_DOWNLOAD_RAW 6
+extern  raw_chunk_result * matrix_download_raw_3(chunk_request *, CLIENT *);
+extern  raw_chunk_result * matrix_download_raw_3_svc(chunk_request *, struct svc_req *);
+extern int matrix_op_prog_3_freeresult (SVCXPRT *, xdrproc_t, caddr_t);
+
+#else /* K&R C */
+#define MATRIX_ADD_RAW 1
+extern  raw_result * matrix_add_raw_3();
+extern  raw_result * matrix_add_raw_3_svc();
+#define MATRIX_MULTIPLY_RAW 2
+extern  raw_result * matrix_multiply_raw_3();
+extern  raw_result * matrix_multiply_raw_3_svc();
+#define MATRIX_TRANSPOSE_RAW 3
+extern  raw_result * matrix_transpose_raw_3();
+extern  raw_result * matrix_transpose_raw_3_svc();
+#define MATRIX_INVERSE_RAW 4
+extern  raw_result * matrix_inverse_raw_3();
+extern  raw_result * matrix_inverse_raw_3_svc();
+#define MATRIX_UPLOAD_RAW 5
+extern  handle_result * matrix_upload_raw_3();
+extern  handle_result * matrix_upload_raw_3_svc();
+#define MATRIX_DOWNLOAD_RAW 6
+extern  raw_chunk_result * matrix_download_raw_3();
+extern  raw_chunk_result * matrix_download_raw_3_svc();
+extern int matrix_op_prog_3_freeresult ();
+#endif /* K&R C */
+#define MATRIX_OP_V4 4
+
+#if defined(__STDC__) || defined(__cplusplus)
+#define MATRIX_ADD_SHM 1
+extern  shm_result * matrix_add_shm_4(shm_request *, CLIENT *);
+extern  shm_result * matrix_add_shm_4_svc(shm_request *, struct svc_req *);
+#define MATRIX_MULTIPLY_SHM 2
+extern  shm_result * matrix_multiply_shm_4(shm_request *, CLIENT *);
+extern  shm_result * matrix_multiply_shm_4_svc(shm_request *, struct svc_req *);
+#define MATRIX_TRANSPOSE_SHM 3
+extern  shm_result * matrix_transpose_shm_4(shm_request *, CLIENT *);
+extern  shm_result * matrix_transpose_shm_4_svc(shm_request *, struct svc_req *);
+#define MATRIX_INVERSE_SHM 4
+extern  shm_result * matrix_inverse_shm_4(shm_request *, CLIENT *);
+extern  shm_result * matrix_inverse_shm_4_svc(shm_request *, struct svc_req *);
+extern int matrix_op_prog_4_freeresult (SVCXPRT *, xdrproc_t, caddr_t);
+
+#else /* K&R C */
+#define MATRIX_ADD_SHM 1
+extern  shm_result * matrix_add_shm_4();
+extern  shm_result * matrix_add_shm_4_svc();
+#define MATRIX_MULTIPLY_SHM 2
+extern  shm_result * matrix_multiply_shm_4();
+extern  shm_result * matrix_multiply_shm_4_svc();
+#define MATRIX_TRANSPOSE_SHM 3
+extern  shm_result * matrix_transpose_shm_4();
+extern  shm_result * matrix_transpose_shm_4_svc();
+#define MATRIX_INVERSE_SHM 4
+extern  shm_result * matrix_inverse_shm_4();
+extern  shm_result * matrix_inverse_shm_4_svc();
+extern int matrix_op_prog_4_freeresult ();
+#endif /* K&R C */
+#define MATRIX_OP_V5 5
+
+#if defined(__STDC__) || defined(__cplusplus)
+#define MATRIX_ADD_CSR 1
+extern  csr_result * matrix_add_csr_5(csr_pair *, CLIENT *);
+extern  csr_result * matrix_add_csr_5_svc(csr_pair *, struct svc_req *);
+#define MATRIX_MULTIPLY_CSR 2
+extern  csr_result * matrix_multiply_csr_5(csr_pair *, CLIENT *);
+extern  csr_result * matrix_multiply_csr_5_svc(csr_pair *, struct svc_req *);
+#define MATRIX_TRANSPOSE_CSR 3
+extern  csr_result * matrix_transpose_csr_5(csr_matrix *, CLIENT *);
+extern  csr_result * matrix_transpose_csr_5_svc(csr_matrix *, struct svc_req *);
+#define MATRIX_SPMM 4
+extern  dense_result * matrix_spmm_5(csr_dense_pair *, CLIENT *);
+extern  dense_result * matrix_spmm_5_svc(csr_dense_pair *, struct svc_req *);
+#define MATRIX_SPMV 5
+extern  dense_result * matrix_spmv_5(csr_dense_pair *, CLIENT *);
+extern  dense_result * matrix_spmv_5_svc(csr_dense_pair *, struct svc_req *);
+extern int matrix_op_prog_5_freeresult (SVCXPRT *, xdrproc_t, caddr_t);
+
+#else /* K&R C */
+#define MATRIX_ADD_CSR 1
+extern  csr_result * matrix_add_csr_5();
+extern  csr_result * matrix_add_csr_5_svc();
+#define MATRIX_MULTIPLY_CSR 2
+extern  csr_result * matrix_multiply_csr_5();
+extern  csr_result * matrix_multiply_csr_5_svc();
+#define MATRIX_TRANSPOSE_CSR 3
+extern  csr_result * matrix_transpose_csr_5();
+extern  csr_result * matrix_transpose_csr_5_svc();
+#define MATRIX_SPMM 4
+extern  dense_result * matrix_spmm_5();
+extern  dense_result * matrix_spmm_5_svc();
+#define MATRIX_SPMV 5
+extern  dense_result * matrix_spmv_5();
+extern  dense_result * matrix_spmv_5_svc();
+extern int matrix_op_prog_5_freeresult ();
+#endif /* K&R C */
 
 /* the xdr functions */
 
 #if defined(__STDC__) || defined(__cplusplus)
 extern  bool_t xdr_matrix (XDR *, matrix*);
 extern  bool_t xdr_matrix_pair (XDR *, matrix_pair*);
+extern  bool_t xdr_scaled_matrix (XDR *, scaled_matrix*);
+extern  bool_t xdr_scaled_pair (XDR *, scaled_pair*);
 extern  bool_t xdr_matrix_result (XDR *, matrix_result*);
+extern  bool_t xdr_batch_opcode (XDR *, batch_opcode*);
+extern  bool_t xdr_matrix_op (XDR *, matrix_op*);
+extern  bool_t xdr_matrix_batch (XDR *, matrix_batch*);
+extern  bool_t xdr_batch_result (XDR *, batch_result*);
+extern  bool_t xdr_matrix_dims (XDR *, matrix_dims*);
+extern  bool_t xdr_matrix_chunk (XDR *, matrix_chunk*);
+extern  bool_t xdr_chunk_request (XDR *, chunk_request*);
+extern  bool_t xdr_handle_pair (XDR *, handle_pair*);
+extern  bool_t xdr_scaled_handle (XDR *, scaled_handle*);
+extern  bool_t xdr_scaled_handle_pair (XDR *, scaled_handle_pair*);
+extern  bool_t xdr_handle_result (XDR *, handle_result*);
+extern  bool_t xdr_chunk_result (XDR *, chunk_result*);
+extern  bool_t xdr_expr_opcode (XDR *, expr_opcode*);
+extern  bool_t xdr_expr_node (XDR *, expr_node*);
+extern  bool_t xdr_matrix_expr (XDR *, matrix_expr*);
+extern  bool_t xdr_raw_matrix (XDR *, raw_matrix*);
+extern  bool_t xdr_raw_pair (XDR *, raw_pair*);
+extern  bool_t xdr_raw_result (XDR *, raw_result*);
+extern  bool_t xdr_raw_chunk (XDR *, raw_chunk*);
+extern  bool_t xdr_raw_chunk_result (XDR *, raw_chunk_result*);
+extern  bool_t xdr_shm_matrix (XDR *, shm_matrix*);
+extern  bool_t xdr_shm_request (XDR *, shm_request*);
+extern  bool_t xdr_shm_result (XDR *, shm_result*);
+extern  bool_t xdr_csr_matrix (XDR *, csr_matrix*);
+extern  bool_t xdr_csr_pair (XDR *, csr_pair*);
+extern  bool_t xdr_csr_result (XDR *, csr_result*);
+extern  bool_t xdr_dense_matrix (XDR *, dense_matrix*);
+extern  bool_t xdr_csr_dense_pair (XDR *, csr_dense_pair*);
+extern  bool_t xdr_dense_result (XDR *, dense_result*);
 
 #else /* K&R C */
 extern bool_t xdr_matrix ();
 extern bool_t xdr_matrix_pair ();
+extern bool_t xdr_scaled_matrix ();
+extern bool_t xdr_scaled_pair ();
 extern bool_t xdr_matrix_result ();
+extern bool_t xdr_batch_opcode ();
+extern bool_t xdr_matrix_op ();
+extern bool_t xdr_matrix_batch ();
+extern bool_t xdr_batch_result ();
+extern bool_t xdr_matrix_dims ();
+extern bool_t xdr_matrix_chunk ();
+extern bool_t xdr_chunk_request ();
+extern bool_t xdr_handle_pair ();
+extern bool_t xdr_scaled_handle ();
+extern bool_t xdr_scaled_handle_pair ();
+extern bool_t xdr_handle_result ();
+extern bool_t xdr_chunk_result ();
+extern bool_t xdr_expr_opcode ();
+extern bool_t xdr_expr_node ();
+extern bool_t xdr_matrix_expr ();
+extern bool_t xdr_raw_matrix ();
+extern bool_t xdr_raw_pair ();
+extern bool_t xdr_raw_result ();
+extern bool_t xdr_raw_chunk ();
+extern bool_t xdr_raw_chunk_result ();
+extern bool_t xdr_shm_matrix ();
+extern bool_t xdr_shm_request ();
+extern bool_t xdr_shm_result ();
+extern bool_t xdr_csr_matrix ();
+extern bool_t xdr_csr_pair ();
+extern bool_t xdr_csr_result ();
+extern bool_t xdr_dense_matrix ();
+extern bool_t xdr_csr_dense_pair ();
+extern bool_t xdr_dense_result ();
 
 #endif /* K&R C */
 
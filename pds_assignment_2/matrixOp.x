@@ -1,5 +1,14 @@
 const MAX_MATRIX_ELEMENTS = 400;
 const ERROR_MESSAGE_LEN = 256;
+const MAX_CHUNK_ELEMENTS = 65536;
+const MAX_BATCH_OPS = 1024;
+const MAX_EXPR_NODES = 64;
+const MAX_RAW_MATRIX_BYTES = 3200;      /* MAX_MATRIX_ELEMENTS doubles */
+const MAX_RAW_CHUNK_BYTES = 524288;     /* MAX_CHUNK_ELEMENTS doubles */
+const RAW_FORMAT_LE_DOUBLE = 1;
+const SHM_NAME_LEN = 64;
+const MAX_SPARSE_NNZ = 1048576;
+const MAX_DENSE_ELEMENTS = 1048576;
 
 struct matrix {
     u_int rows;
@@ -12,17 +21,300 @@ struct matrix_pair {
     matrix b;
 };
 
+/*
+ * The element-wise operations beyond add: subtract (a - b), Hadamard (the
+ * element-by-element product), scale (alpha * a) and axpy (alpha * a + b).
+ * Operands of the binary ones must have the same dimensions.
+ */
+struct scaled_matrix {
+    double alpha;
+    matrix a;
+};
+
+struct scaled_pair {
+    double alpha;
+    matrix a;
+    matrix b;
+};
+
 struct matrix_result {
     int status; /* 0 = success, non-zero = error */
     matrix value;
     string message<ERROR_MESSAGE_LEN>;
 };
 
+/*
+ * MATRIX_BATCH runs many small version 1 operations in one call. The op
+ * codes match the procedure numbers; b is ignored (send 0 x 0) for
+ * transpose and inverse. results[i] answers ops[i].
+ */
+enum batch_opcode {
+    BATCH_ADD = 1,
+    BATCH_MULTIPLY = 2,
+    BATCH_TRANSPOSE = 3,
+    BATCH_INVERSE = 4
+};
+
+struct matrix_op {
+    batch_opcode op;
+    matrix a;
+    matrix b;
+};
+
+struct matrix_batch {
+    matrix_op ops<MAX_BATCH_OPS>;
+};
+
+struct batch_result {
+    int status; /* non-zero only if the batch as a whole failed */
+    matrix_result results<MAX_BATCH_OPS>;
+    string message<ERROR_MESSAGE_LEN>;
+};
+
+/*
+ * Version 2: matrices of any size live on the server behind a handle and
+ * are moved in chunks of at most MAX_CHUNK_ELEMENTS, so no single XDR
+ * message has to carry a whole matrix. Handles are never 0.
+ */
+struct matrix_dims {
+    u_int rows;
+    u_int cols;
+};
+
+struct matrix_chunk {
+    u_int handle;
+    u_int offset; /* first element, row-major */
+    double data<MAX_CHUNK_ELEMENTS>;
+};
+
+struct chunk_request {
+    u_int handle;
+    u_int offset;
+    u_int count;
+};
+
+struct handle_pair {
+    u_int a;
+    u_int b;
+};
+
+struct scaled_handle {
+    double alpha;
+    u_int a;
+};
+
+struct scaled_handle_pair {
+    double alpha;
+    u_int a;
+    u_int b;
+};
+
+struct handle_result {
+    int status; /* 0 = success, non-zero = error */
+    u_int handle;
+    u_int rows;
+    u_int cols;
+    string message<ERROR_MESSAGE_LEN>;
+};
+
+struct chunk_result {
+    int status;
+    double data<MAX_CHUNK_ELEMENTS>;
+    string message<ERROR_MESSAGE_LEN>;
+};
+
+/*
+ * MATRIX_EVAL evaluates an expression over stored matrices in one call.
+ * Nodes are listed operands first: EXPR_HANDLE nodes name a stored matrix
+ * in a, every other node takes earlier nodes as operands (a, and b for the
+ * binary ones); scale and axpy also take alpha. A node may feed several
+ * others. The last node is the result; it comes back as a new handle,
+ * intermediates never leave the server. Chains of element-wise nodes are
+ * fused and computed in one pass.
+ */
+enum expr_opcode {
+    EXPR_HANDLE = 0,
+    EXPR_ADD = 1,
+    EXPR_MULTIPLY = 2,
+    EXPR_TRANSPOSE = 3,
+    EXPR_INVERSE = 4,
+    EXPR_SUBTRACT = 5,
+    EXPR_HADAMARD = 6,
+    EXPR_SCALE = 7,
+    EXPR_AXPY = 8
+};
+
+struct expr_node {
+    expr_opcode op;
+    u_int a;
+    u_int b;
+    double alpha; /* scale and axpy */
+};
+
+struct matrix_expr {
+    expr_node nodes<MAX_EXPR_NODES>;
+};
+
+/*
+ * Version 3: the version 1 operations and the version 2 chunk transfers
+ * with matrix bodies sent as one opaque block instead of an XDR array of
+ * doubles. format says how the block is laid out; RAW_FORMAT_LE_DOUBLE is
+ * rows * cols IEEE-754 binary64 values, little-endian, row-major, and is
+ * what the server always sends.
+ */
+struct raw_matrix {
+    u_int rows;
+    u_int cols;
+    u_int format;
+    opaque data<MAX_RAW_MATRIX_BYTES>;
+};
+
+struct raw_pair {
+    raw_matrix a;
+    raw_matrix b;
+};
+
+struct raw_result {
+    int status; /* 0 = success, non-zero = error */
+    raw_matrix value;
+    string message<ERROR_MESSAGE_LEN>;
+};
+
+struct raw_chunk {
+    u_int handle;
+    u_int offset; /* first element, row-major */
+    u_int format;
+    opaque data<MAX_RAW_CHUNK_BYTES>;
+};
+
+struct raw_chunk_result {
+    int status;
+    u_int format;
+    opaque data<MAX_RAW_CHUNK_BYTES>;
+    string message<ERROR_MESSAGE_LEN>;
+};
+
+/*
+ * Version 4: same-host clients put operands in a POSIX shared-memory
+ * segment and pass only its name and byte offsets. The server maps the
+ * segment, reads the operands in place and writes the result (row-major
+ * doubles) at the result offset; the reply carries no matrix data.
+ * Offsets must be multiples of 8 and regions must lie inside the segment;
+ * the result must not overlap an operand, except that a square transpose
+ * may name its operand as the result to be transposed in place.
+ */
+struct shm_matrix {
+    u_int rows;
+    u_int cols;
+    unsigned hyper offset;
+};
+
+struct shm_request {
+    string segment<SHM_NAME_LEN>; /* shm_open name, "/name" */
+    shm_matrix a;
+    shm_matrix b; /* add and multiply only */
+    unsigned hyper result;
+};
+
+struct shm_result {
+    int status; /* 0 = success; 3 = segment not reachable (another host) */
+    u_int rows;
+    u_int cols;
+    string message<ERROR_MESSAGE_LEN>;
+};
+
+/*
+ * Version 5: sparse matrices in compressed sparse row (CSR) form. row_ptr
+ * has rows + 1 entries starting at 0; row r holds values[row_ptr[r] ..
+ * row_ptr[r + 1]) in columns col_idx[...], strictly ascending. SPMM and
+ * SPMV multiply a CSR matrix by a dense one (a single column for SPMV).
+ */
+struct csr_matrix {
+    u_int rows;
+    u_int cols;
+    u_int row_ptr<MAX_SPARSE_NNZ>;
+    u_int col_idx<MAX_SPARSE_NNZ>;
+    double values<MAX_SPARSE_NNZ>;
+};
+
+struct csr_pair {
+    csr_matrix a;
+    csr_matrix b;
+};
+
+struct csr_result {
+    int status; /* 0 = success, non-zero = error */
+    csr_matrix value;
+    string message<ERROR_MESSAGE_LEN>;
+};
+
+struct dense_matrix {
+    u_int rows;
+    u_int cols;
+    double data<MAX_DENSE_ELEMENTS>;
+};
+
+struct csr_dense_pair {
+    csr_matrix a;
+    dense_matrix b;
+};
+
+struct dense_result {
+    int status; /* 0 = success, non-zero = error */
+    dense_matrix value;
+    string message<ERROR_MESSAGE_LEN>;
+};
+
 program MATRIX_OP_PROG {
     version MATRIX_OP_V1 {
         matrix_result MATRIX_ADD(matrix_pair) = 1;
         matrix_result MATRIX_MULTIPLY(matrix_pair) = 2;
         matrix_result MATRIX_TRANSPOSE(matrix) = 3;
         matrix_result MATRIX_INVERSE(matrix) = 4;
+        batch_result MATRIX_BATCH(matrix_batch) = 5;
+        matrix_result MATRIX_SUBTRACT(matrix_pair) = 6;
+        matrix_result MATRIX_HADAMARD(matrix_pair) = 7;
+        matrix_result MATRIX_SCALE(scaled_matrix) = 8;
+        matrix_result MATRIX_AXPY(scaled_pair) = 9;
     } = 1;
+
+    version MATRIX_OP_V2 {
+        handle_result MATRIX_CREATE(matrix_dims) = 1;
+        handle_result MATRIX_UPLOAD(matrix_chunk) = 2;
+        chunk_result MATRIX_DOWNLOAD(chunk_request) = 3;
+        handle_result MATRIX_FREE(u_int) = 4;
+        handle_result MATRIX_ADD_H(handle_pair) = 5;
+        handle_result MATRIX_MULTIPLY_H(handle_pair) = 6;
+        handle_result MATRIX_TRANSPOSE_H(u_int) = 7;
+        handle_result MATRIX_INVERSE_H(u_int) = 8;
+        handle_result MATRIX_EVAL(matrix_expr) = 9;
+        handle_result MATRIX_SUBTRACT_H(handle_pair) = 10;
+        handle_result MATRIX_HADAMARD_H(handle_pair) = 11;
+        handle_result MATRIX_SCALE_H(scaled_handle) = 12;
+        handle_result MATRIX_AXPY_H(scaled_handle_pair) = 13;
+    } = 2;
+
+    version MATRIX_OP_V3 {
+        raw_result MATRIX_ADD_RAW(raw_pair) = 1;
+        raw_result MATRIX_MULTIPLY_RAW(raw_pair) = 2;
+        raw_result MATRIX_TRANSPOSE_RAW(raw_matrix) = 3;
+        raw_result MATRIX_INVERSE_RAW(raw_matrix) = 4;
+        handle_result MATRIX_UPLOAD_RAW(raw_chunk) = 5;
+        raw_chunk_result MATRIX_DOWNLOAD_RAW(chunk_request) = 6;
+    } = 3;
+
+    version MATRIX_OP_V4 {
+        shm_result MATRIX_ADD_SHM(shm_request) = 1;
+        shm_result MATRIX_MULTIPLY_SHM(shm_request) = 2;
+        shm_result MATRIX_TRANSPOSE_SHM(shm_request) = 3;
+        shm_result MATRIX_INVERSE_SHM(shm_request) = 4;
+    } = 4;
+
+    version MATRIX_OP_V5 {
+        csr_result MATRIX_ADD_CSR(csr_pair) = 1;
+        csr_result MATRIX_MULTIPLY_CSR(csr_pair) = 2;
+        csr_result MATRIX_TRANSPOSE_CSR(csr_matrix) = 3;
+        dense_result MATRIX_SPMM(csr_dense_pair) = 4;
+        dense_result MATRIX_SPMV(csr_dense_pair) = 5;
+    } = 5;
 } = 0x31234567;
@@ -1,7 +1,61 @@
+#define _DEFAULT_SOURCE
 #include "matrixOp.h"
+#include "matrix_loadgen.h"
+#include "matrix_shm.h"
+#include <netdb.h>
+#include <sys/mman.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+/*
+ * Matrices up to MAX_MATRIX_ELEMENTS travel inline through the version 1
+ * procedures. Anything larger goes through shared memory when the server
+ * runs on this host (version 4); otherwise it is uploaded to the server in
+ * chunks, operated on by handle (version 2) and downloaded back in chunks.
+ */
+#define MAX_CLIENT_ELEMENTS (1u << 28)
+
+enum matrix_opcode { OP_ADD, OP_MULTIPLY, OP_TRANSPOSE, OP_INVERSE };
+
+static const char *server_host;
+static unsigned short server_port; /* 0: look the service up via the portmapper */
+static CLIENT *clnt_v2;
+static CLIENT *clnt_v4;
+static bool shm_unavailable; /* server on another host, without version 4, or MATRIXOP_NO_SHM set */
+
+/* TCP client for the given version, on a fixed port if one was given. */
+static CLIENT *
+connect_server(u_long vers)
+{
+	struct addrinfo hints;
+	struct addrinfo *res;
+	struct sockaddr_in addr;
+	int sock = RPC_ANYSOCK;
+	CLIENT *clnt;
+
+	if (server_port == 0) {
+		return clnt_create(server_host, MATRIX_OP_PROG, vers, "tcp");
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(server_host, NULL, &hints, &res) != 0) {
+		fprintf(stderr, "%s: unknown host\n", server_host);
+		return NULL;
+	}
+	memcpy(&addr, res->ai_addr, sizeof(addr));
+	freeaddrinfo(res);
+	addr.sin_port = htons(server_port);
+
+	clnt = clnttcp_create(&addr, MATRIX_OP_PROG, vers, &sock, 0, 0);
+	if (clnt == NULL) {
+		clnt_pcreateerror(server_host);
+	}
+	return clnt;
+}
 
 static void
 discard_line(void)
@@ -39,8 +93,8 @@ read_matrix(const char *label, matrix *out)
 	}
 
 	total = (unsigned long long)rows * (unsigned long long)cols;
-	if (total == 0 || total > MAX_MATRIX_ELEMENTS) {
-		fprintf(stderr, "Matrix too large. Maximum supported elements: %d\n", MAX_MATRIX_ELEMENTS);
+	if (total == 0 || total > MAX_CLIENT_ELEMENTS) {
+		fprintf(stderr, "Matrix too large. Maximum supported elements: %u\n", MAX_CLIENT_ELEMENTS);
 		return false;
 	}
 
@@ -107,6 +161,265 @@ print_result(const char *operation, const matrix_result *res)
 	print_matrix(&res->value);
 }
 
+static bool
+fits_inline(const matrix *m)
+{
+	return m->data.data_len <= MAX_MATRIX_ELEMENTS;
+}
+
+/* Version 2 needs the stream transport; connect on first use. */
+static CLIENT *
+large_client(void)
+{
+	if (clnt_v2 == NULL) {
+		clnt_v2 = connect_server(MATRIX_OP_V2);
+		if (clnt_v2 == NULL && server_port == 0) {
+			clnt_pcreateerror(server_host);
+		}
+	}
+	return clnt_v2;
+}
+
+static bool
+check_handle(const char *what, handle_result *res, CLIENT *clnt)
+{
+	if (res == NULL) {
+		clnt_perror(clnt, what);
+		return false;
+	}
+	if (res->status != 0) {
+		printf("%s failed: %s\n", what, res->message != NULL ? res->message : "unknown error");
+		return false;
+	}
+	return true;
+}
+
+static void
+release_handle(CLIENT *clnt, u_int handle)
+{
+	if (handle != 0) {
+		matrix_free_2(&handle, clnt);
+	}
+}
+
+/* Create a server-side copy of m; returns its handle or 0. */
+static u_int
+upload_matrix(CLIENT *clnt, const matrix *m)
+{
+	matrix_dims dims;
+	matrix_chunk chunk;
+	handle_result *res;
+	u_int handle;
+
+	dims.rows = m->rows;
+	dims.cols = m->cols;
+	res = matrix_create_2(&dims, clnt);
+	if (!check_handle("matrix_create", res, clnt)) {
+		return 0;
+	}
+	handle = res->handle;
+
+	chunk.handle = handle;
+	for (u_int off = 0; off < m->data.data_len; off += MAX_CHUNK_ELEMENTS) {
+		u_int n = m->data.data_len - off;
+
+		if (n > MAX_CHUNK_ELEMENTS) {
+			n = MAX_CHUNK_ELEMENTS;
+		}
+		chunk.offset = off;
+		chunk.data.data_len = n;
+		chunk.data.data_val = m->data.data_val + off;
+		if (!check_handle("matrix_upload", matrix_upload_2(&chunk, clnt), clnt)) {
+			release_handle(clnt, handle);
+			return 0;
+		}
+	}
+	return handle;
+}
+
+static bool
+download_matrix(CLIENT *clnt, u_int handle, u_int rows, u_int cols, matrix *out)
+{
+	u_int total = rows * cols;
+	chunk_request req;
+	double *data;
+
+	data = malloc(sizeof(double) * total);
+	if (data == NULL) {
+		fprintf(stderr, "Unable to allocate memory for the result.\n");
+		return false;
+	}
+
+	req.handle = handle;
+	for (u_int off = 0; off < total; off += MAX_CHUNK_ELEMENTS) {
+		chunk_result *res;
+		bool ok;
+
+		req.offset = off;
+		req.count = total - off > MAX_CHUNK_ELEMENTS ? MAX_CHUNK_ELEMENTS : total - off;
+		res = matrix_download_2(&req, clnt);
+		if (res == NULL) {
+			clnt_perror(clnt, "matrix_download");
+			free(data);
+			return false;
+		}
+		ok = res->status == 0 && res->data.data_len == req.count;
+		if (ok) {
+			memcpy(data + off, res->data.data_val, sizeof(double) * req.count);
+		} else {
+			printf("Download failed: %s\n", res->message != NULL ? res->message : "short chunk");
+		}
+		xdr_free((xdrproc_t)xdr_chunk_result, (char *)res);
+		if (!ok) {
+			free(data);
+			return false;
+		}
+	}
+
+	out->rows = rows;
+	out->cols = cols;
+	out->data.data_len = total;
+	out->data.data_val = data;
+	return true;
+}
+
+/*
+ * Put the operands and room for the result in one shared-memory segment and
+ * pass only offsets; a square transpose is done in place. Returns false if
+ * the server cannot use the segment, so the caller falls back to chunked
+ * transfers.
+ */
+static bool
+run_by_shm(const char *operation, enum matrix_opcode op, const matrix *a, const matrix *b)
+{
+	char name[SHM_NAME_LEN];
+	shm_segment seg;
+	shm_request req;
+	shm_result *res = NULL;
+	size_t a_bytes = sizeof(double) * a->data.data_len;
+	size_t b_bytes = b != NULL ? sizeof(double) * b->data.data_len : 0;
+	bool in_place = op == OP_TRANSPOSE && a->rows == a->cols;
+	size_t r_bytes = in_place ? 0 : sizeof(double) * a->rows * (op == OP_MULTIPLY ? b->cols : a->cols);
+	bool handled = true;
+
+	if (shm_unavailable) {
+		return false;
+	}
+	if (clnt_v4 == NULL && (clnt_v4 = connect_server(MATRIX_OP_V4)) == NULL) {
+		shm_unavailable = true;
+		return false;
+	}
+	if (shm_segment_create(a_bytes + b_bytes + r_bytes, name, &seg) != 0) {
+		shm_unavailable = true;
+		return false;
+	}
+	memcpy(seg.base, a->data.data_val, a_bytes);
+	if (b != NULL) {
+		memcpy((char *)seg.base + a_bytes, b->data.data_val, b_bytes);
+	}
+
+	memset(&req, 0, sizeof(req));
+	req.segment = name;
+	req.a.rows = a->rows;
+	req.a.cols = a->cols;
+	req.a.offset = 0;
+	if (b != NULL) {
+		req.b.rows = b->rows;
+		req.b.cols = b->cols;
+		req.b.offset = a_bytes;
+	}
+	req.result = in_place ? 0 : a_bytes + b_bytes;
+
+	switch (op) {
+	case OP_ADD:
+		res = matrix_add_shm_4(&req, clnt_v4);
+		break;
+	case OP_MULTIPLY:
+		res = matrix_multiply_shm_4(&req, clnt_v4);
+		break;
+	case OP_TRANSPOSE:
+		res = matrix_transpose_shm_4(&req, clnt_v4);
+		break;
+	case OP_INVERSE:
+		res = matrix_inverse_shm_4(&req, clnt_v4);
+		break;
+	}
+
+	if (res == NULL || res->status == 3) {
+		shm_unavailable = true;
+		handled = false;
+	} else if (res->status != 0) {
+		printf("%s failed: %s\n", operation, res->message != NULL ? res->message : "unknown error");
+	} else {
+		matrix out;
+
+		out.rows = res->rows;
+		out.cols = res->cols;
+		out.data.data_len = res->rows * res->cols;
+		out.data.data_val = (double *)(void *)((char *)seg.base + req.result);
+		printf("%s result (%u x %u):\n", operation, out.rows, out.cols);
+		print_matrix(&out);
+	}
+
+	shm_segment_close(&seg);
+	shm_unlink(name);
+	return handled;
+}
+
+static void
+run_by_handle(const char *operation, enum matrix_opcode op, const matrix *a, const matrix *b)
+{
+	CLIENT *clnt;
+	u_int ha = 0;
+	u_int hb = 0;
+	handle_pair pair;
+	handle_result *res = NULL;
+	matrix out;
+
+	if (run_by_shm(operation, op, a, b)) {
+		return;
+	}
+	if ((clnt = large_client()) == NULL) {
+		printf("%s failed: unable to reach server.\n", operation);
+		return;
+	}
+	if ((ha = upload_matrix(clnt, a)) == 0 ||
+	    (b != NULL && (hb = upload_matrix(clnt, b)) == 0)) {
+		release_handle(clnt, ha);
+		return;
+	}
+
+	pair.a = ha;
+	pair.b = hb;
+	switch (op) {
+	case OP_ADD:
+		res = matrix_add_h_2(&pair, clnt);
+		break;
+	case OP_MULTIPLY:
+		res = matrix_multiply_h_2(&pair, clnt);
+		break;
+	case OP_TRANSPOSE:
+		res = matrix_transpose_h_2(&ha, clnt);
+		break;
+	case OP_INVERSE:
+		res = matrix_inverse_h_2(&ha, clnt);
+		break;
+	}
+
+	if (check_handle(operation, res, clnt)) {
+		u_int hr = res->handle;
+
+		if (download_matrix(clnt, hr, res->rows, res->cols, &out)) {
+			printf("%s result (%u x %u):\n", operation, out.rows, out.cols);
+			print_matrix(&out);
+			free_matrix(&out);
+		}
+		release_handle(clnt, hr);
+	}
+	release_handle(clnt, ha);
+	release_handle(clnt, hb);
+}
+
 static void
 interactive_loop(CLIENT *clnt)
 {
@@ -148,6 +461,13 @@ interactive_loop(CLIENT *clnt)
 				break;
 			}
 
+			if (!fits_inline(&a) || !fits_inline(&b)) {
+				run_by_handle("Addition", OP_ADD, &a, &b);
+				free_matrix(&a);
+				free_matrix(&b);
+				break;
+			}
+
 			pair.a = a;
 			pair.b = b;
 			res = matrix_add_1(&pair, clnt);
@@ -174,6 +494,14 @@ interactive_loop(CLIENT *clnt)
 				break;
 			}
 
+			if (!fits_inline(&a) || !fits_inline(&b) ||
+			    (unsigned long long)a.rows * b.cols > MAX_MATRIX_ELEMENTS) {
+				run_by_handle("Multiplication", OP_MULTIPLY, &a, &b);
+				free_matrix(&a);
+				free_matrix(&b);
+				break;
+			}
+
 			pair.a = a;
 			pair.b = b;
 			res = matrix_multiply_1(&pair, clnt);
@@ -194,6 +522,12 @@ interactive_loop(CLIENT *clnt)
 				break;
 			}
 
+			if (!fits_inline(&input)) {
+				run_by_handle("Transpose", OP_TRANSPOSE, &input, NULL);
+				free_matrix(&input);
+				break;
+			}
+
 			res = matrix_transpose_1(&input, clnt);
 			if (res == NULL) {
 				clnt_perror(clnt, "matrix_transpose");
@@ -211,6 +545,12 @@ interactive_loop(CLIENT *clnt)
 				break;
 			}
 
+			if (!fits_inline(&input)) {
+				run_by_handle("Inverse", OP_INVERSE, &input, NULL);
+				free_matrix(&input);
+				break;
+			}
+
 			res = matrix_inverse_1(&input, clnt);
 			if (res == NULL) {
 				clnt_perror(clnt, "matrix_inverse");
@@ -232,9 +572,10 @@ matrix_op_prog_1(char *host)
 {
 	CLIENT *clnt;
 
+	server_host = host;
 #ifndef	DEBUG
-	clnt = clnt_create(host, MATRIX_OP_PROG, MATRIX_OP_V1, "tcp");
-	if (clnt == NULL) {
+	clnt = connect_server(MATRIX_OP_V1);
+	if (clnt == NULL && server_port == 0) {
 		clnt = clnt_create(host, MATRIX_OP_PROG, MATRIX_OP_V1, "udp");
 	}
 	if (clnt == NULL) {
@@ -248,17 +589,102 @@ matrix_op_prog_1(char *host)
 #ifndef	DEBUG
 	clnt_destroy(clnt);
 #endif	 /* DEBUG */
+	if (clnt_v2 != NULL) {
+		clnt_destroy(clnt_v2);
+	}
+	if (clnt_v4 != NULL) {
+		clnt_destroy(clnt_v4);
+	}
 }
 
 
+static void
+usage(const char *prog)
+{
+	printf("Usage: %s <server_host> [port] [--bench [options]]\n"
+	       "  --bench             run a timed load instead of the menu and report per procedure\n"
+	       "  --connections N     concurrent connections, one thread each (default 4)\n"
+	       "  --duration S        seconds to run (default 10)\n"
+	       "  --sizes N,...       n x n matrix sizes, picked uniformly (default 8,20,64)\n"
+	       "  --mix OP[:W],...    operations and weights from add, subtract, hadamard, scale,\n"
+	       "                      axpy, multiply, transpose, inverse (default the four menu ones)\n"
+	       "  --seed N            seed for the matrices and the operation sequence (default 1)\n"
+	       "  --format csv|json   report format (default csv)\n"
+	       "  --output FILE       write the report to FILE instead of stdout\n",
+	       prog);
+	exit(1);
+}
+
 int
 main (int argc, char *argv[])
 {
-	if (argc != 2) {
-		printf("Usage: %s <server_host>\n", argv[0]);
-		exit(1);
+	struct loadgen_config cfg;
+	const char *output = NULL;
+	bool bench = false;
+	int options = 2;
+	int rc;
+
+	if (argc < 2 || argv[1][0] == '-') {
+		usage(argv[0]);
+	}
+	if (argc > 2 && argv[2][0] != '-') {
+		server_port = (unsigned short)strtoul(argv[2], NULL, 10);
+		options = 3;
 	}
 
-	matrix_op_prog_1(argv[1]);
-	return 0;
+	loadgen_defaults(&cfg);
+	for (int i = options; i < argc; ++i) {
+		if (strcmp(argv[i], "--bench") == 0) {
+			bench = true;
+		} else if (strcmp(argv[i], "--connections") == 0 && i + 1 < argc) {
+			cfg.connections = (unsigned int)strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+			cfg.seconds = strtod(argv[++i], NULL);
+		} else if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+			if (!loadgen_parse_sizes(&cfg, argv[++i])) {
+				usage(argv[0]);
+			}
+		} else if (strcmp(argv[i], "--mix") == 0 && i + 1 < argc) {
+			if (!loadgen_parse_mix(&cfg, argv[++i])) {
+				usage(argv[0]);
+			}
+		} else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			cfg.seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+			++i;
+			if (strcmp(argv[i], "json") != 0 && strcmp(argv[i], "csv") != 0) {
+				usage(argv[0]);
+			}
+			cfg.json = strcmp(argv[i], "json") == 0;
+		} else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+			output = argv[++i];
+		} else {
+			usage(argv[0]);
+		}
+	}
+
+	if (!bench) {
+		/* the chunked version 2 path even where shared memory would work, for testing */
+		shm_unavailable = getenv("MATRIXOP_NO_SHM") != NULL;
+		if (options < argc) {
+			usage(argv[0]);	/* benchmark options without --bench */
+		}
+		matrix_op_prog_1(argv[1]);
+		return 0;
+	}
+
+	if (cfg.connections == 0 || !(cfg.seconds > 0.0)) {
+		usage(argv[0]);
+	}
+	cfg.host = argv[1];
+	cfg.port = server_port;
+	if (output != NULL && (cfg.out = fopen(output, "w")) == NULL) {
+		perror(output);
+		exit(1);
+	}
+	rc = loadgen_run(&cfg);
+	if (output != NULL) {
+		fclose(cfg.out);
+	}
+	return rc;
 }
@@ -68,3 +68,498 @@ matrix_inverse_1(matrix *argp, CLIENT *clnt)
 	}
 	return (&clnt_res);
 }
+
+batch_result *
+matrix_batch_1(matrix_batch *argp, CLIENT *clnt)
+{
+	static batch_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_BATCH,
+		(xdrproc_t) xdr_matrix_batch, (caddr_t) argp,
+		(xdrproc_t) xdr_batch_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+matrix_result *
+matrix_subtract_1(matrix_pair *argp, CLIENT *clnt)
+{
+	static matrix_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_SUBTRACT,
+		(xdrproc_t) xdr_matrix_pair, (caddr_t) argp,
+		(xdrproc_t) xdr_matrix_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+matrix_result *
+matrix_hadamard_1(matrix_pair *argp, CLIENT *clnt)
+{
+	static matrix_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_HADAMARD,
+		(xdrproc_t) xdr_matrix_pair, (caddr_t) argp,
+		(xdrproc_t) xdr_matrix_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+matrix_result *
+matrix_scale_1(scaled_matrix *argp, CLIENT *clnt)
+{
+	static matrix_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_SCALE,
+		(xdrproc_t) xdr_scaled_matrix, (caddr_t) argp,
+		(xdrproc_t) xdr_matrix_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+matrix_result *
+matrix_axpy_1(scaled_pair *argp, CLIENT *clnt)
+{
+	static matrix_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_AXPY,
+		(xdrproc_t) xdr_scaled_pair, (caddr_t) argp,
+		(xdrproc_t) xdr_matrix_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+handle_result *
+matrix_create_2(matrix_dims *argp, CLIENT *clnt)
+{
+	static handle_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_CREATE,
+		(xdrproc_t) xdr_matrix_dims, (caddr_t) argp,
+		(xdrproc_t) xdr_handle_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+handle_result *
+matrix_upload_2(matrix_chunk *argp, CLIENT *clnt)
+{
+	static handle_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_UPLOAD,
+		(xdrproc_t) xdr_matrix_chunk, (caddr_t) argp,
+		(xdrproc_t) xdr_handle_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+chunk_result *
+matrix_download_2(chunk_request *argp, CLIENT *clnt)
+{
+	static chunk_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_DOWNLOAD,
+		(xdrproc_t) xdr_chunk_request, (caddr_t) argp,
+		(xdrproc_t) xdr_chunk_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+handle_result *
+matrix_free_2(u_int *argp, CLIENT *clnt)
+{
+	static handle_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_FREE,
+		(xdrproc_t) xdr_u_int, (caddr_t) argp,
+		(xdrproc_t) xdr_handle_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+handle_result *
+matrix_add_h_2(handle_pair *argp, CLIENT *clnt)
+{
+	static handle_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_ADD_H,
+		(xdrproc_t) xdr_handle_pair, (caddr_t) argp,
+		(xdrproc_t) xdr_handle_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+handle_result *
+matrix_multiply_h_2(handle_pair *argp, CLIENT *clnt)
+{
+	static handle_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_MULTIPLY_H,
+		(xdrproc_t) xdr_handle_pair, (caddr_t) argp,
+		(xdrproc_t) xdr_handle_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+handle_result *
+matrix_transpose_h_2(u_int *argp, CLIENT *clnt)
+{
+	static handle_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_TRANSPOSE_H,
+		(xdrproc_t) xdr_u_int, (caddr_t) argp,
+		(xdrproc_t) xdr_handle_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+handle_result *
+matrix_inverse_h_2(u_int *argp, CLIENT *clnt)
+{
+	static handle_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_INVERSE_H,
+		(xdrproc_t) xdr_u_int, (caddr_t) argp,
+		(xdrproc_t) xdr_handle_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+handle_result *
+matrix_eval_2(matrix_expr *argp, CLIENT *clnt)
+{
+	static handle_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_EVAL,
+		(xdrproc_t) xdr_matrix_expr, (caddr_t) argp,
+		(xdrproc_t) xdr_handle_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+handle_result *
+matrix_subtract_h_2(handle_pair *argp, CLIENT *clnt)
+{
+	static handle_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_SUBTRACT_H,
+		(xdrproc_t) xdr_handle_pair, (caddr_t) argp,
+		(xdrproc_t) xdr_handle_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+handle_result *
+matrix_hadamard_h_2(handle_pair *argp, CLIENT *clnt)
+{
+	static handle_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_HADAMARD_H,
+		(xdrproc_t) xdr_handle_pair, (caddr_t) argp,
+		(xdrproc_t) xdr_handle_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+handle_result *
+matrix_scale_h_2(scaled_handle *argp, CLIENT *clnt)
+{
+	static handle_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_SCALE_H,
+		(xdrproc_t) xdr_scaled_handle, (caddr_t) argp,
+		(xdrproc_t) xdr_handle_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+handle_result *
+matrix_axpy_h_2(scaled_handle_pair *argp, CLIENT *clnt)
+{
+	static handle_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_AXPY_H,
+		(xdrproc_t) xdr_scaled_handle_pair, (caddr_t) argp,
+		(xdrproc_t) xdr_handle_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+raw_result *
+matrix_add_raw_3(raw_pair *argp, CLIENT *clnt)
+{
+	static raw_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_ADD_RAW,
+		(xdrproc_t) xdr_raw_pair, (caddr_t) argp,
+		(xdrproc_t) xdr_raw_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+raw_result *
+matrix_multiply_raw_3(raw_pair *argp, CLIENT *clnt)
+{
+	static raw_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_MULTIPLY_RAW,
+		(xdrproc_t) xdr_raw_pair, (caddr_t) argp,
+		(xdrproc_t) xdr_raw_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+raw_result *
+matrix_transpose_raw_3(raw_matrix *argp, CLIENT *clnt)
+{
+	static raw_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_TRANSPOSE_RAW,
+		(xdrproc_t) xdr_raw_matrix, (caddr_t) argp,
+		(xdrproc_t) xdr_raw_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+raw_result *
+matrix_inverse_raw_3(raw_matrix *argp, CLIENT *clnt)
+{
+	static raw_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_INVERSE_RAW,
+		(xdrproc_t) xdr_raw_matrix, (caddr_t) argp,
+		(xdrproc_t) xdr_raw_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+handle_result *
+matrix_upload_raw_3(raw_chunk *argp, CLIENT *clnt)
+{
+	static handle_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_UPLOAD_RAW,
+		(xdrproc_t) xdr_raw_chunk, (caddr_t) argp,
+		(xdrproc_t) xdr_handle_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+raw_chunk_result *
+matrix_download_raw_3(chunk_request *argp, CLIENT *clnt)
+{
+	static raw_chunk_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_DOWNLOAD_RAW,
+		(xdrproc_t) xdr_chunk_request, (caddr_t) argp,
+		(xdrproc_t) xdr_raw_chunk_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+shm_result *
+matrix_add_shm_4(shm_request *argp, CLIENT *clnt)
+{
+	static shm_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_ADD_SHM,
+		(xdrproc_t) xdr_shm_request, (caddr_t) argp,
+		(xdrproc_t) xdr_shm_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+shm_result *
+matrix_multiply_shm_4(shm_request *argp, CLIENT *clnt)
+{
+	static shm_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_MULTIPLY_SHM,
+		(xdrproc_t) xdr_shm_request, (caddr_t) argp,
+		(xdrproc_t) xdr_shm_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+shm_result *
+matrix_transpose_shm_4(shm_request *argp, CLIENT *clnt)
+{
+	static shm_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_TRANSPOSE_SHM,
+		(xdrproc_t) xdr_shm_request, (caddr_t) argp,
+		(xdrproc_t) xdr_shm_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+shm_result *
+matrix_inverse_shm_4(shm_request *argp, CLIENT *clnt)
+{
+	static shm_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_INVERSE_SHM,
+		(xdrproc_t) xdr_shm_request, (caddr_t) argp,
+		(xdrproc_t) xdr_shm_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+csr_result *
+matrix_add_csr_5(csr_pair *argp, CLIENT *clnt)
+{
+	static csr_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_ADD_CSR,
+		(xdrproc_t) xdr_csr_pair, (caddr_t) argp,
+		(xdrproc_t) xdr_csr_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+csr_result *
+matrix_multiply_csr_5(csr_pair *argp, CLIENT *clnt)
+{
+	static csr_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_MULTIPLY_CSR,
+		(xdrproc_t) xdr_csr_pair, (caddr_t) argp,
+		(xdrproc_t) xdr_csr_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+csr_result *
+matrix_transpose_csr_5(csr_matrix *argp, CLIENT *clnt)
+{
+	static csr_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_TRANSPOSE_CSR,
+		(xdrproc_t) xdr_csr_matrix, (caddr_t) argp,
+		(xdrproc_t) xdr_csr_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+dense_result *
+matrix_spmm_5(csr_dense_pair *argp, CLIENT *clnt)
+{
+	static dense_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_SPMM,
+		(xdrproc_t) xdr_csr_dense_pair, (caddr_t) argp,
+		(xdrproc_t) xdr_dense_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
+
+dense_result *
+matrix_spmv_5(csr_dense_pair *argp, CLIENT *clnt)
+{
+	static dense_result clnt_res;
+
+	memset((char *)&clnt_res, 0, sizeof(clnt_res));
+	if (clnt_call (clnt, MATRIX_SPMV,
+		(xdrproc_t) xdr_csr_dense_pair, (caddr_t) argp,
+		(xdrproc_t) xdr_dense_result, (caddr_t) &clnt_res,
+		TIMEOUT) != RPC_SUCCESS) {
+		return (NULL);
+	}
+	return (&clnt_res);
+}
@@ -0,0 +1,258 @@
+#define _DEFAULT_SOURCE
+#include "matrixOp.h"
+#include "matrixOp_server.h"
+#include "matrix_cache.h"
+#include "matrix_dispatch.h"
+#include "matrix_distribute.h"
+#include "matrix_parallel.h"
+#include "matrix_shm.h"
+#include "matrix_store.h"
+#include <netinet/in.h>
+#include <pthread.h>
+#include <rpc/pmap_clnt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const struct dispatch_program programs[] = {
+	{ MATRIX_OP_PROG, MATRIX_OP_V1, matrix_op_prog_1 },
+	{ MATRIX_OP_PROG, MATRIX_OP_V2, matrix_op_prog_2 },
+	{ MATRIX_OP_PROG, MATRIX_OP_V3, matrix_op_prog_3 },
+	{ MATRIX_OP_PROG, MATRIX_OP_V4, matrix_op_prog_4 },
+	{ MATRIX_OP_PROG, MATRIX_OP_V5, matrix_op_prog_5 },
+};
+
+#define PROGRAM_COUNT (sizeof(programs) / sizeof(programs[0]))
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [--threads N] [--kernel-threads N] [--max-queue N] [--cache-mb N] [--port P]\n"
+		"          [--store-mb N] [--workers HOST:PORT,...]\n"
+		"  --threads N    worker threads for TCP requests (default: CPUs, at least 4)\n"
+		"  --kernel-threads N  threads one large inverse may use (default: CPUs)\n"
+		"  --max-queue N  requests waiting for a worker before reading pauses (default 256)\n"
+		"  --cache-mb N   memory for cached multiply/inverse results, 0 = off (default 64)\n"
+		"  --store-mb N   memory for matrices held by handle, 0 = no limit (default 4096)\n"
+		"  --port P       fixed TCP port; skips portmapper registration and UDP\n"
+		"  --workers LIST coordinator mode: large multiplies are split across these servers\n",
+		prog);
+	exit(1);
+}
+
+static void
+stop_handler(int sig)
+{
+	(void)sig;
+	dispatch_stop();
+}
+
+static int
+open_listener(unsigned short port)
+{
+	struct sockaddr_in addr;
+	int one = 1;
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (fd < 0) {
+		perror("socket");
+		return -1;
+	}
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+		perror("tcp listener");
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ * UDP stays on the stock single-threaded libtirpc loop, which does not
+ * know about matrix_op_request_done; these run it after each reply, as the
+ * TCP dispatcher does.
+ */
+static void
+udp_prog_1(struct svc_req *rqstp, SVCXPRT *transp)
+{
+	matrix_op_prog_1(rqstp, transp);
+	matrix_op_request_done();
+}
+
+static void
+udp_prog_2(struct svc_req *rqstp, SVCXPRT *transp)
+{
+	matrix_op_prog_2(rqstp, transp);
+	matrix_op_request_done();
+}
+
+static void
+udp_prog_3(struct svc_req *rqstp, SVCXPRT *transp)
+{
+	matrix_op_prog_3(rqstp, transp);
+	matrix_op_request_done();
+}
+
+static void
+udp_prog_4(struct svc_req *rqstp, SVCXPRT *transp)
+{
+	matrix_op_prog_4(rqstp, transp);
+	matrix_op_request_done();
+}
+
+static void
+udp_prog_5(struct svc_req *rqstp, SVCXPRT *transp)
+{
+	matrix_op_prog_5(rqstp, transp);
+	matrix_op_request_done();
+}
+
+static const struct dispatch_program udp_programs[] = {
+	{ MATRIX_OP_PROG, MATRIX_OP_V1, udp_prog_1 },
+	{ MATRIX_OP_PROG, MATRIX_OP_V2, udp_prog_2 },
+	{ MATRIX_OP_PROG, MATRIX_OP_V3, udp_prog_3 },
+	{ MATRIX_OP_PROG, MATRIX_OP_V4, udp_prog_4 },
+	{ MATRIX_OP_PROG, MATRIX_OP_V5, udp_prog_5 },
+};
+
+_Static_assert(sizeof(udp_programs) == sizeof(programs), "a UDP wrapper per program");
+
+static void *
+udp_main(void *arg)
+{
+	(void)arg;
+	svc_run();
+	return NULL;
+}
+
+static void
+register_udp(void)
+{
+	SVCXPRT *transp;
+	pthread_t th;
+
+	transp = svcudp_create(RPC_ANYSOCK);
+	if (transp == NULL) {
+		fprintf(stderr, "%s", "cannot create udp service.");
+		exit(1);
+	}
+	for (size_t i = 0; i < PROGRAM_COUNT; ++i) {
+		if (!svc_register(transp, udp_programs[i].prog, udp_programs[i].vers,
+				  udp_programs[i].dispatch, IPPROTO_UDP)) {
+			fprintf(stderr, "unable to register (MATRIX_OP_PROG, %lu, udp).",
+				(unsigned long)udp_programs[i].vers);
+			exit(1);
+		}
+	}
+	if (pthread_create(&th, NULL, udp_main, NULL) != 0) {
+		fprintf(stderr, "%s", "cannot start udp service thread.");
+		exit(1);
+	}
+	pthread_detach(th);
+}
+
+static void
+unset_programs(void)
+{
+	for (size_t i = 0; i < PROGRAM_COUNT; ++i) {
+		pmap_unset(programs[i].prog, programs[i].vers);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	struct dispatch_config cfg;
+	struct cache_stats stats;
+	struct distribute_stats dstats;
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	long port = -1;
+	int listen_fd;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.programs = programs;
+	cfg.program_count = PROGRAM_COUNT;
+	cfg.threads = cpus > 4 ? (unsigned int)cpus : 4;
+	cfg.max_queue = 256;
+	cfg.request_done = matrix_op_request_done;
+	cfg.conn_closed = store_free_owned;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			cfg.threads = (unsigned int)strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--kernel-threads") == 0 && i + 1 < argc) {
+			parallel_set_threads((unsigned int)strtoul(argv[++i], NULL, 10));
+		} else if (strcmp(argv[i], "--max-queue") == 0 && i + 1 < argc) {
+			cfg.max_queue = (unsigned int)strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--cache-mb") == 0 && i + 1 < argc) {
+			cache_set_limit((size_t)strtoul(argv[++i], NULL, 10) << 20);
+		} else if (strcmp(argv[i], "--store-mb") == 0 && i + 1 < argc) {
+			store_set_limit(strtoull(argv[++i], NULL, 10) << 20);
+		} else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+			if (!distribute_set_workers(argv[++i])) {
+				usage(argv[0]);
+			}
+		} else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+			port = strtol(argv[++i], NULL, 10);
+			if (port < 0 || port > 65535) {
+				usage(argv[0]);
+			}
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if (cfg.threads == 0 || cfg.max_queue == 0) {
+		usage(argv[0]);
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	shm_guard_install();
+	signal(SIGINT, stop_handler);
+	signal(SIGTERM, stop_handler);
+
+	listen_fd = open_listener(port < 0 ? 0 : (unsigned short)port);
+	if (listen_fd < 0) {
+		exit(1);
+	}
+	getsockname(listen_fd, (struct sockaddr *)&addr, &len);
+
+	if (port < 0) {
+		unset_programs();
+		register_udp();
+		for (size_t i = 0; i < PROGRAM_COUNT; ++i) {
+			if (!pmap_set(programs[i].prog, programs[i].vers, IPPROTO_TCP,
+				      ntohs(addr.sin_port))) {
+				fprintf(stderr, "%s", "unable to register (MATRIX_OP_PROG, tcp).");
+				exit(1);
+			}
+		}
+	}
+
+	fprintf(stderr, "matrixOp_server: tcp port %u, %u worker threads\n",
+		ntohs(addr.sin_port), cfg.threads);
+	if (dispatch_serve(listen_fd, &cfg) < 0) {
+		exit(1);
+	}
+	if (port < 0) {
+		unset_programs();
+	}
+	cache_get_stats(&stats);
+	fprintf(stderr, "matrixOp_server: result cache %llu hits, %llu misses, %zu entries (%zu of %zu KiB)\n",
+		stats.hits, stats.misses, stats.entries, stats.bytes >> 10, stats.limit >> 10);
+	distribute_get_stats(&dstats);
+	if (dstats.workers != 0) {
+		fprintf(stderr, "matrixOp_server: %llu multiplies on %u workers, %llu blocks computed locally after a worker failed\n",
+			dstats.multiplies, dstats.workers, dstats.fallbacks);
+	}
+	return 0;
+}
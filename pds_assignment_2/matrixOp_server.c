@@ -1,73 +1,97 @@
 #include "matrixOp.h"
-#include <math.h>
+#include "matrixOp_server.h"
+#include "matrix_cache.h"
+#include "matrix_dispatch.h"
+#include "matrix_distribute.h"
+#include "matrix_expr.h"
+#include "matrix_kernels.h"
+#include "matrix_parallel.h"
+#include "matrix_raw.h"
+#include "matrix_shm.h"
+#include "matrix_sparse.h"
+#include "matrix_store.h"
 #include <stdbool.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define EPSILON 1e-9
+#define BATCH_GRAIN 16		/* batch operations per parallel range, at least */
 
-static matrix_result result;
-static double result_buffer[MAX_MATRIX_ELEMENTS];
-static char message_buffer[ERROR_MESSAGE_LEN];
+/*
+ * Procedures may run on several worker threads at once (see
+ * matrix_dispatch.c). Each thread builds its reply in its own buffers,
+ * which stay valid until the dispatcher has encoded the reply.
+ */
+static _Thread_local matrix_result result;
+static _Thread_local double result_buffer[MAX_MATRIX_ELEMENTS];
+static _Thread_local char message_buffer[ERROR_MESSAGE_LEN];
+
+/* Reply buffers for one MATRIX_BATCH entry. */
+struct batch_slot {
+	double data[MAX_MATRIX_ELEMENTS];
+	char message[ERROR_MESSAGE_LEN];
+};
+
+static _Thread_local batch_result bresult;
+static _Thread_local struct batch_slot *batch_slots;
 
 static void
-prepare_result(void)
-{
-	result.status = 0;
-	result.value.rows = 0;
-	result.value.cols = 0;
-	result.value.data.data_len = 0;
-	result.value.data.data_val = result_buffer;
-	result.message = message_buffer;
-	message_buffer[0] = '\0';
+prepare_result(matrix_result *res, double *buffer, char *message)
+{
+	res->status = 0;
+	res->value.rows = 0;
+	res->value.cols = 0;
+	res->value.data.data_len = 0;
+	res->value.data.data_val = buffer;
+	res->message = message;
+	message[0] = '\0';
 }
 
 static void
-set_error(int status, const char *fmt, ...)
+set_error(matrix_result *res, int status, const char *fmt, ...)
 {
 	va_list args;
 
-	result.status = status;
-	result.value.rows = 0;
-	result.value.cols = 0;
-	result.value.data.data_len = 0;
+	res->status = status;
+	res->value.rows = 0;
+	res->value.cols = 0;
+	res->value.data.data_len = 0;
 
 	va_start(args, fmt);
-	vsnprintf(message_buffer, ERROR_MESSAGE_LEN, fmt, args);
+	vsnprintf(res->message, ERROR_MESSAGE_LEN, fmt, args);
 	va_end(args);
 }
 
 static bool
-ensure_valid_matrix(const matrix *m, const char *name)
+ensure_valid_matrix(matrix_result *res, const matrix *m, const char *name)
 {
 	unsigned long long expected;
 
 	if (m == NULL) {
-		set_error(1, "%s is missing", name);
+		set_error(res, 1, "%s is missing", name);
 		return false;
 	}
 
 	if (m->rows == 0 || m->cols == 0) {
-		set_error(1, "%s must have positive dimensions", name);
+		set_error(res, 1, "%s must have positive dimensions", name);
 		return false;
 	}
 
 	expected = (unsigned long long)m->rows * (unsigned long long)m->cols;
 	if (expected == 0 || expected > MAX_MATRIX_ELEMENTS) {
-		set_error(1, "%s exceeds maximum supported elements (%d)", name, MAX_MATRIX_ELEMENTS);
+		set_error(res, 1, "%s exceeds maximum supported elements (%d)", name, MAX_MATRIX_ELEMENTS);
 		return false;
 	}
 
 	if (m->data.data_len != expected) {
-		set_error(1, "%s payload size (%u) does not match %u x %u matrix", name,
+		set_error(res, 1, "%s payload size (%u) does not match %u x %u matrix", name,
 			  m->data.data_len, m->rows, m->cols);
 		return false;
 	}
 
 	if (m->data.data_val == NULL && expected > 0) {
-		set_error(1, "%s data buffer is missing", name);
+		set_error(res, 1, "%s data buffer is missing", name);
 		return false;
 	}
 
@@ -75,222 +99,1243 @@ ensure_valid_matrix(const matrix *m, const char *name)
 }
 
 static void
-write_success_matrix(u_int rows, u_int cols, u_int elements)
+write_success_matrix(matrix_result *res, u_int rows, u_int cols, u_int elements)
 {
-	result.status = 0;
-	result.value.rows = rows;
-	result.value.cols = cols;
-	result.value.data.data_len = elements;
-	message_buffer[0] = '\0';
+	res->status = 0;
+	res->value.rows = rows;
+	res->value.cols = cols;
+	res->value.data.data_len = elements;
+	res->message[0] = '\0';
 }
 
-matrix_result *
-matrix_add_1_svc(matrix_pair *argp, struct svc_req *rqstp)
+/* What a binary element-wise operation is called in dimension errors. */
+static const char *
+elementwise_name(enum ew_opcode op)
+{
+	switch (op) {
+	case EW_ADD:
+		return "addition";
+	case EW_SUBTRACT:
+		return "subtraction";
+	case EW_HADAMARD:
+		return "the Hadamard product";
+	default:
+		return "axpy";
+	}
+}
+
+/*
+ * The operations proper. Each fills in a result already set up by
+ * prepare_result(), so the single-call procedures and MATRIX_BATCH share
+ * them.
+ */
+/* a op b, or alpha * a for EW_SCALE (b is NULL then) */
+static void
+elementwise_into(matrix_result *res, enum ew_opcode op, double alpha, const matrix *a,
+		 const matrix *b)
 {
 	u_int elements;
-	const double *a;
-	const double *b;
 
-	(void)rqstp;
+	if (!ensure_valid_matrix(res, a, "Matrix A") ||
+	    (b != NULL && !ensure_valid_matrix(res, b, "Matrix B"))) {
+		return;
+	}
+
+	if (b != NULL && (a->rows != b->rows || a->cols != b->cols)) {
+		set_error(res, 1, "Matrix dimensions must match for %s", elementwise_name(op));
+		return;
+	}
+
+	elements = a->rows * a->cols;
+	kernel_elementwise_op(op, alpha, a->data.data_val, b != NULL ? b->data.data_val : NULL,
+			      res->value.data.data_val, elements);
+
+	write_success_matrix(res, a->rows, a->cols, elements);
+}
+
+static void
+add_into(matrix_result *res, const matrix *a, const matrix *b)
+{
+	elementwise_into(res, EW_ADD, 0.0, a, b);
+}
+
+static void
+multiply_into(matrix_result *res, const matrix *a, const matrix *b)
+{
+	u_int m, n, p;
+	u_int elements;
 
-	prepare_result();
+	if (!ensure_valid_matrix(res, a, "Matrix A") ||
+	    !ensure_valid_matrix(res, b, "Matrix B")) {
+		return;
+	}
 
-	if (!ensure_valid_matrix(&argp->a, "Matrix A") ||
-	    !ensure_valid_matrix(&argp->b, "Matrix B")) {
-		return &result;
+	if (a->cols != b->rows) {
+		set_error(res, 1, "Matrix multiplication requires A.cols (%u) == B.rows (%u)",
+			  a->cols, b->rows);
+		return;
 	}
 
-	if (argp->a.rows != argp->b.rows || argp->a.cols != argp->b.cols) {
-		set_error(1, "Matrix dimensions must match for addition");
-		return &result;
+	m = a->rows;
+	n = a->cols;
+	p = b->cols;
+
+	elements = m * p;
+	if (elements > MAX_MATRIX_ELEMENTS) {
+		set_error(res, 1, "Result exceeds maximum supported elements (%d)", MAX_MATRIX_ELEMENTS);
+		return;
 	}
 
-	elements = argp->a.rows * argp->a.cols;
-	a = argp->a.data.data_val;
-	b = argp->b.data.data_val;
+	cache_multiply(a->data.data_val, b->data.data_val, res->value.data.data_val, m, n, p);
 
-	for (u_int i = 0; i < elements; ++i) {
-		result_buffer[i] = a[i] + b[i];
+	write_success_matrix(res, m, p, elements);
+}
+
+static void
+transpose_into(matrix_result *res, const matrix *in)
+{
+	if (!ensure_valid_matrix(res, in, "Matrix")) {
+		return;
 	}
 
-	write_success_matrix(argp->a.rows, argp->a.cols, elements);
+	kernel_transpose(in->data.data_val, res->value.data.data_val, in->rows, in->cols);
+
+	write_success_matrix(res, in->cols, in->rows, in->rows * in->cols);
+}
+
+static void
+inverse_into(matrix_result *res, const matrix *in)
+{
+	u_int n;
+
+	if (!ensure_valid_matrix(res, in, "Matrix")) {
+		return;
+	}
+
+	if (in->rows != in->cols) {
+		set_error(res, 1, "Inverse is defined only for square matrices");
+		return;
+	}
+
+	n = in->rows;
+
+	switch (cache_inverse(in->data.data_val, res->value.data.data_val, n)) {
+	case KERNEL_OK:
+		write_success_matrix(res, n, n, n * n);
+		break;
+	case KERNEL_SINGULAR:
+		set_error(res, 1, "Matrix is singular or near-singular; inverse does not exist");
+		break;
+	default:
+		set_error(res, 2, "Server out of memory while computing inverse");
+		break;
+	}
+}
+
+matrix_result *
+matrix_add_1_svc(matrix_pair *argp, struct svc_req *rqstp)
+{
+	(void)rqstp;
+
+	prepare_result(&result, result_buffer, message_buffer);
+	add_into(&result, &argp->a, &argp->b);
 	return &result;
 }
 
 matrix_result *
 matrix_multiply_1_svc(matrix_pair *argp, struct svc_req *rqstp)
 {
-	u_int m, n, p;
-	u_int elements;
-	const double *a;
-	const double *b;
+	(void)rqstp;
+
+	prepare_result(&result, result_buffer, message_buffer);
+	multiply_into(&result, &argp->a, &argp->b);
+	return &result;
+}
+
+matrix_result *
+matrix_transpose_1_svc(matrix *argp, struct svc_req *rqstp)
+{
+	(void)rqstp;
+
+	prepare_result(&result, result_buffer, message_buffer);
+	transpose_into(&result, argp);
+	return &result;
+}
+
+matrix_result *
+matrix_inverse_1_svc(matrix *argp, struct svc_req *rqstp)
+{
+	(void)rqstp;
+
+	prepare_result(&result, result_buffer, message_buffer);
+	inverse_into(&result, argp);
+	return &result;
+}
+
+matrix_result *
+matrix_subtract_1_svc(matrix_pair *argp, struct svc_req *rqstp)
+{
+	(void)rqstp;
 
+	prepare_result(&result, result_buffer, message_buffer);
+	elementwise_into(&result, EW_SUBTRACT, 0.0, &argp->a, &argp->b);
+	return &result;
+}
+
+matrix_result *
+matrix_hadamard_1_svc(matrix_pair *argp, struct svc_req *rqstp)
+{
 	(void)rqstp;
 
-	prepare_result();
+	prepare_result(&result, result_buffer, message_buffer);
+	elementwise_into(&result, EW_HADAMARD, 0.0, &argp->a, &argp->b);
+	return &result;
+}
+
+matrix_result *
+matrix_scale_1_svc(scaled_matrix *argp, struct svc_req *rqstp)
+{
+	(void)rqstp;
 
-	if (!ensure_valid_matrix(&argp->a, "Matrix A") ||
-	    !ensure_valid_matrix(&argp->b, "Matrix B")) {
-		return &result;
+	prepare_result(&result, result_buffer, message_buffer);
+	elementwise_into(&result, EW_SCALE, argp->alpha, &argp->a, NULL);
+	return &result;
+}
+
+matrix_result *
+matrix_axpy_1_svc(scaled_pair *argp, struct svc_req *rqstp)
+{
+	(void)rqstp;
+
+	prepare_result(&result, result_buffer, message_buffer);
+	elementwise_into(&result, EW_AXPY, argp->alpha, &argp->a, &argp->b);
+	return &result;
+}
+
+static void
+free_batch(void)
+{
+	free(bresult.results.results_val);
+	free(batch_slots);
+	bresult.results.results_val = NULL;
+	bresult.results.results_len = 0;
+	batch_slots = NULL;
+}
+
+struct batch_run {
+	const matrix_op *ops;
+	matrix_result *results;
+	struct batch_slot *slots;
+};
+
+/* Batch entries [begin, end); each writes only its own result slot. */
+static void
+run_batch_ops(void *ctx, size_t begin, size_t end)
+{
+	const struct batch_run *run = ctx;
+
+	for (size_t i = begin; i < end; ++i) {
+		const matrix_op *op = &run->ops[i];
+		matrix_result *res = &run->results[i];
+
+		prepare_result(res, run->slots[i].data, run->slots[i].message);
+		switch (op->op) {
+		case BATCH_ADD:
+			add_into(res, &op->a, &op->b);
+			break;
+		case BATCH_MULTIPLY:
+			multiply_into(res, &op->a, &op->b);
+			break;
+		case BATCH_TRANSPOSE:
+			transpose_into(res, &op->a);
+			break;
+		case BATCH_INVERSE:
+			inverse_into(res, &op->a);
+			break;
+		default:
+			set_error(res, 1, "Unknown batch operation %d", (int)op->op);
+			break;
+		}
 	}
+}
 
-	if (argp->a.cols != argp->b.rows) {
-		set_error(1, "Matrix multiplication requires A.cols (%u) == B.rows (%u)",
-			  argp->a.cols, argp->b.rows);
-		return &result;
+batch_result *
+matrix_batch_1_svc(matrix_batch *argp, struct svc_req *rqstp)
+{
+	struct batch_run run;
+	u_int count = argp->ops.ops_len;
+
+	(void)rqstp;
+
+	bresult.status = 0;
+	bresult.message = message_buffer;
+	message_buffer[0] = '\0';
+	if (count == 0) {
+		return &bresult;
 	}
 
-	m = argp->a.rows;
-	n = argp->a.cols;
-	p = argp->b.cols;
+	bresult.results.results_val = malloc(sizeof(matrix_result) * count);
+	batch_slots = malloc(sizeof(struct batch_slot) * count);
+	if (bresult.results.results_val == NULL || batch_slots == NULL) {
+		free_batch();
+		bresult.status = 2;
+		snprintf(message_buffer, ERROR_MESSAGE_LEN, "Server out of memory for a batch of %u", count);
+		return &bresult;
+	}
+	bresult.results.results_len = count;
 
-	elements = m * p;
-	if (elements > MAX_MATRIX_ELEMENTS) {
-		set_error(1, "Result exceeds maximum supported elements (%d)", MAX_MATRIX_ELEMENTS);
-		return &result;
+	run.ops = argp->ops.ops_val;
+	run.results = bresult.results.results_val;
+	run.slots = batch_slots;
+	parallel_for(count, BATCH_GRAIN, run_batch_ops, &run);
+
+	return &bresult;
+}
+
+/* ---------------- version 2: server-side matrices ---------------- */
+
+static _Thread_local handle_result hresult;
+static _Thread_local chunk_result cresult;
+/* matrix a download reply points into; released once the reply is sent */
+static _Thread_local stored_matrix *pinned;
+/* big-endian hosts: byte-swapped copy a raw download reply points into */
+static _Thread_local char *raw_copy;
+/* arrays a version 5 reply points into */
+static _Thread_local sparse_matrix sparse_reply;
+static _Thread_local double *dense_reply;
+
+void
+matrix_op_request_done(void)
+{
+	free_batch();
+	if (pinned != NULL) {
+		store_release(pinned);
+		pinned = NULL;
 	}
+	free(raw_copy);
+	raw_copy = NULL;
+	sparse_free(&sparse_reply);
+	free(dense_reply);
+	dense_reply = NULL;
+}
 
-	a = argp->a.data.data_val;
-	b = argp->b.data.data_val;
+static handle_result *
+handle_error(int status, const char *fmt, ...)
+{
+	va_list args;
 
-	for (u_int i = 0; i < m; ++i) {
-		for (u_int j = 0; j < p; ++j) {
-			double sum = 0.0;
-			for (u_int k = 0; k < n; ++k) {
-				sum += a[i * n + k] * b[k * p + j];
-			}
-			result_buffer[i * p + j] = sum;
-		}
+	hresult.status = status;
+	hresult.handle = 0;
+	hresult.rows = 0;
+	hresult.cols = 0;
+	hresult.message = message_buffer;
+
+	va_start(args, fmt);
+	vsnprintf(message_buffer, ERROR_MESSAGE_LEN, fmt, args);
+	va_end(args);
+	return &hresult;
+}
+
+static handle_result *
+handle_success(u_int handle, u_int rows, u_int cols)
+{
+	hresult.status = 0;
+	hresult.handle = handle;
+	hresult.rows = rows;
+	hresult.cols = cols;
+	hresult.message = message_buffer;
+	message_buffer[0] = '\0';
+	return &hresult;
+}
+
+static stored_matrix *
+lookup(u_int handle, const char *name)
+{
+	stored_matrix *m = store_acquire(handle);
+
+	if (m == NULL) {
+		handle_error(1, "%s: unknown matrix handle %u", name, handle);
 	}
+	return m;
+}
 
-	write_success_matrix(m, p, elements);
+/* The connection a request came on, which owns the handles it creates; NULL over UDP. */
+static const void *
+owner_of(struct svc_req *rqstp)
+{
+	return dispatch_conn(rqstp->rq_xprt);
+}
 
-	return &result;
+/* Allocate a result matrix, reporting failure through hresult. */
+static u_int
+create_result(u_int rows, u_int cols, const void *owner, stored_matrix **out)
+{
+	u_int handle = store_create(rows, cols, owner, out);
+
+	if (handle == 0) {
+		handle_error(2, "Server cannot allocate a %u x %u matrix", rows, cols);
+	}
+	return handle;
 }
 
-matrix_result *
-matrix_transpose_1_svc(matrix *argp, struct svc_req *rqstp)
+/* Drop the references an operation held and build its reply. */
+static handle_result *
+finish_op(u_int handle, stored_matrix *out, stored_matrix *a, stored_matrix *b)
 {
-	u_int rows, cols;
-	const double *input;
+	handle_result *res = handle != 0 ? handle_success(handle, out->rows, out->cols) : &hresult;
+
+	if (out != NULL) {
+		store_release(out);
+	}
+	if (a != NULL) {
+		store_release(a);
+	}
+	if (b != NULL) {
+		store_release(b);
+	}
+	return res;
+}
+
+handle_result *
+matrix_create_2_svc(matrix_dims *argp, struct svc_req *rqstp)
+{
+	u_int handle;
+
+	if (argp->rows == 0 || argp->cols == 0) {
+		return handle_error(1, "Matrix must have positive dimensions");
+	}
+	handle = store_create(argp->rows, argp->cols, owner_of(rqstp), NULL);
+	if (handle == 0) {
+		return handle_error(2, "Server cannot allocate a %u x %u matrix",
+				    argp->rows, argp->cols);
+	}
+	return handle_success(handle, argp->rows, argp->cols);
+}
+
+handle_result *
+matrix_upload_2_svc(matrix_chunk *argp, struct svc_req *rqstp)
+{
+	stored_matrix *m;
+	unsigned long long end;
+
+	if ((m = lookup(argp->handle, "Upload")) == NULL) {
+		return &hresult;
+	}
+	if (!store_writable(m, owner_of(rqstp))) {
+		handle_error(1, "Upload: matrix handle %u belongs to another connection", argp->handle);
+		return finish_op(0, NULL, m, NULL);
+	}
+	end = (unsigned long long)argp->offset + argp->data.data_len;
+	if (end > (unsigned long long)m->rows * m->cols) {
+		handle_error(1, "Chunk [%u, %llu) is outside the %u x %u matrix",
+			     argp->offset, end, m->rows, m->cols);
+		return finish_op(0, NULL, m, NULL);
+	}
+	memcpy(m->data + argp->offset, argp->data.data_val,
+	       sizeof(double) * argp->data.data_len);
+	handle_success(argp->handle, m->rows, m->cols);
+	store_release(m);
+	return &hresult;
+}
+
+chunk_result *
+matrix_download_2_svc(chunk_request *argp, struct svc_req *rqstp)
+{
+	stored_matrix *m;
+	unsigned long long end;
 
 	(void)rqstp;
 
-	prepare_result();
+	cresult.status = 0;
+	cresult.data.data_len = 0;
+	cresult.data.data_val = NULL;
+	cresult.message = message_buffer;
+	message_buffer[0] = '\0';
 
-	if (!ensure_valid_matrix(argp, "Matrix")) {
-		return &result;
+	m = store_acquire(argp->handle);
+	end = (unsigned long long)argp->offset + argp->count;
+	if (m == NULL) {
+		cresult.status = 1;
+		snprintf(message_buffer, ERROR_MESSAGE_LEN, "Download: unknown matrix handle %u",
+			 argp->handle);
+	} else if (argp->count > MAX_CHUNK_ELEMENTS) {
+		cresult.status = 1;
+		snprintf(message_buffer, ERROR_MESSAGE_LEN, "Chunk exceeds %d elements",
+			 MAX_CHUNK_ELEMENTS);
+	} else if (end > (unsigned long long)m->rows * m->cols) {
+		cresult.status = 1;
+		snprintf(message_buffer, ERROR_MESSAGE_LEN,
+			 "Chunk [%u, %llu) is outside the %u x %u matrix",
+			 argp->offset, end, m->rows, m->cols);
+	} else {
+		/* encoded straight from the stored matrix, no copy */
+		cresult.data.data_len = argp->count;
+		cresult.data.data_val = m->data + argp->offset;
+		pinned = m;
+		return &cresult;
+	}
+	if (m != NULL) {
+		store_release(m);
 	}
+	return &cresult;
+}
 
-	rows = argp->rows;
-	cols = argp->cols;
-	input = argp->data.data_val;
+handle_result *
+matrix_free_2_svc(u_int *argp, struct svc_req *rqstp)
+{
+	if (!store_free(*argp, owner_of(rqstp))) {
+		return handle_error(1, "Free: unknown matrix handle %u, or another connection's", *argp);
+	}
+	return handle_success(0, 0, 0);
+}
 
-	for (u_int i = 0; i < rows; ++i) {
-		for (u_int j = 0; j < cols; ++j) {
-			result_buffer[j * rows + i] = input[i * cols + j];
+/* A new matrix holding a op b, or alpha * a for EW_SCALE (handle_b unused then). */
+static handle_result *
+elementwise_h(enum ew_opcode op, double alpha, u_int handle_a, u_int handle_b,
+	      struct svc_req *rqstp)
+{
+	stored_matrix *a, *b = NULL, *out = NULL;
+	u_int handle = 0;
+
+	if ((a = lookup(handle_a, "Matrix A")) == NULL) {
+		return &hresult;
+	}
+	if (op != EW_SCALE && (b = lookup(handle_b, "Matrix B")) == NULL) {
+		/* error already reported */
+	} else if (b != NULL && (a->rows != b->rows || a->cols != b->cols)) {
+		handle_error(1, "Matrix dimensions must match for %s", elementwise_name(op));
+	} else if ((handle = create_result(a->rows, a->cols, owner_of(rqstp), &out)) != 0) {
+		kernel_elementwise_op(op, alpha, a->data, b != NULL ? b->data : NULL, out->data,
+				      (size_t)a->rows * a->cols);
+	}
+	return finish_op(handle, out, a, b);
+}
+
+handle_result *
+matrix_add_h_2_svc(handle_pair *argp, struct svc_req *rqstp)
+{
+	return elementwise_h(EW_ADD, 0.0, argp->a, argp->b, rqstp);
+}
+
+/*
+ * Multiply for handles and shared memory, where matrices can be large: on
+ * the workers in coordinator mode, otherwise (or if they fail) here,
+ * through the result cache.
+ */
+static void
+multiply_large(const double *a, const double *b, double *out, size_t m, size_t n, size_t p)
+{
+	if (!distribute_multiply(a, b, out, m, n, p)) {
+		cache_multiply(a, b, out, m, n, p);
+	}
+}
+
+handle_result *
+matrix_multiply_h_2_svc(handle_pair *argp, struct svc_req *rqstp)
+{
+	stored_matrix *a, *b = NULL, *out = NULL;
+	u_int handle = 0;
+
+	if ((a = lookup(argp->a, "Matrix A")) == NULL) {
+		return &hresult;
+	}
+	if ((b = lookup(argp->b, "Matrix B")) == NULL) {
+		/* error already reported */
+	} else if (a->cols != b->rows) {
+		handle_error(1, "Matrix multiplication requires A.cols (%u) == B.rows (%u)",
+			     a->cols, b->rows);
+	} else if ((handle = create_result(a->rows, b->cols, owner_of(rqstp), &out)) != 0) {
+		multiply_large(a->data, b->data, out->data, a->rows, a->cols, b->cols);
+	}
+	return finish_op(handle, out, a, b);
+}
+
+handle_result *
+matrix_transpose_h_2_svc(u_int *argp, struct svc_req *rqstp)
+{
+	stored_matrix *m, *out = NULL;
+	u_int handle;
+
+	if ((m = lookup(*argp, "Matrix")) == NULL) {
+		return &hresult;
+	}
+	if ((handle = create_result(m->cols, m->rows, owner_of(rqstp), &out)) != 0) {
+		kernel_transpose(m->data, out->data, m->rows, m->cols);
+	}
+	return finish_op(handle, out, m, NULL);
+}
+
+handle_result *
+matrix_inverse_h_2_svc(u_int *argp, struct svc_req *rqstp)
+{
+	stored_matrix *m, *out = NULL;
+	u_int handle = 0;
+	int rc;
+
+	if ((m = lookup(*argp, "Matrix")) == NULL) {
+		return &hresult;
+	}
+	if (m->rows != m->cols) {
+		handle_error(1, "Inverse is defined only for square matrices");
+	} else if ((handle = create_result(m->rows, m->cols, owner_of(rqstp), &out)) != 0) {
+		rc = cache_inverse(m->data, out->data, m->rows);
+		if (rc != KERNEL_OK) {
+			store_free(handle, owner_of(rqstp));
+			handle = 0;
+			if (rc == KERNEL_SINGULAR) {
+				handle_error(1, "Matrix is singular or near-singular; inverse does not exist");
+			} else {
+				handle_error(2, "Server out of memory while computing inverse");
+			}
 		}
 	}
+	return finish_op(handle, out, m, NULL);
+}
 
-	write_success_matrix(cols, rows, rows * cols);
+handle_result *
+matrix_eval_2_svc(matrix_expr *argp, struct svc_req *rqstp)
+{
+	u_int handle;
+	u_int rows = 0, cols = 0;
+	int status;
 
-	return &result;
+	handle = expr_evaluate(argp->nodes.nodes_val, argp->nodes.nodes_len, owner_of(rqstp),
+			       &rows, &cols, &status, message_buffer);
+	if (handle == 0) {
+		hresult.status = status;
+		hresult.handle = 0;
+		hresult.rows = 0;
+		hresult.cols = 0;
+		hresult.message = message_buffer;
+		return &hresult;
+	}
+	return handle_success(handle, rows, cols);
 }
 
-matrix_result *
-matrix_inverse_1_svc(matrix *argp, struct svc_req *rqstp)
+handle_result *
+matrix_subtract_h_2_svc(handle_pair *argp, struct svc_req *rqstp)
 {
-	u_int n;
-	const double *input;
-	double *augmented = NULL;
-	u_int stride;
+	return elementwise_h(EW_SUBTRACT, 0.0, argp->a, argp->b, rqstp);
+}
+
+handle_result *
+matrix_hadamard_h_2_svc(handle_pair *argp, struct svc_req *rqstp)
+{
+	return elementwise_h(EW_HADAMARD, 0.0, argp->a, argp->b, rqstp);
+}
+
+handle_result *
+matrix_scale_h_2_svc(scaled_handle *argp, struct svc_req *rqstp)
+{
+	return elementwise_h(EW_SCALE, argp->alpha, argp->a, 0, rqstp);
+}
+
+handle_result *
+matrix_axpy_h_2_svc(scaled_handle_pair *argp, struct svc_req *rqstp)
+{
+	return elementwise_h(EW_AXPY, argp->alpha, argp->a, argp->b, rqstp);
+}
+
+/* ---------------- version 3: raw little-endian payloads ---------------- */
+
+static _Thread_local raw_result rresult;
+static _Thread_local raw_chunk_result rcresult;
+
+/* Version 1 view of a raw matrix, converted to host order in place; false (error in res) if malformed. */
+static bool
+raw_view(matrix_result *res, raw_matrix *in, matrix *out, const char *name)
+{
+	if (in->format != RAW_FORMAT_LE_DOUBLE) {
+		set_error(res, 1, "%s: unsupported raw format %u", name, in->format);
+		return false;
+	}
+	if (in->data.data_len % sizeof(double) != 0) {
+		set_error(res, 1, "%s: raw payload of %u bytes is not whole doubles", name,
+			  in->data.data_len);
+		return false;
+	}
+	out->rows = in->rows;
+	out->cols = in->cols;
+	out->data.data_len = in->data.data_len / sizeof(double);
+	out->data.data_val = (double *)(void *)in->data.data_val;
+	raw_byte_order(out->data.data_val, out->data.data_len);
+	return true;
+}
+
+/* The version 1 result, sent as a raw block straight from its buffer. */
+static raw_result *
+raw_reply(void)
+{
+	raw_byte_order(result.value.data.data_val, result.value.data.data_len);
+	rresult.status = result.status;
+	rresult.value.rows = result.value.rows;
+	rresult.value.cols = result.value.cols;
+	rresult.value.format = RAW_FORMAT_LE_DOUBLE;
+	rresult.value.data.data_len = result.value.data.data_len * sizeof(double);
+	rresult.value.data.data_val = (char *)result.value.data.data_val;
+	rresult.message = result.message;
+	return &rresult;
+}
+
+raw_result *
+matrix_add_raw_3_svc(raw_pair *argp, struct svc_req *rqstp)
+{
+	matrix a, b;
 
 	(void)rqstp;
 
-	prepare_result();
+	prepare_result(&result, result_buffer, message_buffer);
+	if (raw_view(&result, &argp->a, &a, "Matrix A") &&
+	    raw_view(&result, &argp->b, &b, "Matrix B")) {
+		add_into(&result, &a, &b);
+	}
+	return raw_reply();
+}
+
+raw_result *
+matrix_multiply_raw_3_svc(raw_pair *argp, struct svc_req *rqstp)
+{
+	matrix a, b;
 
-	if (!ensure_valid_matrix(argp, "Matrix")) {
-		return &result;
+	(void)rqstp;
+
+	prepare_result(&result, result_buffer, message_buffer);
+	if (raw_view(&result, &argp->a, &a, "Matrix A") &&
+	    raw_view(&result, &argp->b, &b, "Matrix B")) {
+		multiply_into(&result, &a, &b);
 	}
+	return raw_reply();
+}
 
-	if (argp->rows != argp->cols) {
-		set_error(1, "Inverse is defined only for square matrices");
-		return &result;
+raw_result *
+matrix_transpose_raw_3_svc(raw_matrix *argp, struct svc_req *rqstp)
+{
+	matrix in;
+
+	(void)rqstp;
+
+	prepare_result(&result, result_buffer, message_buffer);
+	if (raw_view(&result, argp, &in, "Matrix")) {
+		transpose_into(&result, &in);
 	}
+	return raw_reply();
+}
 
-	n = argp->rows;
-	input = argp->data.data_val;
-	stride = n * 2;
+raw_result *
+matrix_inverse_raw_3_svc(raw_matrix *argp, struct svc_req *rqstp)
+{
+	matrix in;
 
-	augmented = malloc(sizeof(double) * n * stride);
-	if (augmented == NULL) {
-		set_error(2, "Server out of memory while computing inverse");
-		return &result;
+	(void)rqstp;
+
+	prepare_result(&result, result_buffer, message_buffer);
+	if (raw_view(&result, argp, &in, "Matrix")) {
+		inverse_into(&result, &in);
 	}
+	return raw_reply();
+}
 
-	for (u_int i = 0; i < n; ++i) {
-		for (u_int j = 0; j < n; ++j) {
-			augmented[i * stride + j] = input[i * n + j];
-			augmented[i * stride + (n + j)] = (i == j) ? 1.0 : 0.0;
-		}
+handle_result *
+matrix_upload_raw_3_svc(raw_chunk *argp, struct svc_req *rqstp)
+{
+	matrix_chunk chunk;
+
+	if (argp->format != RAW_FORMAT_LE_DOUBLE) {
+		return handle_error(1, "Upload: unsupported raw format %u", argp->format);
+	}
+	if (argp->data.data_len % sizeof(double) != 0) {
+		return handle_error(1, "Upload: raw payload of %u bytes is not whole doubles",
+				    argp->data.data_len);
 	}
+	chunk.handle = argp->handle;
+	chunk.offset = argp->offset;
+	chunk.data.data_len = argp->data.data_len / sizeof(double);
+	chunk.data.data_val = (double *)(void *)argp->data.data_val;
+	raw_byte_order(chunk.data.data_val, chunk.data.data_len);
+	return matrix_upload_2_svc(&chunk, rqstp);
+}
 
-	for (u_int col = 0; col < n; ++col) {
-		u_int pivot = col;
-		double max_val = fabs(augmented[col * stride + col]);
+raw_chunk_result *
+matrix_download_raw_3_svc(chunk_request *argp, struct svc_req *rqstp)
+{
+	chunk_result *res = matrix_download_2_svc(argp, rqstp);
+	size_t bytes = res->data.data_len * sizeof(double);
 
-		for (u_int row = col + 1; row < n; ++row) {
-			double val = fabs(augmented[row * stride + col]);
-			if (val > max_val) {
-				max_val = val;
-				pivot = row;
-			}
-		}
+	rcresult.status = res->status;
+	rcresult.format = RAW_FORMAT_LE_DOUBLE;
+	rcresult.data.data_len = bytes;
+	rcresult.data.data_val = (char *)res->data.data_val;
+	rcresult.message = res->message;
 
-		if (max_val < EPSILON) {
-			free(augmented);
-			set_error(1, "Matrix is singular or near-singular; inverse does not exist");
-			return &result;
+	/* little-endian hosts send the pinned store data as it is */
+	if (!RAW_HOST_ORDER && bytes > 0) {
+		if ((raw_copy = malloc(bytes)) == NULL) {
+			rcresult.status = 2;
+			rcresult.data.data_len = 0;
+			rcresult.data.data_val = NULL;
+			snprintf(message_buffer, ERROR_MESSAGE_LEN, "Server out of memory");
+			return &rcresult;
 		}
+		memcpy(raw_copy, res->data.data_val, bytes);
+		raw_byte_order(raw_copy, res->data.data_len);
+		rcresult.data.data_val = raw_copy;
+	}
+	return &rcresult;
+}
 
-		if (pivot != col) {
-			for (u_int j = 0; j < stride; ++j) {
-				double tmp = augmented[col * stride + j];
-				augmented[col * stride + j] = augmented[pivot * stride + j];
-				augmented[pivot * stride + j] = tmp;
-			}
+/* ---------------- version 4: same-host shared memory ---------------- */
+
+static _Thread_local shm_result sresult;
+
+static shm_result *
+shm_error(int status, const char *fmt, ...)
+{
+	va_list args;
+
+	sresult.status = status;
+	sresult.rows = 0;
+	sresult.cols = 0;
+	sresult.message = message_buffer;
+
+	va_start(args, fmt);
+	vsnprintf(message_buffer, ERROR_MESSAGE_LEN, fmt, args);
+	va_end(args);
+	return &sresult;
+}
+
+/* Whether rows x cols doubles at offset lie inside the segment; sets sresult if not. */
+static bool
+shm_region(const shm_file *file, unsigned long long offset, u_int rows, u_int cols,
+	   const char *name)
+{
+	unsigned long long elements = (unsigned long long)rows * cols;
+
+	if (rows == 0 || cols == 0) {
+		shm_error(1, "%s must have positive dimensions", name);
+		return false;
+	}
+	if (offset % sizeof(double) != 0) {
+		shm_error(1, "%s offset %llu is not a multiple of %zu", name, offset, sizeof(double));
+		return false;
+	}
+	if (offset > file->size || elements > (file->size - offset) / sizeof(double)) {
+		shm_error(1, "%s (%u x %u at %llu) does not fit in the %zu byte segment", name,
+			  rows, cols, offset, file->size);
+		return false;
+	}
+	return true;
+}
+
+static bool
+shm_overlaps(unsigned long long a, unsigned long long a_elements, unsigned long long b,
+	     unsigned long long b_elements)
+{
+	return a < b + b_elements * sizeof(double) && b < a + a_elements * sizeof(double);
+}
+
+/* Map rows x cols doubles at offset; sets sresult (status 3) if that fails. */
+static bool
+shm_map(const shm_file *file, const char *segment, unsigned long long offset, u_int rows,
+	u_int cols, shm_segment *seg, double **at)
+{
+	int rc = shm_file_map(file, offset, sizeof(double) * rows * cols, seg, at);
+
+	if (rc != 0) {
+		shm_error(3, "Cannot map shared memory %s: %s", segment, strerror(rc));
+		return false;
+	}
+	return true;
+}
+
+/*
+ * One version 4 operation; op is the procedure number. Only a client on
+ * this host may name a segment, and only one of its own: anyone else gets
+ * status 3 and uses the other versions.
+ */
+static shm_result *
+shm_op(shm_request *req, int op, struct svc_req *rqstp)
+{
+	shm_file file = { -1, 0 };
+	shm_segment sa = { NULL, 0, -1 };
+	shm_segment sb = { NULL, 0, -1 };
+	shm_segment sr = { NULL, 0, -1 };
+	double *pa, *pb = NULL, *pr;
+	const shm_matrix *a = &req->a;
+	const shm_matrix *b = &req->b;
+	bool binary = op == MATRIX_ADD_SHM || op == MATRIX_MULTIPLY_SHM;
+	bool in_place = op == MATRIX_TRANSPOSE_SHM && req->result == a->offset && a->rows == a->cols;
+	u_int rows, cols;
+	uid_t caller;
+	int rc;
+
+	if ((rc = dispatch_peer_uid(rqstp->rq_xprt, &caller)) != 0) {
+		return shm_error(3, "Shared memory is only for local TCP clients: %s", strerror(rc));
+	}
+	if ((rc = shm_file_open(req->segment, caller, &file)) != 0) {
+		return shm_error(3, "Cannot open shared memory %s: %s", req->segment, strerror(rc));
+	}
+	if (!shm_region(&file, a->offset, a->rows, a->cols, "Matrix A") ||
+	    (binary && !shm_region(&file, b->offset, b->rows, b->cols, "Matrix B"))) {
+		goto out;
+	}
+
+	switch (op) {
+	case MATRIX_ADD_SHM:
+		if (a->rows != b->rows || a->cols != b->cols) {
+			shm_error(1, "Matrix dimensions must match for addition");
+			goto out;
+		}
+		rows = a->rows;
+		cols = a->cols;
+		break;
+	case MATRIX_MULTIPLY_SHM:
+		if (a->cols != b->rows) {
+			shm_error(1, "Matrix multiplication requires A.cols (%u) == B.rows (%u)",
+				  a->cols, b->rows);
+			goto out;
+		}
+		rows = a->rows;
+		cols = b->cols;
+		break;
+	case MATRIX_INVERSE_SHM:
+		if (a->rows != a->cols) {
+			shm_error(1, "Inverse is defined only for square matrices");
+			goto out;
 		}
+		/* fall through */
+	default:
+		rows = a->cols;
+		cols = a->rows;
+		break;
+	}
+	if (!shm_region(&file, req->result, rows, cols, "Result")) {
+		goto out;
+	}
+	if ((!in_place && shm_overlaps(req->result, (unsigned long long)rows * cols, a->offset,
+				       (unsigned long long)a->rows * a->cols)) ||
+	    (binary && shm_overlaps(req->result, (unsigned long long)rows * cols, b->offset,
+				    (unsigned long long)b->rows * b->cols))) {
+		shm_error(1, "Result must not overlap an operand");
+		goto out;
+	}
 
-		{
-			double pivot_val = augmented[col * stride + col];
-			for (u_int j = 0; j < stride; ++j) {
-				augmented[col * stride + j] /= pivot_val;
-			}
+	/* only the operands and the result are mapped, not the whole segment */
+	if (!shm_map(&file, req->segment, a->offset, a->rows, a->cols, &sa, &pa) ||
+	    (binary && !shm_map(&file, req->segment, b->offset, b->rows, b->cols, &sb, &pb))) {
+		goto out;
+	}
+	if (in_place) {
+		pr = pa;
+	} else if (!shm_map(&file, req->segment, req->result, rows, cols, &sr, &pr)) {
+		goto out;
+	}
+
+	rc = KERNEL_OK;
+	switch (op) {
+	case MATRIX_ADD_SHM:
+		kernel_add(pa, pb, pr, (size_t)rows * cols);
+		break;
+	case MATRIX_MULTIPLY_SHM:
+		multiply_large(pa, pb, pr, rows, a->cols, cols);
+		break;
+	case MATRIX_TRANSPOSE_SHM:
+		if (in_place) {
+			kernel_transpose_square(pa, rows);
+		} else {
+			kernel_transpose(pa, pr, a->rows, a->cols);
 		}
+		break;
+	default:
+		rc = cache_inverse(pa, pr, rows);
+		break;
+	}
 
-		for (u_int row = 0; row < n; ++row) {
-			if (row == col) {
-				continue;
-			}
-			double factor = augmented[row * stride + col];
-			if (fabs(factor) < EPSILON) {
-				continue;
-			}
-			for (u_int j = 0; j < stride; ++j) {
-				augmented[row * stride + j] -= factor * augmented[col * stride + j];
+	if (shm_segment_truncated(&sa) || shm_segment_truncated(&sb) || shm_segment_truncated(&sr)) {
+		shm_error(3, "Shared memory %s was truncated during the call", req->segment);
+	} else if (rc == KERNEL_SINGULAR) {
+		shm_error(1, "Matrix is singular or near-singular; inverse does not exist");
+	} else if (rc != KERNEL_OK) {
+		shm_error(2, "Server out of memory while computing inverse");
+	} else {
+		sresult.status = 0;
+		sresult.rows = rows;
+		sresult.cols = cols;
+		sresult.message = message_buffer;
+		message_buffer[0] = '\0';
+	}
+out:
+	shm_segment_close(&sr);
+	shm_segment_close(&sb);
+	shm_segment_close(&sa);
+	shm_file_close(&file);
+	return &sresult;
+}
+
+shm_result *
+matrix_add_shm_4_svc(shm_request *argp, struct svc_req *rqstp)
+{
+	return shm_op(argp, MATRIX_ADD_SHM, rqstp);
+}
+
+shm_result *
+matrix_multiply_shm_4_svc(shm_request *argp, struct svc_req *rqstp)
+{
+	return shm_op(argp, MATRIX_MULTIPLY_SHM, rqstp);
+}
+
+shm_result *
+matrix_transpose_shm_4_svc(shm_request *argp, struct svc_req *rqstp)
+{
+	return shm_op(argp, MATRIX_TRANSPOSE_SHM, rqstp);
+}
+
+shm_result *
+matrix_inverse_shm_4_svc(shm_request *argp, struct svc_req *rqstp)
+{
+	return shm_op(argp, MATRIX_INVERSE_SHM, rqstp);
+}
+
+/* ---------------- version 5: sparse (CSR) matrices ---------------- */
+
+static _Thread_local csr_result csresult;
+static _Thread_local dense_result dresult;
+
+/* Check a CSR operand's structure; the reason goes to message_buffer. */
+static bool
+valid_csr(const csr_matrix *m, const char *name)
+{
+	const u_int *ptr = m->row_ptr.row_ptr_val;
+	const u_int *col = m->col_idx.col_idx_val;
+	u_int nnz = m->values.values_len;
+
+	if (m->rows == 0 || m->cols == 0) {
+		snprintf(message_buffer, ERROR_MESSAGE_LEN, "%s must have positive dimensions", name);
+		return false;
+	}
+	if (m->row_ptr.row_ptr_len != (unsigned long long)m->rows + 1) {
+		snprintf(message_buffer, ERROR_MESSAGE_LEN, "%s needs %u row pointers, got %u", name,
+			 m->rows + 1, m->row_ptr.row_ptr_len);
+		return false;
+	}
+	if (m->col_idx.col_idx_len != nnz) {
+		snprintf(message_buffer, ERROR_MESSAGE_LEN, "%s has %u column indices but %u values",
+			 name, m->col_idx.col_idx_len, nnz);
+		return false;
+	}
+	if (ptr[0] != 0 || ptr[m->rows] != nnz) {
+		snprintf(message_buffer, ERROR_MESSAGE_LEN,
+			 "%s row pointers must run from 0 to the entry count (%u)", name, nnz);
+		return false;
+	}
+	for (u_int r = 0; r < m->rows; ++r) {
+		if (ptr[r + 1] < ptr[r] || ptr[r + 1] > nnz) {
+			snprintf(message_buffer, ERROR_MESSAGE_LEN,
+				 "%s row pointers must not decrease (row %u)", name, r);
+			return false;
+		}
+	}
+	for (u_int r = 0; r < m->rows; ++r) {
+		for (u_int i = ptr[r]; i < ptr[r + 1]; ++i) {
+			if (col[i] >= m->cols || (i > ptr[r] && col[i] <= col[i - 1])) {
+				snprintf(message_buffer, ERROR_MESSAGE_LEN,
+					 "%s column indices in row %u must be ascending and below %u",
+					 name, r, m->cols);
+				return false;
 			}
 		}
 	}
+	return true;
+}
 
-	for (u_int i = 0; i < n; ++i) {
-		for (u_int j = 0; j < n; ++j) {
-			result_buffer[i * n + j] = augmented[i * stride + (n + j)];
-		}
+static sparse_matrix
+sparse_view(const csr_matrix *m)
+{
+	sparse_matrix v;
+
+	v.rows = m->rows;
+	v.cols = m->cols;
+	v.row_ptr = m->row_ptr.row_ptr_val;
+	v.col_idx = m->col_idx.col_idx_val;
+	v.values = m->values.values_val;
+	return v;
+}
+
+static bool
+valid_dense(const dense_matrix *m, const char *name)
+{
+	if (m->rows == 0 || m->cols == 0 ||
+	    (unsigned long long)m->rows * m->cols != m->data.data_len) {
+		snprintf(message_buffer, ERROR_MESSAGE_LEN,
+			 "%s payload size (%u) does not match %u x %u matrix", name,
+			 m->data.data_len, m->rows, m->cols);
+		return false;
 	}
+	return true;
+}
 
-	write_success_matrix(n, n, n * n);
+static csr_result *
+csr_reply(int status)
+{
+	csresult.status = status;
+	csresult.message = message_buffer;
+	memset(&csresult.value, 0, sizeof(csresult.value));
+	if (status != 0) {
+		return &csresult;
+	}
+	if (sparse_nnz(&sparse_reply) > MAX_SPARSE_NNZ || sparse_reply.rows >= MAX_SPARSE_NNZ) {
+		snprintf(message_buffer, ERROR_MESSAGE_LEN,
+			 "Result has %zu entries, more than one reply carries (%d)",
+			 sparse_nnz(&sparse_reply), MAX_SPARSE_NNZ);
+		csresult.status = 1;
+		return &csresult;
+	}
+	csresult.value.rows = sparse_reply.rows;
+	csresult.value.cols = sparse_reply.cols;
+	csresult.value.row_ptr.row_ptr_len = sparse_reply.rows + 1;
+	csresult.value.row_ptr.row_ptr_val = sparse_reply.row_ptr;
+	csresult.value.col_idx.col_idx_len = sparse_nnz(&sparse_reply);
+	csresult.value.col_idx.col_idx_val = sparse_reply.col_idx;
+	csresult.value.values.values_len = sparse_nnz(&sparse_reply);
+	csresult.value.values.values_val = sparse_reply.values;
+	return &csresult;
+}
 
-	free(augmented);
+/* Fresh reply state for a version 5 call. */
+static void
+start_sparse_call(void)
+{
+	message_buffer[0] = '\0';
+}
 
-	return &result;
+static csr_result *
+csr_kernel_result(int rc)
+{
+	if (rc != KERNEL_OK) {
+		snprintf(message_buffer, ERROR_MESSAGE_LEN, "Server out of memory");
+		return csr_reply(2);
+	}
+	return csr_reply(0);
+}
+
+csr_result *
+matrix_add_csr_5_svc(csr_pair *argp, struct svc_req *rqstp)
+{
+	sparse_matrix a, b;
+
+	(void)rqstp;
+
+	start_sparse_call();
+	if (!valid_csr(&argp->a, "Matrix A") || !valid_csr(&argp->b, "Matrix B")) {
+		return csr_reply(1);
+	}
+	if (argp->a.rows != argp->b.rows || argp->a.cols != argp->b.cols) {
+		snprintf(message_buffer, ERROR_MESSAGE_LEN, "Matrix dimensions must match for addition");
+		return csr_reply(1);
+	}
+	a = sparse_view(&argp->a);
+	b = sparse_view(&argp->b);
+	return csr_kernel_result(sparse_add(&a, &b, &sparse_reply));
+}
+
+csr_result *
+matrix_multiply_csr_5_svc(csr_pair *argp, struct svc_req *rqstp)
+{
+	sparse_matrix a, b;
+
+	(void)rqstp;
+
+	start_sparse_call();
+	if (!valid_csr(&argp->a, "Matrix A") || !valid_csr(&argp->b, "Matrix B")) {
+		return csr_reply(1);
+	}
+	if (argp->a.cols != argp->b.rows) {
+		snprintf(message_buffer, ERROR_MESSAGE_LEN,
+			 "Matrix multiplication requires A.cols (%u) == B.rows (%u)",
+			 argp->a.cols, argp->b.rows);
+		return csr_reply(1);
+	}
+	a = sparse_view(&argp->a);
+	b = sparse_view(&argp->b);
+	return csr_kernel_result(sparse_multiply(&a, &b, &sparse_reply));
+}
+
+csr_result *
+matrix_transpose_csr_5_svc(csr_matrix *argp, struct svc_req *rqstp)
+{
+	sparse_matrix a;
+
+	(void)rqstp;
+
+	start_sparse_call();
+	if (!valid_csr(argp, "Matrix")) {
+		return csr_reply(1);
+	}
+	a = sparse_view(argp);
+	return csr_kernel_result(sparse_transpose(&a, &sparse_reply));
+}
+
+/* Shared by SPMM and SPMV; vector requires b to be a single column. */
+static dense_result *
+sparse_times_dense(csr_dense_pair *argp, bool vector)
+{
+	sparse_matrix a;
+	unsigned long long elements;
+
+	start_sparse_call();
+	memset(&dresult, 0, sizeof(dresult));
+	dresult.message = message_buffer;
+	dresult.status = 1;
+
+	if (!valid_csr(&argp->a, "Matrix A") || !valid_dense(&argp->b, vector ? "Vector x" : "Matrix B")) {
+		return &dresult;
+	}
+	if (argp->a.cols != argp->b.rows) {
+		snprintf(message_buffer, ERROR_MESSAGE_LEN,
+			 "Matrix multiplication requires A.cols (%u) == B.rows (%u)",
+			 argp->a.cols, argp->b.rows);
+		return &dresult;
+	}
+	if (vector && argp->b.cols != 1) {
+		snprintf(message_buffer, ERROR_MESSAGE_LEN, "Vector x must have one column, not %u",
+			 argp->b.cols);
+		return &dresult;
+	}
+	elements = (unsigned long long)argp->a.rows * argp->b.cols;
+	if (elements > MAX_DENSE_ELEMENTS) {
+		snprintf(message_buffer, ERROR_MESSAGE_LEN,
+			 "Result exceeds maximum supported elements (%d)", MAX_DENSE_ELEMENTS);
+		return &dresult;
+	}
+	if ((dense_reply = malloc(sizeof(double) * elements)) == NULL) {
+		dresult.status = 2;
+		snprintf(message_buffer, ERROR_MESSAGE_LEN, "Server out of memory");
+		return &dresult;
+	}
+
+	a = sparse_view(&argp->a);
+	if (vector) {
+		sparse_multiply_vector(&a, argp->b.data.data_val, dense_reply);
+	} else {
+		sparse_multiply_dense(&a, argp->b.data.data_val, dense_reply, argp->b.cols);
+	}
+	dresult.status = 0;
+	dresult.value.rows = argp->a.rows;
+	dresult.value.cols = argp->b.cols;
+	dresult.value.data.data_len = elements;
+	dresult.value.data.data_val = dense_reply;
+	return &dresult;
+}
+
+dense_result *
+matrix_spmm_5_svc(csr_dense_pair *argp, struct svc_req *rqstp)
+{
+	(void)rqstp;
+	return sparse_times_dense(argp, false);
+}
+
+dense_result *
+matrix_spmv_5_svc(csr_dense_pair *argp, struct svc_req *rqstp)
+{
+	(void)rqstp;
+	return sparse_times_dense(argp, true);
 }
@@ -0,0 +1,18 @@
+#ifndef MATRIXOP_SERVER_H
+#define MATRIXOP_SERVER_H
+
+/*
+ * Hooks into the procedure implementations (matrixOp_server.c) for the
+ * server main. The rpcgen dispatch functions come from matrixOp_svc.c.
+ */
+
+void matrix_op_prog_1(struct svc_req *rqstp, SVCXPRT *transp);
+void matrix_op_prog_2(struct svc_req *rqstp, SVCXPRT *transp);
+void matrix_op_prog_3(struct svc_req *rqstp, SVCXPRT *transp);
+void matrix_op_prog_4(struct svc_req *rqstp, SVCXPRT *transp);
+void matrix_op_prog_5(struct svc_req *rqstp, SVCXPRT *transp);
+
+/* Release per-request state once the reply has been sent. */
+void matrix_op_request_done(void);
+
+#endif /* MATRIXOP_SERVER_H */
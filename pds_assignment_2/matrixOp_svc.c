@@ -16,7 +16,7 @@
 #define SIG_PF void(*)(int)
 #endif
 
-static void
+void
 matrix_op_prog_1(struct svc_req *rqstp, register SVCXPRT *transp)
 {
 	union {
@@ -24,6 +24,11 @@ matrix_op_prog_1(struct svc_req *rqstp, register SVCXPRT *transp)
 		matrix_pair matrix_multiply_1_arg;
 		matrix matrix_transpose_1_arg;
 		matrix matrix_inverse_1_arg;
+		matrix_batch matrix_batch_1_arg;
+		matrix_pair matrix_subtract_1_arg;
+		matrix_pair matrix_hadamard_1_arg;
+		scaled_matrix matrix_scale_1_arg;
+		scaled_pair matrix_axpy_1_arg;
 	} argument;
 	char *result;
 	xdrproc_t _xdr_argument, _xdr_result;
@@ -58,6 +63,36 @@ matrix_op_prog_1(struct svc_req *rqstp, register SVCXPRT *transp)
 		local = (char *(*)(char *, struct svc_req *)) matrix_inverse_1_svc;
 		break;
 
+	case MATRIX_BATCH:
+		_xdr_argument = (xdrproc_t) xdr_matrix_batch;
+		_xdr_result = (xdrproc_t) xdr_batch_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_batch_1_svc;
+		break;
+
+	case MATRIX_SUBTRACT:
+		_xdr_argument = (xdrproc_t) xdr_matrix_pair;
+		_xdr_result = (xdrproc_t) xdr_matrix_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_subtract_1_svc;
+		break;
+
+	case MATRIX_HADAMARD:
+		_xdr_argument = (xdrproc_t) xdr_matrix_pair;
+		_xdr_result = (xdrproc_t) xdr_matrix_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_hadamard_1_svc;
+		break;
+
+	case MATRIX_SCALE:
+		_xdr_argument = (xdrproc_t) xdr_scaled_matrix;
+		_xdr_result = (xdrproc_t) xdr_matrix_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_scale_1_svc;
+		break;
+
+	case MATRIX_AXPY:
+		_xdr_argument = (xdrproc_t) xdr_scaled_pair;
+		_xdr_result = (xdrproc_t) xdr_matrix_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_axpy_1_svc;
+		break;
+
 	default:
 		svcerr_noproc (transp);
 		return;
@@ -78,35 +113,334 @@ matrix_op_prog_1(struct svc_req *rqstp, register SVCXPRT *transp)
 	return;
 }
 
-int
-main (int argc, char **argv)
+void
+matrix_op_prog_2(struct svc_req *rqstp, register SVCXPRT *transp)
 {
-	register SVCXPRT *transp;
+	union {
+		matrix_dims matrix_create_2_arg;
+		matrix_chunk matrix_upload_2_arg;
+		chunk_request matrix_download_2_arg;
+		u_int matrix_free_2_arg;
+		handle_pair matrix_add_h_2_arg;
+		handle_pair matrix_multiply_h_2_arg;
+		u_int matrix_transpose_h_2_arg;
+		u_int matrix_inverse_h_2_arg;
+		matrix_expr matrix_eval_2_arg;
+		handle_pair matrix_subtract_h_2_arg;
+		handle_pair matrix_hadamard_h_2_arg;
+		scaled_handle matrix_scale_h_2_arg;
+		scaled_handle_pair matrix_axpy_h_2_arg;
+	} argument;
+	char *result;
+	xdrproc_t _xdr_argument, _xdr_result;
+	char *(*local)(char *, struct svc_req *);
+
+	switch (rqstp->rq_proc) {
+	case NULLPROC:
+		(void) svc_sendreply (transp, (xdrproc_t) xdr_void, (char *)NULL);
+		return;
+
+	case MATRIX_CREATE:
+		_xdr_argument = (xdrproc_t) xdr_matrix_dims;
+		_xdr_result = (xdrproc_t) xdr_handle_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_create_2_svc;
+		break;
+
+	case MATRIX_UPLOAD:
+		_xdr_argument = (xdrproc_t) xdr_matrix_chunk;
+		_xdr_result = (xdrproc_t) xdr_handle_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_upload_2_svc;
+		break;
+
+	case MATRIX_DOWNLOAD:
+		_xdr_argument = (xdrproc_t) xdr_chunk_request;
+		_xdr_result = (xdrproc_t) xdr_chunk_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_download_2_svc;
+		break;
+
+	case MATRIX_FREE:
+		_xdr_argument = (xdrproc_t) xdr_u_int;
+		_xdr_result = (xdrproc_t) xdr_handle_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_free_2_svc;
+		break;
+
+	case MATRIX_ADD_H:
+		_xdr_argument = (xdrproc_t) xdr_handle_pair;
+		_xdr_result = (xdrproc_t) xdr_handle_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_add_h_2_svc;
+		break;
 
-	pmap_unset (MATRIX_OP_PROG, MATRIX_OP_V1);
+	case MATRIX_MULTIPLY_H:
+		_xdr_argument = (xdrproc_t) xdr_handle_pair;
+		_xdr_result = (xdrproc_t) xdr_handle_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_multiply_h_2_svc;
+		break;
+
+	case MATRIX_TRANSPOSE_H:
+		_xdr_argument = (xdrproc_t) xdr_u_int;
+		_xdr_result = (xdrproc_t) xdr_handle_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_transpose_h_2_svc;
+		break;
+
+	case MATRIX_INVERSE_H:
+		_xdr_argument = (xdrproc_t) xdr_u_int;
+		_xdr_result = (xdrproc_t) xdr_handle_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_inverse_h_2_svc;
+		break;
+
+	case MATRIX_EVAL:
+		_xdr_argument = (xdrproc_t) xdr_matrix_expr;
+		_xdr_result = (xdrproc_t) xdr_handle_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_eval_2_svc;
+		break;
+
+	case MATRIX_SUBTRACT_H:
+		_xdr_argument = (xdrproc_t) xdr_handle_pair;
+		_xdr_result = (xdrproc_t) xdr_handle_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_subtract_h_2_svc;
+		break;
 
-	transp = svcudp_create(RPC_ANYSOCK);
-	if (transp == NULL) {
-		fprintf (stderr, "%s", "cannot create udp service.");
-		exit(1);
+	case MATRIX_HADAMARD_H:
+		_xdr_argument = (xdrproc_t) xdr_handle_pair;
+		_xdr_result = (xdrproc_t) xdr_handle_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_hadamard_h_2_svc;
+		break;
+
+	case MATRIX_SCALE_H:
+		_xdr_argument = (xdrproc_t) xdr_scaled_handle;
+		_xdr_result = (xdrproc_t) xdr_handle_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_scale_h_2_svc;
+		break;
+
+	case MATRIX_AXPY_H:
+		_xdr_argument = (xdrproc_t) xdr_scaled_handle_pair;
+		_xdr_result = (xdrproc_t) xdr_handle_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_axpy_h_2_svc;
+		break;
+
+	default:
+		svcerr_noproc (transp);
+		return;
+	}
+	memset ((char *)&argument, 0, sizeof (argument));
+	if (!svc_getargs (transp, (xdrproc_t) _xdr_argument, (caddr_t) &argument)) {
+		svcerr_decode (transp);
+		return;
+	}
+	result = (*local)((char *)&argument, rqstp);
+	if (result != NULL && !svc_sendreply(transp, (xdrproc_t) _xdr_result, result)) {
+		svcerr_systemerr (transp);
 	}
-	if (!svc_register(transp, MATRIX_OP_PROG, MATRIX_OP_V1, matrix_op_prog_1, IPPROTO_UDP)) {
-		fprintf (stderr, "%s", "unable to register (MATRIX_OP_PROG, MATRIX_OP_V1, udp).");
-		exit(1);
+	if (!svc_freeargs (transp, (xdrproc_t) _xdr_argument, (caddr_t) &argument)) {
+		fprintf (stderr, "%s", "unable to free arguments");
+		exit (1);
 	}
+	return;
+}
 
-	transp = svctcp_create(RPC_ANYSOCK, 0, 0);
-	if (transp == NULL) {
-		fprintf (stderr, "%s", "cannot create tcp service.");
-		exit(1);
+void
+matrix_op_prog_3(struct svc_req *rqstp, register SVCXPRT *transp)
+{
+	union {
+		raw_pair matrix_add_raw_3_arg;
+		raw_pair matrix_multiply_raw_3_arg;
+		raw_matrix matrix_transpose_raw_3_arg;
+		raw_matrix matrix_inverse_raw_3_arg;
+		raw_chunk matrix_upload_raw_3_arg;
+		chunk_request matrix_download_raw_3_arg;
+	} argument;
+	char *result;
+	xdrproc_t _xdr_argument, _xdr_result;
+	char *(*local)(char *, struct svc_req *);
+
+	switch (rqstp->rq_proc) {
+	case NULLPROC:
+		(void) svc_sendreply (transp, (xdrproc_t) xdr_void, (char *)NULL);
+		return;
+
+	case MATRIX_ADD_RAW:
+		_xdr_argument = (xdrproc_t) xdr_raw_pair;
+		_xdr_result = (xdrproc_t) xdr_raw_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_add_raw_3_svc;
+		break;
+
+	case MATRIX_MULTIPLY_RAW:
+		_xdr_argument = (xdrproc_t) xdr_raw_pair;
+		_xdr_result = (xdrproc_t) xdr_raw_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_multiply_raw_3_svc;
+		break;
+
+	case MATRIX_TRANSPOSE_RAW:
+		_xdr_argument = (xdrproc_t) xdr_raw_matrix;
+		_xdr_result = (xdrproc_t) xdr_raw_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_transpose_raw_3_svc;
+		break;
+
+	case MATRIX_INVERSE_RAW:
+		_xdr_argument = (xdrproc_t) xdr_raw_matrix;
+		_xdr_result = (xdrproc_t) xdr_raw_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_inverse_raw_3_svc;
+		break;
+
+	case MATRIX_UPLOAD_RAW:
+		_xdr_argument = (xdrproc_t) xdr_raw_chunk;
+		_xdr_result = (xdrproc_t) xdr_handle_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_upload_raw_3_svc;
+		break;
+
+	case MATRIX_DOWNLOAD_RAW:
+		_xdr_argument = (xdrproc_t) xdr_chunk_request;
+		_xdr_result = (xdrproc_t) xdr_raw_chunk_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_download_raw_3_svc;
+		break;
+
+	default:
+		svcerr_noproc (transp);
+		return;
 	}
-	if (!svc_register(transp, MATRIX_OP_PROG, MATRIX_OP_V1, matrix_op_prog_1, IPPROTO_TCP)) {
-		fprintf (stderr, "%s", "unable to register (MATRIX_OP_PROG, MATRIX_OP_V1, tcp).");
-		exit(1);
+	memset ((char *)&argument, 0, sizeof (argument));
+	if (!svc_getargs (transp, (xdrproc_t) _xdr_argument, (caddr_t) &argument)) {
+		svcerr_decode (transp);
+		return;
+	}
+	result = (*local)((char *)&argument, rqstp);
+	if (result != NULL && !svc_sendreply(transp, (xdrproc_t) _xdr_result, result)) {
+		svcerr_systemerr (transp);
+	}
+	if (!svc_freeargs (transp, (xdrproc_t) _xdr_argument, (caddr_t) &argument)) {
+		fprintf (stderr, "%s", "unable to free arguments");
+		exit (1);
+	}
+	return;
+}
+
+void
+matrix_op_prog_4(struct svc_req *rqstp, register SVCXPRT *transp)
+{
+	union {
+		shm_request matrix_add_shm_4_arg;
+		shm_request matrix_multiply_shm_4_arg;
+		shm_request matrix_transpose_shm_4_arg;
+		shm_request matrix_inverse_shm_4_arg;
+	} argument;
+	char *result;
+	xdrproc_t _xdr_argument, _xdr_result;
+	char *(*local)(char *, struct svc_req *);
+
+	switch (rqstp->rq_proc) {
+	case NULLPROC:
+		(void) svc_sendreply (transp, (xdrproc_t) xdr_void, (char *)NULL);
+		return;
+
+	case MATRIX_ADD_SHM:
+		_xdr_argument = (xdrproc_t) xdr_shm_request;
+		_xdr_result = (xdrproc_t) xdr_shm_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_add_shm_4_svc;
+		break;
+
+	case MATRIX_MULTIPLY_SHM:
+		_xdr_argument = (xdrproc_t) xdr_shm_request;
+		_xdr_result = (xdrproc_t) xdr_shm_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_multiply_shm_4_svc;
+		break;
+
+	case MATRIX_TRANSPOSE_SHM:
+		_xdr_argument = (xdrproc_t) xdr_shm_request;
+		_xdr_result = (xdrproc_t) xdr_shm_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_transpose_shm_4_svc;
+		break;
+
+	case MATRIX_INVERSE_SHM:
+		_xdr_argument = (xdrproc_t) xdr_shm_request;
+		_xdr_result = (xdrproc_t) xdr_shm_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_inverse_shm_4_svc;
+		break;
+
+	default:
+		svcerr_noproc (transp);
+		return;
+	}
+	memset ((char *)&argument, 0, sizeof (argument));
+	if (!svc_getargs (transp, (xdrproc_t) _xdr_argument, (caddr_t) &argument)) {
+		svcerr_decode (transp);
+		return;
+	}
+	result = (*local)((char *)&argument, rqstp);
+	if (result != NULL && !svc_sendreply(transp, (xdrproc_t) _xdr_result, result)) {
+		svcerr_systemerr (transp);
+	}
+	if (!svc_freeargs (transp, (xdrproc_t) _xdr_argument, (caddr_t) &argument)) {
+		fprintf (stderr, "%s", "unable to free arguments");
+		exit (1);
 	}
+	return;
+}
+
+void
+matrix_op_prog_5(struct svc_req *rqstp, register SVCXPRT *transp)
+{
+	union {
+		csr_pair matrix_add_csr_5_arg;
+		csr_pair matrix_multiply_csr_5_arg;
+		csr_matrix matrix_transpose_csr_5_arg;
+		csr_dense_pair matrix_spmm_5_arg;
+		csr_dense_pair matrix_spmv_5_arg;
+	} argument;
+	char *result;
+	xdrproc_t _xdr_argument, _xdr_result;
+	char *(*local)(char *, struct svc_req *);
+
+	switch (rqstp->rq_proc) {
+	case NULLPROC:
+		(void) svc_sendreply (transp, (xdrproc_t) xdr_void, (char *)NULL);
+		return;
+
+	case MATRIX_ADD_CSR:
+		_xdr_argument = (xdrproc_t) xdr_csr_pair;
+		_xdr_result = (xdrproc_t) xdr_csr_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_add_csr_5_svc;
+		break;
 
-	svc_run ();
-	fprintf (stderr, "%s", "svc_run returned");
-	exit (1);
-	/* NOTREACHED */
+	case MATRIX_MULTIPLY_CSR:
+		_xdr_argument = (xdrproc_t) xdr_csr_pair;
+		_xdr_result = (xdrproc_t) xdr_csr_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_multiply_csr_5_svc;
+		break;
+
+	case MATRIX_TRANSPOSE_CSR:
+		_xdr_argument = (xdrproc_t) xdr_csr_matrix;
+		_xdr_result = (xdrproc_t) xdr_csr_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_transpose_csr_5_svc;
+		break;
+
+	case MATRIX_SPMM:
+		_xdr_argument = (xdrproc_t) xdr_csr_dense_pair;
+		_xdr_result = (xdrproc_t) xdr_dense_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_spmm_5_svc;
+		break;
+
+	case MATRIX_SPMV:
+		_xdr_argument = (xdrproc_t) xdr_csr_dense_pair;
+		_xdr_result = (xdrproc_t) xdr_dense_result;
+		local = (char *(*)(char *, struct svc_req *)) matrix_spmv_5_svc;
+		break;
+
+	default:
+		svcerr_noproc (transp);
+		return;
+	}
+	memset ((char *)&argument, 0, sizeof (argument));
+	if (!svc_getargs (transp, (xdrproc_t) _xdr_argument, (caddr_t) &argument)) {
+		svcerr_decode (transp);
+		return;
+	}
+	result = (*local)((char *)&argument, rqstp);
+	if (result != NULL && !svc_sendreply(transp, (xdrproc_t) _xdr_result, result)) {
+		svcerr_systemerr (transp);
+	}
+	if (!svc_freeargs (transp, (xdrproc_t) _xdr_argument, (caddr_t) &argument)) {
+		fprintf (stderr, "%s", "unable to free arguments");
+		exit (1);
+	}
+	return;
 }
@@ -32,6 +32,32 @@ xdr_matrix_pair (XDR *xdrs, matrix_pair *objp)
 	return TRUE;
 }
 
+bool_t
+xdr_scaled_matrix (XDR *xdrs, scaled_matrix *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_double (xdrs, &objp->alpha))
+		 return FALSE;
+	 if (!xdr_matrix (xdrs, &objp->a))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_scaled_pair (XDR *xdrs, scaled_pair *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_double (xdrs, &objp->alpha))
+		 return FALSE;
+	 if (!xdr_matrix (xdrs, &objp->a))
+		 return FALSE;
+	 if (!xdr_matrix (xdrs, &objp->b))
+		 return FALSE;
+	return TRUE;
+}
+
 bool_t
 xdr_matrix_result (XDR *xdrs, matrix_result *objp)
 {
@@ -45,3 +71,572 @@ xdr_matrix_result (XDR *xdrs, matrix_result *objp)
 		 return FALSE;
 	return TRUE;
 }
+
+bool_t
+xdr_batch_opcode (XDR *xdrs, batch_opcode *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_enum (xdrs, (enum_t *) objp))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_matrix_op (XDR *xdrs, matrix_op *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_batch_opcode (xdrs, &objp->op))
+		 return FALSE;
+	 if (!xdr_matrix (xdrs, &objp->a))
+		 return FALSE;
+	 if (!xdr_matrix (xdrs, &objp->b))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_matrix_batch (XDR *xdrs, matrix_batch *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_array (xdrs, (char **)&objp->ops.ops_val, (u_int *) &objp->ops.ops_len, MAX_BATCH_OPS,
+		sizeof (matrix_op), (xdrproc_t) xdr_matrix_op))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_batch_result (XDR *xdrs, batch_result *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_int (xdrs, &objp->status))
+		 return FALSE;
+	 if (!xdr_array (xdrs, (char **)&objp->results.results_val, (u_int *) &objp->results.results_len, MAX_BATCH_OPS,
+		sizeof (matrix_result), (xdrproc_t) xdr_matrix_result))
+		 return FALSE;
+	 if (!xdr_string (xdrs, &objp->message, ERROR_MESSAGE_LEN))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_matrix_dims (XDR *xdrs, matrix_dims *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_u_int (xdrs, &objp->rows))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->cols))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_matrix_chunk (XDR *xdrs, matrix_chunk *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_u_int (xdrs, &objp->handle))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->offset))
+		 return FALSE;
+	 if (!xdr_array (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, MAX_CHUNK_ELEMENTS,
+		sizeof (double), (xdrproc_t) xdr_double))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_chunk_request (XDR *xdrs, chunk_request *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_u_int (xdrs, &objp->handle))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->offset))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->count))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_handle_pair (XDR *xdrs, handle_pair *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_u_int (xdrs, &objp->a))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->b))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_scaled_handle (XDR *xdrs, scaled_handle *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_double (xdrs, &objp->alpha))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->a))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_scaled_handle_pair (XDR *xdrs, scaled_handle_pair *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_double (xdrs, &objp->alpha))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->a))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->b))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_handle_result (XDR *xdrs, handle_result *objp)
+{
+	register int32_t *buf;
+
+
+	if (xdrs->x_op == XDR_ENCODE) {
+		buf = XDR_INLINE (xdrs, 4 * BYTES_PER_XDR_UNIT);
+		if (buf == NULL) {
+			 if (!xdr_int (xdrs, &objp->status))
+				 return FALSE;
+			 if (!xdr_u_int (xdrs, &objp->handle))
+				 return FALSE;
+			 if (!xdr_u_int (xdrs, &objp->rows))
+				 return FALSE;
+			 if (!xdr_u_int (xdrs, &objp->cols))
+				 return FALSE;
+
+		} else {
+		IXDR_PUT_LONG(buf, objp->status);
+		IXDR_PUT_U_LONG(buf, objp->handle);
+		IXDR_PUT_U_LONG(buf, objp->rows);
+		IXDR_PUT_U_LONG(buf, objp->cols);
+		}
+		 if (!xdr_string (xdrs, &objp->message, ERROR_MESSAGE_LEN))
+			 return FALSE;
+		return TRUE;
+	} else if (xdrs->x_op == XDR_DECODE) {
+		buf = XDR_INLINE (xdrs, 4 * BYTES_PER_XDR_UNIT);
+		if (buf == NULL) {
+			 if (!xdr_int (xdrs, &objp->status))
+				 return FALSE;
+			 if (!xdr_u_int (xdrs, &objp->handle))
+				 return FALSE;
+			 if (!xdr_u_int (xdrs, &objp->rows))
+				 return FALSE;
+			 if (!xdr_u_int (xdrs, &objp->cols))
+				 return FALSE;
+
+		} else {
+		objp->status = IXDR_GET_LONG(buf);
+		objp->handle = IXDR_GET_U_LONG(buf);
+		objp->rows = IXDR_GET_U_LONG(buf);
+		objp->cols = IXDR_GET_U_LONG(buf);
+		}
+		 if (!xdr_string (xdrs, &objp->message, ERROR_MESSAGE_LEN))
+			 return FALSE;
+	 return TRUE;
+	}
+
+	 if (!xdr_int (xdrs, &objp->status))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->handle))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->rows))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->cols))
+		 return FALSE;
+	 if (!xdr_string (xdrs, &objp->message, ERROR_MESSAGE_LEN))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_chunk_result (XDR *xdrs, chunk_result *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_int (xdrs, &objp->status))
+		 return FALSE;
+	 if (!xdr_array (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, MAX_CHUNK_ELEMENTS,
+		sizeof (double), (xdrproc_t) xdr_double))
+		 return FALSE;
+	 if (!xdr_string (xdrs, &objp->message, ERROR_MESSAGE_LEN))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_expr_opcode (XDR *xdrs, expr_opcode *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_enum (xdrs, (enum_t *) objp))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_expr_node (XDR *xdrs, expr_node *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_expr_opcode (xdrs, &objp->op))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->a))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->b))
+		 return FALSE;
+	 if (!xdr_double (xdrs, &objp->alpha))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_matrix_expr (XDR *xdrs, matrix_expr *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_array (xdrs, (char **)&objp->nodes.nodes_val, (u_int *) &objp->nodes.nodes_len, MAX_EXPR_NODES,
+		sizeof (expr_node), (xdrproc_t) xdr_expr_node))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_raw_matrix (XDR *xdrs, raw_matrix *objp)
+{
+	register int32_t *buf;
+
+
+	if (xdrs->x_op == XDR_ENCODE) {
+		buf = XDR_INLINE (xdrs, 3 * BYTES_PER_XDR_UNIT);
+		if (buf == NULL) {
+			 if (!xdr_u_int (xdrs, &objp->rows))
+				 return FALSE;
+			 if (!xdr_u_int (xdrs, &objp->cols))
+				 return FALSE;
+			 if (!xdr_u_int (xdrs, &objp->format))
+				 return FALSE;
+
+		} else {
+		IXDR_PUT_U_LONG(buf, objp->rows);
+		IXDR_PUT_U_LONG(buf, objp->cols);
+		IXDR_PUT_U_LONG(buf, objp->format);
+		}
+		 if (!xdr_bytes (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, MAX_RAW_MATRIX_BYTES))
+			 return FALSE;
+		return TRUE;
+	} else if (xdrs->x_op == XDR_DECODE) {
+		buf = XDR_INLINE (xdrs, 3 * BYTES_PER_XDR_UNIT);
+		if (buf == NULL) {
+			 if (!xdr_u_int (xdrs, &objp->rows))
+				 return FALSE;
+			 if (!xdr_u_int (xdrs, &objp->cols))
+				 return FALSE;
+			 if (!xdr_u_int (xdrs, &objp->format))
+				 return FALSE;
+
+		} else {
+		objp->rows = IXDR_GET_U_LONG(buf);
+		objp->cols = IXDR_GET_U_LONG(buf);
+		objp->format = IXDR_GET_U_LONG(buf);
+		}
+		 if (!xdr_bytes (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, MAX_RAW_MATRIX_BYTES))
+			 return FALSE;
+	 return TRUE;
+	}
+
+	 if (!xdr_u_int (xdrs, &objp->rows))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->cols))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->format))
+		 return FALSE;
+	 if (!xdr_bytes (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, MAX_RAW_MATRIX_BYTES))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_raw_pair (XDR *xdrs, raw_pair *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_raw_matrix (xdrs, &objp->a))
+		 return FALSE;
+	 if (!xdr_raw_matrix (xdrs, &objp->b))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_raw_result (XDR *xdrs, raw_result *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_int (xdrs, &objp->status))
+		 return FALSE;
+	 if (!xdr_raw_matrix (xdrs, &objp->value))
+		 return FALSE;
+	 if (!xdr_string (xdrs, &objp->message, ERROR_MESSAGE_LEN))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_raw_chunk (XDR *xdrs, raw_chunk *objp)
+{
+	register int32_t *buf;
+
+
+	if (xdrs->x_op == XDR_ENCODE) {
+		buf = XDR_INLINE (xdrs, 3 * BYTES_PER_XDR_UNIT);
+		if (buf == NULL) {
+			 if (!xdr_u_int (xdrs, &objp->handle))
+				 return FALSE;
+			 if (!xdr_u_int (xdrs, &objp->offset))
+				 return FALSE;
+			 if (!xdr_u_int (xdrs, &objp->format))
+				 return FALSE;
+
+		} else {
+		IXDR_PUT_U_LONG(buf, objp->handle);
+		IXDR_PUT_U_LONG(buf, objp->offset);
+		IXDR_PUT_U_LONG(buf, objp->format);
+		}
+		 if (!xdr_bytes (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, MAX_RAW_CHUNK_BYTES))
+			 return FALSE;
+		return TRUE;
+	} else if (xdrs->x_op == XDR_DECODE) {
+		buf = XDR_INLINE (xdrs, 3 * BYTES_PER_XDR_UNIT);
+		if (buf == NULL) {
+			 if (!xdr_u_int (xdrs, &objp->handle))
+				 return FALSE;
+			 if (!xdr_u_int (xdrs, &objp->offset))
+				 return FALSE;
+			 if (!xdr_u_int (xdrs, &objp->format))
+				 return FALSE;
+
+		} else {
+		objp->handle = IXDR_GET_U_LONG(buf);
+		objp->offset = IXDR_GET_U_LONG(buf);
+		objp->format = IXDR_GET_U_LONG(buf);
+		}
+		 if (!xdr_bytes (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, MAX_RAW_CHUNK_BYTES))
+			 return FALSE;
+	 return TRUE;
+	}
+
+	 if (!xdr_u_int (xdrs, &objp->handle))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->offset))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->format))
+		 return FALSE;
+	 if (!xdr_bytes (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, MAX_RAW_CHUNK_BYTES))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_raw_chunk_result (XDR *xdrs, raw_chunk_result *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_int (xdrs, &objp->status))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->format))
+		 return FALSE;
+	 if (!xdr_bytes (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, MAX_RAW_CHUNK_BYTES))
+		 return FALSE;
+	 if (!xdr_string (xdrs, &objp->message, ERROR_MESSAGE_LEN))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_shm_matrix (XDR *xdrs, shm_matrix *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_u_int (xdrs, &objp->rows))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->cols))
+		 return FALSE;
+	 if (!xdr_u_quad_t (xdrs, &objp->offset))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_shm_request (XDR *xdrs, shm_request *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_string (xdrs, &objp->segment, SHM_NAME_LEN))
+		 return FALSE;
+	 if (!xdr_shm_matrix (xdrs, &objp->a))
+		 return FALSE;
+	 if (!xdr_shm_matrix (xdrs, &objp->b))
+		 return FALSE;
+	 if (!xdr_u_quad_t (xdrs, &objp->result))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_shm_result (XDR *xdrs, shm_result *objp)
+{
+	register int32_t *buf;
+
+
+	if (xdrs->x_op == XDR_ENCODE) {
+		buf = XDR_INLINE (xdrs, 3 * BYTES_PER_XDR_UNIT);
+		if (buf == NULL) {
+			 if (!xdr_int (xdrs, &objp->status))
+				 return FALSE;
+			 if (!xdr_u_int (xdrs, &objp->rows))
+				 return FALSE;
+			 if (!xdr_u_int (xdrs, &objp->cols))
+				 return FALSE;
+
+		} else {
+		IXDR_PUT_LONG(buf, objp->status);
+		IXDR_PUT_U_LONG(buf, objp->rows);
+		IXDR_PUT_U_LONG(buf, objp->cols);
+		}
+		 if (!xdr_string (xdrs, &objp->message, ERROR_MESSAGE_LEN))
+			 return FALSE;
+		return TRUE;
+	} else if (xdrs->x_op == XDR_DECODE) {
+		buf = XDR_INLINE (xdrs, 3 * BYTES_PER_XDR_UNIT);
+		if (buf == NULL) {
+			 if (!xdr_int (xdrs, &objp->status))
+				 return FALSE;
+			 if (!xdr_u_int (xdrs, &objp->rows))
+				 return FALSE;
+			 if (!xdr_u_int (xdrs, &objp->cols))
+				 return FALSE;
+
+		} else {
+		objp->status = IXDR_GET_LONG(buf);
+		objp->rows = IXDR_GET_U_LONG(buf);
+		objp->cols = IXDR_GET_U_LONG(buf);
+		}
+		 if (!xdr_string (xdrs, &objp->message, ERROR_MESSAGE_LEN))
+			 return FALSE;
+	 return TRUE;
+	}
+
+	 if (!xdr_int (xdrs, &objp->status))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->rows))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->cols))
+		 return FALSE;
+	 if (!xdr_string (xdrs, &objp->message, ERROR_MESSAGE_LEN))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_csr_matrix (XDR *xdrs, csr_matrix *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_u_int (xdrs, &objp->rows))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->cols))
+		 return FALSE;
+	 if (!xdr_array (xdrs, (char **)&objp->row_ptr.row_ptr_val, (u_int *) &objp->row_ptr.row_ptr_len, MAX_SPARSE_NNZ,
+		sizeof (u_int), (xdrproc_t) xdr_u_int))
+		 return FALSE;
+	 if (!xdr_array (xdrs, (char **)&objp->col_idx.col_idx_val, (u_int *) &objp->col_idx.col_idx_len, MAX_SPARSE_NNZ,
+		sizeof (u_int), (xdrproc_t) xdr_u_int))
+		 return FALSE;
+	 if (!xdr_array (xdrs, (char **)&objp->values.values_val, (u_int *) &objp->values.values_len, MAX_SPARSE_NNZ,
+		sizeof (double), (xdrproc_t) xdr_double))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_csr_pair (XDR *xdrs, csr_pair *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_csr_matrix (xdrs, &objp->a))
+		 return FALSE;
+	 if (!xdr_csr_matrix (xdrs, &objp->b))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_csr_result (XDR *xdrs, csr_result *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_int (xdrs, &objp->status))
+		 return FALSE;
+	 if (!xdr_csr_matrix (xdrs, &objp->value))
+		 return FALSE;
+	 if (!xdr_string (xdrs, &objp->message, ERROR_MESSAGE_LEN))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_dense_matrix (XDR *xdrs, dense_matrix *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_u_int (xdrs, &objp->rows))
+		 return FALSE;
+	 if (!xdr_u_int (xdrs, &objp->cols))
+		 return FALSE;
+	 if (!xdr_array (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, MAX_DENSE_ELEMENTS,
+		sizeof (double), (xdrproc_t) xdr_double))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_csr_dense_pair (XDR *xdrs, csr_dense_pair *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_csr_matrix (xdrs, &objp->a))
+		 return FALSE;
+	 if (!xdr_dense_matrix (xdrs, &objp->b))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_dense_result (XDR *xdrs, dense_result *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_int (xdrs, &objp->status))
+		 return FALSE;
+	 if (!xdr_dense_matrix (xdrs, &objp->value))
+		 return FALSE;
+	 if (!xdr_string (xdrs, &objp->message, ERROR_MESSAGE_LEN))
+		 return FALSE;
+	return TRUE;
+}
@@ -0,0 +1,517 @@
+/*
+ * Pipelined client side of the matrixOp protocol. The generated stubs (and
+ * clnt_call) send one call and block for its reply, so a connection is
+ * idle for a whole round trip per call and the server's worker threads
+ * never see more than one request from it. Here calls are encoded and
+ * sent as record-marked messages directly, each connection has a receiver
+ * thread that decodes replies as they come, and the pending table maps a
+ * reply's xid back to its call. depth bounds the calls outstanding per
+ * connection so a fast producer cannot queue unbounded work on the server.
+ */
+#define _DEFAULT_SOURCE
+#include "matrix_async.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_RECORD (64u << 20)	/* larger replies drop the connection */
+
+struct pending {
+	uint32_t xid;
+	xdrproc_t xres;
+	void *res;
+	async_done_fn done;
+	void *ctx;
+	struct pending *next;
+};
+
+struct conn {
+	int fd;
+	pthread_t receiver;
+	bool started;
+
+	pthread_mutex_t lock;	/* guards the fields below */
+	pthread_cond_t room;
+	struct pending *head;	/* in send order; replies mostly come back in it */
+	struct pending *tail;
+	unsigned int in_flight;
+	bool dead;
+
+	pthread_mutex_t send_lock;
+	char *send_buf;
+	size_t send_cap;
+};
+
+struct async_client {
+	rpcprog_t prog;
+	rpcvers_t vers;
+	unsigned int depth;
+	unsigned int count;
+	unsigned int next;
+	uint32_t xid;
+	struct conn conns[];
+};
+
+struct async_call {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	bool finished;
+	enum clnt_stat status;
+};
+
+/* ---------------- connections ---------------- */
+
+static bool
+read_full(int fd, char *buf, size_t len)
+{
+	while (len > 0) {
+		ssize_t n = recv(fd, buf, len, 0);
+
+		if (n > 0) {
+			buf += n;
+			len -= (size_t)n;
+		} else if (n == 0 || errno != EINTR) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool
+write_full(int fd, const char *buf, size_t len)
+{
+	while (len > 0) {
+		ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+
+		if (n > 0) {
+			buf += n;
+			len -= (size_t)n;
+		} else if (n == 0 || errno != EINTR) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Read one record, reassembling its fragments into *rec. */
+static bool
+read_record(int fd, char **rec, size_t *cap, size_t *len)
+{
+	uint32_t mark;
+	size_t frag;
+
+	*len = 0;
+	do {
+		if (!read_full(fd, (char *)&mark, 4)) {
+			return false;
+		}
+		mark = ntohl(mark);
+		frag = mark & 0x7fffffffu;
+		if (*len + frag > MAX_RECORD) {
+			return false;
+		}
+		if (*len + frag > *cap) {
+			char *grown = realloc(*rec, *len + frag);
+
+			if (grown == NULL) {
+				return false;
+			}
+			*rec = grown;
+			*cap = *len + frag;
+		}
+		if (!read_full(fd, *rec + *len, frag)) {
+			return false;
+		}
+		*len += frag;
+	} while ((mark & 0x80000000u) == 0);
+	return true;
+}
+
+/* Unlink the pending call with this xid, or NULL if there is none. */
+static struct pending *
+take_pending(struct conn *c, uint32_t xid)
+{
+	struct pending *prev = NULL;
+	struct pending *p;
+
+	pthread_mutex_lock(&c->lock);
+	for (p = c->head; p != NULL && p->xid != xid; p = p->next) {
+		prev = p;
+	}
+	if (p != NULL) {
+		if (prev == NULL) {
+			c->head = p->next;
+		} else {
+			prev->next = p->next;
+		}
+		if (c->tail == p) {
+			c->tail = prev;
+		}
+		c->in_flight--;
+		pthread_cond_signal(&c->room);
+	}
+	pthread_mutex_unlock(&c->lock);
+	return p;
+}
+
+static void
+complete(struct pending *p, enum clnt_stat status)
+{
+	p->done(p->ctx, status, p->res);
+	free(p);
+}
+
+static void
+deliver(struct conn *c, const char *rec, size_t len)
+{
+	char verf[MAX_AUTH_BYTES];
+	struct rpc_msg msg;
+	struct rpc_err err;
+	struct pending *p;
+	uint32_t xid;
+	XDR in;
+
+	if (len < 4) {
+		return;
+	}
+	memcpy(&xid, rec, 4);
+	if ((p = take_pending(c, ntohl(xid))) == NULL) {
+		return;	/* not ours, or a duplicate */
+	}
+
+	memset(&msg, 0, sizeof(msg));
+	msg.acpted_rply.ar_verf.oa_base = verf;
+	msg.acpted_rply.ar_results.where = p->res;
+	msg.acpted_rply.ar_results.proc = p->xres;
+	xdrmem_create(&in, (char *)rec, (u_int)len, XDR_DECODE);
+	if (!xdr_replymsg(&in, &msg) || msg.rm_direction != REPLY) {
+		xdr_free(p->xres, p->res);
+		complete(p, RPC_CANTDECODERES);
+		return;
+	}
+	_seterr_reply(&msg, &err);
+	complete(p, err.re_status);
+}
+
+/* Decode replies until the connection fails or is shut down, then fail what is left. */
+static void *
+receiver_main(void *arg)
+{
+	struct conn *c = arg;
+	char *rec = NULL;
+	size_t cap = 0;
+	size_t len;
+	struct pending *left;
+
+	while (read_record(c->fd, &rec, &cap, &len)) {
+		deliver(c, rec, len);
+	}
+	free(rec);
+
+	pthread_mutex_lock(&c->lock);
+	__atomic_store_n(&c->dead, true, __ATOMIC_RELAXED);
+	left = c->head;
+	c->head = c->tail = NULL;
+	c->in_flight = 0;
+	pthread_cond_broadcast(&c->room);
+	pthread_mutex_unlock(&c->lock);
+
+	while (left != NULL) {
+		struct pending *next = left->next;
+
+		complete(left, RPC_CANTRECV);
+		left = next;
+	}
+	return NULL;
+}
+
+static int
+connect_to(const struct sockaddr_in *addr)
+{
+	int one = 1;
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (fd < 0) {
+		return -1;
+	}
+	if (connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) != 0) {
+		close(fd);
+		return -1;
+	}
+	/* small calls go out as soon as they are encoded, not after the previous reply */
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	return fd;
+}
+
+async_client *
+async_create(const char *host, unsigned short port, rpcprog_t prog, rpcvers_t vers,
+	     unsigned int connections, unsigned int depth)
+{
+	struct addrinfo hints;
+	struct addrinfo *res;
+	struct sockaddr_in addr;
+	async_client *ac;
+
+	if (connections == 0 || depth == 0) {
+		fprintf(stderr, "async_create: connections and depth must be positive\n");
+		return NULL;
+	}
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, NULL, &hints, &res) != 0) {
+		fprintf(stderr, "%s: unknown host\n", host);
+		return NULL;
+	}
+	memcpy(&addr, res->ai_addr, sizeof(addr));
+	freeaddrinfo(res);
+	if (port == 0 && (port = pmap_getport(&addr, prog, vers, IPPROTO_TCP)) == 0) {
+		fprintf(stderr, "%s\n", clnt_spcreateerror(host));
+		return NULL;
+	}
+	addr.sin_port = htons(port);
+
+	ac = calloc(1, sizeof(*ac) + sizeof(struct conn) * connections);
+	if (ac == NULL) {
+		fprintf(stderr, "async_create: out of memory\n");
+		return NULL;
+	}
+	ac->prog = prog;
+	ac->vers = vers;
+	ac->depth = depth;
+	ac->xid = (uint32_t)getpid() << 16 ^ (uint32_t)time(NULL);
+
+	for (unsigned int i = 0; i < connections; ++i) {
+		struct conn *c = &ac->conns[i];
+
+		pthread_mutex_init(&c->lock, NULL);
+		pthread_cond_init(&c->room, NULL);
+		pthread_mutex_init(&c->send_lock, NULL);
+		ac->count++;
+		if ((c->fd = connect_to(&addr)) < 0) {
+			fprintf(stderr, "%s:%u: %s\n", host, port, strerror(errno));
+			async_destroy(ac);
+			return NULL;
+		}
+		if (pthread_create(&c->receiver, NULL, receiver_main, c) != 0) {
+			fprintf(stderr, "async_create: cannot start receiver thread\n");
+			async_destroy(ac);
+			return NULL;
+		}
+		c->started = true;
+	}
+	return ac;
+}
+
+void
+async_destroy(async_client *ac)
+{
+	if (ac == NULL) {
+		return;
+	}
+	for (unsigned int i = 0; i < ac->count; ++i) {
+		struct conn *c = &ac->conns[i];
+
+		if (c->fd >= 0) {
+			shutdown(c->fd, SHUT_RDWR);
+		}
+		if (c->started) {
+			pthread_join(c->receiver, NULL);
+		}
+		if (c->fd >= 0) {
+			close(c->fd);
+		}
+		pthread_mutex_destroy(&c->lock);
+		pthread_cond_destroy(&c->room);
+		pthread_mutex_destroy(&c->send_lock);
+		free(c->send_buf);
+	}
+	free(ac);
+}
+
+/* ---------------- calls ---------------- */
+
+/* Round robin over the live connections; NULL once all of them have failed. */
+static struct conn *
+pick_conn(async_client *ac)
+{
+	unsigned int start = __atomic_fetch_add(&ac->next, 1, __ATOMIC_RELAXED);
+
+	for (unsigned int i = 0; i < ac->count; ++i) {
+		struct conn *c = &ac->conns[(start + i) % ac->count];
+
+		if (!__atomic_load_n(&c->dead, __ATOMIC_RELAXED)) {
+			return c;
+		}
+	}
+	return NULL;
+}
+
+/* Encode the call as a single record-marked fragment and send it. */
+static enum clnt_stat
+send_call(async_client *ac, struct conn *c, uint32_t xid, rpcproc_t proc, xdrproc_t xargs,
+	  const void *args)
+{
+	enum clnt_stat status = RPC_SUCCESS;
+	struct rpc_msg msg;
+	size_t need;
+	uint32_t mark;
+	XDR out;
+	u_int len;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.rm_xid = xid;
+	msg.rm_direction = CALL;
+	msg.rm_call.cb_rpcvers = RPC_MSG_VERSION;
+	msg.rm_call.cb_prog = ac->prog;
+	msg.rm_call.cb_vers = ac->vers;
+	msg.rm_call.cb_proc = proc;
+	msg.rm_call.cb_cred = _null_auth;
+	msg.rm_call.cb_verf = _null_auth;
+
+	need = xdr_sizeof((xdrproc_t)xdr_callmsg, &msg) + xdr_sizeof(xargs, (void *)args) + 4;
+	if (need - 4 > 0x7fffffffu) {
+		return RPC_CANTENCODEARGS;
+	}
+	pthread_mutex_lock(&c->send_lock);
+	if (need > c->send_cap) {
+		char *grown = realloc(c->send_buf, need);
+
+		if (grown == NULL) {
+			pthread_mutex_unlock(&c->send_lock);
+			return RPC_SYSTEMERROR;
+		}
+		c->send_buf = grown;
+		c->send_cap = need;
+	}
+	xdrmem_create(&out, c->send_buf + 4, (u_int)(need - 4), XDR_ENCODE);
+	if (!xdr_callmsg(&out, &msg) || !(*xargs)(&out, (void *)args)) {
+		status = RPC_CANTENCODEARGS;
+	} else {
+		len = xdr_getpos(&out);
+		mark = htonl(0x80000000u | len);
+		memcpy(c->send_buf, &mark, 4);
+		if (!write_full(c->fd, c->send_buf, (size_t)len + 4)) {
+			/* a partial record would desynchronise the stream: let the receiver fail the rest */
+			shutdown(c->fd, SHUT_RDWR);
+			status = RPC_CANTSEND;
+		}
+	}
+	pthread_mutex_unlock(&c->send_lock);
+	return status;
+}
+
+enum clnt_stat
+async_submit(async_client *ac, rpcproc_t proc, xdrproc_t xargs, const void *args,
+	     xdrproc_t xres, void *res, async_done_fn done, void *ctx)
+{
+	struct pending *p = malloc(sizeof(*p));
+	struct conn *c = pick_conn(ac);
+	enum clnt_stat status;
+	uint32_t xid;
+
+	if (p == NULL || c == NULL) {
+		free(p);
+		status = p == NULL ? RPC_SYSTEMERROR : RPC_CANTSEND;
+		done(ctx, status, res);
+		return status;
+	}
+	p->xres = xres;
+	p->res = res;
+	p->done = done;
+	p->ctx = ctx;
+	p->next = NULL;
+
+	/* registered before it is sent: the reply may beat send() back */
+	pthread_mutex_lock(&c->lock);
+	while (!c->dead && c->in_flight >= ac->depth) {
+		pthread_cond_wait(&c->room, &c->lock);
+	}
+	if (c->dead) {
+		pthread_mutex_unlock(&c->lock);
+		free(p);
+		done(ctx, RPC_CANTSEND, res);
+		return RPC_CANTSEND;
+	}
+	xid = p->xid = __atomic_fetch_add(&ac->xid, 1, __ATOMIC_RELAXED);
+	if (c->tail == NULL) {
+		c->head = p;
+	} else {
+		c->tail->next = p;
+	}
+	c->tail = p;
+	c->in_flight++;
+	pthread_mutex_unlock(&c->lock);
+
+	/* p may be completed and freed from here on */
+	status = send_call(ac, c, xid, proc, xargs, args);
+	if (status != RPC_SUCCESS) {
+		/* unless the receiver has already failed it */
+		struct pending *mine = take_pending(c, xid);
+
+		if (mine != NULL) {
+			complete(mine, status);
+		}
+	}
+	return status;
+}
+
+/* ---------------- futures ---------------- */
+
+static void
+call_finished(void *ctx, enum clnt_stat status, void *res)
+{
+	async_call *call = ctx;
+
+	(void)res;
+	pthread_mutex_lock(&call->lock);
+	call->status = status;
+	call->finished = true;
+	pthread_cond_signal(&call->cond);
+	pthread_mutex_unlock(&call->lock);
+}
+
+async_call *
+async_start(async_client *ac, rpcproc_t proc, xdrproc_t xargs, const void *args,
+	    xdrproc_t xres, void *res)
+{
+	async_call *call = malloc(sizeof(*call));
+
+	if (call == NULL) {
+		return NULL;
+	}
+	pthread_mutex_init(&call->lock, NULL);
+	pthread_cond_init(&call->cond, NULL);
+	call->finished = false;
+	call->status = RPC_SUCCESS;
+	async_submit(ac, proc, xargs, args, xres, res, call_finished, call);
+	return call;
+}
+
+enum clnt_stat
+async_wait(async_call *call)
+{
+	enum clnt_stat status;
+
+	pthread_mutex_lock(&call->lock);
+	while (!call->finished) {
+		pthread_cond_wait(&call->cond, &call->lock);
+	}
+	status = call->status;
+	pthread_mutex_unlock(&call->lock);
+	pthread_mutex_destroy(&call->lock);
+	pthread_cond_destroy(&call->cond);
+	free(call);
+	return status;
+}
@@ -0,0 +1,57 @@
+#ifndef MATRIX_ASYNC_H
+#define MATRIX_ASYNC_H
+
+#include <rpc/rpc.h>
+
+/*
+ * Asynchronous client for the matrixOp program. A client is a pool of TCP
+ * connections to one server; calls are sent without waiting for earlier
+ * replies, up to depth outstanding per connection, and each reply is
+ * matched to its call by xid, so the server may answer in any order (the
+ * dispatcher does, see matrix_dispatch.c). Completion is reported through
+ * a callback or a future.
+ *
+ * Any procedure of any version can be called: pass the procedure number
+ * and the rpcgen xdr routines of its argument and result types, as
+ * clnt_call() takes them.
+ */
+
+typedef struct async_client async_client;
+typedef struct async_call async_call;
+
+/*
+ * Called once per call, on the connection's receiver thread, when the
+ * reply has been decoded into res (status RPC_SUCCESS) or the call failed.
+ * It must not block on the same client; free res with xdr_free() when done.
+ */
+typedef void (*async_done_fn)(void *ctx, enum clnt_stat status, void *res);
+
+/*
+ * Connect connections sockets to program prog, version vers on host. A
+ * port of 0 asks the portmapper. Returns NULL, after printing why, on
+ * failure.
+ */
+async_client *async_create(const char *host, unsigned short port, rpcprog_t prog,
+			   rpcvers_t vers, unsigned int connections, unsigned int depth);
+
+/* Close the connections; calls still outstanding fail with RPC_CANTRECV. */
+void async_destroy(async_client *ac);
+
+/*
+ * Send proc(args) and return at once, or once a connection has room for
+ * another call. res must be zeroed, as for clnt_call(), and stay valid
+ * until the reply has been decoded into it. done is called exactly once,
+ * possibly before this returns. Returns RPC_SUCCESS if the call was sent,
+ * otherwise why it was not.
+ */
+enum clnt_stat async_submit(async_client *ac, rpcproc_t proc, xdrproc_t xargs, const void *args,
+			    xdrproc_t xres, void *res, async_done_fn done, void *ctx);
+
+/* As async_submit(), but completion is collected with async_wait(). NULL if out of memory. */
+async_call *async_start(async_client *ac, rpcproc_t proc, xdrproc_t xargs, const void *args,
+			xdrproc_t xres, void *res);
+
+/* Wait for the call to finish, free it and return its status. */
+enum clnt_stat async_wait(async_call *call);
+
+#endif /* MATRIX_ASYNC_H */
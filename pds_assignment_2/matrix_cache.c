@@ -0,0 +1,383 @@
+/*
+ * Result cache for multiply and inverse.
+ *
+ * Entries sit in a chained hash table and on a list from most to least
+ * recently used, both under one lock. The lock is only held to find, link
+ * and unlink entries. Hashing, comparing and copying matrices happen
+ * outside it; a reference keeps a found entry alive meanwhile, as in
+ * matrix_store.c. A miss computes from the entry's own copy of the
+ * operands, so a client changing shared-memory operands mid-call cannot
+ * leave a result cached under operands it was not computed from.
+ */
+#include "matrix_cache.h"
+#include "matrix_kernels.h"
+#include "matrix_sparse.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_MIN_FLOPS (16 * 16 * 16)	/* below this a lookup costs about as much as the kernel */
+#define FIRST_BUCKETS 256
+
+enum { CACHE_MULTIPLY, CACHE_INVERSE };
+
+struct cache_entry {
+	struct cache_entry *chain;	/* next in the bucket */
+	struct cache_entry *newer;
+	struct cache_entry *older;
+	uint64_t hash;
+	int op;
+	int rc;			/* kernel result; the result data is valid for KERNEL_OK */
+	size_t m, n, p;		/* multiply: m x n times n x p; inverse: all n */
+	size_t operands;	/* elements before the result in data */
+	size_t bytes;
+	unsigned int refs;	/* guarded by cache_lock; the table holds one */
+	double data[];		/* A, then B for multiply, then the result */
+};
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct cache_entry **buckets;
+static size_t bucket_count;
+static struct cache_entry *newest;
+static struct cache_entry *oldest;
+static size_t entry_count;
+static size_t cached_bytes;
+static size_t byte_limit = CACHE_DEFAULT_BYTES;
+static unsigned long long hits;
+static unsigned long long misses;
+
+/* Four independent multiply-xorshift lanes over the raw bits of the doubles. */
+static uint64_t
+hash_data(uint64_t seed, const double *data, size_t count)
+{
+	const uint64_t k = 0x9e3779b97f4a7c15ULL;
+	uint64_t lane[4] = { seed, seed ^ k, seed + k, ~seed };
+	uint64_t h;
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		for (int l = 0; l < 4; ++l) {
+			uint64_t w;
+
+			memcpy(&w, data + i + l, sizeof(w));
+			lane[l] = (lane[l] ^ w) * k;
+			lane[l] ^= lane[l] >> 32;
+		}
+	}
+	for (; i < count; ++i) {
+		uint64_t w;
+
+		memcpy(&w, data + i, sizeof(w));
+		lane[0] = (lane[0] ^ w) * k;
+		lane[0] ^= lane[0] >> 32;
+	}
+	h = lane[0] ^ (lane[1] << 16 | lane[1] >> 48) ^ (lane[2] << 32 | lane[2] >> 32) ^
+	    (lane[3] << 48 | lane[3] >> 16) ^ count;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+}
+
+static void
+make_key(struct cache_entry *key, int op, size_t m, size_t n, size_t p,
+	 const double *a, const double *b)
+{
+	key->op = op;
+	key->m = m;
+	key->n = n;
+	key->p = p;
+	key->operands = m * n + (b != NULL ? n * p : 0);
+	key->hash = hash_data((uint64_t)op << 56 ^ m << 32 ^ n << 16 ^ p, a, m * n);
+	if (b != NULL) {
+		key->hash = hash_data(key->hash, b, n * p);
+	}
+}
+
+static bool
+same_key(const struct cache_entry *e, const struct cache_entry *key)
+{
+	return e->hash == key->hash && e->op == key->op && e->m == key->m && e->n == key->n &&
+	       e->p == key->p;
+}
+
+static double *
+result_of(struct cache_entry *e)
+{
+	return e->data + e->operands;
+}
+
+static void
+unlink_lru(struct cache_entry *e)
+{
+	if (e->newer != NULL) {
+		e->newer->older = e->older;
+	} else {
+		newest = e->older;
+	}
+	if (e->older != NULL) {
+		e->older->newer = e->newer;
+	} else {
+		oldest = e->newer;
+	}
+}
+
+static void
+push_lru(struct cache_entry *e)
+{
+	e->newer = NULL;
+	e->older = newest;
+	if (newest != NULL) {
+		newest->newer = e;
+	} else {
+		oldest = e;
+	}
+	newest = e;
+}
+
+static void
+release(struct cache_entry *e)
+{
+	unsigned int refs;
+
+	pthread_mutex_lock(&cache_lock);
+	refs = --e->refs;
+	pthread_mutex_unlock(&cache_lock);
+	if (refs == 0) {
+		free(e);
+	}
+}
+
+/*
+ * With cache_lock held: drop least recently used entries until the cache
+ * fits its limit. Entries nobody else references are chained onto *dead
+ * for the caller to free after unlocking.
+ */
+static void
+evict(struct cache_entry **dead)
+{
+	while (cached_bytes > byte_limit && oldest != NULL) {
+		struct cache_entry *e = oldest;
+		struct cache_entry **link = &buckets[e->hash & (bucket_count - 1)];
+
+		while (*link != e) {
+			link = &(*link)->chain;
+		}
+		*link = e->chain;
+		unlink_lru(e);
+		entry_count--;
+		cached_bytes -= e->bytes;
+		if (--e->refs == 0) {
+			e->chain = *dead;
+			*dead = e;
+		}
+	}
+}
+
+static void
+free_dead(struct cache_entry *dead)
+{
+	while (dead != NULL) {
+		struct cache_entry *next = dead->chain;
+
+		free(dead);
+		dead = next;
+	}
+}
+
+/* With cache_lock held: double the table once chains average two entries. */
+static void
+grow_buckets(void)
+{
+	size_t grown = bucket_count == 0 ? FIRST_BUCKETS : bucket_count * 2;
+	struct cache_entry **tmp;
+
+	if (bucket_count != 0 && entry_count <= bucket_count * 2) {
+		return;
+	}
+	tmp = calloc(grown, sizeof(*tmp));
+	if (tmp == NULL) {
+		return;
+	}
+	for (size_t i = 0; i < bucket_count; ++i) {
+		while (buckets[i] != NULL) {
+			struct cache_entry *e = buckets[i];
+
+			buckets[i] = e->chain;
+			e->chain = tmp[e->hash & (grown - 1)];
+			tmp[e->hash & (grown - 1)] = e;
+		}
+	}
+	free(buckets);
+	buckets = tmp;
+	bucket_count = grown;
+}
+
+/* A referenced entry holding exactly these operands, or NULL. */
+static struct cache_entry *
+find(const struct cache_entry *key, const double *a, const double *b)
+{
+	struct cache_entry *e = NULL;
+
+	pthread_mutex_lock(&cache_lock);
+	if (bucket_count != 0) {
+		for (e = buckets[key->hash & (bucket_count - 1)]; e != NULL; e = e->chain) {
+			if (same_key(e, key)) {
+				e->refs++;
+				unlink_lru(e);
+				push_lru(e);
+				break;
+			}
+		}
+	}
+	pthread_mutex_unlock(&cache_lock);
+
+	if (e != NULL &&
+	    (memcmp(e->data, a, sizeof(double) * key->m * key->n) != 0 ||
+	     (b != NULL && memcmp(e->data + key->m * key->n, b, sizeof(double) * key->n * key->p) != 0))) {
+		release(e);
+		e = NULL;
+	}
+	__atomic_fetch_add(e != NULL ? &hits : &misses, 1, __ATOMIC_RELAXED);
+	return e;
+}
+
+/* An unlinked entry for key holding a copy of the operands; NULL if it would not fit. */
+static struct cache_entry *
+fill(const struct cache_entry *key, const double *a, const double *b, size_t result_elements)
+{
+	size_t bytes = sizeof(struct cache_entry) + sizeof(double) * (key->operands + result_elements);
+	struct cache_entry *e;
+
+	if (bytes > __atomic_load_n(&byte_limit, __ATOMIC_RELAXED) || (e = malloc(bytes)) == NULL) {
+		return NULL;
+	}
+	*e = *key;
+	e->bytes = bytes;
+	e->refs = 1;
+	memcpy(e->data, a, sizeof(double) * key->m * key->n);
+	if (b != NULL) {
+		memcpy(e->data + key->m * key->n, b, sizeof(double) * key->n * key->p);
+	}
+	return e;
+}
+
+/* Link a computed entry, unless another thread got the same key in first. */
+static void
+insert(struct cache_entry *e)
+{
+	struct cache_entry *dead = NULL;
+	struct cache_entry **bucket;
+
+	pthread_mutex_lock(&cache_lock);
+	grow_buckets();
+	if (bucket_count == 0 || e->bytes > byte_limit) {
+		dead = e;
+		e->chain = NULL;
+	} else {
+		bucket = &buckets[e->hash & (bucket_count - 1)];
+		for (struct cache_entry *other = *bucket; other != NULL; other = other->chain) {
+			if (same_key(other, e)) {
+				dead = e;
+				e->chain = NULL;
+				break;
+			}
+		}
+		if (dead == NULL) {
+			e->chain = *bucket;
+			*bucket = e;
+			push_lru(e);
+			entry_count++;
+			cached_bytes += e->bytes;
+			evict(&dead);
+		}
+	}
+	pthread_mutex_unlock(&cache_lock);
+	free_dead(dead);
+}
+
+void
+cache_set_limit(size_t bytes)
+{
+	struct cache_entry *dead = NULL;
+
+	pthread_mutex_lock(&cache_lock);
+	__atomic_store_n(&byte_limit, bytes, __ATOMIC_RELAXED);
+	evict(&dead);
+	pthread_mutex_unlock(&cache_lock);
+	free_dead(dead);
+}
+
+void
+cache_multiply(const double *a, const double *b, double *out, size_t m, size_t n, size_t p)
+{
+	struct cache_entry key;
+	struct cache_entry *e;
+
+	if (m * n * p < CACHE_MIN_FLOPS || __atomic_load_n(&byte_limit, __ATOMIC_RELAXED) == 0) {
+		kernel_multiply_auto(a, b, out, m, n, p);
+		return;
+	}
+	make_key(&key, CACHE_MULTIPLY, m, n, p, a, b);
+	if ((e = find(&key, a, b)) != NULL) {
+		memcpy(out, result_of(e), sizeof(double) * m * p);
+		release(e);
+		return;
+	}
+	if ((e = fill(&key, a, b, m * p)) == NULL) {
+		kernel_multiply_auto(a, b, out, m, n, p);
+		return;
+	}
+	kernel_multiply_auto(e->data, e->data + m * n, result_of(e), m, n, p);
+	e->rc = KERNEL_OK;
+	memcpy(out, result_of(e), sizeof(double) * m * p);
+	insert(e);
+}
+
+int
+cache_inverse(const double *in, double *out, size_t n)
+{
+	struct cache_entry key;
+	struct cache_entry *e;
+	int rc;
+
+	if (n * n * n < CACHE_MIN_FLOPS || __atomic_load_n(&byte_limit, __ATOMIC_RELAXED) == 0) {
+		return kernel_inverse(in, out, n);
+	}
+	make_key(&key, CACHE_INVERSE, n, n, n, in, NULL);
+	if ((e = find(&key, in, NULL)) != NULL) {
+		rc = e->rc;
+		if (rc == KERNEL_OK) {
+			memcpy(out, result_of(e), sizeof(double) * n * n);
+		}
+		release(e);
+		return rc;
+	}
+	if ((e = fill(&key, in, NULL, n * n)) == NULL) {
+		return kernel_inverse(in, out, n);
+	}
+	rc = e->rc = kernel_inverse(e->data, result_of(e), n);
+	if (rc == KERNEL_NO_MEMORY) {
+		free(e);
+		return rc;
+	}
+	if (rc == KERNEL_OK) {
+		memcpy(out, result_of(e), sizeof(double) * n * n);
+	}
+	insert(e);
+	return rc;
+}
+
+void
+cache_get_stats(struct cache_stats *stats)
+{
+	pthread_mutex_lock(&cache_lock);
+	stats->entries = entry_count;
+	stats->bytes = cached_bytes;
+	stats->limit = byte_limit;
+	pthread_mutex_unlock(&cache_lock);
+	stats->hits = __atomic_load_n(&hits, __ATOMIC_RELAXED);
+	stats->misses = __atomic_load_n(&misses, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,38 @@
+#ifndef MATRIX_CACHE_H
+#define MATRIX_CACHE_H
+
+#include <stddef.h>
+
+/*
+ * Results of multiply and inverse, shared by all worker threads and keyed
+ * by the operation, the operand dimensions and a hash of the operand data.
+ * Each entry keeps a copy of its operands, so a hit is confirmed
+ * element by element and a hash collision never returns a wrong result.
+ * The least recently used entries are dropped once the cache holds more
+ * than its byte limit. The element-wise operations and transpose are not
+ * cached: hashing their operands costs about as much as computing them.
+ */
+
+/* Default limit on cached bytes (operands and results). */
+#define CACHE_DEFAULT_BYTES (64UL << 20)
+
+struct cache_stats {
+	unsigned long long hits;
+	unsigned long long misses;
+	size_t entries;
+	size_t bytes;
+	size_t limit;
+};
+
+/* Byte limit for all entries; 0 turns the cache off. Call before serving. */
+void cache_set_limit(size_t bytes);
+
+/* kernel_multiply_auto, served from the cache when the same product was computed before. */
+void cache_multiply(const double *a, const double *b, double *out, size_t m, size_t n, size_t p);
+
+/* kernel_inverse through the cache; singular matrices are remembered too. */
+int cache_inverse(const double *in, double *out, size_t n);
+
+void cache_get_stats(struct cache_stats *stats);
+
+#endif /* MATRIX_CACHE_H */
@@ -0,0 +1,615 @@
+#define _DEFAULT_SOURCE
+#include "matrix_dispatch.h"
+#include "matrix_shm.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define MAX_RECORD (64u << 20)	/* larger requests drop the connection */
+#define READ_CHUNK 65536
+#define WRITE_TIMEOUT_MS 30000
+
+struct conn {
+	int fd;
+	unsigned int refs;	/* dispatcher + queued/running requests; guarded by conn_lock */
+	int peer_uid_rc;	/* -1 until looked up, then shm_peer_uid()'s result; guarded by conn_lock */
+	uid_t peer_uid;
+	pthread_mutex_t write_lock;	/* one reply on the wire at a time */
+
+	/* record-marking reader state, dispatcher thread only */
+	unsigned char mark[4];
+	size_t mark_have;
+	size_t frag_left;
+	bool last_frag;
+	char *rec;
+	size_t rec_len;
+	size_t rec_cap;
+};
+
+struct request {
+	struct conn *conn;
+	char *rec;
+	size_t len;
+	struct request *next;
+};
+
+/* Per-call transport handed to the rpcgen dispatch function. */
+struct call {
+	struct conn *conn;
+	uint32_t xid;
+	XDR args;
+	char **reply_buf;	/* worker's reusable encode buffer */
+	size_t *reply_cap;
+};
+
+static const struct dispatch_config *config;
+static pthread_mutex_t conn_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static struct request *queue_head;
+static struct request *queue_tail;
+static unsigned int queue_len;
+static bool reader_paused;
+static bool stopping;
+
+static int wake_pipe[2] = { -1, -1 };
+static volatile sig_atomic_t stop_requested;
+
+static void
+wake_dispatcher(void)
+{
+	char c = 0;
+
+	if (write(wake_pipe[1], &c, 1) < 0) {
+		/* pipe full: the dispatcher is awake anyway */
+	}
+}
+
+void
+dispatch_stop(void)
+{
+	stop_requested = 1;
+	if (wake_pipe[1] >= 0) {
+		wake_dispatcher();
+	}
+}
+
+static void
+conn_put(struct conn *c)
+{
+	unsigned int refs;
+
+	pthread_mutex_lock(&conn_lock);
+	refs = --c->refs;
+	pthread_mutex_unlock(&conn_lock);
+	if (refs == 0) {
+		if (config->conn_closed != NULL) {
+			config->conn_closed(c);
+		}
+		close(c->fd);
+		pthread_mutex_destroy(&c->write_lock);
+		free(c->rec);
+		free(c);
+	}
+}
+
+/* ---------------- worker side ---------------- */
+
+static bool
+conn_write(struct conn *c, const char *buf, size_t len)
+{
+	bool ok = true;
+
+	pthread_mutex_lock(&c->write_lock);
+	while (len > 0) {
+		ssize_t n = send(c->fd, buf, len, MSG_NOSIGNAL);
+
+		if (n > 0) {
+			buf += n;
+			len -= (size_t)n;
+			continue;
+		}
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			struct pollfd pfd = { c->fd, POLLOUT, 0 };
+
+			if (poll(&pfd, 1, WRITE_TIMEOUT_MS) > 0) {
+				continue;
+			}
+		}
+		/* dead or stuck client: make the dispatcher drop it */
+		shutdown(c->fd, SHUT_RDWR);
+		ok = false;
+		break;
+	}
+	pthread_mutex_unlock(&c->write_lock);
+	return ok;
+}
+
+static bool_t
+call_getargs(SVCXPRT *xprt, xdrproc_t proc, void *where)
+{
+	struct call *call = xprt->xp_p1;
+
+	return (*proc)(&call->args, where);
+}
+
+static bool_t
+call_freeargs(SVCXPRT *xprt, xdrproc_t proc, void *where)
+{
+	(void)xprt;
+	xdr_free(proc, where);
+	return TRUE;
+}
+
+/* Encode the reply as a single record-marked fragment and send it. */
+static bool_t
+call_reply(SVCXPRT *xprt, struct rpc_msg *msg)
+{
+	struct call *call = xprt->xp_p1;
+	size_t need;
+	uint32_t mark;
+	XDR out;
+	u_int len;
+
+	msg->rm_xid = call->xid;
+	need = xdr_sizeof((xdrproc_t)xdr_replymsg, msg) + 4;
+	if (need > *call->reply_cap) {
+		char *grown = realloc(*call->reply_buf, need);
+		if (grown == NULL) {
+			return FALSE;
+		}
+		*call->reply_buf = grown;
+		*call->reply_cap = need;
+	}
+
+	xdrmem_create(&out, *call->reply_buf + 4, (u_int)(need - 4), XDR_ENCODE);
+	if (!xdr_replymsg(&out, msg)) {
+		return FALSE;
+	}
+	len = xdr_getpos(&out);
+	mark = htonl(0x80000000u | len);
+	memcpy(*call->reply_buf, &mark, 4);
+	return conn_write(call->conn, *call->reply_buf, (size_t)len + 4) ? TRUE : FALSE;
+}
+
+static const struct xp_ops call_ops = {
+	.xp_getargs = call_getargs,
+	.xp_reply = call_reply,
+	.xp_freeargs = call_freeargs,
+};
+
+const void *
+dispatch_conn(const SVCXPRT *xprt)
+{
+	if (xprt->xp_ops != &call_ops) {
+		return NULL;
+	}
+	return ((const struct call *)xprt->xp_p1)->conn;
+}
+
+int
+dispatch_peer_uid(const SVCXPRT *xprt, uid_t *uid)
+{
+	struct conn *c;
+	uid_t found = 0;
+	int rc;
+
+	if (xprt->xp_ops != &call_ops) {
+		return shm_peer_uid(xprt->xp_fd, uid);
+	}
+	c = ((const struct call *)xprt->xp_p1)->conn;
+	pthread_mutex_lock(&conn_lock);
+	rc = c->peer_uid_rc;
+	found = c->peer_uid;
+	pthread_mutex_unlock(&conn_lock);
+	if (rc < 0) {
+		/* concurrent calls may both look it up; they find the same answer */
+		rc = shm_peer_uid(c->fd, &found);
+		if (rc == 0 || rc == EPERM) {	/* anything else may be transient */
+			pthread_mutex_lock(&conn_lock);
+			c->peer_uid_rc = rc;
+			c->peer_uid = found;
+			pthread_mutex_unlock(&conn_lock);
+		}
+	}
+	*uid = found;
+	return rc;
+}
+
+static void
+reply_rpc_mismatch(SVCXPRT *xprt)
+{
+	struct rpc_msg msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.rm_direction = REPLY;
+	msg.rm_reply.rp_stat = MSG_DENIED;
+	msg.rjcted_rply.rj_stat = RPC_MISMATCH;
+	msg.rjcted_rply.rj_vers.low = RPC_MSG_VERSION;
+	msg.rjcted_rply.rj_vers.high = RPC_MSG_VERSION;
+	call_reply(xprt, &msg);
+}
+
+static void
+serve_request(struct request *rq, char **reply_buf, size_t *reply_cap)
+{
+	char cred[MAX_AUTH_BYTES];
+	char verf[MAX_AUTH_BYTES];
+	struct rpc_msg msg;
+	struct svc_req req;
+	struct call call;
+	SVCXPRT xprt;
+	const struct dispatch_program *match = NULL;
+	rpcvers_t low = ~(rpcvers_t)0;
+	rpcvers_t high = 0;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.rm_call.cb_cred.oa_base = cred;
+	msg.rm_call.cb_verf.oa_base = verf;
+	xdrmem_create(&call.args, rq->rec, (u_int)rq->len, XDR_DECODE);
+	if (!xdr_callmsg(&call.args, &msg) || msg.rm_direction != CALL) {
+		return;	/* not a call; nothing sensible to reply to */
+	}
+	call.conn = rq->conn;
+	call.xid = msg.rm_xid;
+	call.reply_buf = reply_buf;
+	call.reply_cap = reply_cap;
+
+	memset(&xprt, 0, sizeof(xprt));
+	xprt.xp_fd = rq->conn->fd;
+	xprt.xp_ops = &call_ops;
+	xprt.xp_verf = _null_auth;
+	xprt.xp_p1 = &call;
+
+	if (msg.rm_call.cb_rpcvers != RPC_MSG_VERSION) {
+		reply_rpc_mismatch(&xprt);
+		return;
+	}
+
+	memset(&req, 0, sizeof(req));
+	req.rq_prog = msg.rm_call.cb_prog;
+	req.rq_vers = msg.rm_call.cb_vers;
+	req.rq_proc = msg.rm_call.cb_proc;
+	req.rq_cred = msg.rm_call.cb_cred;
+	req.rq_xprt = &xprt;
+
+	for (size_t i = 0; i < config->program_count; ++i) {
+		const struct dispatch_program *p = &config->programs[i];
+
+		if (p->prog != req.rq_prog) {
+			continue;
+		}
+		if (p->vers == req.rq_vers) {
+			match = p;
+		}
+		low = p->vers < low ? p->vers : low;
+		high = p->vers > high ? p->vers : high;
+	}
+
+	if (match != NULL) {
+		match->dispatch(&req, &xprt);
+		if (config->request_done != NULL) {
+			config->request_done();
+		}
+	} else if (high != 0) {
+		svcerr_progvers(&xprt, low, high);
+	} else {
+		svcerr_noprog(&xprt);
+	}
+}
+
+static void *
+worker_main(void *arg)
+{
+	char *reply_buf = NULL;
+	size_t reply_cap = 0;
+
+	(void)arg;
+
+	for (;;) {
+		struct request *rq;
+
+		pthread_mutex_lock(&queue_lock);
+		while (queue_head == NULL && !stopping) {
+			pthread_cond_wait(&queue_cond, &queue_lock);
+		}
+		if (queue_head == NULL) {
+			pthread_mutex_unlock(&queue_lock);
+			break;
+		}
+		rq = queue_head;
+		queue_head = rq->next;
+		if (queue_head == NULL) {
+			queue_tail = NULL;
+		}
+		queue_len--;
+		if (reader_paused && queue_len < config->max_queue) {
+			reader_paused = false;
+			wake_dispatcher();
+		}
+		pthread_mutex_unlock(&queue_lock);
+
+		serve_request(rq, &reply_buf, &reply_cap);
+		conn_put(rq->conn);
+		free(rq->rec);
+		free(rq);
+	}
+
+	free(reply_buf);
+	return NULL;
+}
+
+/* ---------------- dispatcher side ---------------- */
+
+static void
+enqueue(struct conn *c, char *rec, size_t len)
+{
+	struct request *rq = malloc(sizeof(*rq));
+
+	if (rq == NULL) {
+		free(rec);
+		return;
+	}
+	pthread_mutex_lock(&conn_lock);
+	c->refs++;
+	pthread_mutex_unlock(&conn_lock);
+
+	rq->conn = c;
+	rq->rec = rec;
+	rq->len = len;
+	rq->next = NULL;
+
+	pthread_mutex_lock(&queue_lock);
+	if (queue_tail != NULL) {
+		queue_tail->next = rq;
+	} else {
+		queue_head = rq;
+	}
+	queue_tail = rq;
+	queue_len++;
+	pthread_cond_signal(&queue_cond);
+	pthread_mutex_unlock(&queue_lock);
+}
+
+/* Feed received bytes through the record-marking parser; false on a bad stream. */
+static bool
+conn_consume(struct conn *c, const char *data, size_t len)
+{
+	while (len > 0) {
+		size_t n;
+
+		if (c->frag_left == 0 && c->mark_have < 4) {
+			uint32_t mark;
+
+			while (c->mark_have < 4 && len > 0) {
+				c->mark[c->mark_have++] = (unsigned char)*data++;
+				len--;
+			}
+			if (c->mark_have < 4) {
+				break;
+			}
+			memcpy(&mark, c->mark, 4);
+			mark = ntohl(mark);
+			c->last_frag = (mark & 0x80000000u) != 0;
+			c->frag_left = mark & 0x7fffffffu;
+			if (c->rec_len + c->frag_left > MAX_RECORD) {
+				return false;
+			}
+			if (c->rec_len + c->frag_left > c->rec_cap) {
+				size_t cap = c->rec_len + c->frag_left;
+				char *grown = realloc(c->rec, cap);
+				if (grown == NULL) {
+					return false;
+				}
+				c->rec = grown;
+				c->rec_cap = cap;
+			}
+		}
+
+		n = len < c->frag_left ? len : c->frag_left;
+		memcpy(c->rec + c->rec_len, data, n);
+		c->rec_len += n;
+		c->frag_left -= n;
+		data += n;
+		len -= n;
+
+		if (c->frag_left == 0) {
+			c->mark_have = 0;
+			if (c->last_frag) {
+				/* hand the record over; the next one gets a fresh buffer */
+				enqueue(c, c->rec, c->rec_len);
+				c->rec = NULL;
+				c->rec_len = 0;
+				c->rec_cap = 0;
+			}
+		}
+	}
+	return true;
+}
+
+/* Read what is available; false when the connection is finished. */
+static bool
+conn_read(struct conn *c, char *buf)
+{
+	for (;;) {
+		ssize_t n = recv(c->fd, buf, READ_CHUNK, 0);
+
+		if (n > 0) {
+			if (!conn_consume(c, buf, (size_t)n)) {
+				return false;
+			}
+			if (n < READ_CHUNK) {
+				return true;
+			}
+			continue;
+		}
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+	}
+}
+
+static struct conn *
+accept_conn(int listen_fd)
+{
+	struct conn *c;
+	int fd = accept(listen_fd, NULL, NULL);
+
+	if (fd < 0) {
+		return NULL;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	c = calloc(1, sizeof(*c));
+	if (c == NULL) {
+		close(fd);
+		return NULL;
+	}
+	c->fd = fd;
+	c->refs = 1;
+	c->peer_uid_rc = -1;
+	pthread_mutex_init(&c->write_lock, NULL);
+	return c;
+}
+
+int
+dispatch_serve(int listen_fd, const struct dispatch_config *cfg)
+{
+	pthread_t *workers;
+	unsigned int started = 0;
+	struct conn **conns = NULL;
+	size_t nconns = 0;
+	size_t conns_cap = 0;
+	struct pollfd *pfds = NULL;
+	size_t pfds_cap = 0;
+	char *buf;
+	int rc = 0;
+
+	config = cfg;
+	if (pipe(wake_pipe) < 0) {
+		perror("pipe");
+		return -1;
+	}
+	for (int i = 0; i < 2; ++i) {
+		fcntl(wake_pipe[i], F_SETFL, fcntl(wake_pipe[i], F_GETFL) | O_NONBLOCK);
+		fcntl(wake_pipe[i], F_SETFD, FD_CLOEXEC);
+	}
+	fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+
+	buf = malloc(READ_CHUNK);
+	workers = calloc(cfg->threads, sizeof(*workers));
+	if (buf == NULL || workers == NULL) {
+		fprintf(stderr, "dispatcher: out of memory\n");
+		free(buf);
+		free(workers);
+		return -1;
+	}
+	for (; started < cfg->threads; ++started) {
+		if (pthread_create(&workers[started], NULL, worker_main, NULL) != 0) {
+			fprintf(stderr, "dispatcher: cannot start worker thread\n");
+			rc = -1;
+			stop_requested = 1;
+			break;
+		}
+	}
+
+	while (!stop_requested) {
+		bool reading;
+		size_t npfd = 2;
+
+		pthread_mutex_lock(&queue_lock);
+		reader_paused = queue_len >= config->max_queue;
+		reading = !reader_paused;
+		pthread_mutex_unlock(&queue_lock);
+
+		if (nconns + 2 > pfds_cap) {
+			struct pollfd *grown = realloc(pfds, sizeof(*pfds) * (conns_cap + 2));
+			if (grown == NULL) {
+				rc = -1;
+				break;
+			}
+			pfds = grown;
+			pfds_cap = conns_cap + 2;
+		}
+		pfds[0] = (struct pollfd){ wake_pipe[0], POLLIN, 0 };
+		pfds[1] = (struct pollfd){ listen_fd, POLLIN, 0 };
+		if (reading) {
+			for (size_t i = 0; i < nconns; ++i) {
+				pfds[npfd++] = (struct pollfd){ conns[i]->fd, POLLIN, 0 };
+			}
+		}
+
+		if (poll(pfds, npfd, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("poll");
+			rc = -1;
+			break;
+		}
+
+		if (pfds[0].revents) {
+			while (read(wake_pipe[0], buf, READ_CHUNK) > 0) {
+				/* drain */
+			}
+		}
+
+		/* conns[i] lines up with pfds[i + 2] until the array is modified below */
+		for (size_t i = npfd - 2; i-- > 0; ) {
+			if (pfds[i + 2].revents && !conn_read(conns[i], buf)) {
+				conn_put(conns[i]);
+				conns[i] = conns[--nconns];
+			}
+		}
+
+		if (pfds[1].revents) {
+			struct conn *c;
+
+			while ((c = accept_conn(listen_fd)) != NULL) {
+				if (nconns == conns_cap) {
+					size_t cap = conns_cap == 0 ? 64 : conns_cap * 2;
+					struct conn **grown = realloc(conns, sizeof(*conns) * cap);
+					if (grown == NULL) {
+						conn_put(c);
+						break;
+					}
+					conns = grown;
+					conns_cap = cap;
+				}
+				conns[nconns++] = c;
+			}
+		}
+	}
+
+	pthread_mutex_lock(&queue_lock);
+	stopping = true;
+	pthread_cond_broadcast(&queue_cond);
+	pthread_mutex_unlock(&queue_lock);
+	for (unsigned int i = 0; i < started; ++i) {
+		pthread_join(workers[i], NULL);
+	}
+	for (size_t i = 0; i < nconns; ++i) {
+		conn_put(conns[i]);
+	}
+
+	free(conns);
+	free(pfds);
+	free(workers);
+	free(buf);
+	return rc;
+}
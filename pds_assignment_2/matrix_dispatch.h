@@ -0,0 +1,52 @@
+#ifndef MATRIX_DISPATCH_H
+#define MATRIX_DISPATCH_H
+
+#include <rpc/rpc.h>
+
+/*
+ * Concurrent ONC RPC server over TCP.
+ *
+ * One dispatcher thread accepts connections and reads record-marked
+ * requests from all of them; complete requests are queued to a pool of
+ * worker threads, which decode the call, run the rpcgen dispatch function
+ * and write the reply. Requests from different clients (and pipelined
+ * requests from one client) run in parallel, so a slow call no longer holds
+ * up everyone else.
+ */
+
+typedef void (*dispatch_fn)(struct svc_req *, SVCXPRT *);
+
+struct dispatch_program {
+	rpcprog_t prog;
+	rpcvers_t vers;
+	dispatch_fn dispatch;
+};
+
+struct dispatch_config {
+	const struct dispatch_program *programs;
+	size_t program_count;
+	unsigned int threads;	/* worker threads */
+	unsigned int max_queue;	/* stop reading requests while this many are waiting */
+	void (*request_done)(void);	/* called on the worker after each reply, may be NULL */
+	void (*conn_closed)(const void *conn);	/* called once a connection is gone, may be NULL */
+};
+
+/* Serve on a listening TCP socket until dispatch_stop(); -1 on setup failure. */
+int dispatch_serve(int listen_fd, const struct dispatch_config *cfg);
+
+/* Make dispatch_serve() return. Async-signal-safe. */
+void dispatch_stop(void);
+
+/*
+ * The connection a request handed to a dispatch function came on, as later
+ * passed to conn_closed; NULL for transports not served here (UDP).
+ */
+const void *dispatch_conn(const SVCXPRT *xprt);
+
+/*
+ * shm_peer_uid() for the connection xprt came on, looked up on its first
+ * call and remembered, so later calls skip the /proc/net/tcp scan.
+ */
+int dispatch_peer_uid(const SVCXPRT *xprt, uid_t *uid);
+
+#endif /* MATRIX_DISPATCH_H */
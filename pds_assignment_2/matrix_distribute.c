@@ -0,0 +1,442 @@
+/*
+ * Distributed multiply (coordinator mode).
+ *
+ * C = A x B is cut into a pr x pc grid of blocks, one per worker, with
+ * pr x pc as close to square as the worker count allows. Worker (i, j)
+ * receives row block i of A and column block j of B, multiplies them with
+ * MATRIX_MULTIPLY_H and sends back block (i, j) of C. Each worker so
+ * receives m/pr x n + n x p/pc elements rather than all of B, as it
+ * would if only the rows were split. Blocks move as version 3 raw chunks,
+ * and every block runs on its own thread so the workers compute at the
+ * same time.
+ *
+ * Each worker has one connection, opened on first use, that carries both
+ * the version 2 and the version 3 calls: a worker lets only the connection
+ * that created a handle upload into it, and drops the handles itself when
+ * that connection breaks (see matrix_store.h). A worker that cannot be
+ * reached or breaks the connection is left alone for WORKER_RETRY_SEC; its
+ * blocks are computed here meanwhile, and so are those of a worker that
+ * fails a call, while the other blocks still come from the workers. A
+ * worker computes one block at a time; blocks of concurrent multiplies
+ * queue on its lock. The calls are made with
+ * clnt_call and local results because the rpcgen stubs keep theirs in
+ * static storage.
+ */
+#define _DEFAULT_SOURCE
+#include "matrix_distribute.h"
+#include "matrixOp.h"
+#include "matrix_kernels.h"
+#include "matrix_raw.h"
+#include <limits.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DISTRIBUTE_MIN_FLOPS ((size_t)256 * 256 * 256)	/* below this the transfers cost more than they save */
+#define RAW_CHUNK_ELEMENTS (MAX_RAW_CHUNK_BYTES / sizeof(double))
+#define WORKER_RETRY_SEC 10	/* how long a worker that failed is skipped */
+
+static struct timeval call_timeout = { 600, 0 };	/* a block multiply may take minutes */
+
+struct worker {
+	char *host;
+	unsigned short port;
+	pthread_mutex_t lock;	/* held while the worker computes a block */
+	CLIENT *clnt;		/* versions 2 and 3, switched per call */
+	time_t retry_at;	/* CLOCK_MONOTONIC seconds; skipped until then */
+};
+
+struct block {
+	struct worker *w;
+	const double *a;	/* rows x n, row stride n */
+	const double *b;	/* n x cols, row stride ldb */
+	double *c;		/* rows x cols, row stride ldc */
+	size_t rows;
+	size_t n;
+	size_t cols;
+	size_t ldb;
+	size_t ldc;
+	pthread_t thread;
+	bool started;
+	bool ok;
+};
+
+static struct worker workers[DISTRIBUTE_MAX_WORKERS];
+static unsigned int worker_count;
+static unsigned long long multiplies;
+static unsigned long long fallbacks;
+
+bool
+distribute_set_workers(const char *list)
+{
+	const char *s = list;
+
+	while (*s != '\0') {
+		const char *end = strchr(s, ',');
+		const char *colon = NULL;
+		char *stop;
+		long port;
+
+		if (end == NULL) {
+			end = s + strlen(s);
+		}
+		for (const char *c = s; c < end; ++c) {
+			if (*c == ':') {
+				colon = c;
+			}
+		}
+		if (colon == NULL || colon == s || worker_count == DISTRIBUTE_MAX_WORKERS) {
+			return false;
+		}
+		port = strtol(colon + 1, &stop, 10);
+		if (stop != end || port <= 0 || port > 65535) {
+			return false;
+		}
+		workers[worker_count].host = strndup(s, (size_t)(colon - s));
+		workers[worker_count].port = (unsigned short)port;
+		pthread_mutex_init(&workers[worker_count].lock, NULL);
+		worker_count++;
+		s = *end == ',' ? end + 1 : end;
+	}
+	return worker_count > 0;
+}
+
+static time_t
+now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec;
+}
+
+/* false while w is being skipped after a failure */
+static bool
+worker_up(struct worker *w)
+{
+	return now_sec() >= __atomic_load_n(&w->retry_at, __ATOMIC_RELAXED);
+}
+
+/* Close w's connection and skip it for WORKER_RETRY_SEC. */
+static void
+disconnect(struct worker *w)
+{
+	if (w->clnt != NULL) {
+		clnt_destroy(w->clnt);
+		w->clnt = NULL;
+	}
+	__atomic_store_n(&w->retry_at, now_sec() + WORKER_RETRY_SEC, __ATOMIC_RELAXED);
+}
+
+/* With w->lock held: open the connection if it is not open. */
+static bool
+connect_worker(struct worker *w)
+{
+	struct addrinfo hints;
+	struct addrinfo *res;
+	struct sockaddr_in addr;
+	int sock = RPC_ANYSOCK;
+
+	if (w->clnt != NULL) {
+		return true;
+	}
+	if (!worker_up(w)) {
+		return false;
+	}
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(w->host, NULL, &hints, &res) != 0) {
+		fprintf(stderr, "matrixOp_server: worker %s: unknown host\n", w->host);
+		disconnect(w);
+		return false;
+	}
+	memcpy(&addr, res->ai_addr, sizeof(addr));
+	freeaddrinfo(res);
+	addr.sin_port = htons(w->port);
+
+	w->clnt = clnttcp_create(&addr, MATRIX_OP_PROG, MATRIX_OP_V2, &sock, 0, 0);
+	if (w->clnt == NULL) {
+		fprintf(stderr, "matrixOp_server: worker %s:%u: %s\n", w->host, w->port,
+			clnt_spcreateerror("cannot connect"));
+		disconnect(w);
+		return false;
+	}
+	return true;
+}
+
+/* One call to version vers; a transport error drops the worker's connection and skips it for a while. */
+static bool
+call(struct worker *w, rpcvers_t vers, rpcproc_t proc, xdrproc_t xargs, void *args,
+     xdrproc_t xres, void *res)
+{
+	enum clnt_stat st;
+
+	clnt_control(w->clnt, CLSET_VERS, (char *)&vers);
+	st = clnt_call(w->clnt, proc, xargs, args, xres, res, call_timeout);
+	if (st != RPC_SUCCESS) {
+		fprintf(stderr, "matrixOp_server: worker %s:%u: %s\n", w->host, w->port,
+			clnt_sperrno(st));
+		disconnect(w);
+		return false;
+	}
+	return true;
+}
+
+/* A call answered with a handle_result; its handle goes to *handle if not NULL. */
+static bool
+handle_call(struct worker *w, rpcvers_t vers, rpcproc_t proc, xdrproc_t xargs, void *args,
+	    u_int *handle)
+{
+	handle_result res;
+	bool ok;
+
+	memset(&res, 0, sizeof(res));
+	if (!call(w, vers, proc, xargs, args, (xdrproc_t)xdr_handle_result, &res)) {
+		return false;
+	}
+	ok = res.status == 0;
+	if (!ok) {
+		fprintf(stderr, "matrixOp_server: worker %s:%u: %s\n", w->host, w->port, res.message);
+	} else if (handle != NULL) {
+		*handle = res.handle;
+	}
+	xdr_free((xdrproc_t)xdr_handle_result, (char *)&res);
+	return ok;
+}
+
+static bool
+create(struct worker *w, size_t rows, size_t cols, u_int *handle)
+{
+	matrix_dims dims = { (u_int)rows, (u_int)cols };
+
+	return handle_call(w, MATRIX_OP_V2, MATRIX_CREATE, (xdrproc_t)xdr_matrix_dims, &dims, handle);
+}
+
+/* flat = elements [off, off + k) of a block with cols columns and row stride ld */
+static void
+gather(double *flat, const double *block, size_t ld, size_t cols, size_t off, size_t k)
+{
+	for (size_t i = 0; i < k;) {
+		size_t c = (off + i) % cols;
+		size_t run = cols - c < k - i ? cols - c : k - i;
+
+		memcpy(flat + i, block + (off + i) / cols * ld + c, sizeof(double) * run);
+		i += run;
+	}
+}
+
+/* the reverse of gather() */
+static void
+scatter(double *block, size_t ld, size_t cols, size_t off, size_t k, const double *flat)
+{
+	for (size_t i = 0; i < k;) {
+		size_t c = (off + i) % cols;
+		size_t run = cols - c < k - i ? cols - c : k - i;
+
+		memcpy(block + (off + i) / cols * ld + c, flat + i, sizeof(double) * run);
+		i += run;
+	}
+}
+
+/* Send rows x cols at src (row stride ld) to handle, packing each chunk in buf. */
+static bool
+upload(struct worker *w, u_int handle, const double *src, size_t ld, size_t rows, size_t cols,
+       double *buf)
+{
+	size_t total = rows * cols;
+
+	for (size_t off = 0; off < total;) {
+		size_t k = total - off < RAW_CHUNK_ELEMENTS ? total - off : RAW_CHUNK_ELEMENTS;
+		raw_chunk chunk;
+
+		gather(buf, src, ld, cols, off, k);
+		raw_byte_order(buf, k);
+		chunk.handle = handle;
+		chunk.offset = (u_int)off;
+		chunk.format = RAW_FORMAT_LE_DOUBLE;
+		chunk.data.data_len = (u_int)(sizeof(double) * k);
+		chunk.data.data_val = (char *)buf;
+		if (!handle_call(w, MATRIX_OP_V3, MATRIX_UPLOAD_RAW, (xdrproc_t)xdr_raw_chunk, &chunk, NULL)) {
+			return false;
+		}
+		off += k;
+	}
+	return true;
+}
+
+/* Fetch handle (rows x cols) into dst, row stride ld. */
+static bool
+download(struct worker *w, u_int handle, double *dst, size_t ld, size_t rows, size_t cols)
+{
+	size_t total = rows * cols;
+
+	for (size_t off = 0; off < total;) {
+		size_t k = total - off < RAW_CHUNK_ELEMENTS ? total - off : RAW_CHUNK_ELEMENTS;
+		chunk_request req = { handle, (u_int)off, (u_int)k };
+		raw_chunk_result res;
+		bool ok;
+
+		memset(&res, 0, sizeof(res));
+		if (!call(w, MATRIX_OP_V3, MATRIX_DOWNLOAD_RAW, (xdrproc_t)xdr_chunk_request, &req,
+			  (xdrproc_t)xdr_raw_chunk_result, &res)) {
+			return false;
+		}
+		ok = res.status == 0 && res.format == RAW_FORMAT_LE_DOUBLE &&
+		     res.data.data_len == sizeof(double) * k;
+		if (ok) {
+			/* XDR allocated the block with malloc, so it is aligned for doubles */
+			raw_byte_order(res.data.data_val, k);
+			scatter(dst, ld, cols, off, k, (const double *)(void *)res.data.data_val);
+		} else {
+			fprintf(stderr, "matrixOp_server: worker %s:%u: bad download: %s\n", w->host,
+				w->port, res.status != 0 ? res.message : "wrong size or format");
+		}
+		xdr_free((xdrproc_t)xdr_raw_chunk_result, (char *)&res);
+		if (!ok) {
+			return false;
+		}
+		off += k;
+	}
+	return true;
+}
+
+/* Thread body: one block of C on its worker. */
+static void *
+run_block(void *arg)
+{
+	struct block *blk = arg;
+	struct worker *w = blk->w;
+	u_int handles[3] = { 0, 0, 0 };	/* A block, B block, C block */
+	double *buf = malloc(MAX_RAW_CHUNK_BYTES);
+	handle_pair pair;
+
+	blk->ok = false;
+	if (buf == NULL) {
+		return NULL;
+	}
+	pthread_mutex_lock(&w->lock);
+	if (connect_worker(w) && create(w, blk->rows, blk->n, &handles[0]) &&
+	    upload(w, handles[0], blk->a, blk->n, blk->rows, blk->n, buf) &&
+	    create(w, blk->n, blk->cols, &handles[1]) &&
+	    upload(w, handles[1], blk->b, blk->ldb, blk->n, blk->cols, buf)) {
+		pair.a = handles[0];
+		pair.b = handles[1];
+		blk->ok = handle_call(w, MATRIX_OP_V2, MATRIX_MULTIPLY_H, (xdrproc_t)xdr_handle_pair, &pair,
+				      &handles[2]) &&
+			  download(w, handles[2], blk->c, blk->ldc, blk->rows, blk->cols);
+	}
+	for (int i = 0; i < 3; ++i) {
+		/* after a transport error the worker has dropped them with the connection */
+		if (handles[i] != 0 && w->clnt != NULL) {
+			handle_call(w, MATRIX_OP_V2, MATRIX_FREE, (xdrproc_t)xdr_u_int, &handles[i], NULL);
+		}
+	}
+	pthread_mutex_unlock(&w->lock);
+	free(buf);
+	return NULL;
+}
+
+/* The block here, in place of a worker that failed or is being skipped. */
+static void
+compute_block(const struct block *blk)
+{
+	for (size_t i = 0; i < blk->rows; ++i) {
+		memset(blk->c + i * blk->ldc, 0, sizeof(double) * blk->cols);
+	}
+	kernel_gemm(blk->rows, blk->n, blk->cols, 1.0, blk->a, blk->n, blk->b, blk->ldb, blk->c,
+		    blk->ldc);
+}
+
+/* pr x pc = count, as square as count allows, with the larger factor along the longer side of C. */
+static void
+choose_grid(size_t count, size_t m, size_t p, size_t *pr, size_t *pc)
+{
+	size_t small = 1;
+
+	for (size_t d = 1; d * d <= count; ++d) {
+		if (count % d == 0) {
+			small = d;
+		}
+	}
+	*pr = m >= p ? count / small : small;
+	*pc = count / *pr;
+}
+
+bool
+distribute_multiply(const double *a, const double *b, double *out, size_t m, size_t n,
+		    size_t p)
+{
+	struct block blocks[DISTRIBUTE_MAX_WORKERS];
+	size_t pr, pc;
+	size_t remote = 0;
+	unsigned long long local = 0;
+
+	if (worker_count == 0 || m * n * p < DISTRIBUTE_MIN_FLOPS) {
+		return false;
+	}
+	choose_grid(worker_count, m, p, &pr, &pc);
+	/* every block non-empty, and its elements addressable by a u_int offset */
+	if (m < pr || p < pc || (m / pr + 1) * n > UINT_MAX || n * (p / pc + 1) > UINT_MAX ||
+	    (m / pr + 1) * (p / pc + 1) > UINT_MAX) {
+		return false;
+	}
+
+	for (size_t i = 0; i < pr; ++i) {
+		for (size_t j = 0; j < pc; ++j) {
+			struct block *blk = &blocks[i * pc + j];
+			size_t r0 = m * i / pr;
+			size_t c0 = p * j / pc;
+
+			blk->w = &workers[i * pc + j];
+			blk->a = a + r0 * n;
+			blk->b = b + c0;
+			blk->c = out + r0 * p + c0;
+			blk->rows = m * (i + 1) / pr - r0;
+			blk->n = n;
+			blk->cols = p * (j + 1) / pc - c0;
+			blk->ldb = p;
+			blk->ldc = p;
+			blk->ok = false;
+			blk->started = false;
+			if (!worker_up(blk->w)) {
+				continue;
+			}
+			blk->started = pthread_create(&blk->thread, NULL, run_block, blk) == 0;
+			if (!blk->started) {
+				run_block(blk);
+			}
+		}
+	}
+	for (size_t k = 0; k < pr * pc; ++k) {
+		if (blocks[k].started) {
+			pthread_join(blocks[k].thread, NULL);
+		}
+		remote += blocks[k].ok;
+	}
+	if (remote == 0) {
+		/* every worker failed or is being skipped: the caller computes it all, through the cache */
+		__atomic_fetch_add(&fallbacks, pr * pc, __ATOMIC_RELAXED);
+		return false;
+	}
+	for (size_t k = 0; k < pr * pc; ++k) {
+		if (!blocks[k].ok) {
+			compute_block(&blocks[k]);
+			++local;
+		}
+	}
+	__atomic_fetch_add(&multiplies, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&fallbacks, local, __ATOMIC_RELAXED);
+	return true;
+}
+
+void
+distribute_get_stats(struct distribute_stats *stats)
+{
+	stats->workers = worker_count;
+	stats->multiplies = __atomic_load_n(&multiplies, __ATOMIC_RELAXED);
+	stats->fallbacks = __atomic_load_n(&fallbacks, __ATOMIC_RELAXED);
+}
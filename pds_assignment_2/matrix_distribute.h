@@ -0,0 +1,38 @@
+#ifndef MATRIX_DISTRIBUTE_H
+#define MATRIX_DISTRIBUTE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Coordinator mode: large multiplies are split into blocks and computed by
+ * other matrixOp_server processes (the workers), see matrix_distribute.c.
+ * The workers must be plain servers reachable on fixed ports, not
+ * coordinators themselves.
+ */
+
+/* Most workers one coordinator uses. */
+#define DISTRIBUTE_MAX_WORKERS 64
+
+struct distribute_stats {
+	unsigned int workers;
+	unsigned long long multiplies;	/* products computed, at least in part, by the workers */
+	unsigned long long fallbacks;	/* blocks computed locally because their worker failed or was skipped */
+};
+
+/* Use the workers in list, "host:port[,host:port...]"; false if it is malformed. Call before serving. */
+bool distribute_set_workers(const char *list);
+
+/*
+ * out (m x p) = a (m x n) x b (n x p), computed by the workers; the blocks
+ * of workers that fail are computed here. Returns false, leaving the
+ * product to the caller, when there are no workers, the product is too
+ * small to gain from them or no worker computed its block; out may be
+ * partly written then.
+ */
+bool distribute_multiply(const double *a, const double *b, double *out, size_t m, size_t n,
+			 size_t p);
+
+void distribute_get_stats(struct distribute_stats *stats);
+
+#endif /* MATRIX_DISTRIBUTE_H */
@@ -0,0 +1,414 @@
+/*
+ * Expression evaluation for MATRIX_EVAL.
+ *
+ * Nodes are evaluated in order. A node's value is a row-major buffer plus a
+ * transposed flag, so a transpose node costs nothing: multiply hands the
+ * flags to kernel_gemm_trans and inverse uses (X^T)^-1 = (X^-1)^T.
+ *
+ * An element-wise node whose only use is as an operand of another
+ * element-wise node is not computed on its own: the consumer runs the whole
+ * tree of such nodes as one kernel_elementwise program, so alpha * (A - B)
+ * .* C reads A, B and C once and writes no intermediate matrices. The
+ * program works in whichever orientation most of its operands are stored
+ * in; the others are transposed into temporaries first.
+ *
+ * The final node computes directly into the result matrix in the store;
+ * only a final value that is still transposed (or a bare handle) is copied
+ * there.
+ */
+#include "matrix_expr.h"
+#include "matrix_kernels.h"
+#include "matrix_store.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct value {
+	double *data;		/* rows x cols, row-major */
+	u_int rows;
+	u_int cols;
+	bool transposed;	/* the node's value is data^T */
+	bool owned;		/* data is this node's temporary */
+	stored_matrix *ref;	/* store reference behind data, if any */
+	u_int uses;		/* nodes taking this one as an operand */
+	u_int consumer;		/* the last of them */
+	bool deferred;		/* computed inside its consumer's program; no data */
+	u_int depth;		/* deferred: stack values its program needs */
+};
+
+/* A fused element-wise tree as a kernel_elementwise program. */
+struct ew_program {
+	struct ew_step steps[3 * MAX_EXPR_NODES];
+	const struct value *leaves[MAX_EXPR_NODES];
+	u_int nsteps;
+	u_int nleaves;
+};
+
+struct expr_eval {
+	const expr_node *nodes;
+	struct value *values;
+	u_int count;
+	u_int handle;		/* result matrix, once created */
+	const void *owner;	/* of the result matrix */
+	int status;
+	char *message;
+};
+
+static u_int
+value_rows(const struct value *v)
+{
+	return v->transposed ? v->cols : v->rows;
+}
+
+static u_int
+value_cols(const struct value *v)
+{
+	return v->transposed ? v->rows : v->cols;
+}
+
+static bool
+fail(struct expr_eval *ev, int status, const char *fmt, ...)
+{
+	va_list args;
+
+	ev->status = status;
+	va_start(args, fmt);
+	vsnprintf(ev->message, ERROR_MESSAGE_LEN, fmt, args);
+	va_end(args);
+	return false;
+}
+
+/* Zeroed rows x cols buffer for node i; the final, untransposed value goes straight into the store. */
+static bool
+alloc_value(struct expr_eval *ev, u_int i, u_int rows, u_int cols, bool transposed)
+{
+	struct value *v = &ev->values[i];
+	unsigned long long elements = (unsigned long long)rows * cols;
+
+	v->rows = rows;
+	v->cols = cols;
+	v->transposed = transposed;
+	if (i == ev->count - 1 && !transposed) {
+		ev->handle = store_create(rows, cols, ev->owner, &v->ref);
+		if (ev->handle == 0) {
+			return fail(ev, 2, "Server cannot allocate a %u x %u matrix", rows, cols);
+		}
+		v->data = v->ref->data;
+		return true;
+	}
+	if (elements > STORE_MAX_ELEMENTS ||
+	    (v->data = calloc((size_t)elements, sizeof(double))) == NULL) {
+		return fail(ev, 2, "Server cannot allocate a %u x %u matrix", rows, cols);
+	}
+	v->owned = true;
+	return true;
+}
+
+static bool
+is_binary(expr_opcode op)
+{
+	return op == EXPR_ADD || op == EXPR_MULTIPLY || op == EXPR_SUBTRACT ||
+	       op == EXPR_HADAMARD || op == EXPR_AXPY;
+}
+
+/* The kernel_elementwise step for an element-wise node. */
+static bool
+elementwise_op(expr_opcode op, enum ew_opcode *step)
+{
+	switch (op) {
+	case EXPR_ADD:
+		*step = EW_ADD;
+		return true;
+	case EXPR_SUBTRACT:
+		*step = EW_SUBTRACT;
+		return true;
+	case EXPR_HADAMARD:
+		*step = EW_HADAMARD;
+		return true;
+	case EXPR_SCALE:
+		*step = EW_SCALE;
+		return true;
+	case EXPR_AXPY:
+		*step = EW_AXPY;
+		return true;
+	default:
+		return false;
+	}
+}
+
+static const char *
+elementwise_name(enum ew_opcode op)
+{
+	switch (op) {
+	case EW_ADD:
+		return "addition";
+	case EW_SUBTRACT:
+		return "subtraction";
+	case EW_HADAMARD:
+		return "the Hadamard product";
+	default:
+		return "axpy";
+	}
+}
+
+static u_int
+depth_of(const struct value *v)
+{
+	return v->deferred ? v->depth : 1;
+}
+
+/* Append node j to the program: the root or a deferred node as its operands and its step, anything else as a load. */
+static void
+emit(const struct expr_eval *ev, struct ew_program *prog, u_int j, bool root)
+{
+	const expr_node *node = &ev->nodes[j];
+	const struct value *v = &ev->values[j];
+	enum ew_opcode op;
+	u_int k = 0;
+
+	if ((root || v->deferred) && elementwise_op(node->op, &op)) {
+		emit(ev, prog, node->a, false);
+		if (op != EW_SCALE) {
+			emit(ev, prog, node->b, false);
+		}
+		prog->steps[prog->nsteps++] = (struct ew_step){ op, 0, node->alpha };
+		return;
+	}
+	while (k < prog->nleaves && prog->leaves[k] != v) {
+		++k;
+	}
+	if (k == prog->nleaves) {
+		prog->leaves[prog->nleaves++] = v;
+	}
+	prog->steps[prog->nsteps++] = (struct ew_step){ EW_LOAD, k, 0.0 };
+}
+
+/* Compute node i, a logical rows x cols element-wise node, with the tree of deferred nodes under it. */
+static bool
+run_elementwise(struct expr_eval *ev, u_int i, u_int rows, u_int cols)
+{
+	struct value *v = &ev->values[i];
+	struct ew_program prog;
+	const double *inputs[MAX_EXPR_NODES];
+	double *temps[MAX_EXPR_NODES];
+	u_int flipped = 0;
+	bool transposed;
+	bool ok = true;
+
+	prog.nsteps = 0;
+	prog.nleaves = 0;
+	emit(ev, &prog, i, true);
+	for (u_int k = 0; k < prog.nleaves; ++k) {
+		flipped += prog.leaves[k]->transposed;
+		temps[k] = NULL;
+	}
+	transposed = 2 * flipped > prog.nleaves;
+	if (!alloc_value(ev, i, transposed ? cols : rows, transposed ? rows : cols, transposed)) {
+		return false;
+	}
+	for (u_int k = 0; k < prog.nleaves && ok; ++k) {
+		const struct value *leaf = prog.leaves[k];
+
+		inputs[k] = leaf->data;
+		if (leaf->transposed == transposed) {
+			continue;
+		}
+		if ((temps[k] = malloc(sizeof(double) * leaf->rows * leaf->cols)) == NULL) {
+			ok = fail(ev, 2, "Server out of memory");
+		} else {
+			kernel_transpose(leaf->data, temps[k], leaf->rows, leaf->cols);
+			inputs[k] = temps[k];
+		}
+	}
+	if (ok) {
+		kernel_elementwise(prog.steps, prog.nsteps, inputs, v->data, (size_t)rows * cols);
+	}
+	for (u_int k = 0; k < prog.nleaves; ++k) {
+		free(temps[k]);
+	}
+	return ok;
+}
+
+static bool
+eval_elementwise(struct expr_eval *ev, u_int i, const expr_node *node, enum ew_opcode op)
+{
+	struct value *v = &ev->values[i];
+	const struct value *a = &ev->values[node->a];
+	const struct value *b = op == EW_SCALE ? a : &ev->values[node->b];
+	u_int depth = depth_of(a);
+
+	if (value_rows(a) != value_rows(b) || value_cols(a) != value_cols(b)) {
+		return fail(ev, 1, "Node %u: matrix dimensions must match for %s", i,
+			    elementwise_name(op));
+	}
+	if (op != EW_SCALE && depth_of(b) + 1 > depth) {
+		depth = depth_of(b) + 1;
+	}
+	if (v->deferred && depth < EW_MAX_DEPTH) {
+		/* only the shape for now; the consumer computes the values */
+		v->rows = value_rows(a);
+		v->cols = value_cols(a);
+		v->depth = depth;
+		return true;
+	}
+	v->deferred = false;
+	return run_elementwise(ev, i, value_rows(a), value_cols(a));
+}
+
+static bool
+eval_node(struct expr_eval *ev, u_int i, const expr_node *node)
+{
+	struct value *v = &ev->values[i];
+	const struct value *a;
+	const struct value *b;
+	enum ew_opcode op;
+	int rc;
+
+	if (node->op == EXPR_HANDLE) {
+		if ((v->ref = store_acquire(node->a)) == NULL) {
+			return fail(ev, 1, "Node %u: unknown matrix handle %u", i, node->a);
+		}
+		v->data = v->ref->data;
+		v->rows = v->ref->rows;
+		v->cols = v->ref->cols;
+		return true;
+	}
+
+	if (node->a >= i || (is_binary(node->op) && node->b >= i)) {
+		return fail(ev, 1, "Node %u: operands must be earlier nodes", i);
+	}
+	if (elementwise_op(node->op, &op)) {
+		return eval_elementwise(ev, i, node, op);
+	}
+	a = &ev->values[node->a];
+	b = &ev->values[node->b];
+
+	switch (node->op) {
+	case EXPR_TRANSPOSE:
+		/* a view of the operand's buffer, which lives until the end */
+		*v = *a;
+		v->transposed = !a->transposed;
+		v->owned = false;
+		v->ref = NULL;
+		return true;
+	case EXPR_MULTIPLY:
+		if (value_cols(a) != value_rows(b)) {
+			return fail(ev, 1, "Node %u: matrix multiplication requires A.cols (%u) == B.rows (%u)",
+				    i, value_cols(a), value_rows(b));
+		}
+		if (!alloc_value(ev, i, value_rows(a), value_cols(b), false)) {
+			return false;
+		}
+		kernel_gemm_trans(a->transposed, b->transposed, value_rows(a), value_cols(a),
+				  value_cols(b), 1.0, a->data, a->cols, b->data, b->cols,
+				  v->data, v->cols);
+		return true;
+	case EXPR_INVERSE:
+		if (a->rows != a->cols) {
+			return fail(ev, 1, "Node %u: inverse is defined only for square matrices", i);
+		}
+		if (!alloc_value(ev, i, a->rows, a->cols, a->transposed)) {
+			return false;
+		}
+		rc = kernel_inverse(a->data, v->data, a->rows);
+		if (rc == KERNEL_SINGULAR) {
+			return fail(ev, 1, "Node %u: matrix is singular or near-singular; inverse does not exist", i);
+		} else if (rc != KERNEL_OK) {
+			return fail(ev, 2, "Server out of memory while computing inverse");
+		}
+		return true;
+	default:
+		return fail(ev, 1, "Node %u: unknown operation %d", i, (int)node->op);
+	}
+}
+
+u_int
+expr_evaluate(const expr_node *nodes, u_int count, const void *owner, u_int *rows,
+	      u_int *cols, int *status, char *message)
+{
+	struct expr_eval ev;
+	const struct value *last;
+	bool ok = true;
+
+	ev.nodes = nodes;
+	ev.count = count;
+	ev.handle = 0;
+	ev.owner = owner;
+	ev.status = 0;
+	ev.message = message;
+	message[0] = '\0';
+	if (count == 0) {
+		*status = 1;
+		snprintf(message, ERROR_MESSAGE_LEN, "Expression has no nodes");
+		return 0;
+	}
+	if ((ev.values = calloc(count, sizeof(struct value))) == NULL) {
+		*status = 2;
+		snprintf(message, ERROR_MESSAGE_LEN, "Server out of memory");
+		return 0;
+	}
+
+	for (u_int i = 0; i < count; ++i) {
+		if (nodes[i].op == EXPR_HANDLE) {
+			continue;
+		}
+		if (nodes[i].a < i) {
+			ev.values[nodes[i].a].uses++;
+			ev.values[nodes[i].a].consumer = i;
+		}
+		if (is_binary(nodes[i].op) && nodes[i].b < i) {
+			ev.values[nodes[i].b].uses++;
+			ev.values[nodes[i].b].consumer = i;
+		}
+	}
+	for (u_int i = 0; i + 1 < count; ++i) {
+		enum ew_opcode op;
+
+		ev.values[i].deferred = ev.values[i].uses == 1 && elementwise_op(nodes[i].op, &op) &&
+					elementwise_op(nodes[ev.values[i].consumer].op, &op);
+	}
+
+	for (u_int i = 0; i < count && ok; ++i) {
+		ok = eval_node(&ev, i, &nodes[i]);
+	}
+
+	last = &ev.values[count - 1];
+	if (ok && ev.handle == 0) {
+		/* a bare handle or a transposed value: copy it out */
+		stored_matrix *out;
+
+		ev.handle = store_create(value_rows(last), value_cols(last), ev.owner, &out);
+		if (ev.handle == 0) {
+			ok = fail(&ev, 2, "Server cannot allocate a %u x %u matrix",
+				  value_rows(last), value_cols(last));
+		} else {
+			if (last->transposed) {
+				kernel_transpose(last->data, out->data, last->rows, last->cols);
+			} else {
+				memcpy(out->data, last->data, sizeof(double) * last->rows * last->cols);
+			}
+			store_release(out);
+		}
+	}
+	if (ok) {
+		*rows = value_rows(last);
+		*cols = value_cols(last);
+	} else if (ev.handle != 0) {
+		store_free(ev.handle, ev.owner);
+		ev.handle = 0;
+	}
+
+	for (u_int i = 0; i < count; ++i) {
+		if (ev.values[i].owned) {
+			free(ev.values[i].data);
+		}
+		if (ev.values[i].ref != NULL) {
+			store_release(ev.values[i].ref);
+		}
+	}
+	free(ev.values);
+	*status = ev.status;
+	return ev.handle;
+}
@@ -0,0 +1,16 @@
+#ifndef MATRIX_EXPR_H
+#define MATRIX_EXPR_H
+
+#include "matrixOp.h"
+
+/*
+ * Evaluate a MATRIX_EVAL expression over stored matrices. Returns the
+ * handle of a new stored matrix, owned by owner (see matrix_store.h),
+ * holding the last node's value, with its dimensions in rows and cols. On failure returns 0 and sets status (1 for
+ * a bad expression, 2 when the server is out of memory) and message
+ * (ERROR_MESSAGE_LEN bytes).
+ */
+u_int expr_evaluate(const expr_node *nodes, u_int count, const void *owner, u_int *rows,
+		    u_int *cols, int *status, char *message);
+
+#endif /* MATRIX_EXPR_H */
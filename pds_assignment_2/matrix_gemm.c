@@ -0,0 +1,285 @@
+/*
+ * Cache-blocked matrix multiply.
+ *
+ * The classic three-level blocking: B is packed one KC x NC block at a time
+ * into NR-wide column panels, A one MC x KC block at a time into MR-high row
+ * panels, and an MR x NR micro-kernel keeps its block of C in registers
+ * while streaming both panels contiguously. The micro-kernel uses AVX2/FMA
+ * when the CPU has it (checked at run time) and portable C otherwise.
+ *
+ * Operands are addressed as element (i, k) = a[i * rs + k * cs], so a
+ * transposed operand is only a different pair of strides to the packers
+ * and never has to be materialized.
+ */
+#include "matrix_kernels.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_KERNEL 1
+#include <immintrin.h>
+#endif
+
+#define MR 6
+#define NR 8
+#define KC 256
+#define MC 72	/* multiple of MR; an A block (MC x KC) stays in L2 */
+#define NC 4096	/* multiple of NR */
+
+/* below this many multiply-adds packing costs more than it saves */
+#define SMALL_GEMM_FLOPS (8 * 8 * 8)
+
+typedef void (*micro_kernel_fn)(size_t kc, const double *a, const double *b,
+				double *c, size_t ldc);
+
+/* C (MR x NR, row stride ldc) += packed A panel * packed B panel */
+static void
+micro_kernel_scalar(size_t kc, const double *a, const double *b, double *c, size_t ldc)
+{
+	double acc[MR][NR] = { { 0.0 } };
+
+	for (size_t k = 0; k < kc; ++k) {
+		for (size_t i = 0; i < MR; ++i) {
+			double aik = a[k * MR + i];
+			for (size_t j = 0; j < NR; ++j) {
+				acc[i][j] += aik * b[k * NR + j];
+			}
+		}
+	}
+	for (size_t i = 0; i < MR; ++i) {
+		for (size_t j = 0; j < NR; ++j) {
+			c[i * ldc + j] += acc[i][j];
+		}
+	}
+}
+
+#ifdef HAVE_AVX2_KERNEL
+__attribute__((target("avx2,fma")))
+static void
+micro_kernel_avx2(size_t kc, const double *a, const double *b, double *c, size_t ldc)
+{
+	__m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+	__m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+	__m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+	__m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+	__m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+	__m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+
+	for (size_t k = 0; k < kc; ++k) {
+		__m256d b0 = _mm256_load_pd(b);
+		__m256d b1 = _mm256_load_pd(b + 4);
+		__m256d ai;
+
+		ai = _mm256_broadcast_sd(a + 0);
+		c00 = _mm256_fmadd_pd(ai, b0, c00);
+		c01 = _mm256_fmadd_pd(ai, b1, c01);
+		ai = _mm256_broadcast_sd(a + 1);
+		c10 = _mm256_fmadd_pd(ai, b0, c10);
+		c11 = _mm256_fmadd_pd(ai, b1, c11);
+		ai = _mm256_broadcast_sd(a + 2);
+		c20 = _mm256_fmadd_pd(ai, b0, c20);
+		c21 = _mm256_fmadd_pd(ai, b1, c21);
+		ai = _mm256_broadcast_sd(a + 3);
+		c30 = _mm256_fmadd_pd(ai, b0, c30);
+		c31 = _mm256_fmadd_pd(ai, b1, c31);
+		ai = _mm256_broadcast_sd(a + 4);
+		c40 = _mm256_fmadd_pd(ai, b0, c40);
+		c41 = _mm256_fmadd_pd(ai, b1, c41);
+		ai = _mm256_broadcast_sd(a + 5);
+		c50 = _mm256_fmadd_pd(ai, b0, c50);
+		c51 = _mm256_fmadd_pd(ai, b1, c51);
+
+		a += MR;
+		b += NR;
+	}
+
+#define ACCUMULATE_ROW(i, lo, hi) \
+	_mm256_storeu_pd(c + (i) * ldc, _mm256_add_pd(_mm256_loadu_pd(c + (i) * ldc), lo)); \
+	_mm256_storeu_pd(c + (i) * ldc + 4, _mm256_add_pd(_mm256_loadu_pd(c + (i) * ldc + 4), hi))
+	ACCUMULATE_ROW(0, c00, c01);
+	ACCUMULATE_ROW(1, c10, c11);
+	ACCUMULATE_ROW(2, c20, c21);
+	ACCUMULATE_ROW(3, c30, c31);
+	ACCUMULATE_ROW(4, c40, c41);
+	ACCUMULATE_ROW(5, c50, c51);
+#undef ACCUMULATE_ROW
+}
+#endif
+
+static micro_kernel_fn
+select_micro_kernel(void)
+{
+#ifdef HAVE_AVX2_KERNEL
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		return micro_kernel_avx2;
+	}
+#endif
+	return micro_kernel_scalar;
+}
+
+const char *
+kernel_multiply_isa(void)
+{
+	return select_micro_kernel() == micro_kernel_scalar ? "scalar" : "avx2+fma";
+}
+
+/* alpha * rows [0, mc) x cols [0, kc) of A into MR-high panels, k-major, zero padded. */
+static void
+pack_a(const double *a, size_t rs, size_t cs, size_t mc, size_t kc, double alpha, double *dst)
+{
+	for (size_t i = 0; i < mc; i += MR) {
+		size_t rows = mc - i < MR ? mc - i : MR;
+
+		for (size_t k = 0; k < kc; ++k) {
+			for (size_t r = 0; r < rows; ++r) {
+				dst[r] = alpha * a[(i + r) * rs + k * cs];
+			}
+			for (size_t r = rows; r < MR; ++r) {
+				dst[r] = 0.0;
+			}
+			dst += MR;
+		}
+	}
+}
+
+/* Rows [0, kc) x cols [0, nc) of B into NR-wide panels, k-major, zero padded. */
+static void
+pack_b(const double *b, size_t rs, size_t cs, size_t kc, size_t nc, double *dst)
+{
+	for (size_t j = 0; j < nc; j += NR) {
+		size_t cols = nc - j < NR ? nc - j : NR;
+
+		for (size_t k = 0; k < kc; ++k) {
+			const double *src = b + k * rs + j * cs;
+
+			if (cs == 1) {
+				memcpy(dst, src, sizeof(double) * cols);
+			} else {
+				for (size_t c = 0; c < cols; ++c) {
+					dst[c] = src[c * cs];
+				}
+			}
+			for (size_t c = cols; c < NR; ++c) {
+				dst[c] = 0.0;
+			}
+			dst += NR;
+		}
+	}
+}
+
+/* i-k-j order: streams rows of B and C, fine for operands that fit in L1. */
+static void
+gemm_small(size_t m, size_t n, size_t p, double alpha, const double *a, size_t rsa, size_t csa,
+	   const double *b, size_t rsb, size_t csb, double *c, size_t ldc)
+{
+	for (size_t i = 0; i < m; ++i) {
+		double *row = c + i * ldc;
+		for (size_t k = 0; k < n; ++k) {
+			double aik = alpha * a[i * rsa + k * csa];
+			const double *brow = b + k * rsb;
+			for (size_t j = 0; j < p; ++j) {
+				row[j] += aik * brow[j * csb];
+			}
+		}
+	}
+}
+
+static size_t
+round_up(size_t x, size_t to)
+{
+	return (x + to - 1) / to * to;
+}
+
+static void
+gemm_strided(size_t m, size_t n, size_t p, double alpha, const double *a, size_t rsa, size_t csa,
+	     const double *b, size_t rsb, size_t csb, double *c, size_t ldc)
+{
+	micro_kernel_fn micro = select_micro_kernel();
+	size_t kc_max = n < KC ? n : KC;
+	size_t mc_max = round_up(m < MC ? m : MC, MR);
+	size_t nc_max = round_up(p < NC ? p : NC, NR);
+	double *pa;
+	double *pb;
+
+	if (m == 0 || n == 0 || p == 0) {
+		return;
+	}
+	if (m * n * p <= SMALL_GEMM_FLOPS) {
+		gemm_small(m, n, p, alpha, a, rsa, csa, b, rsb, csb, c, ldc);
+		return;
+	}
+
+	pa = aligned_alloc(64, round_up(sizeof(double) * mc_max * kc_max, 64));
+	pb = aligned_alloc(64, round_up(sizeof(double) * kc_max * nc_max, 64));
+	if (pa == NULL || pb == NULL) {
+		free(pa);
+		free(pb);
+		gemm_small(m, n, p, alpha, a, rsa, csa, b, rsb, csb, c, ldc);
+		return;
+	}
+
+	for (size_t jc = 0; jc < p; jc += NC) {
+		size_t nc = p - jc < NC ? p - jc : NC;
+
+		for (size_t pc = 0; pc < n; pc += KC) {
+			size_t kc = n - pc < KC ? n - pc : KC;
+
+			pack_b(b + pc * rsb + jc * csb, rsb, csb, kc, nc, pb);
+			for (size_t ic = 0; ic < m; ic += MC) {
+				size_t mc = m - ic < MC ? m - ic : MC;
+
+				pack_a(a + ic * rsa + pc * csa, rsa, csa, mc, kc, alpha, pa);
+				for (size_t jr = 0; jr < nc; jr += NR) {
+					size_t nr = nc - jr < NR ? nc - jr : NR;
+
+					for (size_t ir = 0; ir < mc; ir += MR) {
+						size_t mr = mc - ir < MR ? mc - ir : MR;
+						const double *ap = pa + ir * kc;
+						const double *bp = pb + jr * kc;
+						double *ct = c + (ic + ir) * ldc + jc + jr;
+
+						if (mr == MR && nr == NR) {
+							micro(kc, ap, bp, ct, ldc);
+						} else {
+							/* edge tile: compute into scratch, add the valid part */
+							double tile[MR * NR] = { 0.0 };
+
+							micro(kc, ap, bp, tile, NR);
+							for (size_t i = 0; i < mr; ++i) {
+								for (size_t j = 0; j < nr; ++j) {
+									ct[i * ldc + j] += tile[i * NR + j];
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	free(pa);
+	free(pb);
+}
+
+void
+kernel_gemm(size_t m, size_t n, size_t p, double alpha, const double *a, size_t lda,
+	    const double *b, size_t ldb, double *c, size_t ldc)
+{
+	gemm_strided(m, n, p, alpha, a, lda, 1, b, ldb, 1, c, ldc);
+}
+
+void
+kernel_gemm_trans(int trans_a, int trans_b, size_t m, size_t n, size_t p, double alpha,
+		  const double *a, size_t lda, const double *b, size_t ldb, double *c, size_t ldc)
+{
+	gemm_strided(m, n, p, alpha, a, trans_a ? 1 : lda, trans_a ? lda : 1,
+		     b, trans_b ? 1 : ldb, trans_b ? ldb : 1, c, ldc);
+}
+
+void
+kernel_multiply(const double *a, const double *b, double *out,
+		size_t m, size_t n, size_t p)
+{
+	memset(out, 0, sizeof(double) * m * p);
+	kernel_gemm(m, n, p, 1.0, a, n, b, p, out, p);
+}
@@ -0,0 +1,198 @@
+/*
+ * Element-wise kernels.
+ *
+ * Every element-wise operation runs as a short postfix program over its
+ * inputs (see struct ew_step). The elements are processed EW_CHUNK at a
+ * time: each step combines the chunks on top of a small stack, and
+ * intermediate chunks stay in an L1-sized scratch area. So an expression
+ * such as alpha * (A - B) .* C reads each input and writes the output once,
+ * however many steps it has. The step loops use AVX when the CPU has it
+ * (checked at run time), and large inputs are split by chunks across the
+ * kernel thread pool.
+ */
+#include "matrix_kernels.h"
+#include "matrix_parallel.h"
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX_ELEMENTWISE 1
+#include <immintrin.h>
+#endif
+
+#define EW_CHUNK 256		/* elements per step; EW_MAX_DEPTH chunks fit in L1 */
+#define EW_GRAIN 64		/* chunks per parallel range, at least */
+
+/* z[i] = x[i] op y[i] (alpha * x[i] for EW_SCALE) for n elements; z may be x or y */
+typedef void (*ew_apply_fn)(enum ew_opcode op, double alpha, const double *x, const double *y,
+			    double *z, size_t n);
+
+static void
+apply_scalar(enum ew_opcode op, double alpha, const double *x, const double *y, double *z,
+	     size_t n)
+{
+	switch (op) {
+	case EW_ADD:
+		for (size_t i = 0; i < n; ++i) {
+			z[i] = x[i] + y[i];
+		}
+		break;
+	case EW_SUBTRACT:
+		for (size_t i = 0; i < n; ++i) {
+			z[i] = x[i] - y[i];
+		}
+		break;
+	case EW_HADAMARD:
+		for (size_t i = 0; i < n; ++i) {
+			z[i] = x[i] * y[i];
+		}
+		break;
+	case EW_SCALE:
+		for (size_t i = 0; i < n; ++i) {
+			z[i] = alpha * x[i];
+		}
+		break;
+	case EW_AXPY:
+		for (size_t i = 0; i < n; ++i) {
+			z[i] = alpha * x[i] + y[i];
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+#ifdef HAVE_AVX_ELEMENTWISE
+__attribute__((target("avx")))
+static void
+apply_avx(enum ew_opcode op, double alpha, const double *x, const double *y, double *z,
+	  size_t n)
+{
+	__m256d va = _mm256_set1_pd(alpha);
+	size_t n4 = n & ~(size_t)3;
+
+	switch (op) {
+	case EW_ADD:
+		for (size_t i = 0; i < n4; i += 4) {
+			_mm256_storeu_pd(z + i, _mm256_add_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+		}
+		break;
+	case EW_SUBTRACT:
+		for (size_t i = 0; i < n4; i += 4) {
+			_mm256_storeu_pd(z + i, _mm256_sub_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+		}
+		break;
+	case EW_HADAMARD:
+		for (size_t i = 0; i < n4; i += 4) {
+			_mm256_storeu_pd(z + i, _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+		}
+		break;
+	case EW_SCALE:
+		for (size_t i = 0; i < n4; i += 4) {
+			_mm256_storeu_pd(z + i, _mm256_mul_pd(va, _mm256_loadu_pd(x + i)));
+		}
+		break;
+	case EW_AXPY:
+		/* multiply, then add: the same rounding as the C loop */
+		for (size_t i = 0; i < n4; i += 4) {
+			__m256d ax = _mm256_mul_pd(va, _mm256_loadu_pd(x + i));
+
+			_mm256_storeu_pd(z + i, _mm256_add_pd(ax, _mm256_loadu_pd(y + i)));
+		}
+		break;
+	default:
+		return;
+	}
+	/* GCC emits no vzeroupper before this tail call; the SSE code in apply_scalar needs one */
+	_mm256_zeroupper();
+	apply_scalar(op, alpha, x + n4, y != NULL ? y + n4 : NULL, z + n4, n - n4);
+}
+#endif
+
+struct ew_job {
+	const struct ew_step *steps;
+	size_t nsteps;
+	const double *const *inputs;
+	double *out;
+	size_t count;
+	ew_apply_fn apply;
+};
+
+/* Chunks [begin, end): run the whole program on each. */
+static void
+run_chunks(void *ctx, size_t begin, size_t end)
+{
+	const struct ew_job *job = ctx;
+	double scratch[EW_MAX_DEPTH][EW_CHUNK];
+	const double *stack[EW_MAX_DEPTH];
+
+	for (size_t c = begin; c < end; ++c) {
+		size_t off = c * EW_CHUNK;
+		size_t n = job->count - off < EW_CHUNK ? job->count - off : EW_CHUNK;
+		size_t top = 0;
+
+		for (size_t s = 0; s < job->nsteps; ++s) {
+			const struct ew_step *step = &job->steps[s];
+			bool binary = step->op != EW_SCALE;
+			size_t base;
+			double *dst;
+
+			if (step->op == EW_LOAD) {
+				stack[top++] = job->inputs[step->input] + off;
+				continue;
+			}
+			base = binary ? top - 2 : top - 1;
+			/* the last step writes the output directly */
+			dst = s == job->nsteps - 1 ? job->out + off : scratch[base];
+			job->apply(step->op, step->alpha, stack[base], binary ? stack[base + 1] : NULL,
+				   dst, n);
+			stack[base] = dst;
+			top = base + 1;
+		}
+		if (job->steps[job->nsteps - 1].op == EW_LOAD) {
+			memmove(job->out + off, stack[0], sizeof(double) * n);
+		}
+	}
+}
+
+void
+kernel_elementwise(const struct ew_step *steps, size_t nsteps, const double *const *inputs,
+		   double *out, size_t count)
+{
+	struct ew_job job = { steps, nsteps, inputs, out, count, apply_scalar };
+
+	if (nsteps == 0 || count == 0) {
+		return;
+	}
+#ifdef HAVE_AVX_ELEMENTWISE
+	if (__builtin_cpu_supports("avx")) {
+		job.apply = apply_avx;
+	}
+#endif
+	parallel_for((count + EW_CHUNK - 1) / EW_CHUNK, EW_GRAIN, run_chunks, &job);
+}
+
+void
+kernel_elementwise_op(enum ew_opcode op, double alpha, const double *a, const double *b,
+		      double *out, size_t count)
+{
+	const struct ew_step binary[] = {
+		{ EW_LOAD, 0, 0.0 }, { EW_LOAD, 1, 0.0 }, { op, 0, alpha },
+	};
+	const struct ew_step unary[] = {
+		{ EW_LOAD, 0, 0.0 }, { op, 0, alpha },
+	};
+	const double *inputs[] = { a, b };
+
+	if (op == EW_SCALE) {
+		kernel_elementwise(unary, 2, inputs, out, count);
+	} else {
+		kernel_elementwise(binary, 3, inputs, out, count);
+	}
+}
+
+void
+kernel_add(const double *a, const double *b, double *out, size_t count)
+{
+	kernel_elementwise_op(EW_ADD, 0.0, a, b, out, count);
+}
@@ -0,0 +1,91 @@
+#ifndef MATRIX_KERNELS_H
+#define MATRIX_KERNELS_H
+
+#include <stddef.h>
+
+/*
+ * Dense row-major matrix kernels shared by every RPC entry point.
+ * Callers validate dimensions; kernels only compute.
+ */
+
+#define KERNEL_OK 0
+#define KERNEL_SINGULAR 1
+#define KERNEL_NO_MEMORY 2
+
+#define EPSILON 1e-9
+
+/* out[i] = a[i] + b[i] for count elements */
+void kernel_add(const double *a, const double *b, double *out, size_t count);
+
+/*
+ * A fused element-wise expression in postfix form: EW_LOAD pushes one of
+ * the inputs, EW_SCALE replaces the top value x with alpha * x, and the
+ * binary steps replace the top two values x, y (y on top) with one.
+ */
+enum ew_opcode {
+	EW_LOAD,	/* push inputs[input] */
+	EW_ADD,		/* x + y */
+	EW_SUBTRACT,	/* x - y */
+	EW_HADAMARD,	/* x * y */
+	EW_SCALE,	/* alpha * x */
+	EW_AXPY,	/* alpha * x + y */
+};
+
+struct ew_step {
+	enum ew_opcode op;
+	unsigned int input;	/* EW_LOAD */
+	double alpha;		/* EW_SCALE, EW_AXPY */
+};
+
+/* values a program may hold at once */
+#define EW_MAX_DEPTH 8
+
+/*
+ * out[i] = the program's value at element i, for count elements, in one
+ * pass over the inputs; see matrix_kernels.c. The program must leave one
+ * value and never hold more than EW_MAX_DEPTH. out may be one of the
+ * inputs but must not partly overlap one.
+ */
+void kernel_elementwise(const struct ew_step *steps, size_t nsteps, const double *const *inputs,
+			double *out, size_t count);
+
+/* out = a op b, or alpha * a for EW_SCALE (b unused): a single step */
+void kernel_elementwise_op(enum ew_opcode op, double alpha, const double *a, const double *b,
+			   double *out, size_t count);
+
+/* out (m x p) = a (m x n) * b (n x p); cache-blocked, see matrix_gemm.c */
+void kernel_multiply(const double *a, const double *b, double *out,
+		     size_t m, size_t n, size_t p);
+
+/*
+ * c (m x p) += alpha * a (m x n) * b (n x p), each operand with its own row
+ * stride; the building block for kernel_multiply and kernel_inverse.
+ */
+void kernel_gemm(size_t m, size_t n, size_t p, double alpha, const double *a, size_t lda,
+		 const double *b, size_t ldb, double *c, size_t ldc);
+
+/*
+ * kernel_gemm with op(a) = a^T if trans_a and op(b) = b^T if trans_b:
+ * c (m x p) += alpha * op(a) (m x n) * op(b) (n x p). lda and ldb are the
+ * row strides of a and b as stored.
+ */
+void kernel_gemm_trans(int trans_a, int trans_b, size_t m, size_t n, size_t p, double alpha,
+		       const double *a, size_t lda, const double *b, size_t ldb,
+		       double *c, size_t ldc);
+
+/* instruction set the multiply micro-kernel runs with on this CPU */
+const char *kernel_multiply_isa(void);
+
+/* out (cols x rows) = in (rows x cols)^T; tiled, see matrix_transpose.c */
+void kernel_transpose(const double *in, double *out, size_t rows, size_t cols);
+
+/* a (n x n) = a^T in place */
+void kernel_transpose_square(double *a, size_t n);
+
+/*
+ * out (n x n) = in^-1 by blocked LU, see matrix_lu.c; returns KERNEL_SINGULAR
+ * or KERNEL_NO_MEMORY on failure
+ */
+int kernel_inverse(const double *in, double *out, size_t n);
+
+#endif /* MATRIX_KERNELS_H */
@@ -0,0 +1,693 @@
+#define _DEFAULT_SOURCE
+#include "matrix_loadgen.h"
+#include "matrixOp.h"
+#include <math.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_SIZE 8192
+#define ROWS_PER_SIZE (LOADGEN_OP_COUNT + 2)	/* the operations, then download and free */
+#define ROW_DOWNLOAD LOADGEN_OP_COUNT
+#define ROW_FREE (LOADGEN_OP_COUNT + 1)
+#define ALPHA 0.5
+
+enum { OP_ADD, OP_SUBTRACT, OP_HADAMARD, OP_SCALE, OP_AXPY, OP_MULTIPLY, OP_TRANSPOSE, OP_INVERSE };
+
+static const struct op_info {
+	const char *name;	/* as given to --mix */
+	int operands;
+	bool scaled;
+	rpcproc_t inline_proc;
+	const char *inline_name;
+	rpcproc_t handle_proc;
+	const char *handle_name;
+} ops[LOADGEN_OP_COUNT] = {
+	[OP_ADD] = { "add", 2, false, MATRIX_ADD, "MATRIX_ADD", MATRIX_ADD_H, "MATRIX_ADD_H" },
+	[OP_SUBTRACT] = { "subtract", 2, false, MATRIX_SUBTRACT, "MATRIX_SUBTRACT", MATRIX_SUBTRACT_H, "MATRIX_SUBTRACT_H" },
+	[OP_HADAMARD] = { "hadamard", 2, false, MATRIX_HADAMARD, "MATRIX_HADAMARD", MATRIX_HADAMARD_H, "MATRIX_HADAMARD_H" },
+	[OP_SCALE] = { "scale", 1, true, MATRIX_SCALE, "MATRIX_SCALE", MATRIX_SCALE_H, "MATRIX_SCALE_H" },
+	[OP_AXPY] = { "axpy", 2, true, MATRIX_AXPY, "MATRIX_AXPY", MATRIX_AXPY_H, "MATRIX_AXPY_H" },
+	[OP_MULTIPLY] = { "multiply", 2, false, MATRIX_MULTIPLY, "MATRIX_MULTIPLY", MATRIX_MULTIPLY_H, "MATRIX_MULTIPLY_H" },
+	[OP_TRANSPOSE] = { "transpose", 1, false, MATRIX_TRANSPOSE, "MATRIX_TRANSPOSE", MATRIX_TRANSPOSE_H, "MATRIX_TRANSPOSE_H" },
+	[OP_INVERSE] = { "inverse", 1, false, MATRIX_INVERSE, "MATRIX_INVERSE", MATRIX_INVERSE_H, "MATRIX_INVERSE_H" },
+};
+
+/* Latencies of the successful calls of one procedure at one size. */
+struct samples {
+	double *secs;
+	size_t count;
+	size_t cap;
+	unsigned long errors;
+	unsigned long long bytes;	/* XDR arguments and results, RPC headers excluded */
+	unsigned int request_bytes;	/* the same for every call of the row, 0 until known */
+};
+
+struct worker {
+	const struct loadgen_config *cfg;
+	pthread_barrier_t *start;
+	pthread_t thread;
+	unsigned int seed;
+	CLIENT *v1;
+	CLIENT *v2;
+	matrix a[LOADGEN_MAX_SIZES];	/* inline operands */
+	matrix b[LOADGEN_MAX_SIZES];
+	u_int ha[LOADGEN_MAX_SIZES];	/* stored operands */
+	u_int hb[LOADGEN_MAX_SIZES];
+	struct samples rows[LOADGEN_MAX_SIZES * ROWS_PER_SIZE];
+	bool failed;
+};
+
+static const struct timeval call_timeout = { 600, 0 };
+
+static double
+now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool
+fits_inline(unsigned int n)
+{
+	return n * n <= MAX_MATRIX_ELEMENTS;
+}
+
+void
+loadgen_defaults(struct loadgen_config *cfg)
+{
+	memset(cfg, 0, sizeof(*cfg));
+	cfg->connections = 4;
+	cfg->seconds = 10.0;
+	cfg->sizes[0] = 8;
+	cfg->sizes[1] = 20;
+	cfg->sizes[2] = 64;
+	cfg->size_count = 3;
+	cfg->weights[OP_ADD] = 1;
+	cfg->weights[OP_MULTIPLY] = 1;
+	cfg->weights[OP_TRANSPOSE] = 1;
+	cfg->weights[OP_INVERSE] = 1;
+	cfg->seed = 1;
+	cfg->out = stdout;
+}
+
+bool
+loadgen_parse_sizes(struct loadgen_config *cfg, const char *list)
+{
+	const char *p = list;
+
+	cfg->size_count = 0;
+	for (;;) {
+		char *end;
+		unsigned long n = strtoul(p, &end, 10);
+
+		if (end == p || n == 0 || n > MAX_SIZE || cfg->size_count == LOADGEN_MAX_SIZES) {
+			return false;
+		}
+		cfg->sizes[cfg->size_count++] = (unsigned int)n;
+		if (*end == '\0') {
+			return true;
+		}
+		if (*end != ',') {
+			return false;
+		}
+		p = end + 1;
+	}
+}
+
+bool
+loadgen_parse_mix(struct loadgen_config *cfg, const char *list)
+{
+	const char *p = list;
+	unsigned int total = 0;
+
+	memset(cfg->weights, 0, sizeof(cfg->weights));
+	while (*p != '\0') {
+		size_t len = strcspn(p, ":,");
+		unsigned long weight = 1;
+		int k;
+
+		for (k = 0; k < LOADGEN_OP_COUNT; ++k) {
+			if (strlen(ops[k].name) == len && strncmp(ops[k].name, p, len) == 0) {
+				break;
+			}
+		}
+		if (k == LOADGEN_OP_COUNT) {
+			return false;
+		}
+		p += len;
+		if (*p == ':') {
+			char *end;
+
+			weight = strtoul(p + 1, &end, 10);
+			if (end == p + 1 || weight > 1000) {
+				return false;
+			}
+			p = end;
+		}
+		cfg->weights[k] += (unsigned int)weight;
+		total += (unsigned int)weight;
+		if (*p == ',') {
+			++p;
+		} else if (*p != '\0') {
+			return false;
+		}
+	}
+	return total > 0;
+}
+
+/* ---------------- one connection ---------------- */
+
+/* TCP client for the given version, on a fixed port if one was given. */
+static CLIENT *
+connect_version(const struct loadgen_config *cfg, rpcvers_t vers)
+{
+	struct addrinfo hints;
+	struct addrinfo *res;
+	struct sockaddr_in addr;
+	int sock = RPC_ANYSOCK;
+	CLIENT *clnt;
+
+	if (cfg->port == 0) {
+		clnt = clnt_create(cfg->host, MATRIX_OP_PROG, vers, "tcp");
+	} else {
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		if (getaddrinfo(cfg->host, NULL, &hints, &res) != 0) {
+			fprintf(stderr, "%s: unknown host\n", cfg->host);
+			return NULL;
+		}
+		memcpy(&addr, res->ai_addr, sizeof(addr));
+		freeaddrinfo(res);
+		addr.sin_port = htons(cfg->port);
+		clnt = clnttcp_create(&addr, MATRIX_OP_PROG, vers, &sock, 0, 0);
+	}
+	if (clnt == NULL) {
+		clnt_pcreateerror(cfg->host);
+	}
+	return clnt;
+}
+
+static void
+record(struct samples *s, double secs, bool ok, size_t bytes)
+{
+	if (!ok) {
+		s->errors++;
+		return;
+	}
+	if (s->count == s->cap) {
+		size_t cap = s->cap != 0 ? s->cap * 2 : 4096;
+		double *grown = realloc(s->secs, sizeof(double) * cap);
+
+		if (grown == NULL) {
+			s->errors++;	/* cannot keep the sample; count the call at least */
+			return;
+		}
+		s->secs = grown;
+		s->cap = cap;
+	}
+	s->secs[s->count++] = secs;
+	s->bytes += bytes;
+}
+
+/* One call; a transport failure stops the worker. */
+static bool
+call(struct worker *w, CLIENT *clnt, const char *name, rpcproc_t proc, xdrproc_t xargs,
+     void *args, xdrproc_t xres, void *res)
+{
+	enum clnt_stat stat = clnt_call(clnt, proc, xargs, args, xres, res, call_timeout);
+
+	if (stat != RPC_SUCCESS) {
+		fprintf(stderr, "%s", clnt_sperror(clnt, name));
+		w->failed = true;
+		return false;
+	}
+	return true;
+}
+
+/* XDR size of a reply carrying len doubles, without walking every element. */
+static unsigned int
+reply_bytes(xdrproc_t xres, void *res, u_int *len)
+{
+	u_int saved = *len;
+	unsigned int bytes;
+
+	*len = 0;
+	bytes = (unsigned int)xdr_sizeof(xres, res) + 8 * saved;
+	*len = saved;
+	return bytes;
+}
+
+static void
+random_matrix(struct worker *w, double *data, unsigned int n)
+{
+	for (unsigned int i = 0; i < n * n; ++i) {
+		data[i] = (double)rand_r(&w->seed) / RAND_MAX - 0.5;
+	}
+	for (unsigned int i = 0; i < n; ++i) {
+		data[i * n + i] += n;	/* diagonally dominant, so inverse never fails */
+	}
+}
+
+static u_int
+upload(struct worker *w, const double *data, unsigned int n)
+{
+	matrix_dims dims = { n, n };
+	handle_result res;
+	u_int handle;
+
+	memset(&res, 0, sizeof(res));
+	if (!call(w, w->v2, "matrix_create", MATRIX_CREATE, (xdrproc_t)xdr_matrix_dims, &dims,
+		  (xdrproc_t)xdr_handle_result, &res)) {
+		return 0;
+	}
+	handle = res.status == 0 ? res.handle : 0;
+	xdr_free((xdrproc_t)xdr_handle_result, (char *)&res);
+	for (u_int off = 0; handle != 0 && off < n * n; off += MAX_CHUNK_ELEMENTS) {
+		matrix_chunk chunk;
+		bool ok;
+
+		chunk.handle = handle;
+		chunk.offset = off;
+		chunk.data.data_len = n * n - off < MAX_CHUNK_ELEMENTS ? n * n - off : MAX_CHUNK_ELEMENTS;
+		chunk.data.data_val = (double *)data + off;
+		memset(&res, 0, sizeof(res));
+		if (!call(w, w->v2, "matrix_upload", MATRIX_UPLOAD, (xdrproc_t)xdr_matrix_chunk, &chunk,
+			  (xdrproc_t)xdr_handle_result, &res)) {
+			return 0;
+		}
+		ok = res.status == 0;
+		xdr_free((xdrproc_t)xdr_handle_result, (char *)&res);
+		if (!ok) {
+			return 0;
+		}
+	}
+	return handle;
+}
+
+static void
+release(struct worker *w, u_int handle)
+{
+	handle_result res;
+
+	memset(&res, 0, sizeof(res));
+	if (call(w, w->v2, "matrix_free", MATRIX_FREE, (xdrproc_t)xdr_u_int, &handle,
+		 (xdrproc_t)xdr_handle_result, &res)) {
+		xdr_free((xdrproc_t)xdr_handle_result, (char *)&res);
+	}
+}
+
+/* Connect and create the operands; untimed. */
+static bool
+setup(struct worker *w)
+{
+	const struct loadgen_config *cfg = w->cfg;
+	bool need_v1 = false;
+	bool need_v2 = false;
+
+	for (unsigned int s = 0; s < cfg->size_count; ++s) {
+		need_v1 |= fits_inline(cfg->sizes[s]);
+		need_v2 |= !fits_inline(cfg->sizes[s]);
+	}
+	if ((need_v1 && (w->v1 = connect_version(cfg, MATRIX_OP_V1)) == NULL) ||
+	    (need_v2 && (w->v2 = connect_version(cfg, MATRIX_OP_V2)) == NULL)) {
+		return false;
+	}
+
+	for (unsigned int s = 0; s < cfg->size_count; ++s) {
+		unsigned int n = cfg->sizes[s];
+		double *a = malloc(sizeof(double) * n * n);
+		double *b = malloc(sizeof(double) * n * n);
+
+		if (a == NULL || b == NULL) {
+			fprintf(stderr, "Unable to allocate %u x %u operands.\n", n, n);
+			free(a);
+			free(b);
+			return false;
+		}
+		random_matrix(w, a, n);
+		random_matrix(w, b, n);
+		if (fits_inline(n)) {
+			w->a[s].rows = w->a[s].cols = w->b[s].rows = w->b[s].cols = n;
+			w->a[s].data.data_len = w->b[s].data.data_len = n * n;
+			w->a[s].data.data_val = a;
+			w->b[s].data.data_val = b;
+			continue;
+		}
+		w->ha[s] = upload(w, a, n);
+		w->hb[s] = upload(w, b, n);
+		free(a);
+		free(b);
+		if (w->ha[s] == 0 || w->hb[s] == 0) {
+			if (!w->failed) {
+				fprintf(stderr, "Unable to store %u x %u operands on the server.\n", n, n);
+			}
+			return false;
+		}
+	}
+	return true;
+}
+
+static void
+run_inline(struct worker *w, int k, unsigned int s)
+{
+	const struct op_info *op = &ops[k];
+	struct samples *row = &w->rows[s * ROWS_PER_SIZE + k];
+	matrix_pair pair = { w->a[s], w->b[s] };
+	scaled_matrix scaled = { ALPHA, w->a[s] };
+	scaled_pair scaled2 = { ALPHA, w->a[s], w->b[s] };
+	xdrproc_t xargs;
+	void *args;
+	matrix_result res;
+	double t0, t;
+	bool ok;
+
+	if (op->scaled) {
+		xargs = op->operands == 2 ? (xdrproc_t)xdr_scaled_pair : (xdrproc_t)xdr_scaled_matrix;
+		args = op->operands == 2 ? (void *)&scaled2 : (void *)&scaled;
+	} else {
+		xargs = op->operands == 2 ? (xdrproc_t)xdr_matrix_pair : (xdrproc_t)xdr_matrix;
+		args = op->operands == 2 ? (void *)&pair : (void *)&w->a[s];
+	}
+	if (row->request_bytes == 0) {
+		row->request_bytes = (unsigned int)xdr_sizeof(xargs, args);
+	}
+
+	memset(&res, 0, sizeof(res));
+	t0 = now_sec();
+	if (!call(w, w->v1, op->inline_name, op->inline_proc, xargs, args,
+		  (xdrproc_t)xdr_matrix_result, &res)) {
+		record(row, 0.0, false, 0);
+		return;
+	}
+	t = now_sec() - t0;
+	ok = res.status == 0;
+	record(row, t, ok, row->request_bytes +
+	       reply_bytes((xdrproc_t)xdr_matrix_result, &res, &res.value.data.data_len));
+	xdr_free((xdrproc_t)xdr_matrix_result, (char *)&res);
+}
+
+/* A handle call whose reply is a handle_result; the new handle, or 0. */
+static u_int
+timed_handle_call(struct worker *w, struct samples *row, const char *name, rpcproc_t proc,
+		  xdrproc_t xargs, void *args)
+{
+	handle_result res;
+	double t0, t;
+	u_int handle;
+
+	if (row->request_bytes == 0) {
+		row->request_bytes = (unsigned int)xdr_sizeof(xargs, args);
+	}
+	memset(&res, 0, sizeof(res));
+	t0 = now_sec();
+	if (!call(w, w->v2, name, proc, xargs, args, (xdrproc_t)xdr_handle_result, &res)) {
+		record(row, 0.0, false, 0);
+		return 0;
+	}
+	t = now_sec() - t0;
+	record(row, t, res.status == 0,
+	       row->request_bytes + (unsigned int)xdr_sizeof((xdrproc_t)xdr_handle_result, &res));
+	handle = res.status == 0 ? res.handle : 0;
+	xdr_free((xdrproc_t)xdr_handle_result, (char *)&res);
+	return handle;
+}
+
+static void
+run_by_handle(struct worker *w, int k, unsigned int s)
+{
+	const struct op_info *op = &ops[k];
+	struct samples *rows = &w->rows[s * ROWS_PER_SIZE];
+	unsigned int total = w->cfg->sizes[s] * w->cfg->sizes[s];
+	handle_pair pair = { w->ha[s], w->hb[s] };
+	scaled_handle scaled = { ALPHA, w->ha[s] };
+	scaled_handle_pair scaled2 = { ALPHA, w->ha[s], w->hb[s] };
+	xdrproc_t xargs;
+	void *args;
+	u_int result;
+
+	if (op->scaled) {
+		xargs = op->operands == 2 ? (xdrproc_t)xdr_scaled_handle_pair : (xdrproc_t)xdr_scaled_handle;
+		args = op->operands == 2 ? (void *)&scaled2 : (void *)&scaled;
+	} else {
+		xargs = op->operands == 2 ? (xdrproc_t)xdr_handle_pair : (xdrproc_t)xdr_u_int;
+		args = op->operands == 2 ? (void *)&pair : (void *)&w->ha[s];
+	}
+	result = timed_handle_call(w, &rows[k], op->handle_name, op->handle_proc, xargs, args);
+	if (result == 0) {
+		return;
+	}
+
+	for (u_int off = 0; !w->failed && off < total; off += MAX_CHUNK_ELEMENTS) {
+		chunk_request req = { result, off, total - off < MAX_CHUNK_ELEMENTS ? total - off : MAX_CHUNK_ELEMENTS };
+		struct samples *row = &rows[ROW_DOWNLOAD];
+		chunk_result res;
+		double t0, t;
+
+		if (row->request_bytes == 0) {
+			row->request_bytes = (unsigned int)xdr_sizeof((xdrproc_t)xdr_chunk_request, &req);
+		}
+		memset(&res, 0, sizeof(res));
+		t0 = now_sec();
+		if (!call(w, w->v2, "matrix_download", MATRIX_DOWNLOAD, (xdrproc_t)xdr_chunk_request,
+			  &req, (xdrproc_t)xdr_chunk_result, &res)) {
+			record(row, 0.0, false, 0);
+			return;
+		}
+		t = now_sec() - t0;
+		record(row, t, res.status == 0 && res.data.data_len == req.count, row->request_bytes +
+		       reply_bytes((xdrproc_t)xdr_chunk_result, &res, &res.data.data_len));
+		xdr_free((xdrproc_t)xdr_chunk_result, (char *)&res);
+	}
+	if (!w->failed) {
+		timed_handle_call(w, &rows[ROW_FREE], "matrix_free", MATRIX_FREE, (xdrproc_t)xdr_u_int,
+				  &result);
+	}
+}
+
+static int
+pick_op(struct worker *w)
+{
+	unsigned int total = 0;
+	unsigned int r;
+	int k;
+
+	for (k = 0; k < LOADGEN_OP_COUNT; ++k) {
+		total += w->cfg->weights[k];
+	}
+	r = (unsigned int)rand_r(&w->seed) % total;
+	for (k = 0; r >= w->cfg->weights[k]; ++k) {
+		r -= w->cfg->weights[k];
+	}
+	return k;
+}
+
+static void *
+worker_main(void *arg)
+{
+	struct worker *w = arg;
+	const struct loadgen_config *cfg = w->cfg;
+	double deadline;
+
+	if (!setup(w)) {
+		w->failed = true;
+	}
+	pthread_barrier_wait(w->start);
+	deadline = now_sec() + cfg->seconds;
+
+	while (!w->failed && now_sec() < deadline) {
+		int k = pick_op(w);
+		unsigned int s = (unsigned int)rand_r(&w->seed) % cfg->size_count;
+
+		if (fits_inline(cfg->sizes[s])) {
+			run_inline(w, k, s);
+		} else {
+			run_by_handle(w, k, s);
+		}
+	}
+
+	for (unsigned int s = 0; s < cfg->size_count; ++s) {
+		if (w->ha[s] != 0 && !w->failed) {
+			release(w, w->ha[s]);
+		}
+		if (w->hb[s] != 0 && !w->failed) {
+			release(w, w->hb[s]);
+		}
+		free(w->a[s].data.data_val);
+		free(w->b[s].data.data_val);
+	}
+	if (w->v1 != NULL) {
+		clnt_destroy(w->v1);
+	}
+	if (w->v2 != NULL) {
+		clnt_destroy(w->v2);
+	}
+	return NULL;
+}
+
+/* ---------------- report ---------------- */
+
+static int
+compare_double(const void *x, const void *y)
+{
+	double a = *(const double *)x;
+	double b = *(const double *)y;
+
+	return (a > b) - (a < b);
+}
+
+/* nearest-rank percentile of sorted samples, in milliseconds */
+static double
+percentile_ms(const struct samples *s, double p)
+{
+	size_t rank = (size_t)ceil(p * (double)s->count);
+
+	return s->secs[rank > 0 ? rank - 1 : 0] * 1e3;
+}
+
+static void
+report(const struct loadgen_config *cfg, struct samples *rows, double elapsed)
+{
+	FILE *out = cfg->out;
+	unsigned long long calls = 0;
+	bool first = true;
+
+	if (cfg->json) {
+		fprintf(out, "{\n  \"host\": \"%s\",\n  \"connections\": %u,\n  \"seconds\": %.3f,\n"
+			"  \"seed\": %u,\n  \"results\": [", cfg->host, cfg->connections, elapsed, cfg->seed);
+	} else {
+		fprintf(out, "procedure,n,calls,errors,ops_per_sec,bytes_per_sec,mean_ms,p50_ms,p90_ms,"
+			"p99_ms,max_ms\n");
+	}
+
+	for (unsigned int s = 0; s < cfg->size_count; ++s) {
+		for (int k = 0; k < ROWS_PER_SIZE; ++k) {
+			struct samples *row = &rows[s * ROWS_PER_SIZE + k];
+			unsigned int n = cfg->sizes[s];
+			const char *name;
+			double sum = 0.0;
+			double mean = 0.0, p50 = 0.0, p90 = 0.0, p99 = 0.0, max = 0.0;
+
+			if (row->count + row->errors == 0) {
+				continue;
+			}
+			if (k == ROW_DOWNLOAD) {
+				name = "MATRIX_DOWNLOAD";
+			} else if (k == ROW_FREE) {
+				name = "MATRIX_FREE";
+			} else {
+				name = fits_inline(n) ? ops[k].inline_name : ops[k].handle_name;
+			}
+			if (row->count > 0) {
+				qsort(row->secs, row->count, sizeof(double), compare_double);
+				for (size_t i = 0; i < row->count; ++i) {
+					sum += row->secs[i];
+				}
+				mean = sum / row->count * 1e3;
+				p50 = percentile_ms(row, 0.50);
+				p90 = percentile_ms(row, 0.90);
+				p99 = percentile_ms(row, 0.99);
+				max = row->secs[row->count - 1] * 1e3;
+			}
+			calls += row->count + row->errors;
+
+			if (cfg->json) {
+				fprintf(out, "%s\n    {\"procedure\": \"%s\", \"n\": %u, \"calls\": %lu, "
+					"\"errors\": %lu, \"ops_per_sec\": %.1f, \"bytes_per_sec\": %.0f, "
+					"\"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p90_ms\": %.4f, \"p99_ms\": %.4f, "
+					"\"max_ms\": %.4f}", first ? "" : ",", name, n,
+					(unsigned long)row->count + row->errors, row->errors,
+					row->count / elapsed, row->bytes / elapsed, mean, p50, p90, p99, max);
+			} else {
+				fprintf(out, "%s,%u,%lu,%lu,%.1f,%.0f,%.4f,%.4f,%.4f,%.4f,%.4f\n", name, n,
+					(unsigned long)row->count + row->errors, row->errors,
+					row->count / elapsed, row->bytes / elapsed, mean, p50, p90, p99, max);
+			}
+			first = false;
+		}
+	}
+
+	if (cfg->json) {
+		fprintf(out, "\n  ],\n  \"calls\": %llu,\n  \"ops_per_sec\": %.1f\n}\n", calls,
+			calls / elapsed);
+	}
+	fflush(out);
+}
+
+static void
+merge(struct samples *into, struct samples *from)
+{
+	if (from->count > 0) {
+		double *grown = realloc(into->secs, sizeof(double) * (into->count + from->count));
+
+		if (grown == NULL) {
+			into->errors += from->count;
+		} else {
+			into->secs = grown;
+			memcpy(into->secs + into->count, from->secs, sizeof(double) * from->count);
+			into->count += from->count;
+			into->bytes += from->bytes;
+		}
+	}
+	into->errors += from->errors;
+	free(from->secs);
+}
+
+int
+loadgen_run(const struct loadgen_config *cfg)
+{
+	size_t row_count = (size_t)cfg->size_count * ROWS_PER_SIZE;
+	struct worker *workers = calloc(cfg->connections, sizeof(*workers));
+	struct samples *rows = calloc(row_count, sizeof(*rows));
+	pthread_barrier_t start;
+	unsigned long errors = 0;
+	bool failed = false;
+	double t0, elapsed;
+
+	if (workers == NULL || rows == NULL) {
+		fprintf(stderr, "Unable to allocate %u connections.\n", cfg->connections);
+		free(workers);
+		free(rows);
+		return 1;
+	}
+	signal(SIGPIPE, SIG_IGN);
+	pthread_barrier_init(&start, NULL, cfg->connections + 1);
+
+	for (unsigned int i = 0; i < cfg->connections; ++i) {
+		workers[i].cfg = cfg;
+		workers[i].start = &start;
+		workers[i].seed = cfg->seed * 2654435761u + i;
+		if (pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]) != 0) {
+			fprintf(stderr, "Unable to start connection thread %u.\n", i);
+			exit(1);
+		}
+	}
+	pthread_barrier_wait(&start);
+	t0 = now_sec();
+	for (unsigned int i = 0; i < cfg->connections; ++i) {
+		pthread_join(workers[i].thread, NULL);
+	}
+	elapsed = now_sec() - t0;
+	pthread_barrier_destroy(&start);
+
+	for (unsigned int i = 0; i < cfg->connections; ++i) {
+		failed |= workers[i].failed;
+		for (size_t r = 0; r < row_count; ++r) {
+			merge(&rows[r], &workers[i].rows[r]);
+		}
+	}
+	report(cfg, rows, elapsed);
+	for (size_t r = 0; r < row_count; ++r) {
+		errors += rows[r].errors;
+		free(rows[r].secs);
+	}
+	free(workers);
+	free(rows);
+	return failed || errors != 0 ? 1 : 0;
+}
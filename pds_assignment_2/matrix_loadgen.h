@@ -0,0 +1,45 @@
+#ifndef MATRIX_LOADGEN_H
+#define MATRIX_LOADGEN_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/*
+ * The client's benchmark mode (matrixOp_client --bench): each connection
+ * is a thread that runs randomly chosen operations from a weighted mix on
+ * random n x n matrices, back to back, for a fixed time. n x n matrices
+ * that fit inline use the version 1 procedures; larger ones are uploaded
+ * once and operated on by handle (version 2), with the result downloaded
+ * and freed. Calls, errors, throughput and latency percentiles are
+ * reported per procedure and size.
+ */
+
+#define LOADGEN_MAX_SIZES 16
+#define LOADGEN_OP_COUNT 8	/* add subtract hadamard scale axpy multiply transpose inverse */
+
+struct loadgen_config {
+	const char *host;
+	unsigned short port;	/* 0: look the service up via the portmapper */
+	unsigned int connections;
+	double seconds;
+	unsigned int sizes[LOADGEN_MAX_SIZES];
+	unsigned int size_count;
+	unsigned int weights[LOADGEN_OP_COUNT];	/* relative frequency of each operation */
+	unsigned int seed;
+	bool json;	/* JSON instead of CSV */
+	FILE *out;
+};
+
+/* Defaults: 4 connections, 10 s, n = 8, 20 and 64, the four menu operations equally. */
+void loadgen_defaults(struct loadgen_config *cfg);
+
+/* "n[,n...]"; false if it is malformed. */
+bool loadgen_parse_sizes(struct loadgen_config *cfg, const char *list);
+
+/* "op[:weight][,op[:weight]...]" with the operation names above; false if it is malformed. */
+bool loadgen_parse_mix(struct loadgen_config *cfg, const char *list);
+
+/* Run the benchmark and write the report; 0 if every call succeeded. */
+int loadgen_run(const struct loadgen_config *cfg);
+
+#endif /* MATRIX_LOADGEN_H */
@@ -0,0 +1,236 @@
+/*
+ * Matrix inverse through a blocked LU factorization.
+ *
+ * PA = LU is computed right-looking, NB columns at a time: the panel is
+ * factored with partial pivoting, the matching block row of U is solved,
+ * and the trailing submatrix gets one large GEMM update split by rows
+ * across the thread pool. A^-1 = U^-1 L^-1 P then comes from two blocked
+ * triangular solves on independent column strips of the identity, again in
+ * parallel. That is about 2n^3 flops, against 4n^3 for Gauss-Jordan on the
+ * n x 2n augmented matrix.
+ *
+ * Singularity is judged as before: a pivot column whose largest remaining
+ * magnitude is below EPSILON.
+ */
+#include "matrix_kernels.h"
+#include "matrix_parallel.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NB 64			/* panel width and triangular-solve block */
+#define UPDATE_GRAIN 48		/* trailing rows per parallel range, at least */
+#define SOLVE_STRIP 128		/* identity columns solved together */
+
+struct lu_step {
+	double *a;
+	size_t n;
+	size_t k0;	/* first column of the panel */
+	size_t nb;	/* panel width */
+};
+
+/* Columns [begin, end) of the block row right of the panel: U12 = L11^-1 A12. */
+static void
+solve_block_row(void *ctx, size_t begin, size_t end)
+{
+	const struct lu_step *s = ctx;
+	double *a = s->a;
+	size_t n = s->n;
+	size_t c0 = s->k0 + s->nb + begin;
+	size_t c1 = s->k0 + s->nb + end;
+
+	for (size_t i = s->k0 + 1; i < s->k0 + s->nb; ++i) {
+		for (size_t k = s->k0; k < i; ++k) {
+			double lik = a[i * n + k];
+			for (size_t c = c0; c < c1; ++c) {
+				a[i * n + c] -= lik * a[k * n + c];
+			}
+		}
+	}
+}
+
+/* Rows [begin, end) below the panel: A22 -= L21 * U12. */
+static void
+update_trailing(void *ctx, size_t begin, size_t end)
+{
+	const struct lu_step *s = ctx;
+	size_t n = s->n;
+	size_t r0 = s->k0 + s->nb + begin;
+	size_t c0 = s->k0 + s->nb;
+
+	kernel_gemm(end - begin, s->nb, n - c0, -1.0,
+		    s->a + r0 * n + s->k0, n,
+		    s->a + s->k0 * n + c0, n,
+		    s->a + r0 * n + c0, n);
+}
+
+/* Unblocked LU of the panel, swapping whole rows; KERNEL_SINGULAR on a pivot below EPSILON. */
+static int
+factor_panel(double *a, size_t n, size_t k0, size_t nb, size_t *perm)
+{
+	for (size_t j = k0; j < k0 + nb; ++j) {
+		size_t pivot = j;
+		double max_val = fabs(a[j * n + j]);
+
+		for (size_t row = j + 1; row < n; ++row) {
+			double val = fabs(a[row * n + j]);
+			if (val > max_val) {
+				max_val = val;
+				pivot = row;
+			}
+		}
+		if (max_val < EPSILON) {
+			return KERNEL_SINGULAR;
+		}
+
+		if (pivot != j) {
+			size_t p = perm[j];
+			perm[j] = perm[pivot];
+			perm[pivot] = p;
+			for (size_t c = 0; c < n; ++c) {
+				double tmp = a[j * n + c];
+				a[j * n + c] = a[pivot * n + c];
+				a[pivot * n + c] = tmp;
+			}
+		}
+
+		{
+			double inv = 1.0 / a[j * n + j];
+			for (size_t row = j + 1; row < n; ++row) {
+				double lij = a[row * n + j] *= inv;
+				for (size_t c = j + 1; c < k0 + nb; ++c) {
+					a[row * n + c] -= lij * a[j * n + c];
+				}
+			}
+		}
+	}
+	return KERNEL_OK;
+}
+
+struct inverse_solve {
+	const double *lu;
+	const size_t *perm;
+	double *work;
+	double *out;
+	size_t n;
+};
+
+/* Columns [c0, c1): solve L U z = e_c for each, scatter into out by the pivot order. */
+static void
+solve_strip(const struct inverse_solve *s, size_t c0, size_t c1)
+{
+	const double *lu = s->lu;
+	double *w = s->work;
+	size_t n = s->n;
+	size_t width = c1 - c0;
+
+	/* L^-1 is lower triangular: rows above c0 stay zero and are skipped */
+	for (size_t r = c0; r < n; ++r) {
+		memset(w + r * n + c0, 0, sizeof(double) * width);
+		if (r < c1) {
+			w[r * n + r] = 1.0;
+		}
+	}
+	for (size_t r0 = c0; r0 < n; r0 += NB) {
+		size_t r1 = r0 + NB < n ? r0 + NB : n;
+
+		kernel_gemm(r1 - r0, r0 - c0, width, -1.0, lu + r0 * n + c0, n,
+			    w + c0 * n + c0, n, w + r0 * n + c0, n);
+		for (size_t i = r0 + 1; i < r1; ++i) {
+			for (size_t k = r0; k < i; ++k) {
+				double lik = lu[i * n + k];
+				for (size_t c = c0; c < c1; ++c) {
+					w[i * n + c] -= lik * w[k * n + c];
+				}
+			}
+		}
+	}
+
+	/* U^-1, bottom block first; rows above c0 get filled in here */
+	for (size_t r = 0; r < c0; ++r) {
+		memset(w + r * n + c0, 0, sizeof(double) * width);
+	}
+	for (size_t r1 = n; r1 > 0; ) {
+		size_t r0 = r1 > NB ? r1 - NB : 0;
+
+		kernel_gemm(r1 - r0, n - r1, width, -1.0, lu + r0 * n + r1, n,
+			    w + r1 * n + c0, n, w + r0 * n + c0, n);
+		for (size_t i = r1; i-- > r0; ) {
+			double inv = 1.0 / lu[i * n + i];
+			for (size_t k = i + 1; k < r1; ++k) {
+				double uik = lu[i * n + k];
+				for (size_t c = c0; c < c1; ++c) {
+					w[i * n + c] -= uik * w[k * n + c];
+				}
+			}
+			for (size_t c = c0; c < c1; ++c) {
+				w[i * n + c] *= inv;
+			}
+		}
+		r1 = r0;
+	}
+
+	/* A^-1 = Z P: column c of Z is column perm[c] of the inverse */
+	for (size_t r = 0; r < n; ++r) {
+		for (size_t c = c0; c < c1; ++c) {
+			s->out[r * n + s->perm[c]] = w[r * n + c];
+		}
+	}
+}
+
+static void
+solve_columns(void *ctx, size_t begin, size_t end)
+{
+	for (size_t c0 = begin; c0 < end; c0 += SOLVE_STRIP) {
+		solve_strip(ctx, c0, c0 + SOLVE_STRIP < end ? c0 + SOLVE_STRIP : end);
+	}
+}
+
+int
+kernel_inverse(const double *in, double *out, size_t n)
+{
+	struct inverse_solve solve;
+	double *lu;
+	double *work;
+	size_t *perm;
+	int rc = KERNEL_OK;
+
+	lu = malloc(sizeof(double) * n * n);
+	work = malloc(sizeof(double) * n * n);
+	perm = malloc(sizeof(size_t) * n);
+	if (lu == NULL || work == NULL || perm == NULL) {
+		free(lu);
+		free(work);
+		free(perm);
+		return KERNEL_NO_MEMORY;
+	}
+	memcpy(lu, in, sizeof(double) * n * n);
+	for (size_t i = 0; i < n; ++i) {
+		perm[i] = i;
+	}
+
+	for (size_t k0 = 0; k0 < n && rc == KERNEL_OK; k0 += NB) {
+		struct lu_step step = { lu, n, k0, k0 + NB < n ? NB : n - k0 };
+		size_t rest = n - k0 - step.nb;
+
+		rc = factor_panel(lu, n, k0, step.nb, perm);
+		if (rc == KERNEL_OK && rest > 0) {
+			parallel_for(rest, NB, solve_block_row, &step);
+			parallel_for(rest, UPDATE_GRAIN, update_trailing, &step);
+		}
+	}
+
+	if (rc == KERNEL_OK) {
+		solve.lu = lu;
+		solve.perm = perm;
+		solve.work = work;
+		solve.out = out;
+		solve.n = n;
+		parallel_for(n, SOLVE_STRIP, solve_columns, &solve);
+	}
+
+	free(lu);
+	free(work);
+	free(perm);
+	return rc;
+}
@@ -0,0 +1,208 @@
+#define _DEFAULT_SOURCE
+#include "matrix_parallel.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+struct loop {
+	parallel_body body;
+	void *ctx;
+	size_t remaining;	/* ranges not finished yet; guarded by pool_lock */
+};
+
+struct task {
+	struct loop *loop;
+	size_t begin;
+	size_t end;
+	struct task *next;
+};
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;	/* tasks queued */
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;	/* a loop finished */
+static struct task *queue_head;
+static struct task *queue_tail;
+static unsigned int configured;
+static unsigned int pool_threads;	/* 0 until the pool is started */
+
+void
+parallel_set_threads(unsigned int threads)
+{
+	pthread_mutex_lock(&pool_lock);
+	if (pool_threads == 0) {
+		configured = threads;
+	}
+	pthread_mutex_unlock(&pool_lock);
+}
+
+/* Pop a queued task; pool_lock held. */
+static struct task *
+pop_task(void)
+{
+	struct task *t = queue_head;
+
+	if (t != NULL) {
+		queue_head = t->next;
+		if (queue_head == NULL) {
+			queue_tail = NULL;
+		}
+	}
+	return t;
+}
+
+/* Unlink a queued task of loop, or NULL if none is left; pool_lock held. */
+static struct task *
+pop_own_task(const struct loop *loop)
+{
+	struct task *prev = NULL;
+
+	for (struct task *t = queue_head; t != NULL; prev = t, t = t->next) {
+		if (t->loop != loop) {
+			continue;
+		}
+		if (prev != NULL) {
+			prev->next = t->next;
+		} else {
+			queue_head = t->next;
+		}
+		if (queue_tail == t) {
+			queue_tail = prev;
+		}
+		return t;
+	}
+	return NULL;
+}
+
+/* Run a task with pool_lock held on entry and exit. */
+static void
+run_task(struct task *t)
+{
+	struct loop *loop = t->loop;
+
+	pthread_mutex_unlock(&pool_lock);
+	loop->body(loop->ctx, t->begin, t->end);
+	pthread_mutex_lock(&pool_lock);
+	if (--loop->remaining == 0) {
+		pthread_cond_broadcast(&done_cond);
+	}
+}
+
+static void *
+pool_main(void *arg)
+{
+	(void)arg;
+
+	pthread_mutex_lock(&pool_lock);
+	for (;;) {
+		struct task *t;
+
+		while ((t = pop_task()) == NULL) {
+			pthread_cond_wait(&work_cond, &pool_lock);
+		}
+		run_task(t);
+	}
+	return NULL;
+}
+
+/* Start the pool on first use; pool_lock held. */
+static void
+start_pool(void)
+{
+	long cpus;
+
+	if (pool_threads != 0) {
+		return;
+	}
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	pool_threads = configured != 0 ? configured : (cpus > 0 ? (unsigned int)cpus : 1);
+
+	/* the calling thread is one of them */
+	for (unsigned int i = 1; i < pool_threads; ++i) {
+		pthread_t th;
+
+		if (pthread_create(&th, NULL, pool_main, NULL) != 0) {
+			pool_threads = i;
+			break;
+		}
+		pthread_detach(th);
+	}
+}
+
+unsigned int
+parallel_threads(void)
+{
+	unsigned int n;
+
+	pthread_mutex_lock(&pool_lock);
+	start_pool();
+	n = pool_threads;
+	pthread_mutex_unlock(&pool_lock);
+	return n;
+}
+
+void
+parallel_for(size_t count, size_t grain, parallel_body body, void *ctx)
+{
+	struct loop loop;
+	struct task *tasks;
+	size_t ranges;
+	size_t step;
+	unsigned int threads = parallel_threads();
+
+	if (count == 0) {
+		return;
+	}
+	if (grain == 0) {
+		grain = 1;
+	}
+	ranges = (count + grain - 1) / grain;
+	if (ranges > threads) {
+		ranges = threads;
+	}
+	if (ranges <= 1 || (tasks = malloc(sizeof(*tasks) * ranges)) == NULL) {
+		body(ctx, 0, count);
+		return;
+	}
+
+	step = (count + ranges - 1) / ranges;
+	ranges = (count + step - 1) / step;
+	loop.body = body;
+	loop.ctx = ctx;
+	loop.remaining = ranges;
+
+	pthread_mutex_lock(&pool_lock);
+	for (size_t i = 0; i < ranges; ++i) {
+		tasks[i].loop = &loop;
+		tasks[i].begin = i * step;
+		tasks[i].end = (i + 1) * step < count ? (i + 1) * step : count;
+		tasks[i].next = NULL;
+		if (i == 0) {
+			continue;	/* ours */
+		}
+		if (queue_tail != NULL) {
+			queue_tail->next = &tasks[i];
+		} else {
+			queue_head = &tasks[i];
+		}
+		queue_tail = &tasks[i];
+	}
+	pthread_cond_broadcast(&work_cond);
+	run_task(&tasks[0]);
+
+	/*
+	 * help with our own ranges only: a slice of another caller's loop (a
+	 * large inverse, say) would hold up this request's reply
+	 */
+	while (loop.remaining > 0) {
+		struct task *t = pop_own_task(&loop);
+
+		if (t != NULL) {
+			run_task(t);
+		} else {
+			pthread_cond_wait(&done_cond, &pool_lock);
+		}
+	}
+	pthread_mutex_unlock(&pool_lock);
+	free(tasks);
+}
@@ -0,0 +1,26 @@
+#ifndef MATRIX_PARALLEL_H
+#define MATRIX_PARALLEL_H
+
+#include <stddef.h>
+
+/*
+ * Data-parallel loops for the kernels, on one process-wide pool of threads
+ * started on first use. Any number of callers (e.g. RPC worker threads) may
+ * run parallel loops at once; a caller works on its own loop while it waits,
+ * so nesting cannot deadlock.
+ */
+
+typedef void (*parallel_body)(void *ctx, size_t begin, size_t end);
+
+/*
+ * Run body over [0, count) split into ranges of at least grain items.
+ * Returns when every range is done. Runs inline if there is only one range.
+ */
+void parallel_for(size_t count, size_t grain, parallel_body body, void *ctx);
+
+/* Threads a loop may use, the caller included; 0 means one per CPU. Set before first use. */
+void parallel_set_threads(unsigned int threads);
+
+unsigned int parallel_threads(void);
+
+#endif /* MATRIX_PARALLEL_H */
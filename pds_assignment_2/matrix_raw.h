@@ -0,0 +1,38 @@
+#ifndef MATRIX_RAW_H
+#define MATRIX_RAW_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * RAW_FORMAT_LE_DOUBLE blocks (version 3) are little-endian IEEE-754
+ * doubles. On little-endian hosts a block already is a double array; on
+ * big-endian hosts each value is byte-swapped in place on the way in and
+ * on the way out.
+ */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define RAW_HOST_ORDER 0
+#else
+#define RAW_HOST_ORDER 1	/* raw blocks need no conversion */
+#endif
+
+/* Convert count doubles between raw and host order; its own inverse. */
+static inline void
+raw_byte_order(void *data, size_t count)
+{
+	unsigned char *p = data;
+
+	if (RAW_HOST_ORDER) {
+		return;
+	}
+	for (size_t i = 0; i < count; ++i, p += sizeof(uint64_t)) {
+		uint64_t v;
+
+		memcpy(&v, p, sizeof(v));
+		v = __builtin_bswap64(v);
+		memcpy(p, &v, sizeof(v));
+	}
+}
+
+#endif /* MATRIX_RAW_H */
@@ -0,0 +1,267 @@
+#define _DEFAULT_SOURCE
+#include "matrix_shm.h"
+#include "matrixOp.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef MAP_POPULATE
+#define MAP_POPULATE 0
+#endif
+
+static int
+map_fd(int fd, size_t size, off_t offset, int flags, shm_segment *seg)
+{
+	void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | flags, fd, offset);
+
+	if (base == MAP_FAILED) {
+		return errno;
+	}
+	seg->base = base;
+	seg->size = size;
+	seg->guard = -1;
+	return 0;
+}
+
+int
+shm_segment_create(size_t size, char *name, shm_segment *seg)
+{
+	static unsigned int counter;
+	int fd;
+	int rc;
+
+	if (size == 0) {
+		return EINVAL;
+	}
+	for (int attempt = 0;; ++attempt) {
+		snprintf(name, SHM_NAME_LEN, SHM_NAME_PREFIX "%ld-%u-%ld", (long)getpid(),
+			 __atomic_fetch_add(&counter, 1, __ATOMIC_RELAXED), (long)time(NULL));
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd >= 0) {
+			break;
+		}
+		if (errno != EEXIST || attempt == 8) {
+			return errno;
+		}
+	}
+
+	if (ftruncate(fd, (off_t)size) != 0) {
+		rc = errno;
+	} else {
+		rc = map_fd(fd, size, 0, 0, seg);
+	}
+	close(fd);
+	if (rc != 0) {
+		shm_unlink(name);
+	}
+	return rc;
+}
+
+/* ---------------- server side ---------------- */
+
+/*
+ * Mappings in use by calls. A client that truncates its segment during a
+ * call would otherwise kill the server with SIGBUS, in whichever thread
+ * touched the page; the handler finds the guarded mapping the fault is in
+ * and replaces it with anonymous pages so the kernel can finish.
+ */
+#define GUARD_SLOTS 256
+
+static struct guard_slot {
+	int used;
+	char *base;	/* set last, cleared first: the handler reads it */
+	size_t size;
+	int truncated;
+} guard[GUARD_SLOTS];
+
+static void
+guard_handler(int sig, siginfo_t *info, void *context)
+{
+	char *addr = info->si_addr;
+
+	(void)context;
+	for (int i = 0; i < GUARD_SLOTS; ++i) {
+		char *base = __atomic_load_n(&guard[i].base, __ATOMIC_ACQUIRE);
+
+		if (base != NULL && addr >= base && addr < base + guard[i].size) {
+			if (mmap(base, guard[i].size, PROT_READ | PROT_WRITE,
+				 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) {
+				break;
+			}
+			__atomic_store_n(&guard[i].truncated, 1, __ATOMIC_RELEASE);
+			return;
+		}
+	}
+	/* not ours: the access faults again and the process dies as it would have */
+	signal(sig, SIG_DFL);
+}
+
+void
+shm_guard_install(void)
+{
+	struct sigaction sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_sigaction = guard_handler;
+	sa.sa_flags = SA_SIGINFO;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGBUS, &sa, NULL);
+}
+
+static int
+guard_add(char *base, size_t size)
+{
+	for (int i = 0; i < GUARD_SLOTS; ++i) {
+		int expected = 0;
+
+		if (__atomic_compare_exchange_n(&guard[i].used, &expected, 1, false, __ATOMIC_ACQUIRE,
+						__ATOMIC_RELAXED)) {
+			guard[i].size = size;
+			guard[i].truncated = 0;
+			__atomic_store_n(&guard[i].base, base, __ATOMIC_RELEASE);
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void
+guard_remove(int i)
+{
+	__atomic_store_n(&guard[i].base, NULL, __ATOMIC_RELEASE);
+	__atomic_store_n(&guard[i].used, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * A loopback peer is a process on this host; the kernel lists the owner of
+ * its socket in /proc/net/tcp under the peer's address and port.
+ */
+int
+shm_peer_uid(int fd, uid_t *uid)
+{
+	struct sockaddr_in peer, self;
+	socklen_t len = sizeof(peer);
+	char line[256];
+	FILE *f;
+	int rc = ESRCH;
+
+	if (getpeername(fd, (struct sockaddr *)&peer, &len) != 0) {
+		return errno;	/* UDP: no connection, and the source could be forged */
+	}
+	if (peer.sin_family != AF_INET || ntohl(peer.sin_addr.s_addr) >> 24 != 127) {
+		return EPERM;
+	}
+	len = sizeof(self);
+	if (getsockname(fd, (struct sockaddr *)&self, &len) != 0) {
+		return errno;
+	}
+	if ((f = fopen("/proc/net/tcp", "r")) == NULL) {
+		return errno;
+	}
+	while (fgets(line, sizeof(line), f) != NULL) {
+		unsigned int laddr, lport, raddr, rport;
+		unsigned long owner;
+
+		/* sl local rem st tx:rx tr:when retrnsmt uid ...; addresses as stored, ports host order */
+		if (sscanf(line, "%*u: %8X:%4X %8X:%4X %*X %*X:%*X %*X:%*X %*X %lu", &laddr, &lport,
+			   &raddr, &rport, &owner) == 5 &&
+		    laddr == peer.sin_addr.s_addr && lport == ntohs(peer.sin_port) &&
+		    raddr == self.sin_addr.s_addr && rport == ntohs(self.sin_port)) {
+			*uid = (uid_t)owner;
+			rc = 0;
+			break;
+		}
+	}
+	fclose(f);
+	return rc;
+}
+
+int
+shm_file_open(const char *name, uid_t owner, shm_file *file)
+{
+	struct stat st;
+	int fd;
+	int rc = 0;
+
+	if (strncmp(name, SHM_NAME_PREFIX, strlen(SHM_NAME_PREFIX)) != 0 ||
+	    strchr(name + 1, '/') != NULL) {
+		return EPERM;
+	}
+	fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0) {
+		return errno;
+	}
+	if (fstat(fd, &st) != 0) {
+		rc = errno;
+	} else if (!S_ISREG(st.st_mode) || st.st_uid != owner) {
+		rc = EPERM;
+	} else if (st.st_size <= 0) {
+		rc = EINVAL;
+	}
+	if (rc != 0) {
+		close(fd);
+		return rc;
+	}
+	file->fd = fd;
+	file->size = (size_t)st.st_size;
+	return 0;
+}
+
+void
+shm_file_close(shm_file *file)
+{
+	if (file->fd >= 0) {
+		close(file->fd);
+		file->fd = -1;
+	}
+}
+
+int
+shm_file_map(const shm_file *file, unsigned long long offset, size_t len, shm_segment *seg,
+	     double **at)
+{
+	unsigned long long start = offset - offset % (unsigned long long)sysconf(_SC_PAGESIZE);
+	int rc;
+
+	/* fault in only the pages the call uses, up front instead of one at a time */
+	rc = map_fd(file->fd, len + (size_t)(offset - start), (off_t)start, MAP_POPULATE, seg);
+	if (rc != 0) {
+		return rc;
+	}
+	if ((seg->guard = guard_add(seg->base, seg->size)) < 0) {
+		munmap(seg->base, seg->size);
+		seg->base = NULL;
+		return EBUSY;
+	}
+	*at = (double *)(void *)((char *)seg->base + (offset - start));
+	return 0;
+}
+
+bool
+shm_segment_truncated(const shm_segment *seg)
+{
+	return seg->guard >= 0 && __atomic_load_n(&guard[seg->guard].truncated, __ATOMIC_ACQUIRE);
+}
+
+void
+shm_segment_close(shm_segment *seg)
+{
+	if (seg->base != NULL) {
+		if (seg->guard >= 0) {
+			guard_remove(seg->guard);
+			seg->guard = -1;
+		}
+		munmap(seg->base, seg->size);
+		seg->base = NULL;
+		seg->size = 0;
+	}
+}
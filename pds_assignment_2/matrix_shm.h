@@ -0,0 +1,66 @@
+#ifndef MATRIX_SHM_H
+#define MATRIX_SHM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+ * POSIX shared-memory segments for the version 4 (same-host) procedures.
+ * The client creates a segment and removes it when done; the server maps
+ * the parts of it a call uses for the duration of that call.
+ */
+
+/* Every segment name starts with this; the server opens no other. */
+#define SHM_NAME_PREFIX "/matrixOp-"
+
+typedef struct shm_segment {
+	void *base;
+	size_t size;
+	int guard;	/* slot in the truncation guard, -1 if none */
+} shm_segment;
+
+/* A segment the server has opened and checked but not mapped yet. */
+typedef struct shm_file {
+	int fd;
+	size_t size;
+} shm_file;
+
+/*
+ * Create and map a new segment of size bytes under a fresh name, written to
+ * name (SHM_NAME_LEN bytes). Returns 0 or an errno value.
+ */
+int shm_segment_create(size_t size, char *name, shm_segment *seg);
+
+void shm_segment_close(shm_segment *seg);
+
+/*
+ * The uid of the process on the other end of a loopback TCP connection.
+ * Returns 0, EPERM if the peer is not on this host, or another errno value.
+ */
+int shm_peer_uid(int fd, uid_t *uid);
+
+/*
+ * Open an existing segment created by shm_segment_create() and owned by
+ * owner. Returns 0, EPERM for a foreign name or owner, or an errno value.
+ */
+int shm_file_open(const char *name, uid_t owner, shm_file *file);
+
+void shm_file_close(shm_file *file);
+
+/*
+ * Map bytes [offset, offset + len) of the file read-write, faulting them
+ * in, and point *at to offset. The mapping is guarded: if the file is
+ * truncated under it, the pages are replaced by anonymous memory instead
+ * of the process dying of SIGBUS, and shm_segment_truncated() says so.
+ * Returns 0 or an errno value.
+ */
+int shm_file_map(const shm_file *file, unsigned long long offset, size_t len, shm_segment *seg,
+		 double **at);
+
+bool shm_segment_truncated(const shm_segment *seg);
+
+/* Install the SIGBUS handler behind the guard; call once before serving. */
+void shm_guard_install(void);
+
+#endif /* MATRIX_SHM_H */
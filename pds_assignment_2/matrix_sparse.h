@@ -0,0 +1,54 @@
+#ifndef MATRIX_SPARSE_H
+#define MATRIX_SPARSE_H
+
+#include <stddef.h>
+
+/*
+ * Compressed sparse row (CSR) kernels, see matrix_sparse.c. Row r holds
+ * values[row_ptr[r] .. row_ptr[r + 1]) in columns col_idx[...], ascending.
+ * As with the dense kernels, callers validate the structure first.
+ *
+ * Kernels that produce a sparse matrix allocate its three arrays; release
+ * them with sparse_free. They return KERNEL_OK or KERNEL_NO_MEMORY.
+ */
+
+typedef struct sparse_matrix {
+	unsigned int rows;
+	unsigned int cols;
+	unsigned int *row_ptr;	/* rows + 1 entries */
+	unsigned int *col_idx;	/* nnz entries */
+	double *values;		/* nnz entries */
+} sparse_matrix;
+
+/* Stored entries. */
+size_t sparse_nnz(const sparse_matrix *m);
+
+void sparse_free(sparse_matrix *m);
+
+/* out = a + b */
+int sparse_add(const sparse_matrix *a, const sparse_matrix *b, sparse_matrix *out);
+
+/* out = a * b, both sparse (Gustavson's row-by-row product) */
+int sparse_multiply(const sparse_matrix *a, const sparse_matrix *b, sparse_matrix *out);
+
+/* out = a^T */
+int sparse_transpose(const sparse_matrix *a, sparse_matrix *out);
+
+/* out (a.rows x p) = a * b, b dense (a.cols x p), row-major */
+void sparse_multiply_dense(const sparse_matrix *a, const double *b, double *out, size_t p);
+
+/* y = a * x */
+void sparse_multiply_vector(const sparse_matrix *a, const double *x, double *y);
+
+/* CSR copy of a dense rows x cols matrix, dropping exact zeros. */
+int sparse_from_dense(const double *in, unsigned int rows, unsigned int cols, sparse_matrix *out);
+
+/*
+ * out (m x p) = a (m x n) * b (n x p), all dense. If a is sparse enough it
+ * is converted to CSR and multiplied with sparse_multiply_dense, otherwise
+ * this is kernel_multiply.
+ */
+void kernel_multiply_auto(const double *a, const double *b, double *out,
+			  size_t m, size_t n, size_t p);
+
+#endif /* MATRIX_SPARSE_H */
@@ -0,0 +1,242 @@
+#include "matrix_store.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+#define SLOT_BITS 20	/* a handle is generation << SLOT_BITS | (slot + 1) */
+#define SLOT_MASK ((1u << SLOT_BITS) - 1)
+#define MAX_SLOTS SLOT_MASK
+
+struct slot {
+	stored_matrix *m;	/* NULL if free */
+	unsigned int gen;	/* bumped when the slot is freed */
+};
+
+static pthread_mutex_t store_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct slot *slots;
+static size_t slot_count;
+static unsigned long long byte_limit = STORE_DEFAULT_BYTES;
+static unsigned long long bytes;	/* held by all matrices, live or awaiting their last release */
+
+static unsigned long long
+size_of(const stored_matrix *m)
+{
+	return (unsigned long long)m->rows * m->cols * sizeof(double);
+}
+
+/* With store_lock held: false if size more bytes would exceed the limit. */
+static bool
+reserve(unsigned long long size)
+{
+	if (byte_limit != 0 && size > byte_limit - bytes) {
+		return false;
+	}
+	bytes += size;
+	return true;
+}
+
+static void
+unreserve(unsigned long long size)
+{
+	pthread_mutex_lock(&store_lock);
+	bytes -= size;
+	pthread_mutex_unlock(&store_lock);
+}
+
+static unsigned int
+handle_of(size_t slot)
+{
+	return slots[slot].gen << SLOT_BITS | (unsigned int)(slot + 1);
+}
+
+/* With store_lock held: the live slot handle names, or NULL. */
+static struct slot *
+find(unsigned int handle)
+{
+	size_t slot = handle & SLOT_MASK;
+
+	if (slot == 0 || slot > slot_count || slots[slot - 1].m == NULL ||
+	    handle_of(slot - 1) != handle) {
+		return NULL;
+	}
+	return &slots[slot - 1];
+}
+
+/* With store_lock held: empty s and retire its handle. */
+static stored_matrix *
+vacate(struct slot *s)
+{
+	stored_matrix *m = s->m;
+
+	s->m = NULL;
+	s->gen = (s->gen + 1) & (~0u >> SLOT_BITS);
+	return m;
+}
+
+static void
+destroy(stored_matrix *m)
+{
+	free(m->data);
+	free(m);
+}
+
+void
+store_set_limit(unsigned long long limit)
+{
+	byte_limit = limit;
+}
+
+unsigned int
+store_create(unsigned int rows, unsigned int cols, const void *owner, stored_matrix **ref)
+{
+	unsigned long long elements = (unsigned long long)rows * cols;
+	unsigned long long size = elements * sizeof(double);
+	stored_matrix *m;
+	size_t slot;
+	unsigned int handle;
+	bool room;
+
+	if (rows == 0 || cols == 0 || elements > STORE_MAX_ELEMENTS) {
+		return 0;
+	}
+	pthread_mutex_lock(&store_lock);
+	room = reserve(size);
+	pthread_mutex_unlock(&store_lock);
+	if (!room) {
+		return 0;
+	}
+
+	/* allocate outside the lock; zeroing a large matrix takes a while */
+	m = malloc(sizeof(*m));
+	if (m == NULL) {
+		unreserve(size);
+		return 0;
+	}
+	m->data = calloc((size_t)elements, sizeof(double));
+	if (m->data == NULL) {
+		free(m);
+		unreserve(size);
+		return 0;
+	}
+	m->rows = rows;
+	m->cols = cols;
+	m->refs = ref != NULL ? 2 : 1;
+	m->owner = owner;
+
+	pthread_mutex_lock(&store_lock);
+	for (slot = 0; slot < slot_count; ++slot) {
+		if (slots[slot].m == NULL) {
+			break;
+		}
+	}
+	if (slot == slot_count) {
+		size_t grown = slot_count == 0 ? 16 : slot_count * 2;
+		struct slot *tmp = NULL;
+
+		if (grown > MAX_SLOTS) {
+			grown = MAX_SLOTS;
+		}
+		if (grown > slot_count) {
+			tmp = realloc(slots, sizeof(*slots) * grown);
+		}
+		if (tmp == NULL) {
+			bytes -= size;
+			pthread_mutex_unlock(&store_lock);
+			destroy(m);
+			return 0;
+		}
+		for (size_t i = slot_count; i < grown; ++i) {
+			tmp[i].m = NULL;
+			tmp[i].gen = 0;
+		}
+		slots = tmp;
+		slot_count = grown;
+	}
+	slots[slot].m = m;
+	handle = handle_of(slot);
+	pthread_mutex_unlock(&store_lock);
+
+	if (ref != NULL) {
+		*ref = m;
+	}
+	return handle;
+}
+
+stored_matrix *
+store_acquire(unsigned int handle)
+{
+	stored_matrix *m = NULL;
+	struct slot *s;
+
+	pthread_mutex_lock(&store_lock);
+	if ((s = find(handle)) != NULL) {
+		m = s->m;
+		m->refs++;
+	}
+	pthread_mutex_unlock(&store_lock);
+	return m;
+}
+
+void
+store_release(stored_matrix *m)
+{
+	unsigned int refs;
+
+	pthread_mutex_lock(&store_lock);
+	refs = --m->refs;
+	if (refs == 0) {
+		bytes -= size_of(m);
+	}
+	pthread_mutex_unlock(&store_lock);
+	if (refs == 0) {
+		destroy(m);
+	}
+}
+
+bool
+store_writable(const stored_matrix *m, const void *owner)
+{
+	return m->owner == NULL || m->owner == owner;
+}
+
+bool
+store_free(unsigned int handle, const void *owner)
+{
+	stored_matrix *m = NULL;
+	struct slot *s;
+
+	pthread_mutex_lock(&store_lock);
+	if ((s = find(handle)) != NULL && store_writable(s->m, owner)) {
+		m = vacate(s);
+	}
+	pthread_mutex_unlock(&store_lock);
+
+	if (m == NULL) {
+		return false;
+	}
+	store_release(m);
+	return true;
+}
+
+void
+store_free_owned(const void *owner)
+{
+	if (owner == NULL) {
+		return;
+	}
+	for (size_t slot = 0;; ++slot) {
+		stored_matrix *m = NULL;
+
+		pthread_mutex_lock(&store_lock);
+		if (slot >= slot_count) {
+			pthread_mutex_unlock(&store_lock);
+			return;
+		}
+		if (slots[slot].m != NULL && slots[slot].m->owner == owner) {
+			m = vacate(&slots[slot]);
+		}
+		pthread_mutex_unlock(&store_lock);
+		if (m != NULL) {
+			store_release(m);
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef MATRIX_STORE_H
+#define MATRIX_STORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Server-side matrices addressed by handle (version 2 procedures).
+ * A handle is a slot number with the slot's generation above it; freed
+ * slots are reused under a new generation, so the handle of a freed matrix
+ * stays unknown rather than naming whatever took its slot.
+ *
+ * The store is shared by all worker threads. Callers work on a matrix
+ * through a reference (store_acquire/store_release), so a concurrent
+ * MATRIX_FREE only drops the handle; the memory goes away with the last
+ * reference.
+ *
+ * Every matrix may be tagged with an owner, the TCP connection that
+ * created it; the owner's handles are dropped when it goes away, so a
+ * client that disconnects without freeing them does not leak them. Any
+ * connection may read an owned matrix, but only its owner may change or
+ * free it. The matrices together may hold at most the byte limit.
+ */
+
+typedef struct stored_matrix {
+	unsigned int rows;
+	unsigned int cols;
+	double *data; /* rows * cols elements, row-major */
+	unsigned int refs; /* guarded by the store lock */
+	const void *owner; /* NULL: kept until freed */
+} stored_matrix;
+
+/* Largest matrix the store accepts, in elements. */
+#define STORE_MAX_ELEMENTS (1ULL << 31)
+
+#define STORE_DEFAULT_BYTES (4ULL << 30)
+
+/* Bytes all stored matrices may hold together; 0 = no limit. Call before serving. */
+void store_set_limit(unsigned long long bytes);
+
+/*
+ * Allocate a rows x cols matrix (contents zeroed) for owner, which may be
+ * NULL. Returns its handle, or 0 if the dimensions are too large, the byte
+ * limit would be exceeded or memory is exhausted. If ref is not NULL it
+ * receives a reference the caller must release.
+ */
+unsigned int store_create(unsigned int rows, unsigned int cols, const void *owner,
+			  stored_matrix **ref);
+
+/* Take a reference; NULL if the handle is unknown. */
+stored_matrix *store_acquire(unsigned int handle);
+
+void store_release(stored_matrix *m);
+
+/* true if owner may overwrite or free m: m has no owner or it is owner */
+bool store_writable(const stored_matrix *m, const void *owner);
+
+/* Drop the handle for owner; false if it is unknown or not writable by owner. */
+bool store_free(unsigned int handle, const void *owner);
+
+/* Drop every handle owner created. */
+void store_free_owned(const void *owner);
+
+#endif /* MATRIX_STORE_H */
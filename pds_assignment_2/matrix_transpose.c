@@ -0,0 +1,291 @@
+/*
+ * Blocked transpose.
+ *
+ * The naive loop reads rows and writes columns, so every store lands in a
+ * different cache line (and, past a few hundred columns, a different
+ * page). Here the matrix is walked in TILE x TILE tiles, small enough that
+ * the rows read and the rows written both stay in L1. Inside a tile, 4 x 4
+ * blocks are transposed in registers (four loads, four unpacks, four
+ * lane permutes, four stores) with AVX when the CPU has it, and in plain C
+ * otherwise. Large matrices are split by tiles across the kernel thread
+ * pool.
+ */
+#include "matrix_kernels.h"
+#include "matrix_parallel.h"
+#include <stdbool.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX_TRANSPOSE 1
+#include <immintrin.h>
+#endif
+
+#define TILE 32			/* multiple of 4; an in and an out tile fit in L1 */
+#define TILE_GRAIN 8		/* tile rows per parallel range, at least */
+#define SQUARE_GRAIN 2		/* in place, row i of tiles does n / TILE - i of them */
+
+/*
+ * out (cols x rows, row stride ldo) = in (rows x cols, row stride ldi)^T
+ * for one tile or less; full 4 x 4 blocks in registers, the edges by element.
+ */
+typedef void (*transpose_tile_fn)(const double *in, size_t ldi, double *out, size_t ldo,
+				  size_t rows, size_t cols);
+
+/* in-place transpose: the 4 x 4 blocks at x and y become each other's transpose */
+typedef void (*swap_blocks_fn)(double *x, double *y, size_t ld);
+
+static void
+transpose_edges(const double *in, size_t ldi, double *out, size_t ldo, size_t rows,
+		size_t cols)
+{
+	size_t rows4 = rows & ~(size_t)3;
+	size_t cols4 = cols & ~(size_t)3;
+
+	for (size_t i = 0; i < rows; ++i) {
+		for (size_t j = i < rows4 ? cols4 : 0; j < cols; ++j) {
+			out[j * ldo + i] = in[i * ldi + j];
+		}
+	}
+}
+
+static void
+transpose_tile_scalar(const double *in, size_t ldi, double *out, size_t ldo, size_t rows,
+		      size_t cols)
+{
+	for (size_t i = 0; i + 4 <= rows; i += 4) {
+		for (size_t j = 0; j + 4 <= cols; j += 4) {
+			const double *s = in + i * ldi + j;
+			double *d = out + j * ldo + i;
+			double b[4][4];
+
+			for (size_t r = 0; r < 4; ++r) {
+				for (size_t c = 0; c < 4; ++c) {
+					b[c][r] = s[r * ldi + c];
+				}
+			}
+			for (size_t c = 0; c < 4; ++c) {
+				for (size_t r = 0; r < 4; ++r) {
+					d[c * ldo + r] = b[c][r];
+				}
+			}
+		}
+	}
+	transpose_edges(in, ldi, out, ldo, rows, cols);
+}
+
+#ifdef HAVE_AVX_TRANSPOSE
+/* rows r0..r3 of a 4 x 4 block become its columns */
+#define TRANSPOSE4(r0, r1, r2, r3) do { \
+	__m256d t0 = _mm256_unpacklo_pd(r0, r1); \
+	__m256d t1 = _mm256_unpackhi_pd(r0, r1); \
+	__m256d t2 = _mm256_unpacklo_pd(r2, r3); \
+	__m256d t3 = _mm256_unpackhi_pd(r2, r3); \
+	r0 = _mm256_permute2f128_pd(t0, t2, 0x20); \
+	r1 = _mm256_permute2f128_pd(t1, t3, 0x20); \
+	r2 = _mm256_permute2f128_pd(t0, t2, 0x31); \
+	r3 = _mm256_permute2f128_pd(t1, t3, 0x31); \
+} while (0)
+
+__attribute__((target("avx")))
+static void
+transpose_tile_avx(const double *in, size_t ldi, double *out, size_t ldo, size_t rows,
+		   size_t cols)
+{
+	for (size_t i = 0; i + 4 <= rows; i += 4) {
+		for (size_t j = 0; j + 4 <= cols; j += 4) {
+			const double *s = in + i * ldi + j;
+			double *d = out + j * ldo + i;
+			__m256d r0 = _mm256_loadu_pd(s);
+			__m256d r1 = _mm256_loadu_pd(s + ldi);
+			__m256d r2 = _mm256_loadu_pd(s + 2 * ldi);
+			__m256d r3 = _mm256_loadu_pd(s + 3 * ldi);
+
+			TRANSPOSE4(r0, r1, r2, r3);
+			_mm256_storeu_pd(d, r0);
+			_mm256_storeu_pd(d + ldo, r1);
+			_mm256_storeu_pd(d + 2 * ldo, r2);
+			_mm256_storeu_pd(d + 3 * ldo, r3);
+		}
+	}
+	transpose_edges(in, ldi, out, ldo, rows, cols);
+}
+
+/*
+ * Replace the 4 x 4 blocks at x and y (row stride ld) with each other's
+ * transpose. Both are loaded before either is stored, so x == y
+ * transposes a diagonal block in place.
+ */
+__attribute__((target("avx")))
+static void
+swap_blocks_avx(double *x, double *y, size_t ld)
+{
+	__m256d x0 = _mm256_loadu_pd(x);
+	__m256d x1 = _mm256_loadu_pd(x + ld);
+	__m256d x2 = _mm256_loadu_pd(x + 2 * ld);
+	__m256d x3 = _mm256_loadu_pd(x + 3 * ld);
+	__m256d y0 = _mm256_loadu_pd(y);
+	__m256d y1 = _mm256_loadu_pd(y + ld);
+	__m256d y2 = _mm256_loadu_pd(y + 2 * ld);
+	__m256d y3 = _mm256_loadu_pd(y + 3 * ld);
+
+	TRANSPOSE4(x0, x1, x2, x3);
+	TRANSPOSE4(y0, y1, y2, y3);
+	_mm256_storeu_pd(x, y0);
+	_mm256_storeu_pd(x + ld, y1);
+	_mm256_storeu_pd(x + 2 * ld, y2);
+	_mm256_storeu_pd(x + 3 * ld, y3);
+	_mm256_storeu_pd(y, x0);
+	_mm256_storeu_pd(y + ld, x1);
+	_mm256_storeu_pd(y + 2 * ld, x2);
+	_mm256_storeu_pd(y + 3 * ld, x3);
+}
+#undef TRANSPOSE4
+#endif
+
+static void
+swap_blocks_scalar(double *x, double *y, size_t ld)
+{
+	double bx[4][4];
+	double by[4][4];
+
+	for (size_t r = 0; r < 4; ++r) {
+		for (size_t c = 0; c < 4; ++c) {
+			bx[r][c] = x[r * ld + c];
+			by[r][c] = y[r * ld + c];
+		}
+	}
+	for (size_t r = 0; r < 4; ++r) {
+		for (size_t c = 0; c < 4; ++c) {
+			x[r * ld + c] = by[c][r];
+			y[r * ld + c] = bx[c][r];
+		}
+	}
+}
+
+static bool
+have_avx(void)
+{
+#ifdef HAVE_AVX_TRANSPOSE
+	return __builtin_cpu_supports("avx");
+#else
+	return false;
+#endif
+}
+
+struct transpose_job {
+	const double *in;
+	double *out;
+	size_t rows;
+	size_t cols;
+	transpose_tile_fn tile;
+};
+
+struct square_job {
+	double *a;
+	size_t n;
+	swap_blocks_fn swap;
+};
+
+/* Row tiles [begin, end) of in, each across all of its columns; for tall, narrow matrices. */
+static void
+transpose_rows(void *ctx, size_t begin, size_t end)
+{
+	const struct transpose_job *t = ctx;
+	size_t r1 = end * TILE < t->rows ? end * TILE : t->rows;
+
+	for (size_t r = begin * TILE; r < r1; r += TILE) {
+		size_t h = r1 - r < TILE ? r1 - r : TILE;
+
+		for (size_t c = 0; c < t->cols; c += TILE) {
+			size_t w = t->cols - c < TILE ? t->cols - c : TILE;
+
+			t->tile(t->in + r * t->cols + c, t->cols, t->out + c * t->rows + r, t->rows, h, w);
+		}
+	}
+}
+
+/* Column tiles [begin, end) of in, each down all of its rows. */
+static void
+transpose_cols(void *ctx, size_t begin, size_t end)
+{
+	const struct transpose_job *t = ctx;
+	size_t c1 = end * TILE < t->cols ? end * TILE : t->cols;
+
+	for (size_t c = begin * TILE; c < c1; c += TILE) {
+		size_t w = c1 - c < TILE ? c1 - c : TILE;
+
+		for (size_t r = 0; r < t->rows; r += TILE) {
+			size_t h = t->rows - r < TILE ? t->rows - r : TILE;
+
+			t->tile(t->in + r * t->cols + c, t->cols, t->out + c * t->rows + r, t->rows, h, w);
+		}
+	}
+}
+
+void
+kernel_transpose(const double *in, double *out, size_t rows, size_t cols)
+{
+	struct transpose_job job = { in, out, rows, cols, transpose_tile_scalar };
+
+#ifdef HAVE_AVX_TRANSPOSE
+	if (have_avx()) {
+		job.tile = transpose_tile_avx;
+	}
+#endif
+	/*
+	 * Column tiles first, so each output row is written front to back; rows
+	 * first only when the matrix is too narrow to give the pool two ranges.
+	 */
+	if (cols <= TILE * TILE_GRAIN && rows > cols) {
+		parallel_for((rows + TILE - 1) / TILE, TILE_GRAIN, transpose_rows, &job);
+	} else {
+		parallel_for((cols + TILE - 1) / TILE, TILE_GRAIN, transpose_cols, &job);
+	}
+}
+
+/* Tile rows [begin, end): every 4 x 4 block on or right of the diagonal trades places with its mirror. */
+static void
+transpose_square_rows(void *ctx, size_t begin, size_t end)
+{
+	const struct square_job *t = ctx;
+	size_t n = t->n;
+	size_t n4 = n & ~(size_t)3;
+	size_t r1 = end * TILE < n4 ? end * TILE : n4;
+
+	for (size_t ti = begin * TILE; ti < r1; ti += TILE) {
+		size_t i1 = ti + TILE < n4 ? ti + TILE : n4;
+
+		for (size_t tj = ti; tj < n4; tj += TILE) {
+			size_t j1 = tj + TILE < n4 ? tj + TILE : n4;
+
+			for (size_t i = ti; i < i1; i += 4) {
+				for (size_t j = tj == ti ? i : tj; j < j1; j += 4) {
+					t->swap(t->a + i * n + j, t->a + j * n + i, n);
+				}
+			}
+		}
+	}
+}
+
+void
+kernel_transpose_square(double *a, size_t n)
+{
+	struct square_job job = { a, n, swap_blocks_scalar };
+	size_t n4 = n & ~(size_t)3;
+
+#ifdef HAVE_AVX_TRANSPOSE
+	if (have_avx()) {
+		job.swap = swap_blocks_avx;
+	}
+#endif
+	parallel_for((n4 + TILE - 1) / TILE, SQUARE_GRAIN, transpose_square_rows, &job);
+
+	/* the last n % 4 columns against the last n % 4 rows */
+	for (size_t r = 0; r < n; ++r) {
+		for (size_t c = r + 1 > n4 ? r + 1 : n4; c < n; ++c) {
+			double tmp = a[r * n + c];
+
+			a[r * n + c] = a[c * n + r];
+			a[c * n + r] = tmp;
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#!/usr/bin/env bash
+# Distributed multiply on localhost: for 1 .. MAX_WORKERS workers, start
+# that many plain servers and a coordinator (--workers), check an odd-shaped
+# product against the local kernel and time an N x N x N one. Worker count
+# 0 is a plain server computing locally, the baseline for the speedup.
+# Every server gets one kernel thread, so on a machine with at least
+# MAX_WORKERS + 1 cores the speedup shows how the multiply scales with
+# worker processes.
+#
+#   ./tests/run_distributed.sh [max_workers] [n] [base_port]
+set -euo pipefail
+
+SCRIPT_DIR=$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)
+PROJECT_ROOT=$(cd "${SCRIPT_DIR}/.." && pwd)
+SERVER_BIN="${PROJECT_ROOT}/matrixOp_server"
+BENCH_BIN="${PROJECT_ROOT}/bench/distribute_bench"
+
+MAX_WORKERS=${1:-4}
+N=${2:-1536}
+BASE_PORT=${3:-46200}
+
+if [[ ! -x "${SERVER_BIN}" || ! -x "${BENCH_BIN}" ]]; then
+  echo "Please build the server and the benchmarks (make -f Makefile.matrixOp all bench) first." >&2
+  exit 1
+fi
+
+LOG_DIR=$(mktemp -d)
+PIDS=()
+
+stop_servers() {
+  if [[ ${#PIDS[@]} -gt 0 ]]; then
+    kill "${PIDS[@]}" >/dev/null 2>&1 || true
+    wait "${PIDS[@]}" 2>/dev/null || true
+  fi
+  PIDS=()
+}
+
+cleanup() {
+  stop_servers
+  rm -rf "${LOG_DIR}"
+}
+trap cleanup EXIT
+
+# start_servers K: K workers on BASE_PORT+1 .. BASE_PORT+K, coordinator on BASE_PORT
+start_servers() {
+  local k=$1 list="" i
+  for ((i = 1; i <= k; i++)); do
+    "${SERVER_BIN}" --port $((BASE_PORT + i)) --kernel-threads 1 --cache-mb 0 \
+      >"${LOG_DIR}/worker$i.log" 2>&1 &
+    PIDS+=($!)
+    list+="${list:+,}localhost:$((BASE_PORT + i))"
+  done
+  "${SERVER_BIN}" --port "${BASE_PORT}" --kernel-threads 1 --cache-mb 0 \
+    ${list:+--workers "${list}"} >"${LOG_DIR}/coordinator.log" 2>&1 &
+  PIDS+=($!)
+  sleep 0.5
+}
+
+base_ms=""
+printf "%8s %12s %10s %8s\n" "workers" "best ms" "GFLOP/s" "speedup"
+for ((k = 0; k <= MAX_WORKERS; k++)); do
+  start_servers "$k"
+  # rows, inner and columns all uneven across the blocks
+  "${BENCH_BIN}" 127.0.0.1 "${BASE_PORT}" 523 611 487 1 >/dev/null
+  line=$("${BENCH_BIN}" 127.0.0.1 "${BASE_PORT}" "$N" "$N" "$N" 3)
+  stop_servers
+  if [[ $k -gt 0 ]] && ! grep -q "multiplies on $k workers, 0 blocks computed locally" "${LOG_DIR}/coordinator.log"; then
+    echo "coordinator with $k workers did not distribute:" >&2
+    cat "${LOG_DIR}/coordinator.log" >&2
+    exit 1
+  fi
+  ms=$(sed -n 's/.*best \([0-9.]*\) ms.*/\1/p' <<<"$line")
+  gflops=$(sed -n 's/.* \([0-9.]*\) GFLOP\/s.*/\1/p' <<<"$line")
+  base_ms=${base_ms:-$ms}
+  awk -v k="$k" -v ms="$ms" -v g="$gflops" -v base="$base_ms" \
+    'BEGIN { printf "%8d %12s %10s %7.2fx\n", k, ms, g, base / ms }'
+done
+echo "All distributed products matched the local kernel."
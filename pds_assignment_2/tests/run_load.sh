@@ -0,0 +1,51 @@
+#!/usr/bin/env bash
+# Benchmark mode of the client against a fresh local server: every
+# operation at two inline sizes and one size that goes through handles,
+# from CONNECTIONS connections for SECONDS seconds. The report is written
+# to OUTPUT (CSV, or JSON if the name ends in .json) for comparing runs;
+# the script fails if any call failed. The server runs without the result
+# cache so repeated operands are computed every time.
+#
+#   ./tests/run_load.sh [seconds] [connections] [output] [port]
+set -euo pipefail
+
+SCRIPT_DIR=$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)
+PROJECT_ROOT=$(cd "${SCRIPT_DIR}/.." && pwd)
+SERVER_BIN="${PROJECT_ROOT}/matrixOp_server"
+CLIENT_BIN="${PROJECT_ROOT}/matrixOp_client"
+
+SECONDS_TO_RUN=${1:-5}
+CONNECTIONS=${2:-4}
+OUTPUT=${3:-load.csv}
+PORT=${4:-46300}
+
+if [[ ! -x "${SERVER_BIN}" || ! -x "${CLIENT_BIN}" ]]; then
+  echo "Please build the server and client binaries before running this script." >&2
+  exit 1
+fi
+
+FORMAT=csv
+if [[ "${OUTPUT}" == *.json ]]; then
+  FORMAT=json
+fi
+
+SERVER_LOG=$(mktemp)
+
+cleanup() {
+  if [[ -n "${SERVER_PID:-}" ]]; then
+    kill "${SERVER_PID}" >/dev/null 2>&1 || true
+    wait "${SERVER_PID}" 2>/dev/null || true
+  fi
+  rm -f "${SERVER_LOG}"
+}
+trap cleanup EXIT
+
+"${SERVER_BIN}" --port "${PORT}" --cache-mb 0 >"${SERVER_LOG}" 2>&1 &
+SERVER_PID=$!
+sleep 0.5
+
+"${CLIENT_BIN}" 127.0.0.1 "${PORT}" --bench --duration "${SECONDS_TO_RUN}" \
+  --connections "${CONNECTIONS}" --sizes 8,20,256 \
+  --mix add,subtract,hadamard,scale,axpy,multiply,transpose,inverse \
+  --format "${FORMAT}" --output "${OUTPUT}"
+echo "Report written to ${OUTPUT}"
@@ -17,13 +17,15 @@ if ! pgrep -x rpcbind >/dev/null 2>&1; then
 fi
 
 TEMP_OUTPUT=$(mktemp)
+TEMP_SHM=$(mktemp)
+TEMP_HANDLE=$(mktemp)
 SERVER_LOG=$(mktemp)
 
 cleanup() {
   if [[ -n "${SERVER_PID:-}" ]]; then
     kill "${SERVER_PID}" >/dev/null 2>&1 || true
   fi
-  rm -f "${TEMP_OUTPUT}" "${SERVER_LOG}"
+  rm -f "${TEMP_OUTPUT}" "${TEMP_SHM}" "${TEMP_HANDLE}" "${SERVER_LOG}"
 }
 trap cleanup EXIT
 
@@ -47,4 +49,15 @@ cat <<'EOF' | "${CLIENT_BIN}" localhost | tee "${TEMP_OUTPUT}"
 0
 EOF
 
+# 420 elements: too large for version 1. On this host the client uses
+# shared memory (version 4); MATRIXOP_NO_SHM makes it take the chunked
+# upload / handle / download path of version 2 instead. Both must agree.
+{ echo 3; echo "21 20"; seq 1 420; echo 0; } | "${CLIENT_BIN}" localhost | tee "${TEMP_SHM}"
+{ echo 3; echo "21 20"; seq 1 420; echo 0; } | MATRIXOP_NO_SHM=1 "${CLIENT_BIN}" localhost | tee "${TEMP_HANDLE}"
+cat "${TEMP_SHM}" "${TEMP_HANDLE}" >>"${TEMP_OUTPUT}"
+if ! cmp -s "${TEMP_SHM}" "${TEMP_HANDLE}"; then
+  echo "Shared-memory and version 2 transposes differ." >&2
+  exit 1
+fi
+
 echo "Client interaction transcript saved to ${TEMP_OUTPUT}"